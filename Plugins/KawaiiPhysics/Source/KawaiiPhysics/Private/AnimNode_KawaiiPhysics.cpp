@@ -3,12 +3,24 @@
 #include "AnimNode_KawaiiPhysics.h"
 
 #include "AnimationRuntime.h"
+#include "KawaiiPhysics.h"
+#include "KawaiiPhysicsBakedMotionDataAsset.h"
 #include "KawaiiPhysicsBoneConstraintsDataAsset.h"
+#include "KawaiiPhysicsCapture.h"
+#include "KawaiiPhysicsRestStateDataAsset.h"
 #include "KawaiiPhysicsCustomExternalForce.h"
+#include "KawaiiPhysicsDistanceFieldDataAsset.h"
 #include "KawaiiPhysicsExternalForce.h"
 #include "KawaiiPhysicsLimitsDataAsset.h"
+#include "KawaiiPhysicsSolver.h"
+#include "KawaiiPhysicsSharedContextComponent.h"
+#include "KawaiiPhysicsSubsystem.h"
 #include "Animation/AnimInstanceProxy.h"
 #include "Curves/CurveFloat.h"
+#include "Engine/SkeletalMesh.h"
+#include "GameFramework/Actor.h"
+#include "Misc/ScopeExit.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
 #include "Runtime/Launch/Resources/Version.h"
 #include "SceneInterface.h"
 #include "PhysicsEngine/PhysicsAsset.h"
@@ -30,6 +42,9 @@ TAutoConsoleVariable<bool> CVarAnimNodeKawaiiPhysicsDebug(
 TAutoConsoleVariable<bool> CVarAnimNodeKawaiiPhysicsDebugLengthRate(
 	TEXT("a.AnimNode.KawaiiPhysics.Debug.LengthRate"), false,
 	TEXT("Turn on visualization debugging for KawaiiPhysics Bone's LengthRate"));
+TAutoConsoleVariable<bool> CVarAnimNodeKawaiiPhysicsDebugBoneConstraintMetrics(
+	TEXT("a.AnimNode.KawaiiPhysics.Debug.BoneConstraintMetrics"), false,
+	TEXT("Measure the convergence of KawaiiPhysics bone constraints outside the editor"));
 #endif
 
 DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_InitModifyBones"), STAT_KawaiiPhysics_InitModifyBones, STATGROUP_Anim);
@@ -39,14 +54,289 @@ DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_Simulate"), STAT_KawaiiPhysics_Simulate,
 DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_GetWindVelocity"), STAT_KawaiiPhysics_GetWindVelocity, STATGROUP_Anim);
 DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_WorldCollision"), STAT_KawaiiPhysics_WorldCollision, STATGROUP_Anim);
 DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_AdjustByCollision"), STAT_KawaiiPhysics_AdjustByCollision, STATGROUP_Anim);
-DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_AdjustByBoneConstraint"), STAT_KawaiiPhysics_AdjustByBoneConstraint,
-                   STATGROUP_Anim);
 DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_UpdateSphericalLimit"), STAT_KawaiiPhysics_UpdateSphericalLimit, STATGROUP_Anim);
 DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_UpdatePlanerLimit"), STAT_KawaiiPhysics_UpdatePlanerLimit, STATGROUP_Anim);
 DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_WarmUp"), STAT_KawaiiPhysics_WarmUp, STATGROUP_Anim);
+DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_InitBoneConstraints"), STAT_KawaiiPhysics_InitBoneConstraints, STATGROUP_Anim);
+DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_BuildChainTemplate"), STAT_KawaiiPhysics_BuildChainTemplate, STATGROUP_Anim);
 DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_UpdatePhysicsSetting"), STAT_KawaiiPhysics_UpdatePhysicsSetting, STATGROUP_Anim);
 DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_UpdateCapsuleLimit"), STAT_KawaiiPhysics_UpdateCapsuleLimit, STATGROUP_Anim);
 DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_UpdateBoxLimit"), STAT_KawaiiPhysics_UpdateBoxLimit, STATGROUP_Anim);
+DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_UpdateDistanceFieldLimit"), STAT_KawaiiPhysics_UpdateDistanceFieldLimit,
+                   STATGROUP_Anim);
+DECLARE_DWORD_COUNTER_STAT(TEXT("KawaiiPhysics_ActiveChains"), STAT_KawaiiPhysics_ActiveChains, STATGROUP_Anim);
+DECLARE_DWORD_COUNTER_STAT(TEXT("KawaiiPhysics_DormantChains"), STAT_KawaiiPhysics_DormantChains, STATGROUP_Anim);
+
+void FKawaiiPhysicsSolverState::Reset()
+{
+	Locations.Reset();
+	PrevLocations.Reset();
+	PoseLocations.Reset();
+	PoseRotations.Reset();
+	PoseScales.Reset();
+	PrevRotations.Reset();
+	ParentIndices.Reset();
+	Radii.Reset();
+	Dampings.Reset();
+	Stiffnesses.Reset();
+	WorldDampingLocations.Reset();
+	WorldDampingRotations.Reset();
+	LimitAngles.Reset();
+	bDummies.Reset();
+	bHasBones.Reset();
+	bSkipSimulates.Reset();
+	bDormants.Reset();
+	BoneConstraintLambdas.Reset();
+	BoneConstraintCorrections.Reset();
+	BoneConstraintCorrectionCounts.Reset();
+}
+
+void FKawaiiPhysicsSolverState::Build(const TArray<FKawaiiPhysicsModifyBone>& ModifyBones)
+{
+	const int32 NumBones = ModifyBones.Num();
+
+	Locations.SetNumUninitialized(NumBones);
+	PrevLocations.SetNumUninitialized(NumBones);
+	PoseLocations.SetNumUninitialized(NumBones);
+	PoseRotations.SetNumUninitialized(NumBones);
+	PoseScales.SetNumUninitialized(NumBones);
+	PrevRotations.SetNumUninitialized(NumBones);
+	ParentIndices.SetNumUninitialized(NumBones);
+	Radii.SetNumUninitialized(NumBones);
+	Dampings.SetNumUninitialized(NumBones);
+	Stiffnesses.SetNumUninitialized(NumBones);
+	WorldDampingLocations.SetNumUninitialized(NumBones);
+	WorldDampingRotations.SetNumUninitialized(NumBones);
+	LimitAngles.SetNumUninitialized(NumBones);
+	bDummies.SetNumUninitialized(NumBones);
+	bHasBones.SetNumUninitialized(NumBones);
+	bSkipSimulates.SetNumUninitialized(NumBones);
+
+	for (int32 i = 0; i < NumBones; ++i)
+	{
+		const FKawaiiPhysicsModifyBone& ModifyBone = ModifyBones[i];
+
+		Locations[i] = ModifyBone.Location;
+		PrevLocations[i] = ModifyBone.PrevLocation;
+		PoseLocations[i] = ModifyBone.PoseLocation;
+		PoseRotations[i] = ModifyBone.PoseRotation;
+		PoseScales[i] = ModifyBone.PoseScale;
+		PrevRotations[i] = ModifyBone.PrevRotation;
+		ParentIndices[i] = ModifyBone.ParentIndex;
+		bDummies[i] = ModifyBone.bDummy;
+		bHasBones[i] = ModifyBone.BoneRef.BoneIndex >= 0;
+		bSkipSimulates[i] = ModifyBone.bSkipSimulate;
+		SetPhysicsSettings(i, ModifyBone.PhysicsSettings);
+	}
+}
+
+void FKawaiiPhysicsSolverState::SetPhysicsSettings(int32 Index, const FKawaiiPhysicsSettings& Settings)
+{
+	Radii[Index] = Settings.Radius;
+	Dampings[Index] = Settings.Damping;
+	Stiffnesses[Index] = Settings.Stiffness;
+	WorldDampingLocations[Index] = Settings.WorldDampingLocation;
+	WorldDampingRotations[Index] = Settings.WorldDampingRotation;
+	LimitAngles[Index] = Settings.LimitAngle;
+}
+
+void FKawaiiPhysicsSolverState::WriteToModifyBone(int32 Index, FKawaiiPhysicsModifyBone& ModifyBone) const
+{
+	ModifyBone.Location = Locations[Index];
+	ModifyBone.PrevLocation = PrevLocations[Index];
+	ModifyBone.PoseLocation = PoseLocations[Index];
+	ModifyBone.PoseRotation = PoseRotations[Index];
+	ModifyBone.PoseScale = PoseScales[Index];
+	ModifyBone.PrevRotation = PrevRotations[Index];
+	ModifyBone.bSkipSimulate = bSkipSimulates[Index];
+}
+
+namespace
+{
+	/** Evaluations between searches of every baked clip while no baked frame matches the pose */
+	constexpr int32 BakedMotionSearchInterval = 10;
+
+	/** Largest magnitude of the three smallest components of a normalized quaternion */
+	constexpr float SmallestThreeRange = 0.70710678f;
+	constexpr uint32 SmallestThreeMax = (1 << 10) - 1;
+
+	uint32 PackSmallestThree(const FQuat& Rotation)
+	{
+		const FQuat Normalized = Rotation.GetNormalized();
+		const double Components[4] = {Normalized.X, Normalized.Y, Normalized.Z, Normalized.W};
+		int32 Largest = 0;
+		for (int32 i = 1; i < 4; ++i)
+		{
+			if (FMath::Abs(Components[i]) > FMath::Abs(Components[Largest]))
+			{
+				Largest = i;
+			}
+		}
+
+		// q and -q are the same rotation, so the largest component is always made positive and left out
+		const double Sign = Components[Largest] < 0.0 ? -1.0 : 1.0;
+		uint32 Packed = Largest;
+		int32 Shift = 2;
+		for (int32 i = 0; i < 4; ++i)
+		{
+			if (i != Largest)
+			{
+				const double Unit = Components[i] * Sign / SmallestThreeRange * 0.5 + 0.5;
+				Packed |= static_cast<uint32>(FMath::Clamp(FMath::RoundToInt(Unit * SmallestThreeMax), 0,
+				                                           static_cast<int32>(SmallestThreeMax))) << Shift;
+				Shift += 10;
+			}
+		}
+		return Packed;
+	}
+
+	FQuat UnpackSmallestThree(uint32 Packed)
+	{
+		double Components[4];
+		const int32 Largest = Packed & 3;
+		int32 Shift = 2;
+		double SumSquared = 0.0;
+		for (int32 i = 0; i < 4; ++i)
+		{
+			if (i != Largest)
+			{
+				const double Unit = static_cast<double>((Packed >> Shift) & SmallestThreeMax) / SmallestThreeMax;
+				Components[i] = (Unit * 2.0 - 1.0) * SmallestThreeRange;
+				SumSquared += Components[i] * Components[i];
+				Shift += 10;
+			}
+		}
+		Components[Largest] = FMath::Sqrt(FMath::Max(0.0, 1.0 - SumSquared));
+		return FQuat(Components[0], Components[1], Components[2], Components[3]).GetNormalized();
+	}
+
+	/** Root bone of the chain of each bone. Bones are parent-sorted, so the root of the parent is already known */
+	void CalcChainRoots(const FKawaiiPhysicsSolverState& State, TArray<int32>& OutRoots)
+	{
+		OutRoots.SetNumUninitialized(State.ParentIndices.Num());
+		for (int32 i = 0; i < State.ParentIndices.Num(); ++i)
+		{
+			const int32 ParentIndex = State.ParentIndices[i];
+			OutRoots[i] = ParentIndex < 0 ? i : OutRoots[ParentIndex];
+		}
+	}
+
+	uint32 HashCurve(const FRuntimeFloatCurve& Curve, uint32 Hash)
+	{
+		const FRichCurve& RichCurve = *Curve.GetRichCurveConst();
+		Hash = HashCombine(Hash, GetTypeHash(RichCurve.DefaultValue));
+		Hash = HashCombine(Hash, GetTypeHash(RichCurve.PreInfinityExtrap.GetValue()));
+		Hash = HashCombine(Hash, GetTypeHash(RichCurve.PostInfinityExtrap.GetValue()));
+		for (const FRichCurveKey& Key : RichCurve.GetConstRefOfKeys())
+		{
+			Hash = HashCombine(Hash, GetTypeHash(Key.Time));
+			Hash = HashCombine(Hash, GetTypeHash(Key.Value));
+			Hash = HashCombine(Hash, GetTypeHash(Key.ArriveTangent));
+			Hash = HashCombine(Hash, GetTypeHash(Key.LeaveTangent));
+			Hash = HashCombine(Hash, GetTypeHash(Key.InterpMode.GetValue()));
+			Hash = HashCombine(Hash, GetTypeHash(Key.TangentMode.GetValue()));
+		}
+		return Hash;
+	}
+}
+
+void FKawaiiPhysicsCompactSolverState::Pack(FKawaiiPhysicsSolverState& State,
+                                            EKawaiiPhysicsCompactPrecision Precision)
+{
+	Reset();
+
+	const int32 NumBones = State.Num();
+	TArray<int32> Roots;
+	CalcChainRoots(State, Roots);
+
+	auto GetOffset = [&State, &Roots, NumBones](int32 i)
+	{
+		return i < NumBones
+			       ? State.Locations[i] - State.PoseLocations[Roots[i]]
+			       : State.PrevLocations[i - NumBones] - State.PoseLocations[Roots[i - NumBones]];
+	};
+
+	if (Precision == EKawaiiPhysicsCompactPrecision::Quantized16)
+	{
+		double MaxOffset = 0.0;
+		for (int32 i = 0; i < NumBones * 2; ++i)
+		{
+			MaxOffset = FMath::Max(MaxOffset, GetOffset(i).GetAbsMax());
+		}
+		constexpr int32 QuantizedMax = MAX_int16;
+		QuantizationStep = FMath::Max(static_cast<float>(MaxOffset / QuantizedMax), UE_SMALL_NUMBER);
+
+		QuantizedOffsets.SetNumUninitialized(NumBones * 2);
+		for (int32 i = 0; i < NumBones * 2; ++i)
+		{
+			const FVector Quantized = GetOffset(i) / QuantizationStep;
+			QuantizedOffsets[i] = {
+				static_cast<int16>(FMath::Clamp(FMath::RoundToInt(Quantized.X), -QuantizedMax, QuantizedMax)),
+				static_cast<int16>(FMath::Clamp(FMath::RoundToInt(Quantized.Y), -QuantizedMax, QuantizedMax)),
+				static_cast<int16>(FMath::Clamp(FMath::RoundToInt(Quantized.Z), -QuantizedMax, QuantizedMax))
+			};
+		}
+	}
+	else
+	{
+		Offsets.SetNumUninitialized(NumBones * 2);
+		for (int32 i = 0; i < NumBones * 2; ++i)
+		{
+			Offsets[i] = FVector3f(GetOffset(i));
+		}
+	}
+
+	PrevRotations.SetNumUninitialized(NumBones);
+	for (int32 i = 0; i < NumBones; ++i)
+	{
+		PrevRotations[i] = PackSmallestThree(State.PrevRotations[i]);
+	}
+
+	State.Locations.Empty();
+	State.PrevLocations.Empty();
+	State.PrevRotations.Empty();
+	State.BoneConstraintCorrections.Empty();
+	State.BoneConstraintCorrectionCounts.Empty();
+}
+
+void FKawaiiPhysicsCompactSolverState::Unpack(FKawaiiPhysicsSolverState& State)
+{
+	const int32 NumBones = Num();
+	check(State.ParentIndices.Num() == NumBones);
+	TArray<int32> Roots;
+	CalcChainRoots(State, Roots);
+
+	auto GetOffset = [this](int32 i)
+	{
+		if (QuantizedOffsets.Num() > 0)
+		{
+			const FQuantizedOffset& Quantized = QuantizedOffsets[i];
+			return FVector(Quantized.X, Quantized.Y, Quantized.Z) * QuantizationStep;
+		}
+		return FVector(Offsets[i]);
+	};
+
+	State.Locations.SetNumUninitialized(NumBones);
+	State.PrevLocations.SetNumUninitialized(NumBones);
+	State.PrevRotations.SetNumUninitialized(NumBones);
+	for (int32 i = 0; i < NumBones; ++i)
+	{
+		const FVector& RootLocation = State.PoseLocations[Roots[i]];
+		State.Locations[i] = RootLocation + GetOffset(i);
+		State.PrevLocations[i] = RootLocation + GetOffset(NumBones + i);
+		State.PrevRotations[i] = UnpackSmallestThree(PrevRotations[i]);
+	}
+
+	Reset();
+}
+
+void FKawaiiPhysicsCompactSolverState::Reset()
+{
+	Offsets.Empty();
+	QuantizedOffsets.Empty();
+	QuantizationStep = 0.0f;
+	PrevRotations.Empty();
+}
 
 FAnimNode_KawaiiPhysics::FAnimNode_KawaiiPhysics()
 	: DeltaTime(0)
@@ -67,9 +357,48 @@ void FAnimNode_KawaiiPhysics::Initialize_AnyThread(const FAnimationInitializeCon
 
 	ApplyLimitsDataAsset(RequiredBones);
 	ApplyPhysicsAsset(RequiredBones);
-	ApplyBoneConstraintDataAsset(RequiredBones);
+	// Shared chains only need the bone constraint data asset when their template is built
+	if (bShareChainTemplate)
+	{
+		BoneConstraintsData.Empty();
+	}
+	else
+	{
+		ApplyBoneConstraintDataAsset(RequiredBones);
+	}
+#if WITH_EDITOR
+	AppliedLimitsDataAsset.Update(LimitsDataAsset, LimitsDataAsset ? LimitsDataAsset->GetRevision() : 0,
+	                              RequiredBones);
+	AppliedPhysicsAsset.Update(PhysicsAssetForLimits, FKawaiiPhysicsModule::GetPhysicsAssetRevision(),
+	                           RequiredBones);
+	// Shared chains take the constraints of the data asset from their template, so only the revision is recorded
+	AppliedBoneConstraintsDataAsset.Update(BoneConstraintsDataAsset,
+	                                       BoneConstraintsDataAsset ? BoneConstraintsDataAsset->GetRevision() : 0,
+	                                       RequiredBones);
+#endif
 
 	ModifyBones.Empty();
+	ModifyBoneIndexMap.Reset();
+	ChainTemplate.Reset();
+	SolverState.Reset();
+	CompactSolverState.Reset();
+	BakedMotionClipsAsset = nullptr;
+	BatchJob.Reset();
+	WorldCollisionBatches.Reset();
+	bModifyBonesViewDirty = false;
+
+	LODTier = EKawaiiPhysicsLODTier::Full;
+	FixedTimestepAccumulator = 0.0f;
+	LODAccumulatedDeltaTime = 0.0f;
+	LODFramesSinceStep = 0;
+	bDeferredByBoneBudget = false;
+	InterpolationFromOffsets.Reset();
+	InterpolationToOffsets.Reset();
+	bUseInterpolatedLocations = false;
+	RemainingWarmUpFrames = 0;
+	BoneSleepChains.Reset();
+	bSkelCompTeleported = false;
+	TraceScopeName.Reset();
 
 	// For Avoiding Zero Divide in the first frame
 	DeltaTimeOld = 1.0f / TargetFramerate;
@@ -131,12 +460,12 @@ void FAnimNode_KawaiiPhysics::AnimDrawDebug(const FComponentSpacePoseContext& Ou
 				const auto AnimInstanceProxy = Output.AnimInstanceProxy;
 
 				// Modify Bones
-				for (const auto& ModifyBone : ModifyBones)
+				for (int32 i = 0; i < SolverState.Num(); ++i)
 				{
 					const FVector LocationWS = AnimInstanceProxy->GetComponentTransform().TransformPosition(
-						ModifyBone.Location);
-					auto Color = ModifyBone.bDummy ? FColor::Red : FColor::Yellow;
-					AnimInstanceProxy->AnimDrawDebugSphere(LocationWS, ModifyBone.PhysicsSettings.Radius, 8,
+						SolverState.Locations[i]);
+					auto Color = SolverState.bDummies[i] ? FColor::Red : FColor::Yellow;
+					AnimInstanceProxy->AnimDrawDebugSphere(LocationWS, SolverState.Radii[i], 8,
 					                                       Color, false, -1, 0, SDPG_Foreground);
 
 #if	ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION >= 3
@@ -145,8 +474,8 @@ void FAnimNode_KawaiiPhysics::AnimDrawDebug(const FComponentSpacePoseContext& Ou
 					if (CVarAnimNodeKawaiiPhysicsDebugLengthRate.GetValueOnAnyThread())
 					{
 						AnimInstanceProxy->AnimDrawDebugInWorldMessage(
-							FString::Printf(TEXT("%.2f"), ModifyBone.LengthRateFromRoot),
-							ModifyBone.Location, FColor::White, 1.0f);
+							FString::Printf(TEXT("%.2f"), ModifyBones[i].LengthRateFromRoot),
+							SolverState.Locations[i], FColor::White, 1.0f);
 					}
 #endif
 				}
@@ -218,11 +547,45 @@ void FAnimNode_KawaiiPhysics::EvaluateSkeletalControl_AnyThread(FComponentSpaceP
 {
 	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_Eval);
 
+	if (TraceScopeName.IsEmpty())
+	{
+		UpdateTraceNames(Output.AnimInstanceProxy->GetSkelMeshComponent());
+	}
+	if (!CaptureWriter)
+	{
+		CaptureWriter = FKawaiiPhysicsCaptureWriter::CreateIfRequested(CaptureRequestSerial, TraceScopeName);
+	}
+#if KAWAIIPHYSICS_TRACE_ENABLED
+	TRACE_CPUPROFILER_EVENT_SCOPE_TEXT_ON_CHANNEL(*TraceScopeName, KawaiiPhysicsChannel);
+#endif
+
+	// Counters for Unreal Insights and the CSV profiler, sent on every return
+	bRecordEvaluationStats = KawaiiPhysicsTrace::IsRecording();
+	const uint64 EvaluationStartCycle = bRecordEvaluationStats ? FPlatformTime::Cycles64() : 0;
+	EvaluationStats = FKawaiiPhysicsEvaluationStats();
+	ON_SCOPE_EXIT
+	{
+		if (bRecordEvaluationStats)
+		{
+			OutputEvaluationStats(EvaluationStartCycle);
+		}
+	};
+
 	check(OutBoneTransforms.Num() == 0);
 
 	if (bResetDynamics)
 	{
 		ModifyBones.Empty(ModifyBones.Num());
+		SolverState.Reset();
+		CompactSolverState.Reset();
+		BakedMotionClipsAsset = nullptr;
+		BatchJob.Reset();
+		WorldCollisionBatches.Reset();
+		FixedTimestepAccumulator = 0.0f;
+		InterpolationFromOffsets.Reset();
+		InterpolationToOffsets.Reset();
+		RemainingWarmUpFrames = 0;
+		BoneSleepChains.Reset();
 		bResetDynamics = false;
 		bInitPhysicsSettings = false;
 	}
@@ -231,13 +594,34 @@ void FAnimNode_KawaiiPhysics::EvaluateSkeletalControl_AnyThread(FComponentSpaceP
 	FTransform ComponentTransform = Output.AnimInstanceProxy->GetComponentTransform();
 
 #if WITH_EDITOR
-	// sync editing on other Nodes
-	ApplyLimitsDataAsset(BoneContainer);
-	ApplyPhysicsAsset(BoneContainer);
-	ApplyBoneConstraintDataAsset(BoneContainer);
-
+	// sync editing on other Nodes. Only the assets that changed since they were last applied
+	if (AppliedLimitsDataAsset.Update(LimitsDataAsset, LimitsDataAsset ? LimitsDataAsset->GetRevision() : 0,
+	                                  BoneContainer))
+	{
+		ApplyLimitsDataAsset(BoneContainer);
+	}
+	if (AppliedPhysicsAsset.Update(PhysicsAssetForLimits, FKawaiiPhysicsModule::GetPhysicsAssetRevision(),
+	                               BoneContainer))
+	{
+		ApplyPhysicsAsset(BoneContainer);
+	}
+	if (AppliedBoneConstraintsDataAsset.Update(BoneConstraintsDataAsset,
+	                                           BoneConstraintsDataAsset
+		                                           ? BoneConstraintsDataAsset->GetRevision()
+		                                           : 0, BoneContainer))
+	{
+		if (ChainTemplate)
+		{
+			// The template holds the constraints of the old revision. Look up the one of the new revision
+			bResetDynamics = true;
+		}
+		else
+		{
+			ApplyBoneConstraintDataAsset(BoneContainer);
+		}
+	}
 
-	if (GUnrealEd && !GUnrealEd->IsPlayingSessionInEditor())
+	if (bBoneReferencesDirty && GUnrealEd && !GUnrealEd->IsPlayingSessionInEditor())
 	{
 		// for live editing ( sync before compile )
 		InitializeBoneReferences(BoneContainer);
@@ -263,9 +647,38 @@ void FAnimNode_KawaiiPhysics::EvaluateSkeletalControl_AnyThread(FComponentSpaceP
 		InitBoneConstraints();
 		PreSkelCompTransform = ComponentTransform;
 	}
+	else if (CompactSolverState.IsPacked() ? CompactSolverState.Num() != ModifyBones.Num()
+	                                       : SolverState.Num() != ModifyBones.Num())
+	{
+		// ModifyBones was replaced from outside the solver (e.g. Blueprint)
+		DetachChainTemplate();
+		CompactSolverState.Reset();
+		BakedMotionClipsAsset = nullptr;
+		if (SortModifyBonesInParentOrder())
+		{
+			SolverState.Build(ModifyBones);
+			BuildModifyBoneIndexMap();
+			bCompactPoseIndicesDirty = true;
+			BoneSleepChains.Reset();
+			bInitPhysicsSettings = false;
+		}
+		else
+		{
+			UE_LOG(LogKawaiiPhysics, Warning,
+			       TEXT("KawaiiPhysics: ModifyBones has an invalid parent index or a parent cycle. "
+				       "Rebuilding the modify bones from RootBone."));
+			InitModifyBones(Output, BoneContainer);
+			InitBoneConstraints();
+			PreSkelCompTransform = ComponentTransform;
+			bInitPhysicsSettings = false;
+		}
+	}
 
 	// Update each parameters and collision
-	if (!bInitPhysicsSettings || bUpdatePhysicsSettingsInGame)
+	// The per-bone settings are baked from the curves, so they only need to be recalculated when an input changed
+	if (!bInitPhysicsSettings ||
+		(bUpdatePhysicsSettingsInGame && (bPhysicsSettingsDirty || !BakedPhysicsSettings.Equals(PhysicsSettings) ||
+			CalcCurveDataHash() != BakedCurveDataHash)))
 	{
 		UpdatePhysicsSettingsOfModifyBones();
 
@@ -284,21 +697,75 @@ void FAnimNode_KawaiiPhysics::EvaluateSkeletalControl_AnyThread(FComponentSpaceP
 	UpdateBoxLimits(BoxLimitsData, Output, BoneContainer, ComponentTransform);
 	UpdatePlanerLimits(PlanarLimits, Output, BoneContainer, ComponentTransform);
 	UpdatePlanerLimits(PlanarLimitsData, Output, BoneContainer, ComponentTransform);
+	UpdateDistanceFieldLimits(DistanceFieldLimits, Output, BoneContainer, ComponentTransform);
+	PackedLimits.Build(SphericalLimits, SphericalLimitsData, CapsuleLimits, CapsuleLimitsData, BoxLimits,
+	                   BoxLimitsData, PlanarLimits, PlanarLimitsData, DistanceFieldLimits);
+	if (SharedContext)
+	{
+		if (bPublishSharedLimits)
+		{
+			SharedContext->PublishLimits(this, PackedLimits, ComponentTransform);
+		}
+		else
+		{
+			SharedContext->AppendSharedLimits(PackedLimits, ComponentTransform);
+		}
+	}
 
 	// Update Bone Pose Transform
 	UpdateModifyBonesPoseTransform(Output, BoneContainer);
+	if (bEnableWind)
+	{
+		UpdateWindSampleBounds();
+	}
+
+	// Simulation LOD. Frozen nodes leave the animated pose as is
+	const bool bSimulate = UpdateSimulationLOD(ComponentTransform);
+	if (LODTier != EKawaiiPhysicsLODTier::Frozen)
+	{
+		// Fixed timestep. The movement of the component is kept until a frame simulates at least one substep
+		const int32 NumSubsteps = bSimulate ? ConsumeFixedTimesteps() : 0;
+		if (NumSubsteps > 0)
+		{
+			// Update SkeletalMeshComponent movement in World Space
+			UpdateSkelCompMove(ComponentTransform);
+
+			if (SleepSettings.bEnable)
+			{
+				WakeDormantChains();
+			}
 
-	// Update SkeletalMeshComponent movement in World Space
-	UpdateSkelCompMove(ComponentTransform);
+			// Simulate Physics and Apply
+			if (bNeedWarmUp && (WarmUpFrames > 0 || RestStateDataAsset))
+			{
+				// A settled snapshot replaces the warm up
+				RemainingWarmUpFrames = RestoreRestState(BoneContainer.GetSkeletonAsset()) ? 0 : WarmUpFrames;
+				bNeedWarmUp = false;
+			}
+			if (RemainingWarmUpFrames > 0)
+			{
+				WarmUp(Output, BoneContainer, ComponentTransform);
+			}
+			SimulateSubsteps(Output, ComponentTransform, NumSubsteps);
+		}
+		UpdateInterpolatedLocations(NumSubsteps > 0);
 
-	// Simulate Physics and Apply
-	if (bNeedWarmUp && WarmUpFrames > 0)
+		// Keep the animated pose until the warm up spread over several evaluations is done
+		if (RemainingWarmUpFrames == 0)
+		{
+			ApplySimulateResult(BoneContainer, OutBoneTransforms);
+#if WITH_EDITOR
+			if (bRecordingBakedMotion)
+			{
+				RecordBakedMotionFrame(Output.AnimInstanceProxy->GetDeltaSeconds());
+			}
+#endif
+		}
+	}
+	else if (PlayBakedMotion(BoneContainer.GetSkeletonAsset()))
 	{
-		WarmUp(Output, BoneContainer, ComponentTransform);
-		bNeedWarmUp = false;
+		ApplySimulateResult(BoneContainer, OutBoneTransforms);
 	}
-	SimulateModifyBones(Output, ComponentTransform);
-	ApplySimulateResult(Output, BoneContainer, OutBoneTransforms);
 
 #if ENABLE_ANIM_DEBUG
 
@@ -338,11 +805,10 @@ bool FAnimNode_KawaiiPhysics::IsValidToEvaluate(const USkeleton* Skeleton, const
 
 bool FAnimNode_KawaiiPhysics::HasPreUpdate() const
 {
-#if WITH_EDITOR
+	// The nodes needing PreUpdate are gathered from the class defaults, but wind, LOD, async world collision and the
+	// shared context can all be turned on at runtime (e.g. UKawaiiPhysicsLibrary::SetEnableWind or pins).
+	// PreUpdate only does the work of the features that are enabled
 	return true;
-#else
-	return false;
-#endif
 }
 
 void FAnimNode_KawaiiPhysics::PreUpdate(const UAnimInstance* InAnimInstance)
@@ -357,574 +823,1954 @@ void FAnimNode_KawaiiPhysics::PreUpdate(const UAnimInstance* InAnimInstance)
 		}
 	}
 #endif
-}
 
-void FAnimNode_KawaiiPhysics::InitializeBoneReferences(const FBoneContainer& RequiredBones)
-{
-	auto Initialize = [&RequiredBones](auto& Targets)
-	{
-		for (auto& Target : Targets)
-		{
-			Target.DrivingBone.Initialize(RequiredBones);
-		}
-		return true;
-	};
+	UpdateSharedContext(InAnimInstance);
 
-	RootBone.Initialize(RequiredBones);
-	for (auto& AdditionalRootBone : AdditionalRootBones)
-	{
-		AdditionalRootBone.RootBone.Initialize(RequiredBones);
-	}
-	for (auto& Bone : ModifyBones)
+	const bool bNeedsSubsystem = bUseBatchedSimulation || bSimulateInSharedPass || LODSettings.bEnable ||
+		(bAllowWorldCollision && bUseAsyncWorldCollision);
+	const UWorld* World = bNeedsSubsystem ? InAnimInstance->GetWorld() : nullptr;
+	KawaiiPhysicsSubsystem = World ? World->GetSubsystem<UKawaiiPhysicsSubsystem>() : nullptr;
+
+	if (LODSettings.bEnable)
 	{
-		Bone.BoneRef.Initialize(RequiredBones);
+		UpdateLODMetric(InAnimInstance);
 	}
 
-	Initialize(SphericalLimits);
-	Initialize(CapsuleLimits);
-	Initialize(BoxLimits);
-	Initialize(PlanarLimits);
-
-	for (auto& BoneConstraint : BoneConstraints)
+	if (bEnableWind)
 	{
-		BoneConstraint.InitializeBone(RequiredBones);
+		UpdateWindSamples(InAnimInstance);
 	}
 }
 
-void FAnimNode_KawaiiPhysics::InitModifyBones(FComponentSpacePoseContext& Output, const FBoneContainer& BoneContainer)
+void FAnimNode_KawaiiPhysics::UpdateWindSamples(const UAnimInstance* InAnimInstance)
 {
-	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_InitModifyBones);
+	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_GetWindVelocity);
 
-	const USkeleton* Skeleton = BoneContainer.GetSkeletonAsset();
-	auto& RefSkeleton = Skeleton->GetReferenceSkeleton();
+	NumWindSamples = 0;
 
-	auto InitRootBone = [&](const FName& RootBoneName, const TArray<FBoneReference>& InExcludeBones)
+	const USkeletalMeshComponent* SkelComp = InAnimInstance->GetSkelMeshComponent();
+	const UWorld* World = InAnimInstance->GetWorld();
+	const FSceneInterface* Scene = World ? World->Scene : nullptr;
+	if (!SkelComp || !Scene)
 	{
-		TArray<FKawaiiPhysicsModifyBone> Bones;
-		AddModifyBone(Bones, Output, BoneContainer, RefSkeleton, RefSkeleton.FindBoneIndex(RootBoneName),
-		              InExcludeBones);
-		if (Bones.Num() > 0)
-		{
-			float TotalBoneLength = 0.0f;
-			CalcBoneLength(Bones[0], Bones, BoneContainer.GetRefPoseArray(), TotalBoneLength);
+		return;
+	}
 
-			for (auto& Bone : Bones)
-			{
-				if (Bone.LengthFromRoot > 0.0f)
-				{
-					Bone.LengthRateFromRoot = Bone.LengthFromRoot / TotalBoneLength;
-				}
+	const FTransform& ComponentTransform = SkelComp->GetComponentTransform();
+	auto SampleWind = [&](const FVector& Location)
+	{
+		FVector WindDirection = FVector::ZeroVector;
+		float WindSpeed = 0.0f;
+		float WindMinGust = 0.0f;
+		float WindMaxGust = 0.0f;
+		Scene->GetWindParameters_GameThread(ComponentTransform.TransformPosition(Location), WindDirection,
+		                                    WindSpeed, WindMinGust, WindMaxGust);
+		return ComponentTransform.InverseTransformVector(WindDirection) * WindSpeed * WindScale;
+	};
 
-				Bone.Index += ModifyBones.Num();
-				if (Bone.ParentIndex >= 0)
-				{
-					Bone.ParentIndex += ModifyBones.Num();
-				}
-				for (auto& ChildIndex : Bone.ChildIndices)
-				{
-					ChildIndex += ModifyBones.Num();
-				}
-			}
-			ModifyBones.Append(Bones);
+	// Corner i has the max of the X, Y and Z axis for the bits 0, 1 and 2
+	if (WindSampleBounds.IsValid)
+	{
+		for (int32 i = 0; i < 8; ++i)
+		{
+			WindSamples[i] = SampleWind(FVector(i & 1 ? WindSampleBounds.Max.X : WindSampleBounds.Min.X,
+			                                    i & 2 ? WindSampleBounds.Max.Y : WindSampleBounds.Min.Y,
+			                                    i & 4 ? WindSampleBounds.Max.Z : WindSampleBounds.Min.Z));
 		}
-	};
+		NumWindSamples = 8;
+	}
+	else
+	{
+		WindSamples[0] = SampleWind(FVector::ZeroVector);
+		NumWindSamples = 1;
+	}
+}
 
-	ModifyBones.Empty();
-	InitRootBone(RootBone.BoneName, ExcludeBones);
-	for (auto& AdditionalRootBone : AdditionalRootBones)
+void FAnimNode_KawaiiPhysics::UpdateWindSampleBounds()
+{
+	WindSampleBounds = FBox(ForceInit);
+	for (const FVector& PoseLocation : SolverState.PoseLocations)
 	{
-		InitRootBone(AdditionalRootBone.RootBone.BoneName,
-		             AdditionalRootBone.bUseOverrideExcludeBones
-			             ? AdditionalRootBone.OverrideExcludeBones
-			             : ExcludeBones);
+		WindSampleBounds += PoseLocation;
 	}
 }
 
-void FAnimNode_KawaiiPhysics::ApplyLimitsDataAsset(const FBoneContainer& RequiredBones)
+void FAnimNode_KawaiiPhysics::UpdateSharedContext(const UAnimInstance* InAnimInstance)
 {
-	auto Initialize = [&RequiredBones](auto& Targets)
+	UKawaiiPhysicsSharedContextComponent* NewSharedContext = nullptr;
+	const USkeletalMeshComponent* SkelComp = InAnimInstance->GetSkelMeshComponent();
+	if (const AActor* Owner = bUseSharedContext ? InAnimInstance->GetOwningActor() : nullptr)
 	{
-		for (auto& Target : Targets)
+		const uint32 RegistrationSerial = UKawaiiPhysicsSharedContextComponent::GetRegistrationSerial();
+		if (SharedContextOwner != Owner || SharedContextRegistrationSerial != RegistrationSerial)
 		{
-			Target.DrivingBone.Initialize(RequiredBones);
+			SharedContextOwner = Owner;
+			SharedContextRegistrationSerial = RegistrationSerial;
+			OwnerSharedContext = Owner->FindComponentByClass<UKawaiiPhysicsSharedContextComponent>();
 		}
-	};
-	auto RemoveAllSourceDataAssets = [](auto& Targets)
-	{
-		Targets.RemoveAll([](const FCollisionLimitBase& Limit)
-		{
-			return Limit.SourceType == ECollisionSourceType::DataAsset;
-		});
-	};
 
-	RemoveAllSourceDataAssets(SphericalLimitsData);
-	RemoveAllSourceDataAssets(CapsuleLimitsData);
-	RemoveAllSourceDataAssets(BoxLimitsData);
-	RemoveAllSourceDataAssets(PlanarLimitsData);
+		// Membership can change at any time and is cheap to check
+		if (UKawaiiPhysicsSharedContextComponent* Context = OwnerSharedContext.Get(); Context && Context->
+			IsMember(SkelComp))
+		{
+			NewSharedContext = Context;
+		}
+	}
 
-	if (LimitsDataAsset)
+	const bool bNewPublishSharedLimits = NewSharedContext && NewSharedContext->GetLimitSourceComponent() == SkelComp;
+	if (SharedContext && bPublishSharedLimits && (SharedContext != NewSharedContext || !bNewPublishSharedLimits))
 	{
-		SphericalLimitsData.Append(LimitsDataAsset->SphericalLimits);
-		CapsuleLimitsData.Append(LimitsDataAsset->CapsuleLimits);
-		BoxLimitsData.Append(LimitsDataAsset->BoxLimits);
-		PlanarLimitsData.Append(LimitsDataAsset->PlanarLimits);
+		SharedContext->UnpublishLimits(this);
+	}
 
-		Initialize(SphericalLimitsData);
-		Initialize(CapsuleLimitsData);
-		Initialize(BoxLimitsData);
-		Initialize(PlanarLimitsData);
-	}
+	SharedContext = NewSharedContext;
+	bPublishSharedLimits = bNewPublishSharedLimits;
+	bSimulateInSharedPass = NewSharedContext && NewSharedContext->bSimulateInOnePass;
 }
 
-void FAnimNode_KawaiiPhysics::ApplyPhysicsAsset(const FBoneContainer& RequiredBones)
+void FAnimNode_KawaiiPhysics::UpdateTraceNames(const USkeletalMeshComponent* SkelComp)
 {
-	auto Initialize = [&RequiredBones](auto& Targets)
+	// The class of the owning actor tells the character types apart, the tag tells the nodes of one character apart
+	const AActor* Owner = SkelComp ? SkelComp->GetOwner() : nullptr;
+	TraceOwnerName = Owner ? Owner->GetClass()->GetFName() : NAME_None;
+
+	TraceScopeName = TEXT("KawaiiPhysics");
+	if (!TraceOwnerName.IsNone())
 	{
-		for (auto& Target : Targets)
-		{
-			Target.DrivingBone.Initialize(RequiredBones);
-		}
-	};
-	auto RemoveAllSourcePhysicsAssets = [](auto& Targets)
+		TraceScopeName += TEXT(" ") + TraceOwnerName.ToString();
+	}
+	if (KawaiiPhysicsTag.IsValid())
 	{
-		Targets.RemoveAll([](const FCollisionLimitBase& Limit)
-		{
-			return Limit.SourceType == ECollisionSourceType::PhysicsAsset;
-		});
-	};
+		TraceScopeName += TEXT(" ") + KawaiiPhysicsTag.ToString();
+	}
+}
 
-	RemoveAllSourcePhysicsAssets(SphericalLimitsData);
-	RemoveAllSourcePhysicsAssets(CapsuleLimitsData);
-	RemoveAllSourcePhysicsAssets(BoxLimitsData);
+void FAnimNode_KawaiiPhysics::OutputEvaluationStats(uint64 StartCycle)
+{
+	EvaluationStats.NumBones = SolverState.Num();
+	EvaluationStats.NumLimits = PackedLimits.Num();
+	EvaluationStats.NumBoneConstraints = GetMergedBoneConstraints().Num();
+	EvaluationStats.NumDormantChains = NumDormantChains;
+	EvaluationStats.LODTier = static_cast<uint8>(LODTier);
+
+	KawaiiPhysicsTrace::OutputEvaluation(reinterpret_cast<UPTRINT>(this), TraceOwnerName,
+	                                     KawaiiPhysicsTag.GetTagName(), StartCycle, FPlatformTime::Cycles64(),
+	                                     EvaluationStats);
+}
 
-	if (PhysicsAssetForLimits)
+void FAnimNode_KawaiiPhysics::UpdateLODMetric(const UAnimInstance* InAnimInstance)
+{
+	bHasLODMetricValue = false;
+
+	const USkeletalMeshComponent* SkelComp = InAnimInstance->GetSkelMeshComponent();
+	const UWorld* World = InAnimInstance->GetWorld();
+	if (!SkelComp || !World || World->ViewLocationsRenderedLastFrame.IsEmpty())
 	{
-		for (const auto& BodySetup : PhysicsAssetForLimits->SkeletalBodySetups)
-		{
-			FBoneReference DrivingBone = BodySetup->BoneName;
-			DrivingBone.Initialize(RequiredBones);
-			if (!DrivingBone.IsValidToEvaluate(RequiredBones))
-			{
-				continue;
-			}
+		return;
+	}
 
-			const FKAggregateGeom& AggGeom = BodySetup->AggGeom;
-			for (const auto& SphereElem : AggGeom.SphereElems)
-			{
-				FSphericalLimit NewLimit;
-				NewLimit.DrivingBone = DrivingBone;
-				NewLimit.OffsetLocation = SphereElem.Center;
-				NewLimit.Radius = SphereElem.Radius;
-				NewLimit.SourceType = ECollisionSourceType::PhysicsAsset;
-				SphericalLimitsData.Add(NewLimit);
-			}
-			for (const auto& CapsuleElem : AggGeom.SphylElems)
-			{
-				FCapsuleLimit NewLimit;
-				NewLimit.DrivingBone = DrivingBone;
-				NewLimit.OffsetLocation = CapsuleElem.Center;
-				NewLimit.OffsetRotation = CapsuleElem.Rotation;
-				NewLimit.Length = CapsuleElem.Length;
-				NewLimit.Radius = CapsuleElem.Radius;
-				NewLimit.SourceType = ECollisionSourceType::PhysicsAsset;
-				CapsuleLimitsData.Add(NewLimit);
-			}
-			for (const auto& BoxElem : AggGeom.BoxElems)
-			{
-				FBoxLimit NewLimit;
-				NewLimit.DrivingBone = DrivingBone;
-				NewLimit.OffsetLocation = BoxElem.Center;
-				NewLimit.OffsetRotation = BoxElem.Rotation;
-				NewLimit.Extent = FVector(BoxElem.X, BoxElem.Y, BoxElem.Z) / 2.0f;
-				NewLimit.SourceType = ECollisionSourceType::PhysicsAsset;
-				BoxLimitsData.Add(NewLimit);
-			}
-		}
+	const FBoxSphereBounds& Bounds = SkelComp->Bounds;
+	double MinDistanceSq = UE_DOUBLE_BIG_NUMBER;
+	for (const FVector& ViewLocation : World->ViewLocationsRenderedLastFrame)
+	{
+		MinDistanceSq = FMath::Min(MinDistanceSq, FVector::DistSquared(ViewLocation, Bounds.Origin));
+	}
+	const double Distance = FMath::Sqrt(MinDistanceSq);
 
-		Initialize(SphericalLimitsData);
-		Initialize(CapsuleLimitsData);
-		Initialize(BoxLimitsData);
+	switch (LODSettings.Metric)
+	{
+	case EKawaiiPhysicsLODMetric::Distance:
+		LODMetricValue = Distance;
+		break;
+	case EKawaiiPhysicsLODMetric::ScreenSize:
+		// Bounds radius over distance, i.e. the screen size with a 90 degree FOV
+		LODMetricValue = Bounds.SphereRadius / FMath::Max(Distance, 1.0);
+		break;
+	default: ;
 	}
+	bHasLODMetricValue = true;
 }
 
-void FAnimNode_KawaiiPhysics::ApplyBoneConstraintDataAsset(const FBoneContainer& RequiredBones)
+EKawaiiPhysicsLODTier FAnimNode_KawaiiPhysics::CalcLODTier() const
 {
-	BoneConstraintsData.Empty();
-	if (BoneConstraintsDataAsset)
+	if (!LODSettings.bEnable || !bHasLODMetricValue)
 	{
-		BoneConstraintsData = BoneConstraintsDataAsset->GenerateBoneConstraints();
-		for (auto& BoneConstraint : BoneConstraintsData)
+		return EKawaiiPhysicsLODTier::Full;
+	}
+
+	// Flip screen size so that a larger value is less significant for both metrics
+	const float Sign = LODSettings.Metric == EKawaiiPhysicsLODMetric::ScreenSize ? -1.0f : 1.0f;
+	const float Value = LODMetricValue * Sign;
+
+	EKawaiiPhysicsLODTier NewTier = EKawaiiPhysicsLODTier::Full;
+	for (uint8 Tier = static_cast<uint8>(EKawaiiPhysicsLODTier::Reduced);
+	     Tier <= static_cast<uint8>(EKawaiiPhysicsLODTier::Frozen); ++Tier)
+	{
+		const float Threshold = LODSettings.GetThreshold(static_cast<EKawaiiPhysicsLODTier>(Tier)) * Sign;
+		const float Margin = FMath::Abs(Threshold) * LODSettings.Hysteresis;
+
+		// Entering a tier needs to go past the threshold by the margin, leaving it needs to come back by the margin
+		if (Value <= (Tier <= static_cast<uint8>(LODTier) ? Threshold - Margin : Threshold + Margin))
 		{
-			BoneConstraint.InitializeBone(RequiredBones);
+			break;
 		}
+		NewTier = static_cast<EKawaiiPhysicsLODTier>(Tier);
 	}
+	return NewTier;
 }
 
-int32 FAnimNode_KawaiiPhysics::AddModifyBone(TArray<FKawaiiPhysicsModifyBone>& InModifyBones,
-                                             FComponentSpacePoseContext& Output, const FBoneContainer& BoneContainer,
-                                             const FReferenceSkeleton& RefSkeleton, int32 BoneIndex,
-                                             const TArray<FBoneReference>& InExcludeBones)
+bool FAnimNode_KawaiiPhysics::UpdateSimulationLOD(const FTransform& ComponentTransform)
 {
-	if (BoneIndex < 0 || RefSkeleton.GetNum() < BoneIndex)
+	const EKawaiiPhysicsLODTier PrevTier = LODTier;
+	LODTier = CalcLODTier();
+	if (LODTier == EKawaiiPhysicsLODTier::Frozen)
+	{
+		if (PrevTier != EKawaiiPhysicsLODTier::Frozen && LODSettings.FrozenBakedMotion && SolverState.Num() > 0)
+		{
+			// The baked motion fades in from the simulated offsets
+			const TArray<FVector>& Locations = bUseInterpolatedLocations
+				                                   ? InterpolatedLocations
+				                                   : SolverState.Locations;
+			BakedMotionBlendOffsets.SetNumUninitialized(SolverState.Num());
+			for (int32 i = 0; i < SolverState.Num(); ++i)
+			{
+				BakedMotionBlendOffsets[i] = Locations[i] - SolverState.PoseLocations[i];
+			}
+			BakedMotionBlendAlpha = 0.0f;
+		}
+		if (LODSettings.bCompactFrozenState && !CompactSolverState.IsPacked() && SolverState.Num() > 0)
+		{
+			// Nothing reads the simulated state until the node is unfrozen
+			SyncModifyBonesView();
+			CompactSolverState.Pack(SolverState, LODSettings.CompactPrecision);
+			InterpolationFromOffsets.Empty();
+			InterpolationToOffsets.Empty();
+			InterpolatedLocations.Empty();
+			ExternalForceBoneTransforms.Empty();
+			BatchJob.Reset();
+		}
+		return false;
+	}
+
+	if (CompactSolverState.IsPacked())
 	{
-		return INDEX_NONE;
+		// Resume from the compacted state, relative to wherever the roots are now
+		CompactSolverState.Unpack(SolverState);
+	}
+	else if (PrevTier == EKawaiiPhysicsLODTier::Frozen)
+	{
+		// The chain did not follow the character while frozen, so restart from the pose
+		SolverState.Locations = SolverState.PoseLocations;
+		SolverState.PrevLocations = SolverState.PoseLocations;
 	}
 
-	FBoneReference BoneRef;
-	BoneRef.BoneName = RefSkeleton.GetBoneName(BoneIndex);
+	if (PrevTier == EKawaiiPhysicsLODTier::Frozen)
+	{
+		if (BakedMotionClip != INDEX_NONE && BakedMotionOffsets.Num() == SolverState.Num())
+		{
+			// Continue from the baked motion played while frozen, so that the promotion does not pop
+			for (int32 i = 0; i < SolverState.Num(); ++i)
+			{
+				SolverState.Locations[i] = SolverState.PoseLocations[i] + BakedMotionOffsets[i];
+				SolverState.PrevLocations[i] = SolverState.Locations[i];
+			}
+		}
+		BakedMotionClip = INDEX_NONE;
+		BakedMotionOffsets.Empty();
+		BakedMotionBlendOffsets.Empty();
+		PreSkelCompTransform = ComponentTransform;
+		LODAccumulatedDeltaTime = 0.0f;
+		LODFramesSinceStep = 0;
+		FixedTimestepAccumulator = 0.0f;
+		InterpolationFromOffsets.Reset();
+		InterpolationToOffsets.Reset();
+		bModifyBonesViewDirty = true;
+	}
 
-	if (InExcludeBones.Num() > 0 && InExcludeBones.Find(BoneRef) >= 0)
+	LODAccumulatedDeltaTime += DeltaTime;
+	++LODFramesSinceStep;
+
+	const int32 Interval = LODTier == EKawaiiPhysicsLODTier::Low ? FMath::Max(1, LODSettings.LowSimulationInterval) : 1;
+	if (LODFramesSinceStep < Interval)
 	{
-		return INDEX_NONE;
+		return false;
 	}
 
-	FKawaiiPhysicsModifyBone NewModifyBone;
-	NewModifyBone.BoneRef = BoneRef;
-	NewModifyBone.BoneRef.Initialize(BoneContainer);
-	if (NewModifyBone.BoneRef.CachedCompactPoseIndex == INDEX_NONE)
+	// A node deferred in the previous frame always gets to simulate, so that no node starves
+	if (LODSettings.bEnable && KawaiiPhysicsSubsystem &&
+		!KawaiiPhysicsSubsystem->TryReserveSimulatedBones(SolverState.Num(), bDeferredByBoneBudget))
 	{
-		return INDEX_NONE;
+		bDeferredByBoneBudget = true;
+		return false;
 	}
+	bDeferredByBoneBudget = false;
 
-	auto& RefBonePoseTransform = Output.Pose.GetComponentSpaceTransform(NewModifyBone.BoneRef.CachedCompactPoseIndex);
-	NewModifyBone.Location = RefBonePoseTransform.GetLocation();
-	NewModifyBone.PrevLocation = NewModifyBone.Location;
-	NewModifyBone.PoseLocation = NewModifyBone.Location;
-	NewModifyBone.PrevRotation = RefBonePoseTransform.GetRotation();
-	NewModifyBone.PoseRotation = NewModifyBone.PrevRotation;
-	NewModifyBone.PoseScale = RefBonePoseTransform.GetScale3D();
+	DeltaTime = LODAccumulatedDeltaTime;
+	LODAccumulatedDeltaTime = 0.0f;
+	LODFramesSinceStep = 0;
+	return true;
+}
 
-	int32 ModifyBoneIndex = InModifyBones.Add(NewModifyBone);
-	InModifyBones[ModifyBoneIndex].Index = ModifyBoneIndex;
+bool FAnimNode_KawaiiPhysics::PlayBakedMotion(const USkeleton* Skeleton)
+{
+	const UKawaiiPhysicsBakedMotionDataAsset* BakedMotion = LODSettings.FrozenBakedMotion;
+	const int32 NumBones = SolverState.PoseLocations.Num();
+	if (!BakedMotion || NumBones == 0 || NumBones != ModifyBones.Num())
+	{
+		BakedMotionClip = INDEX_NONE;
+		return false;
+	}
 
-	TArray<int32> ChildBoneIndices;
-	CollectChildBones(RefSkeleton, BoneIndex, ChildBoneIndices);
-	bool AddedChildBone = false;
-	if (ChildBoneIndices.Num() > 0)
+	if (BakedMotionClipsAsset != BakedMotion || BakedMotionNumClips != BakedMotion->Clips.Num())
 	{
-		//for some mesh where tip bone is empty (without any skinning weight in the mesh), ChildBoneIndices > 0 but no actual child bones are created
-		for (auto ChildBoneIndex : ChildBoneIndices)
+		TArray<FName, TInlineAllocator<64>> BoneNames;
+		BoneNames.Reserve(NumBones);
+		for (const FKawaiiPhysicsModifyBone& ModifyBone : ModifyBones)
 		{
-			int32 ChildModifyBoneIndex = AddModifyBone(InModifyBones, Output, BoneContainer, RefSkeleton,
-			                                           ChildBoneIndex,
-			                                           InExcludeBones);
-			if (ChildModifyBoneIndex >= 0)
+			BoneNames.Add(ModifyBone.BoneRef.BoneName);
+		}
+		BakedMotion->GetMatchingClips(Skeleton, BoneNames, BakedMotionClipIndices);
+		BakedMotionClipsAsset = BakedMotion;
+		BakedMotionNumClips = BakedMotion->Clips.Num();
+		BakedMotionClip = INDEX_NONE;
+		BakedMotionFramesUntilSearch = 0;
+	}
+
+	// Follow the played clip, and search every clip only when the pose no longer matches it
+	int32 Frame = 0;
+	if (BakedMotionClip != INDEX_NONE)
+	{
+		const FKawaiiPhysicsBakedMotionClip& Clip = BakedMotion->Clips[BakedMotionClip];
+		BakedMotionFrame = FMath::Fmod(BakedMotionFrame + DeltaTime * Clip.SampleRate,
+		                               static_cast<float>(Clip.NumFrames));
+		if (BakedMotion->FindFrameNear(BakedMotionClip, BakedMotionFrame, SolverState.PoseLocations, Frame))
+		{
+			// Keep the time continuous unless the animation drifted away from the clip
+			const float Drift = FMath::Abs(Frame - BakedMotionFrame);
+			if (FMath::Min(Drift, Clip.NumFrames - Drift) > 1.0f)
 			{
-				InModifyBones[ModifyBoneIndex].ChildIndices.Add(ChildModifyBoneIndex);
-				InModifyBones[ChildModifyBoneIndex].ParentIndex = ModifyBoneIndex;
-				AddedChildBone = true;
+				BakedMotionFrame = Frame;
 			}
 		}
+		else
+		{
+			BakedMotionClip = INDEX_NONE;
+		}
 	}
-
-	if (!AddedChildBone && DummyBoneLength > 0.0f)
+	if (BakedMotionClip == INDEX_NONE)
 	{
-		// Add dummy modify bone
-		FKawaiiPhysicsModifyBone DummyModifyBone;
-		DummyModifyBone.bDummy = true;
-		DummyModifyBone.Location = NewModifyBone.Location + GetBoneForwardVector(NewModifyBone.PrevRotation) *
-			DummyBoneLength;
-		DummyModifyBone.PrevLocation = DummyModifyBone.Location;
-		DummyModifyBone.PoseLocation = DummyModifyBone.Location;
-		DummyModifyBone.PrevRotation = NewModifyBone.PrevRotation;
-		DummyModifyBone.PoseRotation = DummyModifyBone.PrevRotation;
-		DummyModifyBone.PoseScale = RefBonePoseTransform.GetScale3D();
-
-		int32 DummyBoneIndex = InModifyBones.Add(DummyModifyBone);
-		InModifyBones[ModifyBoneIndex].ChildIndices.Add(DummyBoneIndex);
-		InModifyBones[DummyBoneIndex].Index = DummyBoneIndex;
-		InModifyBones[DummyBoneIndex].ParentIndex = ModifyBoneIndex;
+		if (BakedMotionFramesUntilSearch > 0)
+		{
+			--BakedMotionFramesUntilSearch;
+			return false;
+		}
+		if (!BakedMotion->FindFrame(BakedMotionClipIndices, SolverState.PoseLocations, BakedMotionClip, Frame))
+		{
+			BakedMotionFramesUntilSearch = BakedMotionSearchInterval;
+			return false;
+		}
+		BakedMotionFrame = Frame;
 	}
 
+	const FKawaiiPhysicsBakedMotionClip& Clip = BakedMotion->Clips[BakedMotionClip];
+	BakedMotionBlendAlpha = LODSettings.BakedMotionBlendTime > 0.0f
+		                        ? FMath::Min(BakedMotionBlendAlpha + DeltaTime / LODSettings.BakedMotionBlendTime, 1.0f)
+		                        : 1.0f;
+	const bool bBlend = BakedMotionBlendAlpha < 1.0f && BakedMotionBlendOffsets.Num() == NumBones;
 
-	return ModifyBoneIndex;
+	BakedMotionOffsets.SetNumUninitialized(NumBones);
+	InterpolatedLocations.SetNumUninitialized(NumBones);
+	for (int32 i = 0; i < NumBones; ++i)
+	{
+		const FVector Offset = Clip.SampleOffset(BakedMotionFrame, i);
+		BakedMotionOffsets[i] = bBlend ? FMath::Lerp(BakedMotionBlendOffsets[i], Offset, BakedMotionBlendAlpha) : Offset;
+		InterpolatedLocations[i] = SolverState.PoseLocations[i] + BakedMotionOffsets[i];
+	}
+	if (!bBlend)
+	{
+		BakedMotionBlendOffsets.Empty();
+	}
+	bUseInterpolatedLocations = true;
+	return true;
 }
 
-int32 FAnimNode_KawaiiPhysics::CollectChildBones(const FReferenceSkeleton& RefSkeleton, int32 ParentBoneIndex,
-                                                 TArray<int32>& Children) const
+void FAnimNode_KawaiiPhysics::UpdateInterpolatedLocations(bool bSimulated)
 {
-	Children.Reset();
+	bUseInterpolatedLocations = false;
 
-	const int32 NumBones = RefSkeleton.GetNum();
-	for (int32 ChildIndex = ParentBoneIndex + 1; ChildIndex < NumBones; ChildIndex++)
+	// Offsets from the pose are interpolated, so that the chain keeps following the animation in between steps
+	float Alpha;
+	if (UseLODInterpolation())
 	{
-		if (ParentBoneIndex == RefSkeleton.GetParentIndex(ChildIndex))
+		if (bSimulated)
 		{
-			Children.Add(ChildIndex);
+			Swap(InterpolationFromOffsets, InterpolationToOffsets);
+			CaptureInterpolationOffsets(InterpolationToOffsets);
+			if (InterpolationFromOffsets.Num() != InterpolationToOffsets.Num())
+			{
+				InterpolationFromOffsets = InterpolationToOffsets;
+			}
 		}
+		Alpha = static_cast<float>(LODFramesSinceStep + 1) / FMath::Max(1, LODSettings.LowSimulationInterval);
+	}
+	else if (UseFixedTimestepInterpolation())
+	{
+		// The offsets are captured around the last substep in SimulateSubsteps
+		Alpha = FixedTimestepAccumulator * FMath::Max(FixedTimestepRate, 1.0f);
+	}
+	else
+	{
+		InterpolationFromOffsets.Reset();
+		InterpolationToOffsets.Reset();
+		return;
 	}
 
-	return Children.Num();
+	const int32 NumBones = SolverState.Num();
+	if (InterpolationFromOffsets.Num() != NumBones || InterpolationToOffsets.Num() != NumBones)
+	{
+		return;
+	}
+
+	Alpha = FMath::Clamp(Alpha, 0.0f, 1.0f);
+	InterpolatedLocations.SetNumUninitialized(NumBones);
+	for (int32 i = 0; i < NumBones; ++i)
+	{
+		InterpolatedLocations[i] = SolverState.PoseLocations[i] +
+			FMath::Lerp(InterpolationFromOffsets[i], InterpolationToOffsets[i], Alpha);
+	}
+	bUseInterpolatedLocations = true;
 }
 
-void FAnimNode_KawaiiPhysics::CalcBoneLength(FKawaiiPhysicsModifyBone& Bone,
-                                             TArray<FKawaiiPhysicsModifyBone>& InModifyBones,
-                                             const TArray<FTransform>& RefBonePose,
-                                             float& TotalBoneLength)
+void FAnimNode_KawaiiPhysics::CaptureInterpolationOffsets(TArray<FVector>& OutOffsets) const
 {
-	if (Bone.ParentIndex < 0)
+	OutOffsets.SetNumUninitialized(SolverState.Num());
+	for (int32 i = 0; i < SolverState.Num(); ++i)
 	{
-		Bone.LengthFromRoot = 0.0f;
+		OutOffsets[i] = SolverState.Locations[i] - SolverState.PoseLocations[i];
 	}
-	else
-	{
-		if (!Bone.bDummy)
-		{
-			Bone.LengthFromRoot = InModifyBones[Bone.ParentIndex].LengthFromRoot
-				+ RefBonePose[Bone.BoneRef.BoneIndex].GetLocation().Size();
-		}
-		else
-		{
-			Bone.LengthFromRoot = InModifyBones[Bone.ParentIndex].LengthFromRoot + DummyBoneLength;
-		}
+}
 
-		TotalBoneLength = FMath::Max(TotalBoneLength, Bone.LengthFromRoot);
+int32 FAnimNode_KawaiiPhysics::ConsumeFixedTimesteps()
+{
+	if (!bUseFixedTimestep)
+	{
+		return 1;
 	}
 
-	for (const int32 ChildIndex : Bone.ChildIndices)
+	const float Timestep = 1.0f / FMath::Max(FixedTimestepRate, 1.0f);
+	FixedTimestepAccumulator += DeltaTime;
+
+	int32 NumSubsteps = FMath::FloorToInt32((FixedTimestepAccumulator + UE_KINDA_SMALL_NUMBER) / Timestep);
+	if (NumSubsteps > MaxSubsteps)
 	{
-		CalcBoneLength(InModifyBones[ChildIndex], InModifyBones, RefBonePose, TotalBoneLength);
+		// Drop the time we cannot catch up with, instead of simulating more and more every frame
+		NumSubsteps = FMath::Max(MaxSubsteps, 1);
+		FixedTimestepAccumulator = NumSubsteps * Timestep;
 	}
-}
+	FixedTimestepAccumulator = FMath::Max(FixedTimestepAccumulator - NumSubsteps * Timestep, 0.0f);
 
+	DeltaTime = Timestep;
+	return NumSubsteps;
+}
 
-void FAnimNode_KawaiiPhysics::UpdatePhysicsSettingsOfModifyBones()
+void FAnimNode_KawaiiPhysics::SimulateSubsteps(FComponentSpacePoseContext& Output,
+                                               const FTransform& ComponentTransform, int32 NumSubsteps)
 {
-	for (FKawaiiPhysicsModifyBone& Bone : ModifyBones)
+	// Spread the movement of the component over the substeps
+	if (NumSubsteps > 1)
 	{
-		SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_UpdatePhysicsSetting);
+		SkelCompMoveVector /= NumSubsteps;
+		SkelCompMoveRotation = FQuat::Slerp(FQuat::Identity, SkelCompMoveRotation, 1.0f / NumSubsteps);
+	}
 
-		const float LengthRate = Bone.LengthRateFromRoot;
+	if (CanUseBatchedSimulation())
+	{
+		SimulateModifyBonesBatched(Output, ComponentTransform, NumSubsteps);
+		return;
+	}
 
-		// Damping
-		Bone.PhysicsSettings.Damping = PhysicsSettings.Damping;
-		if (!DampingCurveData.GetRichCurve()->IsEmpty())
+	const bool bAsyncWorldCollision = IsWorldCollisionActive() && UseAsyncWorldCollision();
+	if (bAsyncWorldCollision)
+	{
+		BeginAsyncWorldCollision();
+	}
+
+	const bool bCaptureOffsets = UseFixedTimestepInterpolation();
+	for (int32 i = 0; i < NumSubsteps; ++i)
+	{
+		if (bCaptureOffsets && i == NumSubsteps - 1)
 		{
-			Bone.PhysicsSettings.Damping *= DampingCurveData.GetRichCurve()->Eval(LengthRate);
+			CaptureInterpolationOffsets(InterpolationFromOffsets);
 		}
-		Bone.PhysicsSettings.Damping = FMath::Clamp(Bone.PhysicsSettings.Damping, 0.0f, 1.0f);
+		SimulateModifyBones(Output, ComponentTransform);
+	}
+	if (bCaptureOffsets)
+	{
+		CaptureInterpolationOffsets(InterpolationToOffsets);
+	}
+
+	if (bAsyncWorldCollision)
+	{
+		EndAsyncWorldCollision();
+	}
+}
+
+void FAnimNode_KawaiiPhysics::InitializeBoneReferences(const FBoneContainer& RequiredBones)
+{
+	auto Initialize = [&RequiredBones](auto& Targets)
+	{
+		for (auto& Target : Targets)
+		{
+			Target.DrivingBone.Initialize(RequiredBones);
+		}
+		return true;
+	};
+
+	RootBone.Initialize(RequiredBones);
+	for (auto& AdditionalRootBone : AdditionalRootBones)
+	{
+		AdditionalRootBone.RootBone.Initialize(RequiredBones);
+	}
+	for (auto& Bone : ModifyBones)
+	{
+		Bone.BoneRef.Initialize(RequiredBones);
+	}
+	bCompactPoseIndicesDirty = true;
+	if (SolverState.bHasBones.Num() == ModifyBones.Num())
+	{
+		for (int32 i = 0; i < ModifyBones.Num(); ++i)
+		{
+			SolverState.bHasBones[i] = ModifyBones[i].BoneRef.BoneIndex >= 0;
+		}
+	}
+
+	Initialize(SphericalLimits);
+	Initialize(CapsuleLimits);
+	Initialize(BoxLimits);
+	Initialize(PlanarLimits);
+	Initialize(DistanceFieldLimits);
+
+	for (auto& BoneConstraint : BoneConstraints)
+	{
+		BoneConstraint.InitializeBone(RequiredBones);
+	}
+
+#if WITH_EDITORONLY_DATA
+	bBoneReferencesDirty = false;
+#endif
+}
+
+void FAnimNode_KawaiiPhysics::InitModifyBones(FComponentSpacePoseContext& Output, const FBoneContainer& BoneContainer)
+{
+	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_InitModifyBones);
+
+	bool bShareChains = bShareChainTemplate;
+#if WITH_EDITORONLY_DATA
+	// The preview is edited live, so it always builds its own chains
+	bShareChains &= !bEditing;
+#endif
+
+	ChainTemplate.Reset();
+	if (bShareChains)
+	{
+		ChainTemplate = FKawaiiPhysicsChainTemplate::FindOrBuild(
+			MakeChainTemplateKey(BoneContainer), [this, &Output, &BoneContainer](FKawaiiPhysicsChainTemplate& Template)
+			{
+				BuildChainTemplate(Output, BoneContainer, Template);
+			});
+
+		// Only the simulation state is per instance. It starts from the current pose like unshared chains
+		ModifyBones = ChainTemplate->ModifyBones;
+		PoseModifyBones(ModifyBones, [&Output](const FKawaiiPhysicsModifyBone& Bone)
+		{
+			return Output.Pose.GetComponentSpaceTransform(Bone.BoneRef.CachedCompactPoseIndex);
+		});
+		ModifyBoneIndexMap.Empty();
+		MergedBoneConstraints.Empty();
+		BoneConstraintColorStarts.Empty();
+	}
+	else
+	{
+		ModifyBones.Empty();
+		CollectModifyBones(Output, BoneContainer, ModifyBones);
+		BuildModifyBoneIndexMap();
+	}
+
+	SolverState.Build(ModifyBones);
+	CompactSolverState.Reset();
+	BakedMotionClipsAsset = nullptr;
+	bModifyBonesViewDirty = false;
+	bCompactPoseIndicesDirty = true;
+}
+
+void FAnimNode_KawaiiPhysics::CollectModifyBones(FComponentSpacePoseContext& Output,
+                                                 const FBoneContainer& BoneContainer,
+                                                 TArray<FKawaiiPhysicsModifyBone>& OutModifyBones)
+{
+	const USkeleton* Skeleton = BoneContainer.GetSkeletonAsset();
+	auto& RefSkeleton = Skeleton->GetReferenceSkeleton();
+
+	auto InitRootBone = [&](const FName& RootBoneName, const TArray<FBoneReference>& InExcludeBones)
+	{
+		TArray<FKawaiiPhysicsModifyBone> Bones;
+		AddModifyBone(Bones, Output, BoneContainer, RefSkeleton, RefSkeleton.FindBoneIndex(RootBoneName),
+		              InExcludeBones);
+		if (Bones.Num() > 0)
+		{
+			float TotalBoneLength = 0.0f;
+			CalcBoneLength(Bones[0], Bones, BoneContainer.GetRefPoseArray(), TotalBoneLength);
+
+			for (auto& Bone : Bones)
+			{
+				if (Bone.LengthFromRoot > 0.0f)
+				{
+					Bone.LengthRateFromRoot = Bone.LengthFromRoot / TotalBoneLength;
+				}
+
+				Bone.Index += OutModifyBones.Num();
+				if (Bone.ParentIndex >= 0)
+				{
+					Bone.ParentIndex += OutModifyBones.Num();
+				}
+				for (auto& ChildIndex : Bone.ChildIndices)
+				{
+					ChildIndex += OutModifyBones.Num();
+				}
+			}
+			OutModifyBones.Append(Bones);
+		}
+	};
+
+	InitRootBone(RootBone.BoneName, ExcludeBones);
+	for (auto& AdditionalRootBone : AdditionalRootBones)
+	{
+		InitRootBone(AdditionalRootBone.RootBone.BoneName,
+		             AdditionalRootBone.bUseOverrideExcludeBones
+			             ? AdditionalRootBone.OverrideExcludeBones
+			             : ExcludeBones);
+	}
+}
+
+void FAnimNode_KawaiiPhysics::PoseModifyBones(TArray<FKawaiiPhysicsModifyBone>& InModifyBones,
+                                              TFunctionRef<FTransform(const FKawaiiPhysicsModifyBone&)>
+                                              GetComponentSpaceTransform) const
+{
+	// Parent-sorted, so the parent of a dummy bone is already posed
+	for (FKawaiiPhysicsModifyBone& Bone : InModifyBones)
+	{
+		if (Bone.bDummy && Bone.ParentIndex >= 0)
+		{
+			const FKawaiiPhysicsModifyBone& ParentBone = InModifyBones[Bone.ParentIndex];
+			Bone.Location = ParentBone.Location + GetBoneForwardVector(ParentBone.PrevRotation) * DummyBoneLength;
+			Bone.PrevRotation = ParentBone.PrevRotation;
+			Bone.PoseScale = ParentBone.PoseScale;
+		}
+		else
+		{
+			const FTransform Transform = GetComponentSpaceTransform(Bone);
+			Bone.Location = Transform.GetLocation();
+			Bone.PrevRotation = Transform.GetRotation();
+			Bone.PoseScale = Transform.GetScale3D();
+		}
+		Bone.PrevLocation = Bone.Location;
+		Bone.PoseLocation = Bone.Location;
+		Bone.PoseRotation = Bone.PrevRotation;
+	}
+}
+
+FKawaiiPhysicsChainTemplateKey FAnimNode_KawaiiPhysics::MakeChainTemplateKey(const FBoneContainer& BoneContainer) const
+{
+	FKawaiiPhysicsChainTemplateKey Key;
+	if (const USkeletalMesh* SkeletalMesh = BoneContainer.GetSkeletalMeshAsset())
+	{
+		Key.PoseAsset = SkeletalMesh;
+	}
+	else
+	{
+		Key.PoseAsset = BoneContainer.GetSkeletonAsset();
+	}
+	Key.BoneConstraintsDataAsset = BoneConstraintsDataAsset.Get();
+	Key.RequiredBones = BoneContainer.GetBoneIndicesArray();
+
+	auto AddRootBone = [&Key](const FName& RootBoneName, const TArray<FBoneReference>& InExcludeBones)
+	{
+		Key.BoneNames.Add(RootBoneName);
+		for (const FBoneReference& ExcludeBone : InExcludeBones)
+		{
+			Key.BoneNames.Add(ExcludeBone.BoneName);
+		}
+		Key.BoneNames.Add(NAME_None);
+	};
+	AddRootBone(RootBone.BoneName, ExcludeBones);
+	for (const auto& AdditionalRootBone : AdditionalRootBones)
+	{
+		AddRootBone(AdditionalRootBone.RootBone.BoneName,
+		            AdditionalRootBone.bUseOverrideExcludeBones
+			            ? AdditionalRootBone.OverrideExcludeBones
+			            : ExcludeBones);
+	}
+	Key.BoneNames.Add(NAME_None);
+	for (const FModifyBoneConstraint& BoneConstraint : BoneConstraints)
+	{
+		Key.BoneNames.Add(BoneConstraint.Bone1.BoneName);
+		Key.BoneNames.Add(BoneConstraint.Bone2.BoneName);
+		Key.BoneNames.Add(BoneConstraint.bOverrideCompliance
+			                  ? FName(TEXT("Compliance"), static_cast<int32>(BoneConstraint.ComplianceType) + 1)
+			                  : NAME_None);
+	}
+
+	Key.DummyBoneLength = DummyBoneLength;
+	Key.BoneForwardAxis = BoneForwardAxis;
+	Key.BoneConstraintSolver = BoneConstraintSolver;
+	Key.bAutoAddChildDummyBoneConstraint = bAutoAddChildDummyBoneConstraint;
+#if WITH_EDITOR
+	Key.BoneConstraintsDataAssetRevision = BoneConstraintsDataAsset ? BoneConstraintsDataAsset->GetRevision() : 0;
+	Key.LimitsDataAssetRevision = LimitsDataAsset ? LimitsDataAsset->GetRevision() : 0;
+	Key.PhysicsAssetRevision = PhysicsAssetForLimits ? FKawaiiPhysicsModule::GetPhysicsAssetRevision() : 0;
+#endif
+	return Key;
+}
+
+void FAnimNode_KawaiiPhysics::BuildChainTemplate(FComponentSpacePoseContext& Output,
+                                                 const FBoneContainer& BoneContainer,
+                                                 FKawaiiPhysicsChainTemplate& OutTemplate)
+{
+	CollectModifyBones(Output, BoneContainer, OutTemplate.ModifyBones);
+
+	// The rest data must not depend on the pose of the instance that happens to build the template
+	TArray<FTransform> RefPoseComponentSpace;
+	FAnimationRuntime::FillUpComponentSpaceTransforms(BoneContainer.GetReferenceSkeleton(),
+	                                                  BoneContainer.GetRefPoseArray(), RefPoseComponentSpace);
+	PoseModifyBones(OutTemplate.ModifyBones, [&RefPoseComponentSpace](const FKawaiiPhysicsModifyBone& Bone)
+	{
+		return RefPoseComponentSpace.IsValidIndex(Bone.BoneRef.BoneIndex)
+			       ? RefPoseComponentSpace[Bone.BoneRef.BoneIndex]
+			       : FTransform::Identity;
+	});
+
+	OutTemplate.ModifyBoneIndexMap.Reserve(OutTemplate.ModifyBones.Num());
+	for (int32 i = 0; i < OutTemplate.ModifyBones.Num(); ++i)
+	{
+		OutTemplate.ModifyBoneIndexMap.FindOrAdd(OutTemplate.ModifyBones[i].BoneRef.BoneName, i);
+	}
+
+	ApplyBoneConstraintDataAsset(BoneContainer);
+	BuildBoneConstraints(OutTemplate.ModifyBones, [&OutTemplate](const FName& BoneName)
+	{
+		const int32* Index = OutTemplate.ModifyBoneIndexMap.Find(BoneName);
+		return Index ? *Index : INDEX_NONE;
+	}, OutTemplate.BoneConstraints, OutTemplate.BoneConstraintColorStarts);
+}
+
+void FAnimNode_KawaiiPhysics::DetachChainTemplate()
+{
+	if (!ChainTemplate)
+	{
+		return;
+	}
+
+	MergedBoneConstraints = ChainTemplate->BoneConstraints;
+	BoneConstraintColorStarts = ChainTemplate->BoneConstraintColorStarts;
+	ChainTemplate.Reset();
+}
+
+TSharedRef<const FKawaiiPhysicsChainTemplate, ESPMode::ThreadSafe> FKawaiiPhysicsChainTemplate::FindOrBuild(
+	const FKawaiiPhysicsChainTemplateKey& Key, TFunctionRef<void(FKawaiiPhysicsChainTemplate&)> Build)
+{
+	static FCriticalSection TemplatesLock;
+	static TMap<FKawaiiPhysicsChainTemplateKey, TWeakPtr<const FKawaiiPhysicsChainTemplate, ESPMode::ThreadSafe>>
+		Templates;
+
+	// Held while building, so that a crowd initializing on several threads builds the template only once
+	FScopeLock Lock(&TemplatesLock);
+	if (const auto* WeakTemplate = Templates.Find(Key))
+	{
+		if (TSharedPtr<const FKawaiiPhysicsChainTemplate, ESPMode::ThreadSafe> Template = WeakTemplate->Pin())
+		{
+			return Template.ToSharedRef();
+		}
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_BuildChainTemplate);
+
+	TSharedRef<FKawaiiPhysicsChainTemplate, ESPMode::ThreadSafe> Template =
+		MakeShared<FKawaiiPhysicsChainTemplate, ESPMode::ThreadSafe>();
+	Build(*Template);
+
+	// Forget the templates no node uses anymore
+	for (auto It = Templates.CreateIterator(); It; ++It)
+	{
+		if (!It.Value().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+	Templates.Add(Key, Template);
+
+	return Template;
+}
+
+void FAnimNode_KawaiiPhysics::BuildModifyBoneIndexMap()
+{
+	ModifyBoneIndexMap.Reset();
+	ModifyBoneIndexMap.Reserve(ModifyBones.Num());
+	for (int32 i = 0; i < ModifyBones.Num(); ++i)
+	{
+		// Keep the first one, like a linear search would
+		ModifyBoneIndexMap.FindOrAdd(ModifyBones[i].BoneRef.BoneName, i);
+	}
+}
+
+bool FAnimNode_KawaiiPhysics::SortModifyBonesInParentOrder()
+{
+	const int32 NumBones = ModifyBones.Num();
+
+	bool bSorted = true;
+	TArray<TArray<int32>> Children;
+	Children.SetNum(NumBones);
+	TArray<int32> Order;
+	Order.Reserve(NumBones);
+	for (int32 i = 0; i < NumBones; ++i)
+	{
+		const int32 ParentIndex = ModifyBones[i].ParentIndex;
+		if (ParentIndex >= NumBones || ParentIndex == i)
+		{
+			return false;
+		}
+		if (ParentIndex < 0)
+		{
+			Order.Add(i);
+		}
+		else
+		{
+			Children[ParentIndex].Add(i);
+			bSorted &= ParentIndex < i;
+		}
+	}
+	if (bSorted)
+	{
+		return true;
+	}
+
+	// Breadth first from the roots. Bones on a cycle are never reached
+	for (int32 OrderIndex = 0; OrderIndex < Order.Num(); ++OrderIndex)
+	{
+		Order.Append(Children[Order[OrderIndex]]);
+	}
+	if (Order.Num() != NumBones)
+	{
+		return false;
+	}
+
+	TArray<int32> NewIndices;
+	NewIndices.SetNumUninitialized(NumBones);
+	for (int32 i = 0; i < NumBones; ++i)
+	{
+		NewIndices[Order[i]] = i;
+	}
+
+	TArray<FKawaiiPhysicsModifyBone> SortedBones;
+	SortedBones.Reserve(NumBones);
+	for (const int32 OldIndex : Order)
+	{
+		FKawaiiPhysicsModifyBone& Bone = SortedBones.Add_GetRef(MoveTemp(ModifyBones[OldIndex]));
+		Bone.Index = NewIndices[OldIndex];
+		if (Bone.ParentIndex >= 0)
+		{
+			Bone.ParentIndex = NewIndices[Bone.ParentIndex];
+		}
+		Bone.ChildIndices.RemoveAll([NumBones](int32 ChildIndex)
+		{
+			return ChildIndex < 0 || ChildIndex >= NumBones;
+		});
+		for (int32& ChildIndex : Bone.ChildIndices)
+		{
+			ChildIndex = NewIndices[ChildIndex];
+		}
+	}
+	ModifyBones = MoveTemp(SortedBones);
+
+	return true;
+}
+
+void FAnimNode_KawaiiPhysics::ApplyLimitsDataAsset(const FBoneContainer& RequiredBones)
+{
+	auto Initialize = [&RequiredBones](auto& Targets)
+	{
+		for (auto& Target : Targets)
+		{
+			Target.DrivingBone.Initialize(RequiredBones);
+		}
+	};
+	auto RemoveAllSourceDataAssets = [](auto& Targets)
+	{
+		Targets.RemoveAll([](const FCollisionLimitBase& Limit)
+		{
+			return Limit.SourceType == ECollisionSourceType::DataAsset;
+		});
+	};
+
+	RemoveAllSourceDataAssets(SphericalLimitsData);
+	RemoveAllSourceDataAssets(CapsuleLimitsData);
+	RemoveAllSourceDataAssets(BoxLimitsData);
+	RemoveAllSourceDataAssets(PlanarLimitsData);
+
+	if (LimitsDataAsset)
+	{
+		SphericalLimitsData.Append(LimitsDataAsset->SphericalLimits);
+		CapsuleLimitsData.Append(LimitsDataAsset->CapsuleLimits);
+		BoxLimitsData.Append(LimitsDataAsset->BoxLimits);
+		PlanarLimitsData.Append(LimitsDataAsset->PlanarLimits);
+
+		Initialize(SphericalLimitsData);
+		Initialize(CapsuleLimitsData);
+		Initialize(BoxLimitsData);
+		Initialize(PlanarLimitsData);
+	}
+}
+
+void FAnimNode_KawaiiPhysics::ApplyPhysicsAsset(const FBoneContainer& RequiredBones)
+{
+	auto Initialize = [&RequiredBones](auto& Targets)
+	{
+		for (auto& Target : Targets)
+		{
+			Target.DrivingBone.Initialize(RequiredBones);
+		}
+	};
+	auto RemoveAllSourcePhysicsAssets = [](auto& Targets)
+	{
+		Targets.RemoveAll([](const FCollisionLimitBase& Limit)
+		{
+			return Limit.SourceType == ECollisionSourceType::PhysicsAsset;
+		});
+	};
+
+	RemoveAllSourcePhysicsAssets(SphericalLimitsData);
+	RemoveAllSourcePhysicsAssets(CapsuleLimitsData);
+	RemoveAllSourcePhysicsAssets(BoxLimitsData);
+
+	if (PhysicsAssetForLimits)
+	{
+		for (const auto& BodySetup : PhysicsAssetForLimits->SkeletalBodySetups)
+		{
+			FBoneReference DrivingBone = BodySetup->BoneName;
+			DrivingBone.Initialize(RequiredBones);
+			if (!DrivingBone.IsValidToEvaluate(RequiredBones))
+			{
+				continue;
+			}
+
+			const FKAggregateGeom& AggGeom = BodySetup->AggGeom;
+			for (const auto& SphereElem : AggGeom.SphereElems)
+			{
+				FSphericalLimit NewLimit;
+				NewLimit.DrivingBone = DrivingBone;
+				NewLimit.OffsetLocation = SphereElem.Center;
+				NewLimit.Radius = SphereElem.Radius;
+				NewLimit.SourceType = ECollisionSourceType::PhysicsAsset;
+				SphericalLimitsData.Add(NewLimit);
+			}
+			for (const auto& CapsuleElem : AggGeom.SphylElems)
+			{
+				FCapsuleLimit NewLimit;
+				NewLimit.DrivingBone = DrivingBone;
+				NewLimit.OffsetLocation = CapsuleElem.Center;
+				NewLimit.OffsetRotation = CapsuleElem.Rotation;
+				NewLimit.Length = CapsuleElem.Length;
+				NewLimit.Radius = CapsuleElem.Radius;
+				NewLimit.SourceType = ECollisionSourceType::PhysicsAsset;
+				CapsuleLimitsData.Add(NewLimit);
+			}
+			for (const auto& BoxElem : AggGeom.BoxElems)
+			{
+				FBoxLimit NewLimit;
+				NewLimit.DrivingBone = DrivingBone;
+				NewLimit.OffsetLocation = BoxElem.Center;
+				NewLimit.OffsetRotation = BoxElem.Rotation;
+				NewLimit.Extent = FVector(BoxElem.X, BoxElem.Y, BoxElem.Z) / 2.0f;
+				NewLimit.SourceType = ECollisionSourceType::PhysicsAsset;
+				BoxLimitsData.Add(NewLimit);
+			}
+		}
+
+		Initialize(SphericalLimitsData);
+		Initialize(CapsuleLimitsData);
+		Initialize(BoxLimitsData);
+	}
+}
+
+void FAnimNode_KawaiiPhysics::ApplyBoneConstraintDataAsset(const FBoneContainer& RequiredBones)
+{
+	BoneConstraintsData.Empty();
+	if (BoneConstraintsDataAsset)
+	{
+		BoneConstraintsData = BoneConstraintsDataAsset->GenerateBoneConstraints();
+		for (auto& BoneConstraint : BoneConstraintsData)
+		{
+			BoneConstraint.InitializeBone(RequiredBones);
+		}
+	}
+}
+
+int32 FAnimNode_KawaiiPhysics::AddModifyBone(TArray<FKawaiiPhysicsModifyBone>& InModifyBones,
+                                             FComponentSpacePoseContext& Output, const FBoneContainer& BoneContainer,
+                                             const FReferenceSkeleton& RefSkeleton, int32 BoneIndex,
+                                             const TArray<FBoneReference>& InExcludeBones)
+{
+	if (BoneIndex < 0 || RefSkeleton.GetNum() < BoneIndex)
+	{
+		return INDEX_NONE;
+	}
+
+	FBoneReference BoneRef;
+	BoneRef.BoneName = RefSkeleton.GetBoneName(BoneIndex);
+
+	if (InExcludeBones.Num() > 0 && InExcludeBones.Find(BoneRef) >= 0)
+	{
+		return INDEX_NONE;
+	}
+
+	FKawaiiPhysicsModifyBone NewModifyBone;
+	NewModifyBone.BoneRef = BoneRef;
+	NewModifyBone.BoneRef.Initialize(BoneContainer);
+	if (NewModifyBone.BoneRef.CachedCompactPoseIndex == INDEX_NONE)
+	{
+		return INDEX_NONE;
+	}
+
+	auto& RefBonePoseTransform = Output.Pose.GetComponentSpaceTransform(NewModifyBone.BoneRef.CachedCompactPoseIndex);
+	NewModifyBone.Location = RefBonePoseTransform.GetLocation();
+	NewModifyBone.PrevLocation = NewModifyBone.Location;
+	NewModifyBone.PoseLocation = NewModifyBone.Location;
+	NewModifyBone.PrevRotation = RefBonePoseTransform.GetRotation();
+	NewModifyBone.PoseRotation = NewModifyBone.PrevRotation;
+	NewModifyBone.PoseScale = RefBonePoseTransform.GetScale3D();
+
+	int32 ModifyBoneIndex = InModifyBones.Add(NewModifyBone);
+	InModifyBones[ModifyBoneIndex].Index = ModifyBoneIndex;
+
+	TArray<int32> ChildBoneIndices;
+	CollectChildBones(RefSkeleton, BoneIndex, ChildBoneIndices);
+	bool AddedChildBone = false;
+	if (ChildBoneIndices.Num() > 0)
+	{
+		//for some mesh where tip bone is empty (without any skinning weight in the mesh), ChildBoneIndices > 0 but no actual child bones are created
+		for (auto ChildBoneIndex : ChildBoneIndices)
+		{
+			int32 ChildModifyBoneIndex = AddModifyBone(InModifyBones, Output, BoneContainer, RefSkeleton,
+			                                           ChildBoneIndex,
+			                                           InExcludeBones);
+			if (ChildModifyBoneIndex >= 0)
+			{
+				InModifyBones[ModifyBoneIndex].ChildIndices.Add(ChildModifyBoneIndex);
+				InModifyBones[ChildModifyBoneIndex].ParentIndex = ModifyBoneIndex;
+				AddedChildBone = true;
+			}
+		}
+	}
+
+	if (!AddedChildBone && DummyBoneLength > 0.0f)
+	{
+		// Add dummy modify bone
+		FKawaiiPhysicsModifyBone DummyModifyBone;
+		DummyModifyBone.bDummy = true;
+		DummyModifyBone.Location = NewModifyBone.Location + GetBoneForwardVector(NewModifyBone.PrevRotation) *
+			DummyBoneLength;
+		DummyModifyBone.PrevLocation = DummyModifyBone.Location;
+		DummyModifyBone.PoseLocation = DummyModifyBone.Location;
+		DummyModifyBone.PrevRotation = NewModifyBone.PrevRotation;
+		DummyModifyBone.PoseRotation = DummyModifyBone.PrevRotation;
+		DummyModifyBone.PoseScale = RefBonePoseTransform.GetScale3D();
+
+		int32 DummyBoneIndex = InModifyBones.Add(DummyModifyBone);
+		InModifyBones[ModifyBoneIndex].ChildIndices.Add(DummyBoneIndex);
+		InModifyBones[DummyBoneIndex].Index = DummyBoneIndex;
+		InModifyBones[DummyBoneIndex].ParentIndex = ModifyBoneIndex;
+	}
+
+
+	return ModifyBoneIndex;
+}
+
+int32 FAnimNode_KawaiiPhysics::CollectChildBones(const FReferenceSkeleton& RefSkeleton, int32 ParentBoneIndex,
+                                                 TArray<int32>& Children) const
+{
+	Children.Reset();
+
+	const int32 NumBones = RefSkeleton.GetNum();
+	for (int32 ChildIndex = ParentBoneIndex + 1; ChildIndex < NumBones; ChildIndex++)
+	{
+		if (ParentBoneIndex == RefSkeleton.GetParentIndex(ChildIndex))
+		{
+			Children.Add(ChildIndex);
+		}
+	}
+
+	return Children.Num();
+}
+
+void FAnimNode_KawaiiPhysics::CalcBoneLength(FKawaiiPhysicsModifyBone& Bone,
+                                             TArray<FKawaiiPhysicsModifyBone>& InModifyBones,
+                                             const TArray<FTransform>& RefBonePose,
+                                             float& TotalBoneLength)
+{
+	if (Bone.ParentIndex < 0)
+	{
+		Bone.LengthFromRoot = 0.0f;
+	}
+	else
+	{
+		if (!Bone.bDummy)
+		{
+			Bone.LengthFromRoot = InModifyBones[Bone.ParentIndex].LengthFromRoot
+				+ RefBonePose[Bone.BoneRef.BoneIndex].GetLocation().Size();
+		}
+		else
+		{
+			Bone.LengthFromRoot = InModifyBones[Bone.ParentIndex].LengthFromRoot + DummyBoneLength;
+		}
+
+		TotalBoneLength = FMath::Max(TotalBoneLength, Bone.LengthFromRoot);
+	}
+
+	for (const int32 ChildIndex : Bone.ChildIndices)
+	{
+		CalcBoneLength(InModifyBones[ChildIndex], InModifyBones, RefBonePose, TotalBoneLength);
+	}
+}
+
+
+void FAnimNode_KawaiiPhysics::UpdatePhysicsSettingsOfModifyBones()
+{
+	for (FKawaiiPhysicsModifyBone& Bone : ModifyBones)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_UpdatePhysicsSetting);
+
+		const float LengthRate = Bone.LengthRateFromRoot;
+
+		// Damping
+		Bone.PhysicsSettings.Damping = PhysicsSettings.Damping;
+		if (!DampingCurveData.GetRichCurve()->IsEmpty())
+		{
+			Bone.PhysicsSettings.Damping *= DampingCurveData.GetRichCurve()->Eval(LengthRate);
+		}
+		Bone.PhysicsSettings.Damping = FMath::Clamp(Bone.PhysicsSettings.Damping, 0.0f, 1.0f);
 
 		// WorldLocationDamping
 		Bone.PhysicsSettings.WorldDampingLocation = PhysicsSettings.WorldDampingLocation;
 		if (!WorldDampingLocationCurveData.GetRichCurve()->IsEmpty())
 		{
-			Bone.PhysicsSettings.WorldDampingLocation *= WorldDampingLocationCurveData.GetRichCurve()->Eval(LengthRate);
+			Bone.PhysicsSettings.WorldDampingLocation *= WorldDampingLocationCurveData.GetRichCurve()->Eval(LengthRate);
+		}
+		Bone.PhysicsSettings.WorldDampingLocation = FMath::Clamp(Bone.PhysicsSettings.WorldDampingLocation, 0.0f,
+		                                                         1.0f);
+
+		// WorldRotationDamping
+		Bone.PhysicsSettings.WorldDampingRotation = PhysicsSettings.WorldDampingRotation;
+		if (!WorldDampingRotationCurveData.GetRichCurve()->IsEmpty())
+		{
+			Bone.PhysicsSettings.WorldDampingRotation *= WorldDampingRotationCurveData.GetRichCurve()->Eval(LengthRate);
+		}
+		Bone.PhysicsSettings.WorldDampingRotation = FMath::Clamp(Bone.PhysicsSettings.WorldDampingRotation, 0.0f,
+		                                                         1.0f);
+
+		// Stiffness
+		Bone.PhysicsSettings.Stiffness = PhysicsSettings.Stiffness;
+		if (!StiffnessCurveData.GetRichCurve()->IsEmpty())
+		{
+			Bone.PhysicsSettings.Stiffness *= StiffnessCurveData.GetRichCurve()->Eval(LengthRate);
+		}
+		Bone.PhysicsSettings.Stiffness = FMath::Clamp(Bone.PhysicsSettings.Stiffness, 0.0f, 1.0f);
+
+		// Radius
+		Bone.PhysicsSettings.Radius = PhysicsSettings.Radius;
+		if (!RadiusCurveData.GetRichCurve()->IsEmpty())
+		{
+			Bone.PhysicsSettings.Radius *= RadiusCurveData.GetRichCurve()->Eval(LengthRate);
+		}
+		Bone.PhysicsSettings.Radius = FMath::Max(Bone.PhysicsSettings.Radius, 0.0f);
+
+		// LimitAngle
+		Bone.PhysicsSettings.LimitAngle = PhysicsSettings.LimitAngle;
+		if (!LimitAngleCurveData.GetRichCurve()->IsEmpty())
+		{
+			Bone.PhysicsSettings.LimitAngle *= LimitAngleCurveData.GetRichCurve()->Eval(LengthRate);
+		}
+		Bone.PhysicsSettings.LimitAngle = FMath::Max(Bone.PhysicsSettings.LimitAngle, 0.0f);
+
+		SolverState.SetPhysicsSettings(Bone.Index, Bone.PhysicsSettings);
+	}
+
+	BakedPhysicsSettings = PhysicsSettings;
+	BakedCurveDataHash = CalcCurveDataHash();
+	bPhysicsSettingsDirty = false;
+}
+
+uint32 FAnimNode_KawaiiPhysics::CalcCurveDataHash() const
+{
+	uint32 Hash = HashCurve(DampingCurveData, 0);
+	Hash = HashCurve(StiffnessCurveData, Hash);
+	Hash = HashCurve(WorldDampingLocationCurveData, Hash);
+	Hash = HashCurve(WorldDampingRotationCurveData, Hash);
+	Hash = HashCurve(RadiusCurveData, Hash);
+	return HashCurve(LimitAngleCurveData, Hash);
+}
+
+
+void FAnimNode_KawaiiPhysics::UpdateSphericalLimits(TArray<FSphericalLimit>& Limits, FComponentSpacePoseContext& Output,
+                                                    const FBoneContainer& BoneContainer,
+                                                    const FTransform& ComponentTransform)
+{
+	for (auto& Sphere : Limits)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_UpdateSphericalLimit);
+
+		if (Sphere.DrivingBone.IsValidToEvaluate(BoneContainer))
+		{
+			const FCompactPoseBoneIndex CompactPoseIndex = Sphere.DrivingBone.GetCompactPoseIndex(BoneContainer);
+			FTransform BoneTransform = Output.Pose.GetComponentSpaceTransform(CompactPoseIndex);
+
+			FAnimationRuntime::ConvertCSTransformToBoneSpace(ComponentTransform, Output.Pose, BoneTransform,
+			                                                 CompactPoseIndex, BCS_BoneSpace);
+			BoneTransform.SetRotation(Sphere.OffsetRotation.Quaternion() * BoneTransform.GetRotation());
+			BoneTransform.AddToTranslation(Sphere.OffsetLocation);
+
+			FAnimationRuntime::ConvertBoneSpaceTransformToCS(ComponentTransform, Output.Pose, BoneTransform,
+			                                                 CompactPoseIndex, BCS_BoneSpace);
+			Sphere.Location = BoneTransform.GetLocation();
+			Sphere.Rotation = BoneTransform.GetRotation();
+
+			Sphere.bEnable = true;
+		}
+		else
+		{
+			Sphere.bEnable = false;
+		}
+	}
+}
+
+void FAnimNode_KawaiiPhysics::UpdateCapsuleLimits(TArray<FCapsuleLimit>& Limits, FComponentSpacePoseContext& Output,
+                                                  const FBoneContainer& BoneContainer,
+                                                  const FTransform& ComponentTransform)
+{
+	for (auto& Capsule : Limits)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_UpdateCapsuleLimit);
+
+		if (Capsule.DrivingBone.IsValidToEvaluate(BoneContainer))
+		{
+			const FCompactPoseBoneIndex CompactPoseIndex = Capsule.DrivingBone.GetCompactPoseIndex(BoneContainer);
+			FTransform BoneTransform = Output.Pose.GetComponentSpaceTransform(CompactPoseIndex);
+
+			FAnimationRuntime::ConvertCSTransformToBoneSpace(ComponentTransform, Output.Pose, BoneTransform,
+			                                                 CompactPoseIndex, BCS_BoneSpace);
+			BoneTransform.SetRotation(Capsule.OffsetRotation.Quaternion() * BoneTransform.GetRotation());
+			BoneTransform.AddToTranslation(Capsule.OffsetLocation);
+
+			FAnimationRuntime::ConvertBoneSpaceTransformToCS(ComponentTransform, Output.Pose, BoneTransform,
+			                                                 CompactPoseIndex, BCS_BoneSpace);
+			Capsule.Location = BoneTransform.GetLocation();
+			Capsule.Rotation = BoneTransform.GetRotation();
+
+			Capsule.bEnable = true;
+		}
+		else
+		{
+			Capsule.bEnable = false;
+		}
+	}
+}
+
+void FAnimNode_KawaiiPhysics::UpdateBoxLimits(TArray<FBoxLimit>& Limits, FComponentSpacePoseContext& Output,
+                                              const FBoneContainer& BoneContainer,
+                                              const FTransform& ComponentTransform)
+{
+	for (auto& Box : Limits)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_UpdateBoxLimit);
+
+		if (Box.DrivingBone.IsValidToEvaluate(BoneContainer))
+		{
+			const FCompactPoseBoneIndex CompactPoseIndex = Box.DrivingBone.GetCompactPoseIndex(BoneContainer);
+			FTransform BoneTransform = Output.Pose.GetComponentSpaceTransform(CompactPoseIndex);
+
+			FAnimationRuntime::ConvertCSTransformToBoneSpace(ComponentTransform, Output.Pose, BoneTransform,
+			                                                 CompactPoseIndex, BCS_BoneSpace);
+			BoneTransform.SetRotation(Box.OffsetRotation.Quaternion() * BoneTransform.GetRotation());
+			BoneTransform.AddToTranslation(Box.OffsetLocation);
+
+			FAnimationRuntime::ConvertBoneSpaceTransformToCS(ComponentTransform, Output.Pose, BoneTransform,
+			                                                 CompactPoseIndex, BCS_BoneSpace);
+			Box.Location = BoneTransform.GetLocation();
+			Box.Rotation = BoneTransform.GetRotation();
+
+			Box.bEnable = true;
+		}
+		else
+		{
+			Box.bEnable = false;
+		}
+	}
+}
+
+void FAnimNode_KawaiiPhysics::UpdatePlanerLimits(TArray<FPlanarLimit>& Limits, FComponentSpacePoseContext& Output,
+                                                 const FBoneContainer& BoneContainer,
+                                                 const FTransform& ComponentTransform)
+{
+	for (auto& Planar : Limits)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_UpdatePlanerLimit);
+
+		if (Planar.DrivingBone.IsValidToEvaluate(BoneContainer))
+		{
+			const FCompactPoseBoneIndex CompactPoseIndex = Planar.DrivingBone.GetCompactPoseIndex(BoneContainer);
+			FTransform BoneTransform = Output.Pose.GetComponentSpaceTransform(CompactPoseIndex);
+
+			FAnimationRuntime::ConvertCSTransformToBoneSpace(ComponentTransform, Output.Pose, BoneTransform,
+			                                                 CompactPoseIndex, BCS_BoneSpace);
+			BoneTransform.SetRotation(Planar.OffsetRotation.Quaternion() * BoneTransform.GetRotation());
+			BoneTransform.AddToTranslation(Planar.OffsetLocation);
+
+			FAnimationRuntime::ConvertBoneSpaceTransformToCS(ComponentTransform, Output.Pose, BoneTransform,
+			                                                 CompactPoseIndex, BCS_BoneSpace);
+			Planar.Location = BoneTransform.GetLocation();
+			Planar.Rotation = BoneTransform.GetRotation();
+			Planar.Rotation.Normalize();
+			Planar.Plane = FPlane(Planar.Location, Planar.Rotation.GetUpVector());
+
+			Planar.bEnable = true;
+		}
+		else
+		{
+			Planar.Location = Planar.OffsetLocation;
+			Planar.Rotation = Planar.OffsetRotation.Quaternion();
+			Planar.Rotation.Normalize();
+			Planar.Plane = FPlane(Planar.Location, Planar.Rotation.GetUpVector());
+
+			// Maybe the DrivingBone is set to empty for the floor, so keep Enable
+			// Planar.bEnable = false;
 		}
-		Bone.PhysicsSettings.WorldDampingLocation = FMath::Clamp(Bone.PhysicsSettings.WorldDampingLocation, 0.0f,
-		                                                         1.0f);
+	}
+}
 
-		// WorldRotationDamping
-		Bone.PhysicsSettings.WorldDampingRotation = PhysicsSettings.WorldDampingRotation;
-		if (!WorldDampingRotationCurveData.GetRichCurve()->IsEmpty())
+void FAnimNode_KawaiiPhysics::UpdateDistanceFieldLimits(TArray<FDistanceFieldLimit>& Limits,
+                                                        FComponentSpacePoseContext& Output,
+                                                        const FBoneContainer& BoneContainer,
+                                                        const FTransform& ComponentTransform)
+{
+	for (auto& DistanceField : Limits)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_UpdateDistanceFieldLimit);
+
+		if (DistanceField.DrivingBone.IsValidToEvaluate(BoneContainer) && DistanceField.DistanceField &&
+			DistanceField.DistanceField->DistanceField.IsValid())
 		{
-			Bone.PhysicsSettings.WorldDampingRotation *= WorldDampingRotationCurveData.GetRichCurve()->Eval(LengthRate);
+			const FCompactPoseBoneIndex CompactPoseIndex =
+				DistanceField.DrivingBone.GetCompactPoseIndex(BoneContainer);
+			FTransform BoneTransform = Output.Pose.GetComponentSpaceTransform(CompactPoseIndex);
+
+			FAnimationRuntime::ConvertCSTransformToBoneSpace(ComponentTransform, Output.Pose, BoneTransform,
+			                                                 CompactPoseIndex, BCS_BoneSpace);
+			BoneTransform.SetRotation(DistanceField.OffsetRotation.Quaternion() * BoneTransform.GetRotation());
+			BoneTransform.AddToTranslation(DistanceField.OffsetLocation);
+
+			FAnimationRuntime::ConvertBoneSpaceTransformToCS(ComponentTransform, Output.Pose, BoneTransform,
+			                                                 CompactPoseIndex, BCS_BoneSpace);
+			DistanceField.Location = BoneTransform.GetLocation();
+			DistanceField.Rotation = BoneTransform.GetRotation();
+
+			DistanceField.bEnable = true;
 		}
-		Bone.PhysicsSettings.WorldDampingRotation = FMath::Clamp(Bone.PhysicsSettings.WorldDampingRotation, 0.0f,
-		                                                         1.0f);
+		else
+		{
+			DistanceField.bEnable = false;
+		}
+	}
+}
 
-		// Stiffness
-		Bone.PhysicsSettings.Stiffness = PhysicsSettings.Stiffness;
-		if (!StiffnessCurveData.GetRichCurve()->IsEmpty())
+void FAnimNode_KawaiiPhysics::UpdateModifyBonesPoseTransform(FComponentSpacePoseContext& Output,
+                                                             const FBoneContainer& BoneContainer)
+{
+	if (bCompactPoseIndicesDirty || ModifyBoneCompactPoseIndices.Num() != ModifyBones.Num())
+	{
+		CacheCompactPoseIndices(BoneContainer);
+	}
+
+	// The pose is also kept up to date while the locations are compacted, for the chain to resume from
+	for (int32 i = 0; i < SolverState.PoseLocations.Num(); ++i)
+	{
+		if (!SolverState.bDummies[i])
 		{
-			Bone.PhysicsSettings.Stiffness *= StiffnessCurveData.GetRichCurve()->Eval(LengthRate);
+			const FCompactPoseBoneIndex CompactPoseIndex = ModifyBoneCompactPoseIndices[i];
+			if (CompactPoseIndex < 0)
+			{
+				// Reset bone location and rotation may cause trouble when switching between skeleton LODs #44
+				if (ResetBoneTransformWhenBoneNotFound)
+				{
+					SolverState.PoseLocations[i] = FVector::ZeroVector;
+					SolverState.PoseRotations[i] = FQuat::Identity;
+					SolverState.PoseScales[i] = FVector::OneVector;
+				}
+				continue;
+			}
+
+			const auto ComponentSpaceTransform = Output.Pose.GetComponentSpaceTransform(CompactPoseIndex);
+			SolverState.PoseLocations[i] = ComponentSpaceTransform.GetLocation();
+			SolverState.PoseRotations[i] = ComponentSpaceTransform.GetRotation();
+			SolverState.PoseScales[i] = ComponentSpaceTransform.GetScale3D();
 		}
-		Bone.PhysicsSettings.Stiffness = FMath::Clamp(Bone.PhysicsSettings.Stiffness, 0.0f, 1.0f);
+		else
+		{
+			const int32 ParentIndex = SolverState.ParentIndices[i];
+			SolverState.PoseLocations[i] = SolverState.PoseLocations[ParentIndex] +
+				GetBoneForwardVector(SolverState.PoseRotations[ParentIndex]) * DummyBoneLength;
+			SolverState.PoseRotations[i] = SolverState.PoseRotations[ParentIndex];
+			SolverState.PoseScales[i] = SolverState.PoseScales[ParentIndex];
+		}
+	}
+	bModifyBonesViewDirty = true;
+}
 
-		// Radius
-		Bone.PhysicsSettings.Radius = PhysicsSettings.Radius;
-		if (!RadiusCurveData.GetRichCurve()->IsEmpty())
+void FAnimNode_KawaiiPhysics::UpdateSkelCompMove(const FTransform& ComponentTransform)
+{
+	SkelCompMoveVector = ComponentTransform.InverseTransformPosition(PreSkelCompTransform.GetLocation());
+	if (SkelCompMoveVector.SizeSquared() > TeleportDistanceThreshold * TeleportDistanceThreshold)
+	{
+		SkelCompMoveVector = FVector::ZeroVector;
+		bSkelCompTeleported = true;
+	}
+
+	SkelCompMoveRotation = ComponentTransform.InverseTransformRotation(PreSkelCompTransform.GetRotation());
+	if (TeleportRotationThreshold >= 0 && FMath::RadiansToDegrees(SkelCompMoveRotation.GetAngle()) >
+		TeleportRotationThreshold)
+	{
+		SkelCompMoveRotation = FQuat::Identity;
+		bSkelCompTeleported = true;
+	}
+
+	PreSkelCompTransform = ComponentTransform;
+}
+
+void FAnimNode_KawaiiPhysics::SyncModifyBonesView()
+{
+	if (!bModifyBonesViewDirty || SolverState.Num() != ModifyBones.Num())
+	{
+		return;
+	}
+
+	for (int32 i = 0; i < ModifyBones.Num(); ++i)
+	{
+		SolverState.WriteToModifyBone(i, ModifyBones[i]);
+	}
+	bModifyBonesViewDirty = false;
+}
+
+FKawaiiPhysicsModifyBone& FAnimNode_KawaiiPhysics::PushModifyBoneView(int32 Index)
+{
+	FKawaiiPhysicsModifyBone& ModifyBone = ModifyBones[Index];
+	SolverState.WriteToModifyBone(Index, ModifyBone);
+	return ModifyBone;
+}
+
+void FAnimNode_KawaiiPhysics::PullModifyBoneView(int32 Index)
+{
+	SolverState.Locations[Index] = ModifyBones[Index].Location;
+}
+
+FKawaiiPhysicsSolverParams FAnimNode_KawaiiPhysics::MakeSolverParams(const FTransform& ComponentTransform) const
+{
+	FKawaiiPhysicsSolverParams Params;
+	Params.DeltaTime = DeltaTime;
+	Params.DeltaTimeOld = DeltaTimeOld;
+	Params.TargetFramerate = TargetFramerate;
+	Params.GravityCS = ComponentTransform.InverseTransformVector(Gravity);
+	Params.SkelCompMoveVector = SkelCompMoveVector;
+	Params.SkelCompMoveRotation = SkelCompMoveRotation;
+	Params.PlanarConstraint = PlanarConstraint;
+	Params.BoneConstraintGlobalComplianceType = BoneConstraintGlobalComplianceType;
+	Params.BoneConstraintSolver = BoneConstraintSolver;
+	Params.BoneConstraintIterationCountAfterCollision = LODTier == EKawaiiPhysicsLODTier::Full
+		                                                    ? BoneConstraintIterationCountAfterCollision
+		                                                    : FMath::Min(BoneConstraintIterationCountAfterCollision,
+		                                                                 LODSettings.ReducedBoneConstraintIterationCount);
+	return Params;
+}
+
+void FAnimNode_KawaiiPhysics::SimulateModifyBones(FComponentSpacePoseContext& Output,
+                                                  const FTransform& ComponentTransform)
+{
+	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_SimulatemodifyBones);
+
+	if (DeltaTime <= 0.0f)
+	{
+		return;
+	}
+
+	const USkeletalMeshComponent* SkelComp = Output.AnimInstanceProxy->GetSkelMeshComponent();
+
+	if (CaptureWriter)
+	{
+		CaptureWriter->BeginStep(SolverState, GetMergedBoneConstraints(), GetBoneConstraintColorStarts(),
+		                         PackedLimits);
+	}
+
+	// Save Prev/Pose Info , Check SkipSimulate
+	KawaiiPhysicsSolver::PrepareStep(SolverState, SimulatedBoneIndices);
+
+	// Dormant chains keep their settled locations
+	if (SleepSettings.bEnable)
+	{
+		RemoveDormantBones();
+		if (SimulatedBoneIndices.IsEmpty())
+		{
+			if (CaptureWriter)
+			{
+				CaptureWriter->DiscardStep();
+			}
+			DeltaTimeOld = DeltaTime;
+			bModifyBonesViewDirty = true;
+			return;
+		}
+	}
+
+	// Time of each phase for the evaluation stats
+	uint64 PhaseStartCycle = bRecordEvaluationStats ? FPlatformTime::Cycles64() : 0;
+	auto EndPhase = [this, &PhaseStartCycle](uint64& OutCycles)
+	{
+		if (bRecordEvaluationStats)
+		{
+			const uint64 EndCycle = FPlatformTime::Cycles64();
+			OutCycles += EndCycle - PhaseStartCycle;
+			PhaseStartCycle = EndCycle;
+		}
+	};
+
+	// Bone by bone external forces read and write ModifyBones, so bring the view up to date before they run.
+	// Batched forces write the solver state directly
+	const bool bBatchExternalForces = CanBatchExternalForces();
+	if (!bBatchExternalForces && (CustomExternalForces.Num() > 0 || ExternalForces.Num() > 0))
+	{
+		bModifyBonesViewDirty = true;
+		SyncModifyBonesView();
+	}
+
+	// External Force : PreApply
+	// NOTE: if use foreach, you may get issue ( Array has changed during ranged-for iteration )
+	for (int i = 0; i < CustomExternalForces.Num(); ++i)
+	{
+		if (CustomExternalForces[i])
+		{
+			CustomExternalForces[i]->PreApply(*this, SkelComp);
+		}
+	}
+	for (int i = 0; i < ExternalForces.Num(); ++i)
+	{
+		if (ExternalForces[i].IsValid())
+		{
+			auto& Force = ExternalForces[i].GetMutable<FKawaiiPhysics_ExternalForce>();
+			Force.PreApply(*this, SkelComp);
+		}
+	}
+
+	// Simulate
+	const FKawaiiPhysicsSolverParams Params = MakeSolverParams(ComponentTransform);
+	WindGustTime += DeltaTime;
+
+	// The replay runs without the external forces and the world collision, so the capture keeps what they moved
+	// the bones by
+	TArray<FVector> CaptureLocations;
+	if (CaptureWriter)
+	{
+		CaptureWriter->SetParams(Params, ComponentTransform);
+		CaptureWriter->SetSimulatedBoneIndices(SimulatedBoneIndices);
+	}
+
+	if (bRecordEvaluationStats)
+	{
+		++EvaluationStats.NumSubsteps;
+		EvaluationStats.NumSimulatedBones += SimulatedBoneIndices.Num();
+		if (!GetMergedBoneConstraints().IsEmpty())
+		{
+			EvaluationStats.NumBoneConstraintIterations += Params.BoneConstraintIterationCountAfterCollision;
+		}
+	}
+	if (bBatchExternalForces)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_Simulate);
+
+		// Forces only move the bone they are applied to and PullToPose only reads the parent,
+		// which is pulled before its children either way, so this matches the bone by bone order
+		for (const int32 Index : SimulatedBoneIndices)
+		{
+			IntegrateBone(Index, Params);
+		}
+		if (CaptureWriter)
+		{
+			CaptureLocations = SolverState.Locations;
+		}
+		ApplyExternalForcesBatched(Output);
+		if (CaptureWriter)
+		{
+			for (const int32 Index : SimulatedBoneIndices)
+			{
+				CaptureWriter->AddExternalForceOffset(Index, SolverState.Locations[Index] - CaptureLocations[Index]);
+			}
+		}
+		const float Exponent = Params.GetExponent();
+		for (const int32 Index : SimulatedBoneIndices)
+		{
+			KawaiiPhysicsSolver::PullToPose(SolverState, Index, Exponent);
+		}
+	}
+	else
+	{
+		for (const int32 Index : SimulatedBoneIndices)
+		{
+			Simulate(Index, Params, SkelComp, Output);
+		}
+	}
+
+	// External Force : PostApply
+	for (int i = 0; i < ExternalForces.Num(); ++i)
+	{
+		if (ExternalForces[i].IsValid())
+		{
+			auto& Force = ExternalForces[i].GetMutable<FKawaiiPhysics_ExternalForce>();
+			Force.PostApply(*this);
+		}
+	}
+	EndPhase(EvaluationStats.SimulateCycles);
+
+	// Adjust by collisions
+	// Each bone is only pushed out of the limits based on its own location,
+	// so running the limits for all bones before the world collision gives the same result as doing it per bone.
+	{
+		SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_AdjustByCollision);
+
+		PackedLimits.AdjustBones(SolverState, SimulatedBoneIndices);
+		const bool bCaptureWorldCollision = CaptureWriter && IsWorldCollisionActive();
+		if (bCaptureWorldCollision)
+		{
+			CaptureLocations = SolverState.Locations;
+		}
+		if (IsWorldCollisionActive() && UseAsyncWorldCollision())
+		{
+			ApplyAsyncWorldCollision(ComponentTransform);
+			GatherAsyncWorldCollision(SkelComp, ComponentTransform);
+		}
+		else if (IsWorldCollisionActive() && SkelComp)
+		{
+			/** the trace is not done in game thread, so TraceTag does not draw debug traces*/
+			FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(KawaiiCollision));
+			if (bIgnoreSelfComponent)
+			{
+				QueryParams.AddIgnoredComponent(SkelComp);
+			}
+			ECollisionChannel TraceChannel;
+			FCollisionResponseParams ResponseParams;
+			GetWorldCollisionChannel(SkelComp, TraceChannel, ResponseParams);
+
+			for (const int32 Index : SimulatedBoneIndices)
+			{
+				AdjustByWorldCollision(Index, SkelComp, QueryParams, TraceChannel, ResponseParams);
+			}
+			if (bRecordEvaluationStats)
+			{
+				EvaluationStats.NumWorldSweeps += SimulatedBoneIndices.Num();
+			}
+		}
+		if (bCaptureWorldCollision)
+		{
+			for (const int32 Index : SimulatedBoneIndices)
+			{
+				CaptureWriter->AddWorldCollisionOffset(Index, SolverState.Locations[Index] - CaptureLocations[Index]);
+			}
+		}
+	}
+	EndPhase(EvaluationStats.CollisionCycles);
+
+	// Adjust by Bone Constraints After Collision
+	bool bMeasureBoneConstraints = false;
+#if WITH_EDITORONLY_DATA
+	bMeasureBoneConstraints |= bEditing;
+#endif
+#if ENABLE_ANIM_DEBUG
+	bMeasureBoneConstraints |= CVarAnimNodeKawaiiPhysicsDebugBoneConstraintMetrics.GetValueOnAnyThread();
+#endif
+	KawaiiPhysicsSolver::SolveBoneConstraints(SolverState, GetMergedBoneConstraints(), Params,
+	                                          GetBoneConstraintColorStarts(),
+	                                          bMeasureBoneConstraints ? &BoneConstraintMetrics : nullptr);
+	EndPhase(EvaluationStats.BoneConstraintCycles);
+
+	// Adjust by Limits ane Bone Length
+	KawaiiPhysicsSolver::FinishStep(SolverState, SimulatedBoneIndices, Params);
+	EndPhase(EvaluationStats.SimulateCycles);
+
+	if (CaptureWriter && !CaptureWriter->EndStep(SolverState))
+	{
+		CaptureWriter.Reset();
+	}
+
+	if (SleepSettings.bEnable)
+	{
+		UpdateSleepChains();
+	}
+
+	DeltaTimeOld = DeltaTime;
+	bModifyBonesViewDirty = true;
+}
+
+void FAnimNode_KawaiiPhysics::BuildSleepChains()
+{
+	const int32 NumBones = SolverState.Num();
+
+	// Every child of a root bone starts a chain. Bones are parent-sorted, so the parent's chain is already known
+	BoneSleepChains.Init(INDEX_NONE, NumBones);
+	TArray<int32> ChainRoots;
+	for (int32 i = 0; i < NumBones; ++i)
+	{
+		const int32 ParentIndex = SolverState.ParentIndices[i];
+		if (ParentIndex < 0)
+		{
+			continue;
+		}
+		if (SolverState.ParentIndices[ParentIndex] < 0)
+		{
+			BoneSleepChains[i] = ChainRoots.Add(ChainRoots.Num());
+		}
+		else
+		{
+			BoneSleepChains[i] = BoneSleepChains[ParentIndex];
+		}
+	}
+
+	// Merge the chains connected by bone constraints
+	auto FindRoot = [&ChainRoots](int32 Chain)
+	{
+		while (ChainRoots[Chain] != Chain)
+		{
+			ChainRoots[Chain] = ChainRoots[ChainRoots[Chain]];
+			Chain = ChainRoots[Chain];
+		}
+		return Chain;
+	};
+	for (const FModifyBoneConstraint& BoneConstraint : GetMergedBoneConstraints())
+	{
+		if (!BoneConstraint.IsBoneReferenceValid() || BoneConstraint.ModifyBoneIndex1 >= NumBones ||
+			BoneConstraint.ModifyBoneIndex2 >= NumBones)
+		{
+			continue;
+		}
+		const int32 Chain1 = BoneSleepChains[BoneConstraint.ModifyBoneIndex1];
+		const int32 Chain2 = BoneSleepChains[BoneConstraint.ModifyBoneIndex2];
+		if (Chain1 >= 0 && Chain2 >= 0)
 		{
-			Bone.PhysicsSettings.Radius *= RadiusCurveData.GetRichCurve()->Eval(LengthRate);
+			ChainRoots[FindRoot(Chain1)] = FindRoot(Chain2);
 		}
-		Bone.PhysicsSettings.Radius = FMath::Max(Bone.PhysicsSettings.Radius, 0.0f);
+	}
 
-		// LimitAngle
-		Bone.PhysicsSettings.LimitAngle = PhysicsSettings.LimitAngle;
-		if (!LimitAngleCurveData.GetRichCurve()->IsEmpty())
+	// Number the merged chains densely
+	TArray<int32> ChainIndices;
+	ChainIndices.Init(INDEX_NONE, ChainRoots.Num());
+	int32 NumChains = 0;
+	for (int32& Chain : BoneSleepChains)
+	{
+		if (Chain >= 0)
 		{
-			Bone.PhysicsSettings.LimitAngle *= LimitAngleCurveData.GetRichCurve()->Eval(LengthRate);
+			int32& ChainIndex = ChainIndices[FindRoot(Chain)];
+			if (ChainIndex < 0)
+			{
+				ChainIndex = NumChains++;
+			}
+			Chain = ChainIndex;
 		}
-		Bone.PhysicsSettings.LimitAngle = FMath::Max(Bone.PhysicsSettings.LimitAngle, 0.0f);
 	}
-}
 
+	SleepChainCalmSteps.Init(0, NumChains);
+	SleepChainMaxSpeedsSquared.SetNumUninitialized(NumChains);
+	SleepChainMaxPoseDeltasSquared.SetNumUninitialized(NumChains);
+	SleepPoseLocations = SolverState.PoseLocations;
+	NumDormantChains = 0;
+}
 
-void FAnimNode_KawaiiPhysics::UpdateSphericalLimits(TArray<FSphericalLimit>& Limits, FComponentSpacePoseContext& Output,
-                                                    const FBoneContainer& BoneContainer,
-                                                    const FTransform& ComponentTransform)
+void FAnimNode_KawaiiPhysics::WakeDormantChains()
 {
-	for (auto& Sphere : Limits)
+	if (BoneSleepChains.Num() != SolverState.Num())
 	{
-		SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_UpdateSphericalLimit);
-
-		if (Sphere.DrivingBone.IsValidToEvaluate(BoneContainer))
-		{
-			const FCompactPoseBoneIndex CompactPoseIndex = Sphere.DrivingBone.GetCompactPoseIndex(BoneContainer);
-			FTransform BoneTransform = Output.Pose.GetComponentSpaceTransform(CompactPoseIndex);
-
-			FAnimationRuntime::ConvertCSTransformToBoneSpace(ComponentTransform, Output.Pose, BoneTransform,
-			                                                 CompactPoseIndex, BCS_BoneSpace);
-			BoneTransform.SetRotation(Sphere.OffsetRotation.Quaternion() * BoneTransform.GetRotation());
-			BoneTransform.AddToTranslation(Sphere.OffsetLocation);
+		BuildSleepChains();
+	}
 
-			FAnimationRuntime::ConvertBoneSpaceTransformToCS(ComponentTransform, Output.Pose, BoneTransform,
-			                                                 CompactPoseIndex, BCS_BoneSpace);
-			Sphere.Location = BoneTransform.GetLocation();
-			Sphere.Rotation = BoneTransform.GetRotation();
+	const bool bTeleported = bSkelCompTeleported;
+	bSkelCompTeleported = false;
 
-			Sphere.bEnable = true;
+	if (NumDormantChains > 0)
+	{
+		bool bHasActiveExternalForce = false;
+		for (int i = 0; i < CustomExternalForces.Num() && !bHasActiveExternalForce; ++i)
+		{
+			bHasActiveExternalForce = CustomExternalForces[i] && CustomExternalForces[i]->bIsEnabled;
 		}
-		else
+		for (int i = 0; i < ExternalForces.Num() && !bHasActiveExternalForce; ++i)
 		{
-			Sphere.bEnable = false;
+			bHasActiveExternalForce = ExternalForces[i].IsValid() &&
+				ExternalForces[i].Get<FKawaiiPhysics_ExternalForce>().bIsEnabled;
 		}
-	}
-}
 
-void FAnimNode_KawaiiPhysics::UpdateCapsuleLimits(TArray<FCapsuleLimit>& Limits, FComponentSpacePoseContext& Output,
-                                                  const FBoneContainer& BoneContainer,
-                                                  const FTransform& ComponentTransform)
-{
-	for (auto& Capsule : Limits)
-	{
-		SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_UpdateCapsuleLimit);
+		const bool bWakeAll = bTeleported || bHasActiveExternalForce ||
+			SkelCompMoveVector.SizeSquared() > FMath::Square(SleepSettings.WakeMoveThreshold) ||
+			FMath::RadiansToDegrees(SkelCompMoveRotation.GetAngle()) > SleepSettings.WakeRotationThreshold;
 
-		if (Capsule.DrivingBone.IsValidToEvaluate(BoneContainer))
+		// Pose change since the chain went dormant, and wind at the first bone of the chain
+		for (float& PoseDeltaSquared : SleepChainMaxPoseDeltasSquared)
 		{
-			const FCompactPoseBoneIndex CompactPoseIndex = Capsule.DrivingBone.GetCompactPoseIndex(BoneContainer);
-			FTransform BoneTransform = Output.Pose.GetComponentSpaceTransform(CompactPoseIndex);
-
-			FAnimationRuntime::ConvertCSTransformToBoneSpace(ComponentTransform, Output.Pose, BoneTransform,
-			                                                 CompactPoseIndex, BCS_BoneSpace);
-			BoneTransform.SetRotation(Capsule.OffsetRotation.Quaternion() * BoneTransform.GetRotation());
-			BoneTransform.AddToTranslation(Capsule.OffsetLocation);
+			PoseDeltaSquared = 0.0f;
+		}
+		TBitArray<> WindSampled(false, SleepChainCalmSteps.Num());
+		const bool bSampleWind = !bWakeAll && HasWindSamples();
+		for (int32 i = 0; i < SolverState.Num() && !bWakeAll; ++i)
+		{
+			const int32 Chain = BoneSleepChains[i];
+			if (Chain < 0 || !IsSleepChainDormant(Chain))
+			{
+				continue;
+			}
 
-			FAnimationRuntime::ConvertBoneSpaceTransformToCS(ComponentTransform, Output.Pose, BoneTransform,
-			                                                 CompactPoseIndex, BCS_BoneSpace);
-			Capsule.Location = BoneTransform.GetLocation();
-			Capsule.Rotation = BoneTransform.GetRotation();
+			float& PoseDeltaSquared = SleepChainMaxPoseDeltasSquared[Chain];
+			PoseDeltaSquared = FMath::Max(PoseDeltaSquared, static_cast<float>(
+				                              (SolverState.PoseLocations[i] - SleepPoseLocations[i]).SizeSquared()));
 
-			Capsule.bEnable = true;
+			if (bSampleWind && !WindSampled[Chain])
+			{
+				WindSampled[Chain] = true;
+				const FVector WindVelocity = GetWindVelocity(i) * TargetFramerate;
+				if (WindVelocity.SizeSquared() > FMath::Square(SleepSettings.VelocityThreshold))
+				{
+					PoseDeltaSquared = MAX_flt;
+				}
+			}
 		}
-		else
+
+		for (int32 Chain = 0; Chain < SleepChainCalmSteps.Num(); ++Chain)
 		{
-			Capsule.bEnable = false;
+			if (IsSleepChainDormant(Chain) && (bWakeAll || SleepChainMaxPoseDeltasSquared[Chain] >
+				FMath::Square(SleepSettings.PoseThreshold)))
+			{
+				SleepChainCalmSteps[Chain] = 0;
+				--NumDormantChains;
+			}
 		}
 	}
+
+	INC_DWORD_STAT_BY(STAT_KawaiiPhysics_ActiveChains, SleepChainCalmSteps.Num() - NumDormantChains);
+	INC_DWORD_STAT_BY(STAT_KawaiiPhysics_DormantChains, NumDormantChains);
 }
 
-void FAnimNode_KawaiiPhysics::UpdateBoxLimits(TArray<FBoxLimit>& Limits, FComponentSpacePoseContext& Output,
-                                              const FBoneContainer& BoneContainer,
-                                              const FTransform& ComponentTransform)
+void FAnimNode_KawaiiPhysics::RemoveDormantBones()
 {
-	for (auto& Box : Limits)
+	if (BoneSleepChains.Num() != SolverState.Num())
 	{
-		SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_UpdateBoxLimit);
-
-		if (Box.DrivingBone.IsValidToEvaluate(BoneContainer))
-		{
-			const FCompactPoseBoneIndex CompactPoseIndex = Box.DrivingBone.GetCompactPoseIndex(BoneContainer);
-			FTransform BoneTransform = Output.Pose.GetComponentSpaceTransform(CompactPoseIndex);
-
-			FAnimationRuntime::ConvertCSTransformToBoneSpace(ComponentTransform, Output.Pose, BoneTransform,
-			                                                 CompactPoseIndex, BCS_BoneSpace);
-			BoneTransform.SetRotation(Box.OffsetRotation.Quaternion() * BoneTransform.GetRotation());
-			BoneTransform.AddToTranslation(Box.OffsetLocation);
-
-			FAnimationRuntime::ConvertBoneSpaceTransformToCS(ComponentTransform, Output.Pose, BoneTransform,
-			                                                 CompactPoseIndex, BCS_BoneSpace);
-			Box.Location = BoneTransform.GetLocation();
-			Box.Rotation = BoneTransform.GetRotation();
+		BuildSleepChains();
+	}
 
-			Box.bEnable = true;
-		}
-		else
+	if (NumDormantChains > 0)
+	{
+		SimulatedBoneIndices.RemoveAll([this](int32 Index)
 		{
-			Box.bEnable = false;
-		}
+			const int32 Chain = BoneSleepChains[Index];
+			return Chain >= 0 && IsSleepChainDormant(Chain);
+		});
+		KawaiiPhysicsSolver::MarkDormantBones(SolverState, SimulatedBoneIndices);
 	}
 }
 
-void FAnimNode_KawaiiPhysics::UpdatePlanerLimits(TArray<FPlanarLimit>& Limits, FComponentSpacePoseContext& Output,
-                                                 const FBoneContainer& BoneContainer,
-                                                 const FTransform& ComponentTransform)
+void FAnimNode_KawaiiPhysics::UpdateSleepChains()
 {
-	for (auto& Planar : Limits)
+	// A bone constraint moved a dormant bone (e.g. one attached to a root bone), so its chain has to settle again.
+	// Woken chains had no simulated bones in this step, so they do not count it as calm
+	TBitArray<> WokenChains(false, SleepChainCalmSteps.Num());
+	for (int32 Index = 0; Index < SolverState.bDormants.Num(); ++Index)
 	{
-		SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_UpdatePlanerLimit);
-
-		if (Planar.DrivingBone.IsValidToEvaluate(BoneContainer))
+		const int32 Chain = BoneSleepChains[Index];
+		if (!SolverState.bDormants[Index] && !SolverState.bSkipSimulates[Index] && Chain >= 0 &&
+			IsSleepChainDormant(Chain))
 		{
-			const FCompactPoseBoneIndex CompactPoseIndex = Planar.DrivingBone.GetCompactPoseIndex(BoneContainer);
-			FTransform BoneTransform = Output.Pose.GetComponentSpaceTransform(CompactPoseIndex);
-
-			FAnimationRuntime::ConvertCSTransformToBoneSpace(ComponentTransform, Output.Pose, BoneTransform,
-			                                                 CompactPoseIndex, BCS_BoneSpace);
-			BoneTransform.SetRotation(Planar.OffsetRotation.Quaternion() * BoneTransform.GetRotation());
-			BoneTransform.AddToTranslation(Planar.OffsetLocation);
+			SleepChainCalmSteps[Chain] = 0;
+			--NumDormantChains;
+			WokenChains[Chain] = true;
+		}
+	}
 
-			FAnimationRuntime::ConvertBoneSpaceTransformToCS(ComponentTransform, Output.Pose, BoneTransform,
-			                                                 CompactPoseIndex, BCS_BoneSpace);
-			Planar.Location = BoneTransform.GetLocation();
-			Planar.Rotation = BoneTransform.GetRotation();
-			Planar.Rotation.Normalize();
-			Planar.Plane = FPlane(Planar.Location, Planar.Rotation.GetUpVector());
+	for (int32 Chain = 0; Chain < SleepChainCalmSteps.Num(); ++Chain)
+	{
+		SleepChainMaxSpeedsSquared[Chain] = 0.0f;
+		SleepChainMaxPoseDeltasSquared[Chain] = 0.0f;
+	}
 
-			Planar.bEnable = true;
-		}
-		else
+	for (const int32 Index : SimulatedBoneIndices)
+	{
+		const int32 Chain = BoneSleepChains[Index];
+		if (Chain < 0)
 		{
-			Planar.Location = Planar.OffsetLocation;
-			Planar.Rotation = Planar.OffsetRotation.Quaternion();
-			Planar.Rotation.Normalize();
-			Planar.Plane = FPlane(Planar.Location, Planar.Rotation.GetUpVector());
-
-			// Maybe the DrivingBone is set to empty for the floor, so keep Enable
-			// Planar.bEnable = false;
+			continue;
 		}
+
+		const float SpeedSquared = static_cast<float>(
+			(SolverState.Locations[Index] - SolverState.PrevLocations[Index]).SizeSquared() / (DeltaTime * DeltaTime));
+		const float PoseDeltaSquared = static_cast<float>(
+			(SolverState.PoseLocations[Index] - SleepPoseLocations[Index]).SizeSquared());
+		SleepChainMaxSpeedsSquared[Chain] = FMath::Max(SleepChainMaxSpeedsSquared[Chain], SpeedSquared);
+		SleepChainMaxPoseDeltasSquared[Chain] = FMath::Max(SleepChainMaxPoseDeltasSquared[Chain], PoseDeltaSquared);
+		SleepPoseLocations[Index] = SolverState.PoseLocations[Index];
 	}
-}
 
-void FAnimNode_KawaiiPhysics::UpdateModifyBonesPoseTransform(FComponentSpacePoseContext& Output,
-                                                             const FBoneContainer& BoneContainer)
-{
-	for (auto& Bone : ModifyBones)
+	bool bFellAsleep = false;
+	for (int32 Chain = 0; Chain < SleepChainCalmSteps.Num(); ++Chain)
 	{
-		if (!Bone.bDummy)
+		if (IsSleepChainDormant(Chain) || WokenChains[Chain])
+		{
+			continue;
+		}
+
+		if (SleepChainMaxSpeedsSquared[Chain] <= FMath::Square(SleepSettings.VelocityThreshold) &&
+			SleepChainMaxPoseDeltasSquared[Chain] <= FMath::Square(SleepSettings.PoseThreshold))
 		{
-			Bone.UpdatePoseTransform(BoneContainer, Output.Pose, ResetBoneTransformWhenBoneNotFound);
+			++SleepChainCalmSteps[Chain];
+			if (IsSleepChainDormant(Chain))
+			{
+				++NumDormantChains;
+				bFellAsleep = true;
+			}
 		}
 		else
 		{
-			auto ParentBone = ModifyBones[Bone.ParentIndex];
-			Bone.PoseLocation = ParentBone.PoseLocation + GetBoneForwardVector(ParentBone.PoseRotation) *
-				DummyBoneLength;
-			Bone.PoseRotation = ParentBone.PoseRotation;
-			Bone.PoseScale = ParentBone.PoseScale;
+			SleepChainCalmSteps[Chain] = 0;
 		}
 	}
-}
 
-void FAnimNode_KawaiiPhysics::UpdateSkelCompMove(const FTransform& ComponentTransform)
-{
-	SkelCompMoveVector = ComponentTransform.InverseTransformPosition(PreSkelCompTransform.GetLocation());
-	if (SkelCompMoveVector.SizeSquared() > TeleportDistanceThreshold * TeleportDistanceThreshold)
+	// Dormant chains are at rest, so that they start from zero velocity when they wake
+	if (bFellAsleep)
 	{
-		SkelCompMoveVector = FVector::ZeroVector;
+		for (const int32 Index : SimulatedBoneIndices)
+		{
+			const int32 Chain = BoneSleepChains[Index];
+			if (Chain >= 0 && IsSleepChainDormant(Chain))
+			{
+				SolverState.PrevLocations[Index] = SolverState.Locations[Index];
+			}
+		}
 	}
 
-	SkelCompMoveRotation = ComponentTransform.InverseTransformRotation(PreSkelCompTransform.GetRotation());
-	if (TeleportRotationThreshold >= 0 && FMath::RadiansToDegrees(SkelCompMoveRotation.GetAngle()) >
-		TeleportRotationThreshold)
-	{
-		SkelCompMoveRotation = FQuat::Identity;
-	}
+}
 
-	PreSkelCompTransform = ComponentTransform;
+bool FAnimNode_KawaiiPhysics::CanUseBatchedSimulation() const
+{
+	return (bUseBatchedSimulation || bSimulateInSharedPass) && KawaiiPhysicsSubsystem != nullptr &&
+		CustomExternalForces.IsEmpty() && ExternalForces.IsEmpty() && !IsWorldCollisionActive() && !CaptureWriter;
 }
 
-void FAnimNode_KawaiiPhysics::SimulateModifyBones(FComponentSpacePoseContext& Output,
-                                                  const FTransform& ComponentTransform)
+void FAnimNode_KawaiiPhysics::SimulateModifyBonesBatched(FComponentSpacePoseContext& Output,
+                                                         const FTransform& ComponentTransform, int32 NumSubsteps)
 {
 	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_SimulatemodifyBones);
 
@@ -933,184 +2779,213 @@ void FAnimNode_KawaiiPhysics::SimulateModifyBones(FComponentSpacePoseContext& Ou
 		return;
 	}
 
-	const USkeletalMeshComponent* SkelComp = Output.AnimInstanceProxy->GetSkelMeshComponent();
-
-	// Save Prev/Pose Info , Check SkipSimulate
-	for (FKawaiiPhysicsModifyBone& Bone : ModifyBones)
+	if (!BatchJob.IsValid())
 	{
-		if (Bone.BoneRef.BoneIndex < 0 && !Bone.bDummy)
-		{
-			Bone.bSkipSimulate = true;
-			continue;
-		}
-
-		if (Bone.ParentIndex < 0)
-		{
-			Bone.bSkipSimulate = true;
-			Bone.PrevLocation = Bone.Location;
-			Bone.Location = Bone.PoseLocation;
-			continue;
-		}
-
-		Bone.bSkipSimulate = false;
+		BatchJob = MakeShared<FKawaiiPhysicsBatchJob, ESPMode::ThreadSafe>();
 	}
+	FKawaiiPhysicsBatchJob& Job = *BatchJob;
 
-	// External Force : PreApply
-	// NOTE: if use foreach, you may get issue ( Array has changed during ranged-for iteration )
-	for (int i = 0; i < CustomExternalForces.Num(); ++i)
+	// The subsystem is simulating the previous step right now. Keep showing the last result
+	if (!Job.TryAcquire())
 	{
-		if (CustomExternalForces[i])
-		{
-			CustomExternalForces[i]->PreApply(*this, SkelComp);
-		}
+		return;
 	}
-	for (int i = 0; i < ExternalForces.Num(); ++i)
+
+	// Adopt the previous step. Only the locations are changed by the solver
+	if (Job.bHasResult && Job.State.Num() == SolverState.Num())
 	{
-		if (ExternalForces[i].IsValid())
-		{
-			auto& Force = ExternalForces[i].GetMutable<FKawaiiPhysics_ExternalForce>();
-			Force.PreApply(*this, SkelComp);
-		}
+		SolverState.Locations = Job.State.Locations;
+		SolverState.PrevLocations = Job.State.PrevLocations;
+		SolverState.bSkipSimulates = Job.State.bSkipSimulates;
+		bModifyBonesViewDirty = true;
 	}
+	Job.bHasResult = false;
 
-	// Simulate
-	const float Exponent = TargetFramerate * DeltaTime;
-	const FVector GravityCS = ComponentTransform.InverseTransformVector(Gravity);
-	const UWorld* World = SkelComp ? SkelComp->GetWorld() : nullptr;
-	const FSceneInterface* Scene = World ? World->Scene : nullptr;
-	for (FKawaiiPhysicsModifyBone& Bone : ModifyBones)
+	// Hand over the current step
+	Job.State = SolverState;
+	Job.Limits = PackedLimits;
+	Job.Constraints = MergedBoneConstraints;
+	Job.ConstraintColorStarts = BoneConstraintColorStarts;
+	Job.ChainTemplate = ChainTemplate;
+	Job.Params = MakeSolverParams(ComponentTransform);
+	Job.NumSubsteps = NumSubsteps;
+
+	// The wind of the first substep is used for all of them
+	Job.WindVelocities.Reset();
+	WindGustTime += DeltaTime;
+	if (HasWindSamples())
 	{
-		if (Bone.bSkipSimulate)
+		Job.WindVelocities.SetNumUninitialized(SolverState.Num());
+		for (int32 i = 0; i < SolverState.Num(); ++i)
 		{
-			continue;
+			Job.WindVelocities[i] = GetWindVelocity(i);
 		}
-		Simulate(Bone, Scene, ComponentTransform, GravityCS, Exponent, SkelComp, Output);
 	}
+	WindGustTime += DeltaTime * (NumSubsteps - 1);
 
-	// External Force : PostApply
-	for (int i = 0; i < ExternalForces.Num(); ++i)
+	Job.JobState = FKawaiiPhysicsBatchJob::EState::Pending;
+	KawaiiPhysicsSubsystem->SubmitJob(BatchJob.ToSharedRef());
+	if (bRecordEvaluationStats)
 	{
-		if (ExternalForces[i].IsValid())
+		// The subsystem simulates every bone in each substep
+		EvaluationStats.bBatched = true;
+		EvaluationStats.NumSubsteps += NumSubsteps;
+		EvaluationStats.NumSimulatedBones += SolverState.Num() * NumSubsteps;
+		if (!GetMergedBoneConstraints().IsEmpty())
 		{
-			auto& Force = ExternalForces[i].GetMutable<FKawaiiPhysics_ExternalForce>();
-			Force.PostApply(*this);
+			EvaluationStats.NumBoneConstraintIterations +=
+				Job.Params.BoneConstraintIterationCountAfterCollision * NumSubsteps;
 		}
 	}
 
-	// Adjust by collisions
-	for (FKawaiiPhysicsModifyBone& Bone : ModifyBones)
+	DeltaTimeOld = DeltaTime;
+}
+
+void FAnimNode_KawaiiPhysics::Simulate(int32 Index, const FKawaiiPhysicsSolverParams& Params,
+                                       const USkeletalMeshComponent* SkelComp, FComponentSpacePoseContext& Output)
+{
+	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_Simulate);
+
+	IntegrateBone(Index, Params);
+
+	// External Force
+	if (CustomExternalForces.Num() > 0 || ExternalForces.Num() > 0)
 	{
-		if (Bone.bSkipSimulate)
+		const FVector LocationBeforeForces = SolverState.Locations[Index];
+		FKawaiiPhysicsModifyBone& Bone = PushModifyBoneView(Index);
+		const FCompactPoseBoneIndex CompactPoseIndex =
+			ModifyBoneCompactPoseIndices[Bone.bDummy ? SolverState.ParentIndices[Index] : Index];
+
+		// Looked up once for all the forces
+		TOptional<FTransform> BoneTM;
+		auto GetBoneTM = [&]() -> const FTransform&
 		{
-			continue;
+			if (!BoneTM.IsSet())
+			{
+				BoneTM = Output.Pose.GetComponentSpaceTransform(CompactPoseIndex);
+			}
+			return BoneTM.GetValue();
+		};
+
+		// NOTE: if use foreach, you may get issue ( Array has changed during ranged-for iteration )
+		for (int i = 0; i < CustomExternalForces.Num(); ++i)
+		{
+			if (CustomExternalForces[i] && CustomExternalForces[i]->bIsEnabled)
+			{
+				CustomExternalForces[i]->Apply(*this, Index, SkelComp, GetBoneTM());
+			}
 		}
 
-		SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_AdjustByCollision);
+		for (int i = 0; i < ExternalForces.Num(); ++i)
+		{
+			if (ExternalForces[i].IsValid())
+			{
+				if (const auto ExForce = ExternalForces[i].GetMutablePtr<FKawaiiPhysics_ExternalForce>();
+					ExForce->bIsEnabled)
+				{
+					if (ExForce->ExternalForceSpace == EExternalForceSpace::BoneSpace)
+					{
+						ExForce->Apply(Bone, *this, Output, GetBoneTM());
+					}
+					else
+					{
+						ExForce->Apply(Bone, *this, Output);
+					}
+				}
+			}
+		}
 
-		AdjustBySphereCollision(Bone, SphericalLimits);
-		AdjustBySphereCollision(Bone, SphericalLimitsData);
-		AdjustByCapsuleCollision(Bone, CapsuleLimits);
-		AdjustByCapsuleCollision(Bone, CapsuleLimitsData);
-		AdjustByBoxCollision(Bone, BoxLimits);
-		AdjustByBoxCollision(Bone, BoxLimitsData);
-		AdjustByPlanerCollision(Bone, PlanarLimits);
-		AdjustByPlanerCollision(Bone, PlanarLimitsData);
-		if (bAllowWorldCollision)
+		PullModifyBoneView(Index);
+		if (CaptureWriter)
 		{
-			AdjustByWorldCollision(Bone, SkelComp);
+			CaptureWriter->AddExternalForceOffset(Index, SolverState.Locations[Index] - LocationBeforeForces);
 		}
 	}
 
-	// Adjust by Bone Constraints After Collision
-	if (BoneConstraintIterationCountAfterCollision > 0)
+	// Pull to Pose Location
+	KawaiiPhysicsSolver::PullToPose(SolverState, Index, Params.GetExponent());
+
+	// Keep the view of this bone current for the forces of its children and later siblings
+	if (CustomExternalForces.Num() > 0 || ExternalForces.Num() > 0)
+	{
+		SolverState.WriteToModifyBone(Index, ModifyBones[Index]);
+	}
+}
+
+void FAnimNode_KawaiiPhysics::IntegrateBone(int32 Index, const FKawaiiPhysicsSolverParams& Params)
+{
+	// Velocity, wind, follow translation/rotation and gravity
+	if (HasWindSamples())
 	{
-		for (FModifyBoneConstraint& BoneConstraint : MergedBoneConstraints)
+		const FVector WindVelocity = GetWindVelocity(Index);
+		KawaiiPhysicsSolver::Integrate(SolverState, Index, Params, &WindVelocity);
+		if (CaptureWriter)
 		{
-			BoneConstraint.Lambda = 0.0f;
+			CaptureWriter->SetWindVelocity(Index, WindVelocity);
 		}
-		for (int i = 0; i < BoneConstraintIterationCountAfterCollision; ++i)
+	}
+	else
+	{
+		KawaiiPhysicsSolver::Integrate(SolverState, Index, Params, nullptr);
+	}
+}
+
+bool FAnimNode_KawaiiPhysics::CanBatchExternalForces() const
+{
+	for (const TObjectPtr<UKawaiiPhysics_CustomExternalForce>& CustomExternalForce : CustomExternalForces)
+	{
+		if (CustomExternalForce && CustomExternalForce->bIsEnabled)
 		{
-			AdjustByBoneConstraints();
+			return false;
 		}
 	}
 
-	// Adjust by Limits ane Bone Length
-	for (FKawaiiPhysicsModifyBone& Bone : ModifyBones)
+	for (const FInstancedStruct& ExternalForce : ExternalForces)
 	{
-		if (Bone.bSkipSimulate)
+		if (ExternalForce.IsValid() && !FKawaiiPhysics_ExternalForce::CanApplyBatch(ExternalForce))
 		{
-			continue;
+			return false;
 		}
-
-		auto& ParentBone = ModifyBones[Bone.ParentIndex];
-
-		// Adjust by angle limit
-		AdjustByAngleLimit(Bone, ParentBone);
-
-		// Adjust by Planar Constraint
-		AdjustByPlanarConstraint(Bone, ParentBone);
-
-		// Restore Bone Length
-		const float BoneLength = (Bone.PoseLocation - ParentBone.PoseLocation).Size();
-		Bone.Location = (Bone.Location - ParentBone.Location).GetSafeNormal() * BoneLength + ParentBone.Location;
 	}
 
-	DeltaTimeOld = DeltaTime;
+	return true;
 }
 
-void FAnimNode_KawaiiPhysics::Simulate(FKawaiiPhysicsModifyBone& Bone, const FSceneInterface* Scene,
-                                       const FTransform& ComponentTransform, const FVector& GravityCS,
-                                       const float& Exponent, const USkeletalMeshComponent* SkelComp,
-                                       FComponentSpacePoseContext& Output)
+void FAnimNode_KawaiiPhysics::ApplyExternalForcesBatched(FComponentSpacePoseContext& Output)
 {
-	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_Simulate);
-
-	const FKawaiiPhysicsModifyBone& ParentBone = ModifyBones[Bone.ParentIndex];
-
-	// Move using Velocity( = movement amount in pre frame ) and Damping
-	FVector Velocity = (Bone.Location - Bone.PrevLocation) / DeltaTimeOld;
-	Bone.PrevLocation = Bone.Location;
-	Velocity *= (1.0f - Bone.PhysicsSettings.Damping);
-
-	// wind
-	if (bEnableWind && Scene)
+	bool bHasForce = false;
+	bool bNeedsBoneTransforms = false;
+	for (const FInstancedStruct& ExternalForce : ExternalForces)
 	{
-		Velocity += GetWindVelocity(Scene, ComponentTransform, Bone) * TargetFramerate;
+		if (const auto* Force = ExternalForce.GetPtr<FKawaiiPhysics_ExternalForce>(); Force && Force->bIsEnabled)
+		{
+			bHasForce = true;
+			bNeedsBoneTransforms |= Force->ExternalForceSpace == EExternalForceSpace::BoneSpace;
+		}
+	}
+	if (!bHasForce)
+	{
+		return;
 	}
-	Bone.Location += Velocity * DeltaTime;
-
-	// Follow Translation
-	Bone.Location += SkelCompMoveVector * (1.0f - Bone.PhysicsSettings.WorldDampingLocation);
-
-	// Follow Rotation
-	Bone.Location += (SkelCompMoveRotation.RotateVector(Bone.PrevLocation) - Bone.PrevLocation)
-		* (1.0f - Bone.PhysicsSettings.WorldDampingRotation);
-
-	// Gravity
-	// TODO:Migrate if there are more good method (Currently copying AnimDynamics implementation)
-	Bone.Location += 0.5 * GravityCS * DeltaTime * DeltaTime;
 
-	// External Force
-	// NOTE: if use foreach, you may get issue ( Array has changed during ranged-for iteration )
-	for (int i = 0; i < CustomExternalForces.Num(); ++i)
+	// Looked up once for all the forces
+	if (bNeedsBoneTransforms)
 	{
-		if (CustomExternalForces[i] && CustomExternalForces[i]->bIsEnabled)
+		ExternalForceBoneTransforms.SetNumUninitialized(SolverState.Num());
+		for (const int32 Index : SimulatedBoneIndices)
 		{
-			FTransform BoneTM = FTransform::Identity;
-			if (Bone.bDummy)
-			{
-				BoneTM = Output.Pose.GetComponentSpaceTransform(
-					ParentBone.BoneRef.GetCompactPoseIndex(Output.Pose.GetPose().GetBoneContainer()));
-			}
-			else
-			{
-				BoneTM = Output.Pose.GetComponentSpaceTransform(
-					Bone.BoneRef.GetCompactPoseIndex(Output.Pose.GetPose().GetBoneContainer()));
-			}
-			CustomExternalForces[i]->Apply(*this, Bone.Index, SkelComp, BoneTM);
+			const FCompactPoseBoneIndex CompactPoseIndex =
+				ModifyBoneCompactPoseIndices[SolverState.bDummies[Index] ? SolverState.ParentIndices[Index] : Index];
+			ExternalForceBoneTransforms[Index] = CompactPoseIndex.IsValid()
+				                                     ? Output.Pose.GetComponentSpaceTransform(CompactPoseIndex)
+				                                     : FTransform::Identity;
 		}
 	}
 
+	const FKawaiiPhysicsExternalForceBatch Batch(*this, Output, SimulatedBoneIndices, SolverState.Locations,
+	                                             SolverState.PoseLocations, ExternalForceBoneTransforms);
+
+	// NOTE: if use foreach, you may get issue ( Array has changed during ranged-for iteration )
 	for (int i = 0; i < ExternalForces.Num(); ++i)
 	{
 		if (ExternalForces[i].IsValid())
@@ -1118,84 +2993,105 @@ void FAnimNode_KawaiiPhysics::Simulate(FKawaiiPhysicsModifyBone& Bone, const FSc
 			if (const auto ExForce = ExternalForces[i].GetMutablePtr<FKawaiiPhysics_ExternalForce>();
 				ExForce->bIsEnabled)
 			{
-				if (ExForce->ExternalForceSpace == EExternalForceSpace::BoneSpace)
-				{
-					FTransform BoneTM = FTransform::Identity;
-					if (Bone.bDummy)
-					{
-						BoneTM = Output.Pose.GetComponentSpaceTransform(
-							ParentBone.BoneRef.GetCompactPoseIndex(Output.Pose.GetPose().GetBoneContainer()));
-					}
-					else
-					{
-						BoneTM = Output.Pose.GetComponentSpaceTransform(
-							Bone.BoneRef.GetCompactPoseIndex(Output.Pose.GetPose().GetBoneContainer()));
-					}
-
-					ExForce->Apply(Bone, *this, Output, BoneTM);
-				}
-				else
-				{
-					ExForce->Apply(Bone, *this, Output);
-				}
+				ExForce->ApplyBatch(Batch);
 			}
 		}
 	}
-
-	// // Pull to Pose Location
-	const FVector BaseLocation = ParentBone.Location + (Bone.PoseLocation - ParentBone.PoseLocation);
-	Bone.Location += (BaseLocation - Bone.Location) *
-		(1.0f - FMath::Pow(1.0f - Bone.PhysicsSettings.Stiffness, Exponent));
 }
 
-FVector FAnimNode_KawaiiPhysics::GetWindVelocity(const FSceneInterface* Scene, const FTransform& ComponentTransform,
-                                                 const FKawaiiPhysicsModifyBone& Bone) const
+FVector FAnimNode_KawaiiPhysics::GetWindVelocity(int32 Index) const
 {
 	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_GetWindVelocity);
 
-	FVector WindDirection = FVector::ZeroVector;
-	float WindSpeed = 0.0f;
-	float WindMinGust = 0.0f;
-	float WindMaxGust = 0.0f;
+	FVector WindVelocity = WindSamples[0];
+	if (NumWindSamples == 8)
+	{
+		// Trilinear interpolation between the corners of the bounds
+		const FVector Size = WindSampleBounds.GetSize();
+		const FVector Offset = SolverState.PoseLocations[Index] - WindSampleBounds.Min;
+		const FVector Alpha(Size.X > UE_KINDA_SMALL_NUMBER ? FMath::Clamp(Offset.X / Size.X, 0.0, 1.0) : 0.0,
+		                    Size.Y > UE_KINDA_SMALL_NUMBER ? FMath::Clamp(Offset.Y / Size.Y, 0.0, 1.0) : 0.0,
+		                    Size.Z > UE_KINDA_SMALL_NUMBER ? FMath::Clamp(Offset.Z / Size.Z, 0.0, 1.0) : 0.0);
 
-	Scene->GetWindParameters_GameThread(ComponentTransform.TransformPosition(Bone.PoseLocation), WindDirection,
-	                                    WindSpeed, WindMinGust, WindMaxGust);
-	WindDirection = ComponentTransform.Inverse().TransformVector(WindDirection);
-	FVector WindVelocity = WindDirection * WindSpeed * WindScale;
+		const FVector Y0 = FMath::Lerp(FMath::Lerp(WindSamples[0], WindSamples[1], Alpha.X),
+		                               FMath::Lerp(WindSamples[2], WindSamples[3], Alpha.X), Alpha.Y);
+		const FVector Y1 = FMath::Lerp(FMath::Lerp(WindSamples[4], WindSamples[5], Alpha.X),
+		                               FMath::Lerp(WindSamples[6], WindSamples[7], Alpha.X), Alpha.Y);
+		WindVelocity = FMath::Lerp(Y0, Y1, Alpha.Z);
+	}
 
-	// TODO:Migrate if there are more good method (Currently copying AnimDynamics implementation)
-	WindVelocity *= FMath::FRandRange(0.0f, 2.0f);
+	// Gusts scale the wind by 0-2 like AnimDynamics, but with a smooth seeded noise so that the result is reproducible.
+	// Each bone is offset in the noise so that the bones of a chain do not sway in unison
+	if (WindGustFrequency > 0.0f)
+	{
+		const float NoiseInput = WindGustTime * WindGustFrequency + WindNoiseSeed * 17.31f + Index * 0.37f;
+		WindVelocity *= 1.0f + FMath::Clamp(FMath::PerlinNoise1D(NoiseInput), -1.0f, 1.0f);
+	}
 
 	return WindVelocity;
 }
 
-void FAnimNode_KawaiiPhysics::AdjustByWorldCollision(FKawaiiPhysicsModifyBone& Bone,
-                                                     const USkeletalMeshComponent* OwningComp)
+void FAnimNode_KawaiiPhysics::GetWorldCollisionChannel(const USkeletalMeshComponent* OwningComp,
+                                                       ECollisionChannel& OutTraceChannel,
+                                                       FCollisionResponseParams& OutResponseParams) const
 {
-	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_WorldCollision);
+	// Get collision settings from component
+	OutTraceChannel = bOverrideCollisionParams
+		                  ? CollisionChannelSettings.GetObjectType()
+		                  : OwningComp->GetCollisionObjectType();
+	OutResponseParams = bOverrideCollisionParams
+		                    ? FCollisionResponseParams(CollisionChannelSettings.GetResponseToChannels())
+		                    : FCollisionResponseParams(OwningComp->GetCollisionResponseToChannels());
+}
 
-	if (!OwningComp || Bone.ParentIndex < 0)
+bool FAnimNode_KawaiiPhysics::ShouldIgnoreWorldCollisionHit(const FHitResult& Hit,
+                                                            const UPrimitiveComponent* OwningComp,
+                                                            const FName& BoneName,
+                                                            TConstArrayView<FBoneReference> IgnoreBones,
+                                                            TConstArrayView<FName> IgnoreBoneNamePrefix)
+{
+	if (Hit.Component != OwningComp || Hit.BoneName == NAME_None)
 	{
-		return;
+		return false;
+	}
+
+	if (Hit.BoneName == BoneName)
+	{
+		return true;
+	}
+	for (const FBoneReference& BoneRef : IgnoreBones)
+	{
+		if (BoneRef.BoneName == Hit.BoneName)
+		{
+			return true;
+		}
+	}
+	for (const FName& BoneNamePrefix : IgnoreBoneNamePrefix)
+	{
+		if (Hit.BoneName.ToString().StartsWith(BoneNamePrefix.ToString()))
+		{
+			return true;
+		}
 	}
+	return false;
+}
 
-	/** the trace is not done in game thread, so TraceTag does not draw debug traces*/
-	FCollisionQueryParams Params(SCENE_QUERY_STAT(KawaiiCollision));
+void FAnimNode_KawaiiPhysics::AdjustByWorldCollision(int32 Index, const USkeletalMeshComponent* OwningComp,
+                                                     const FCollisionQueryParams& QueryParams,
+                                                     ECollisionChannel TraceChannel,
+                                                     const FCollisionResponseParams& ResponseParams)
+{
+	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_WorldCollision);
 
-	if (bIgnoreSelfComponent)
+	if (!OwningComp || SolverState.ParentIndices[Index] < 0)
 	{
-		Params.AddIgnoredComponent(OwningComp);
+		return;
 	}
 
-	// Get collision settings from component	
-	ECollisionChannel TraceChannel = bOverrideCollisionParams
-		                                 ? CollisionChannelSettings.GetObjectType()
-		                                 : OwningComp->GetCollisionObjectType();
-	FCollisionResponseParams ResponseParams = bOverrideCollisionParams
-		                                          ? FCollisionResponseParams(
-			                                          CollisionChannelSettings.GetResponseToChannels())
-		                                          : FCollisionResponseParams(
-			                                          OwningComp->GetCollisionResponseToChannels());
+	FVector& Location = SolverState.Locations[Index];
+	const FVector& PrevLocation = SolverState.PrevLocations[Index];
+	const float Radius = SolverState.Radii[Index];
+
 	auto CompTransform = OwningComp->GetComponentTransform();
 
 	if (const UWorld* World = OwningComp->GetWorld())
@@ -1204,21 +3100,21 @@ void FAnimNode_KawaiiPhysics::AdjustByWorldCollision(FKawaiiPhysicsModifyBone& B
 		{
 			// Do sphere sweep
 			FHitResult Result;
-			bool bHit = World->SweepSingleByChannel(Result, CompTransform.TransformPosition(Bone.PrevLocation),
-			                                        CompTransform.TransformPosition(Bone.Location), FQuat::Identity,
+			bool bHit = World->SweepSingleByChannel(Result, CompTransform.TransformPosition(PrevLocation),
+			                                        CompTransform.TransformPosition(Location), FQuat::Identity,
 			                                        TraceChannel,
-			                                        FCollisionShape::MakeSphere(Bone.PhysicsSettings.Radius), Params,
+			                                        FCollisionShape::MakeSphere(Radius), QueryParams,
 			                                        ResponseParams);
 			if (bHit)
 			{
 				if (Result.bStartPenetrating)
 				{
-					Bone.Location = CompTransform.InverseTransformPosition(
-						CompTransform.TransformPosition(Bone.Location) + (Result.Normal * Result.PenetrationDepth));
+					Location = CompTransform.InverseTransformPosition(
+						CompTransform.TransformPosition(Location) + (Result.Normal * Result.PenetrationDepth));
 				}
 				else
 				{
-					Bone.Location = CompTransform.InverseTransformPosition(Result.Location);
+					Location = CompTransform.InverseTransformPosition(Result.Location);
 				}
 			}
 		}
@@ -1226,61 +3122,31 @@ void FAnimNode_KawaiiPhysics::AdjustByWorldCollision(FKawaiiPhysicsModifyBone& B
 		{
 			// Do sphere sweep and ignore bones later
 			TArray<FHitResult> Results;
-			bool bHit = World->SweepMultiByChannel(Results, CompTransform.TransformPosition(Bone.PrevLocation),
-			                                       CompTransform.TransformPosition(Bone.Location), FQuat::Identity,
+			bool bHit = World->SweepMultiByChannel(Results, CompTransform.TransformPosition(PrevLocation),
+			                                       CompTransform.TransformPosition(Location), FQuat::Identity,
 			                                       TraceChannel,
-			                                       FCollisionShape::MakeSphere(Bone.PhysicsSettings.Radius), Params,
+			                                       FCollisionShape::MakeSphere(Radius), QueryParams,
 			                                       ResponseParams);
 			if (bHit)
 			{
-				bool IsIgnoreHit;
+				const FName& BoneName = ModifyBones[Index].BoneRef.BoneName;
 				for (const auto& Hit : Results)
 				{
-					if (Hit.bBlockingHit)
+					//found the blocking hit we shouldn't ignore!
+					if (Hit.bBlockingHit &&
+						!ShouldIgnoreWorldCollisionHit(Hit, OwningComp, BoneName, IgnoreBones, IgnoreBoneNamePrefix))
 					{
-						//should we ignore this hit?
-						IsIgnoreHit = false;
-						if (Hit.Component == OwningComp && Hit.BoneName != NAME_None)
+						if (Hit.bStartPenetrating)
 						{
-							IsIgnoreHit = Hit.BoneName == Bone.BoneRef.BoneName;
-							if (!IsIgnoreHit)
-							{
-								for (auto BoneRef : IgnoreBones)
-								{
-									if (BoneRef.BoneName == Hit.BoneName)
-									{
-										IsIgnoreHit = true;
-										break;
-									}
-								}
-							}
-							if (!IsIgnoreHit)
-							{
-								for (auto BoneNamePrefix : IgnoreBoneNamePrefix)
-								{
-									if (Hit.BoneName.ToString().StartsWith(BoneNamePrefix.ToString()))
-									{
-										IsIgnoreHit = true;
-										break;
-									}
-								}
-							}
+							Location = CompTransform.InverseTransformPosition(
+								CompTransform.TransformPosition(Location) + (Hit.Normal * Hit.
+									PenetrationDepth));
 						}
-						//found the blocking hit we shouldn't ignore!
-						if (!IsIgnoreHit)
+						else
 						{
-							if (Hit.bStartPenetrating)
-							{
-								Bone.Location = CompTransform.InverseTransformPosition(
-									CompTransform.TransformPosition(Bone.Location) + (Hit.Normal * Hit.
-										PenetrationDepth));
-							}
-							else
-							{
-								Bone.Location = CompTransform.InverseTransformPosition(Hit.Location);
-							}
-							break;
+							Location = CompTransform.InverseTransformPosition(Hit.Location);
 						}
+						break;
 					}
 				}
 			}
@@ -1288,322 +3154,431 @@ void FAnimNode_KawaiiPhysics::AdjustByWorldCollision(FKawaiiPhysicsModifyBone& B
 	}
 }
 
-void FAnimNode_KawaiiPhysics::AdjustBySphereCollision(FKawaiiPhysicsModifyBone& Bone, TArray<FSphericalLimit>& Limits)
+void FAnimNode_KawaiiPhysics::BeginAsyncWorldCollision()
 {
-	for (auto& Sphere : Limits)
+	using EState = FKawaiiPhysicsWorldCollisionBatch::EState;
+
+	// Newest results. Older ones are dropped
+	WorldCollisionResultBatch.Reset();
+	for (const auto& Batch : WorldCollisionBatches)
 	{
-		if (!Sphere.bEnable || Sphere.Radius <= 0.0f)
+		if (Batch->BatchState == EState::Ready &&
+			(!WorldCollisionResultBatch.IsValid() || Batch->Sequence > WorldCollisionResultBatch->Sequence))
 		{
-			continue;
+			WorldCollisionResultBatch = Batch;
 		}
-
-		const float LimitDistance = Bone.PhysicsSettings.Radius + Sphere.Radius;
-		if (Sphere.LimitType == ESphericalLimitType::Outer)
+	}
+	for (const auto& Batch : WorldCollisionBatches)
+	{
+		if (Batch->BatchState == EState::Ready && Batch != WorldCollisionResultBatch)
 		{
-			if ((Bone.Location - Sphere.Location).SizeSquared() > LimitDistance * LimitDistance)
-			{
-				continue;
-			}
-			Bone.Location += (LimitDistance - (Bone.Location - Sphere.Location).Size())
-				* (Bone.Location - Sphere.Location).GetSafeNormal();
+			Batch->BatchState = EState::Idle;
 		}
-		else
+	}
+
+	// Sweeps usually stay in flight for a frame, so a few batches are enough to gather every frame
+	WorldCollisionGatherBatch.Reset();
+	for (const auto& Batch : WorldCollisionBatches)
+	{
+		if (Batch->BatchState == EState::Idle)
 		{
-			if ((Bone.Location - Sphere.Location).SizeSquared() < LimitDistance * LimitDistance)
-			{
-				continue;
-			}
-			Bone.Location = Sphere.Location + (Sphere.Radius - Bone.PhysicsSettings.Radius) * (Bone.Location - Sphere.
-				Location).GetSafeNormal();
+			WorldCollisionGatherBatch = Batch;
+			break;
 		}
 	}
+	if (!WorldCollisionGatherBatch.IsValid() && WorldCollisionBatches.Num() < 3)
+	{
+		WorldCollisionGatherBatch = WorldCollisionBatches.Add_GetRef(
+			MakeShared<FKawaiiPhysicsWorldCollisionBatch, ESPMode::ThreadSafe>());
+	}
 }
 
-void FAnimNode_KawaiiPhysics::AdjustByCapsuleCollision(FKawaiiPhysicsModifyBone& Bone, TArray<FCapsuleLimit>& Limits)
+void FAnimNode_KawaiiPhysics::ApplyAsyncWorldCollision(const FTransform& ComponentTransform)
 {
-	for (auto& Capsule : Limits)
+	if (!WorldCollisionResultBatch.IsValid())
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_WorldCollision);
+
+	for (const FKawaiiPhysicsWorldCollisionBatch::FSweep& Sweep : WorldCollisionResultBatch->Sweeps)
 	{
-		if (!Capsule.bEnable || Capsule.Radius <= 0 || Capsule.Length <= 0)
+		if (!Sweep.bHit || Sweep.BoneIndex >= SolverState.Num() || SolverState.bSkipSimulates[Sweep.BoneIndex])
 		{
 			continue;
 		}
 
-		FVector StartPoint = Capsule.Location + Capsule.Rotation.GetAxisZ() * Capsule.Length * 0.5f;
-		FVector EndPoint = Capsule.Location + Capsule.Rotation.GetAxisZ() * Capsule.Length * -0.5f;
-		const float DistSquared = FMath::PointDistToSegmentSquared(Bone.Location, StartPoint, EndPoint);
-
-		const float LimitDistance = Bone.PhysicsSettings.Radius + Capsule.Radius;
-		if (DistSquared < LimitDistance * LimitDistance)
+		// The hit is one frame old, so the world is assumed to be flat around it
+		// and the bone is only kept on the free side of that plane
+		const FVector PlanePoint = Sweep.Hit.bStartPenetrating
+			                           ? Sweep.Hit.TraceStart + Sweep.Hit.Normal * Sweep.Hit.PenetrationDepth
+			                           : Sweep.Hit.Location;
+		FVector& Location = SolverState.Locations[Sweep.BoneIndex];
+		const FVector WorldLocation = ComponentTransform.TransformPosition(Location);
+		const double Penetration = FVector::DotProduct(PlanePoint - WorldLocation, Sweep.Hit.Normal);
+		if (Penetration > 0.0)
 		{
-			FVector ClosestPoint = FMath::ClosestPointOnSegment(Bone.Location, StartPoint, EndPoint);
-			Bone.Location = ClosestPoint + (Bone.Location - ClosestPoint).GetSafeNormal() * LimitDistance;
+			Location = ComponentTransform.InverseTransformPosition(WorldLocation + Sweep.Hit.Normal * Penetration);
 		}
 	}
 }
 
-void FAnimNode_KawaiiPhysics::AdjustByBoxCollision(FKawaiiPhysicsModifyBone& Bone, TArray<FBoxLimit>& Limits)
+void FAnimNode_KawaiiPhysics::GatherAsyncWorldCollision(const USkeletalMeshComponent* OwningComp,
+                                                        const FTransform& ComponentTransform)
 {
-	for (auto& Box : Limits)
+	if (!WorldCollisionGatherBatch.IsValid() || !OwningComp)
 	{
-		FTransform BoxTransform(Box.Rotation, Box.Location);
-		float SphereRadius = Bone.PhysicsSettings.Radius;
+		return;
+	}
 
-		FVector LocalSphereCenter = BoxTransform.InverseTransformPosition(Bone.Location);
-		FBox LocalBox(-Box.Extent, Box.Extent);
-		if (FMath::SphereAABBIntersection(FSphere(LocalSphereCenter, SphereRadius), LocalBox))
-		{
-			// Calculate the point of the Box closest to the center of the Sphere
-			FVector ClosestPoint = LocalSphereCenter;
-			ClosestPoint.X = FMath::Clamp(ClosestPoint.X, LocalBox.Min.X, LocalBox.Max.X);
-			ClosestPoint.Y = FMath::Clamp(ClosestPoint.Y, LocalBox.Min.Y, LocalBox.Max.Y);
-			ClosestPoint.Z = FMath::Clamp(ClosestPoint.Z, LocalBox.Min.Z, LocalBox.Max.Z);
+	FKawaiiPhysicsWorldCollisionBatch& Batch = *WorldCollisionGatherBatch;
+	Batch.Component = OwningComp;
+	GetWorldCollisionChannel(OwningComp, Batch.TraceChannel, Batch.ResponseParams);
+	Batch.bIgnoreSelfComponent = bIgnoreSelfComponent;
+	Batch.IgnoreBones = IgnoreBones;
+	Batch.IgnoreBoneNamePrefix = IgnoreBoneNamePrefix;
 
-			FVector PushOutVector = LocalSphereCenter - ClosestPoint;
-			float Distance = PushOutVector.Size();
+	// With substeps, only the sweeps of the last one are kept
+	Batch.Sweeps.Reset();
+	Batch.Chains.Reset();
+	for (const int32 Index : SimulatedBoneIndices)
+	{
+		// The bones are sorted parent first, so the bones under each child of a root bone are contiguous
+		const int32 ParentIndex = SolverState.ParentIndices[Index];
+		if (Batch.Chains.IsEmpty() || SolverState.ParentIndices[ParentIndex] < 0)
+		{
+			Batch.Chains.AddDefaulted_GetRef().FirstSweep = Batch.Sweeps.Num();
+		}
 
-			// When the bone sphere is completely buried inside the box, forced to push.
-			if (PushOutVector.IsNearlyZero())
-			{
-				PushOutVector = LocalSphereCenter;
-				Distance = SphereRadius;
-			}
+		FKawaiiPhysicsWorldCollisionBatch::FSweep& Sweep = Batch.Sweeps.AddDefaulted_GetRef();
+		Sweep.BoneIndex = Index;
+		Sweep.BoneName = ModifyBones[Index].BoneRef.BoneName;
+		Sweep.Start = ComponentTransform.TransformPosition(SolverState.PrevLocations[Index]);
+		Sweep.End = ComponentTransform.TransformPosition(SolverState.Locations[Index]);
+		Sweep.Radius = SolverState.Radii[Index];
 
-			// push
-			if (Distance <= SphereRadius)
-			{
-				FVector PushOutDirection = PushOutVector.GetSafeNormal();
-				FVector NewLocalSphereCenter = ClosestPoint + PushOutDirection * SphereRadius;
-				Bone.Location = BoxTransform.TransformPosition(NewLocalSphereCenter);
-			}
-		}
+		FKawaiiPhysicsWorldCollisionBatch::FChain& Chain = Batch.Chains.Last();
+		Chain.Bounds += FBox::BuildAABB(Sweep.Start, FVector(Sweep.Radius));
+		Chain.Bounds += FBox::BuildAABB(Sweep.End, FVector(Sweep.Radius));
+		++Chain.NumSweeps;
 	}
 }
 
-void FAnimNode_KawaiiPhysics::AdjustByPlanerCollision(FKawaiiPhysicsModifyBone& Bone, TArray<FPlanarLimit>& Limits)
+void FAnimNode_KawaiiPhysics::EndAsyncWorldCollision()
 {
-	for (auto& Planar : Limits)
+	if (WorldCollisionResultBatch.IsValid())
 	{
-		if (!Planar.bEnable)
+		WorldCollisionResultBatch->BatchState = FKawaiiPhysicsWorldCollisionBatch::EState::Idle;
+		WorldCollisionResultBatch.Reset();
+	}
+
+	if (WorldCollisionGatherBatch.IsValid())
+	{
+		if (!WorldCollisionGatherBatch->Sweeps.IsEmpty())
 		{
-			continue;
+			WorldCollisionGatherBatch->Sequence = ++WorldCollisionSequence;
+			WorldCollisionGatherBatch->BatchState = FKawaiiPhysicsWorldCollisionBatch::EState::Submitted;
+			KawaiiPhysicsSubsystem->SubmitWorldCollision(WorldCollisionGatherBatch.ToSharedRef());
+			if (bRecordEvaluationStats)
+			{
+				EvaluationStats.NumWorldSweeps += WorldCollisionGatherBatch->Sweeps.Num();
+			}
 		}
+		WorldCollisionGatherBatch.Reset();
+	}
+}
 
-		FVector PointOnPlane = FVector::PointPlaneProject(Bone.Location, Planar.Plane);
-		const float DistSquared = (Bone.Location - PointOnPlane).SizeSquared();
+void FAnimNode_KawaiiPhysics::WarmUp(FComponentSpacePoseContext& Output, const FBoneContainer& BoneContainer,
+                                     FTransform& ComponentTransform)
+{
+	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_WarmUp);
 
-		FVector IntersectionPoint;
-		if (DistSquared < Bone.PhysicsSettings.Radius * Bone.PhysicsSettings.Radius ||
-			FMath::SegmentPlaneIntersection(Bone.Location, Bone.PrevLocation, Planar.Plane, IntersectionPoint))
-		{
-			Bone.Location = PointOnPlane + Planar.Rotation.GetUpVector() * Bone.PhysicsSettings.Radius;
-		}
+	const int32 NumFrames = WarmUpFramesPerEvaluation > 0
+		                        ? FMath::Min(RemainingWarmUpFrames, WarmUpFramesPerEvaluation)
+		                        : RemainingWarmUpFrames;
+	for (int32 i = 0; i < NumFrames; ++i)
+	{
+		SimulateModifyBones(Output, ComponentTransform);
 	}
+	RemainingWarmUpFrames -= NumFrames;
 }
 
-void FAnimNode_KawaiiPhysics::AdjustByAngleLimit(
-	FKawaiiPhysicsModifyBone& Bone,
-	const FKawaiiPhysicsModifyBone& ParentBone)
+bool FAnimNode_KawaiiPhysics::RestoreRestState(const USkeleton* Skeleton)
 {
-	if (Bone.PhysicsSettings.LimitAngle == 0.0f)
+	if (!RestStateDataAsset || SolverState.Num() != ModifyBones.Num())
 	{
-		return;
+		return false;
+	}
+
+	TArray<FName, TInlineAllocator<64>> BoneNames;
+	BoneNames.Reserve(ModifyBones.Num());
+	for (const FKawaiiPhysicsModifyBone& ModifyBone : ModifyBones)
+	{
+		BoneNames.Add(ModifyBone.BoneRef.BoneName);
 	}
 
-	FVector BoneDir = (Bone.Location - ParentBone.Location).GetSafeNormal();
-	const FVector PoseDir = (Bone.PoseLocation - ParentBone.PoseLocation).GetSafeNormal();
-	const FVector Axis = FVector::CrossProduct(PoseDir, BoneDir);
-	const float Angle = FMath::Atan2(Axis.Size(), FVector::DotProduct(PoseDir, BoneDir));
-	const float AngleOverLimit = FMath::RadiansToDegrees(Angle) - Bone.PhysicsSettings.LimitAngle;
+	const FKawaiiPhysicsRestStateSnapshot* Snapshot =
+		RestStateDataAsset->FindSnapshot(Skeleton, BoneNames, SolverState.PoseLocations);
+	if (!Snapshot)
+	{
+		return false;
+	}
 
-	if (AngleOverLimit > 0.0f)
+	// Settled and at rest
+	for (int32 i = 0; i < SolverState.Num(); ++i)
 	{
-		BoneDir = BoneDir.RotateAngleAxis(-AngleOverLimit, Axis.GetSafeNormal());
-		Bone.Location = BoneDir * (Bone.Location - ParentBone.Location).Size() + ParentBone.Location;
+		SolverState.Locations[i] = SolverState.PoseLocations[i] + Snapshot->Offsets[i];
+		SolverState.PrevLocations[i] = SolverState.Locations[i];
 	}
+	bModifyBonesViewDirty = true;
+	return true;
 }
 
-void FAnimNode_KawaiiPhysics::AdjustByPlanarConstraint(FKawaiiPhysicsModifyBone& Bone,
-                                                       const FKawaiiPhysicsModifyBone& ParentBone)
+bool FAnimNode_KawaiiPhysics::CaptureRestState(const USkeleton* Skeleton,
+                                               FKawaiiPhysicsRestStateSnapshot& OutSnapshot) const
 {
-	if (PlanarConstraint != EPlanarConstraint::None)
+	if (SolverState.Num() == 0 || SolverState.Num() != ModifyBones.Num())
 	{
-		FPlane Plane;
-		switch (PlanarConstraint)
-		{
-		case EPlanarConstraint::X:
-			Plane = FPlane(ParentBone.Location, ParentBone.PoseRotation.GetAxisX());
-			break;
-		case EPlanarConstraint::Y:
-			Plane = FPlane(ParentBone.Location, ParentBone.PoseRotation.GetAxisY());
-			break;
-		case EPlanarConstraint::Z:
-			Plane = FPlane(ParentBone.Location, ParentBone.PoseRotation.GetAxisZ());
-			break;
-		case EPlanarConstraint::None:
-			break;
-		default: ;
-		}
-		Bone.Location = FVector::PointPlaneProject(Bone.Location, Plane);
+		return false;
 	}
+
+	OutSnapshot = FKawaiiPhysicsRestStateSnapshot();
+	OutSnapshot.Skeleton = Skeleton;
+	OutSnapshot.BoneNames.Reserve(SolverState.Num());
+	OutSnapshot.PoseLocations.Reserve(SolverState.Num());
+	OutSnapshot.Offsets.Reserve(SolverState.Num());
+	for (int32 i = 0; i < SolverState.Num(); ++i)
+	{
+		OutSnapshot.BoneNames.Add(ModifyBones[i].BoneRef.BoneName);
+		OutSnapshot.PoseLocations.Add(SolverState.PoseLocations[i] - SolverState.PoseLocations[0]);
+		OutSnapshot.Offsets.Add(SolverState.Locations[i] - SolverState.PoseLocations[i]);
+	}
+	return true;
 }
 
-const TArray<float> XPBDComplianceValues =
+#if WITH_EDITOR
+void FAnimNode_KawaiiPhysics::StartBakedMotionRecording()
 {
-	0.00000000004f, // 0.04 x 10^(-9) (M^2/N) Concrete
-	0.00000000016f, // 0.16 x 10^(-9) (M^2/N) Wood
-	0.000000001f, // 1.0  x 10^(-8) (M^2/N) Leather
-	0.000000002f, // 0.2  x 10^(-7) (M^2/N) Tendon
-	0.0000001f, // 1.0  x 10^(-6) (M^2/N) Rubber
-	0.00002f, // 0.2  x 10^(-3) (M^2/N) Muscle
-	0.0001f, // 1.0  x 10^(-3) (M^2/N) Fat
-};
+	BakedMotionRecordTimes.Reset();
+	BakedMotionRecordPoseLocations.Reset();
+	BakedMotionRecordOffsets.Reset();
+	bRecordingBakedMotion = true;
+}
 
-void FAnimNode_KawaiiPhysics::AdjustByBoneConstraints()
+void FAnimNode_KawaiiPhysics::RecordBakedMotionFrame(float FrameDeltaTime)
 {
-	for (FModifyBoneConstraint& BoneConstraint : MergedBoneConstraints)
+	const TArray<FVector>& Locations = bUseInterpolatedLocations ? InterpolatedLocations : SolverState.Locations;
+	const int32 NumBones = SolverState.Num();
+	if (NumBones == 0 || Locations.Num() != NumBones)
 	{
-		SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_AdjustByBoneConstraint);
+		return;
+	}
 
-		if (!BoneConstraint.IsValid())
+	// The bones of the recording must not change, and a paused preview adds nothing
+	if (!BakedMotionRecordTimes.IsEmpty())
+	{
+		if (BakedMotionRecordOffsets.Num() != BakedMotionRecordTimes.Num() * NumBones)
 		{
-			continue;
+			bRecordingBakedMotion = false;
+			return;
 		}
-
-		FKawaiiPhysicsModifyBone& ModifyBone1 = ModifyBones[BoneConstraint.ModifyBoneIndex1];
-		FKawaiiPhysicsModifyBone& ModifyBone2 = ModifyBones[BoneConstraint.ModifyBoneIndex2];
-		EXPBDComplianceType ComplianceType = BoneConstraint.bOverrideCompliance
-			                                     ? BoneConstraint.ComplianceType
-			                                     : BoneConstraintGlobalComplianceType;
-
-		FVector Delta = ModifyBone2.Location - ModifyBone1.Location;
-		float DeltaLength = Delta.Size();
-		if (DeltaLength <= 0.0f)
+		if (FrameDeltaTime <= 0.0f)
 		{
-			continue;
+			return;
 		}
+	}
 
-		// PBD
-		// Delta *= (DeltaLength - BoneConstraint.Length) / DeltaLength * 0.5f;
-		// ModifyBone1.Location += Delta * Stiffness;
-		// ModifyBone2.Location -= Delta * Stiffness;
+	BakedMotionRecordTimes.Add(BakedMotionRecordTimes.IsEmpty() ? 0.0f : BakedMotionRecordTimes.Last() + FrameDeltaTime);
+	for (int32 i = 0; i < NumBones; ++i)
+	{
+		BakedMotionRecordPoseLocations.Add(SolverState.PoseLocations[i] - SolverState.PoseLocations[0]);
+		BakedMotionRecordOffsets.Add(Locations[i] - SolverState.PoseLocations[i]);
+	}
+}
+
+bool FAnimNode_KawaiiPhysics::StopBakedMotionRecording(const USkeleton* Skeleton, float SampleRate,
+                                                       FKawaiiPhysicsBakedMotionClip& OutClip)
+{
+	bRecordingBakedMotion = false;
+	ON_SCOPE_EXIT
+	{
+		BakedMotionRecordTimes.Empty();
+		BakedMotionRecordPoseLocations.Empty();
+		BakedMotionRecordOffsets.Empty();
+	};
+
+	const int32 NumBones = ModifyBones.Num();
+	const int32 NumRecordedFrames = BakedMotionRecordTimes.Num();
+	if (NumBones == 0 || NumRecordedFrames < 2 || SampleRate <= 0.0f ||
+		BakedMotionRecordOffsets.Num() != NumRecordedFrames * NumBones)
+	{
+		return false;
+	}
 
-		// XBPD
-		float Constraint = DeltaLength - BoneConstraint.Length;
-		float Compliance = XPBDComplianceValues[static_cast<int32>(ComplianceType)];
-		Compliance /= DeltaTime * DeltaTime;
-		float DeltaLambda = (Constraint - Compliance * BoneConstraint.Lambda) / (2 + Compliance); // 2 = SumMass
-		Delta = (Delta / DeltaLength) * DeltaLambda;
+	OutClip = FKawaiiPhysicsBakedMotionClip();
+	OutClip.Skeleton = Skeleton;
+	OutClip.SampleRate = SampleRate;
+	OutClip.BoneNames.Reserve(NumBones);
+	for (const FKawaiiPhysicsModifyBone& ModifyBone : ModifyBones)
+	{
+		OutClip.BoneNames.Add(ModifyBone.BoneRef.BoneName);
+	}
 
-		ModifyBone1.Location += Delta;
-		ModifyBone2.Location -= Delta;
-		BoneConstraint.Lambda += DeltaLambda;
+	// Resample the evaluations, which come at any rate, at the fixed rate of the clip
+	const int32 NumFrames = FMath::Max(FMath::FloorToInt(BakedMotionRecordTimes.Last() * SampleRate), 1);
+	TArray<FVector> PoseLocations;
+	TArray<FVector> Offsets;
+	PoseLocations.SetNumUninitialized(NumFrames * NumBones);
+	Offsets.SetNumUninitialized(NumFrames * NumBones);
+	int32 Recorded = 0;
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		const float Time = Frame / SampleRate;
+		while (Recorded + 2 < NumRecordedFrames && BakedMotionRecordTimes[Recorded + 1] <= Time)
+		{
+			++Recorded;
+		}
+		const float Alpha = FMath::Clamp((Time - BakedMotionRecordTimes[Recorded]) /
+		                                 FMath::Max(BakedMotionRecordTimes[Recorded + 1] -
+		                                            BakedMotionRecordTimes[Recorded], UE_SMALL_NUMBER), 0.0f, 1.0f);
+		for (int32 i = 0; i < NumBones; ++i)
+		{
+			const int32 From = Recorded * NumBones + i;
+			const int32 To = From + NumBones;
+			PoseLocations[Frame * NumBones + i] = FMath::Lerp(BakedMotionRecordPoseLocations[From],
+			                                                  BakedMotionRecordPoseLocations[To], Alpha);
+			Offsets[Frame * NumBones + i] = FMath::Lerp(BakedMotionRecordOffsets[From], BakedMotionRecordOffsets[To],
+			                                            Alpha);
+		}
 	}
+	OutClip.Build(PoseLocations, Offsets);
+	return true;
 }
+#endif
 
-void FAnimNode_KawaiiPhysics::WarmUp(FComponentSpacePoseContext& Output, const FBoneContainer& BoneContainer,
-                                     FTransform& ComponentTransform)
+void FAnimNode_KawaiiPhysics::InitBoneConstraints()
 {
-	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_WarmUp);
+	// The sleep chains depend on the constraints
+	BoneSleepChains.Reset();
 
-	for (int32 i = 0; i < WarmUpFrames; ++i)
+	// Shared chains come with their constraints
+	if (ChainTemplate)
 	{
-		SimulateModifyBones(Output, ComponentTransform);
+		return;
 	}
+
+	BuildBoneConstraints(ModifyBones, [this](const FName& BoneName)
+	{
+		return FindModifyBoneIndex(BoneName);
+	}, MergedBoneConstraints, BoneConstraintColorStarts);
 }
 
-void FAnimNode_KawaiiPhysics::InitBoneConstraints()
+void FAnimNode_KawaiiPhysics::BuildBoneConstraints(const TArray<FKawaiiPhysicsModifyBone>& InModifyBones,
+                                                   TFunctionRef<int32(const FName&)> FindBoneIndex,
+                                                   TArray<FModifyBoneConstraint>& OutConstraints,
+                                                   TArray<int32>& OutColorStarts) const
 {
-	MergedBoneConstraints = BoneConstraints;
-	MergedBoneConstraints.Append(BoneConstraintsData);
+	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_InitBoneConstraints);
 
-	TArray<FModifyBoneConstraint> DummyBoneConstraint;
-	for (FModifyBoneConstraint& Constraint : MergedBoneConstraints)
+	OutConstraints = BoneConstraints;
+	OutConstraints.Append(BoneConstraintsData);
+
+	auto FindChildDummyBone = [&InModifyBones](int32 ModifyBoneIndex)
 	{
-		Constraint.ModifyBoneIndex1 =
-			ModifyBones.IndexOfByPredicate([Constraint](const FKawaiiPhysicsModifyBone& ModifyBone)
+		for (const int32 ChildIndex : InModifyBones[ModifyBoneIndex].ChildIndices)
+		{
+			if (ChildIndex >= 0 && InModifyBones[ChildIndex].bDummy)
 			{
-				return ModifyBone.BoneRef == Constraint.Bone1;
-			});
+				return ChildIndex;
+			}
+		}
+		return static_cast<int32>(INDEX_NONE);
+	};
+
+	TArray<FModifyBoneConstraint> DummyBoneConstraint;
+	for (FModifyBoneConstraint& Constraint : OutConstraints)
+	{
+		Constraint.ModifyBoneIndex1 = FindBoneIndex(Constraint.Bone1.BoneName);
 		if (Constraint.ModifyBoneIndex1 < 0)
 		{
 			continue;
 		}
 
-		Constraint.ModifyBoneIndex2 =
-			ModifyBones.IndexOfByPredicate([Constraint](const FKawaiiPhysicsModifyBone& ModifyBone)
-			{
-				return ModifyBone.BoneRef == Constraint.Bone2;
-			});
+		Constraint.ModifyBoneIndex2 = FindBoneIndex(Constraint.Bone2.BoneName);
 		if (Constraint.ModifyBoneIndex2 < 0)
 		{
 			continue;
 		}
 
 		Constraint.Length =
-			(ModifyBones[Constraint.ModifyBoneIndex1].Location - ModifyBones[Constraint.ModifyBoneIndex2].Location).
+			(InModifyBones[Constraint.ModifyBoneIndex1].Location - InModifyBones[Constraint.ModifyBoneIndex2].Location).
 			Size();
 
 		// DummyBone"s constraint
 		if (bAutoAddChildDummyBoneConstraint)
 		{
-			const int32 ChildDummyBoneIndex1 = ModifyBones[Constraint.ModifyBoneIndex1].ChildIndices.IndexOfByPredicate(
-				[&](int32 Index)
-				{
-					return Index >= 0 && ModifyBones[Index].bDummy == true;
-				});
-			const int32 ChildDummyBoneIndex2 = ModifyBones[Constraint.ModifyBoneIndex2].ChildIndices.IndexOfByPredicate(
-				[&](int32 Index)
-				{
-					return Index >= 0 && ModifyBones[Index].bDummy == true;
-				});
+			const int32 ChildDummyBoneIndex1 = FindChildDummyBone(Constraint.ModifyBoneIndex1);
+			const int32 ChildDummyBoneIndex2 = FindChildDummyBone(Constraint.ModifyBoneIndex2);
 
 			if (ChildDummyBoneIndex1 >= 0 && ChildDummyBoneIndex2 >= 0)
 			{
 				FModifyBoneConstraint NewDummyBoneConstraint;
-				NewDummyBoneConstraint.ModifyBoneIndex1 = ModifyBones[Constraint.ModifyBoneIndex1].ChildIndices[
-					ChildDummyBoneIndex1];
-				NewDummyBoneConstraint.ModifyBoneIndex2 = ModifyBones[Constraint.ModifyBoneIndex2].ChildIndices[
-					ChildDummyBoneIndex2];
+				NewDummyBoneConstraint.ModifyBoneIndex1 = ChildDummyBoneIndex1;
+				NewDummyBoneConstraint.ModifyBoneIndex2 = ChildDummyBoneIndex2;
 				NewDummyBoneConstraint.Length =
-					(ModifyBones[NewDummyBoneConstraint.ModifyBoneIndex1].Location - ModifyBones[NewDummyBoneConstraint.
-						ModifyBoneIndex2].Location).
-					Size();
+					(InModifyBones[ChildDummyBoneIndex1].Location - InModifyBones[ChildDummyBoneIndex2].Location).Size();
 				NewDummyBoneConstraint.bIsDummy = true;
 				DummyBoneConstraint.Add(NewDummyBoneConstraint);
 			}
 		}
 	}
 
-	MergedBoneConstraints.Append(DummyBoneConstraint);
+	OutConstraints.Append(DummyBoneConstraint);
+
+	// Color the constraints offline so that each color can be solved in parallel
+	OutColorStarts.Reset();
+	if (BoneConstraintSolver == EKawaiiPhysicsBoneConstraintSolver::GraphColored)
+	{
+		KawaiiPhysicsSolver::ColorBoneConstraints(OutConstraints, InModifyBones.Num(), OutColorStarts);
+	}
 }
 
-void FAnimNode_KawaiiPhysics::ApplySimulateResult(FComponentSpacePoseContext& Output,
-                                                  const FBoneContainer& BoneContainer,
+void FAnimNode_KawaiiPhysics::ApplySimulateResult(const FBoneContainer& BoneContainer,
                                                   TArray<FBoneTransform>& OutBoneTransforms)
 {
-	for (int32 i = 0; i < ModifyBones.Num(); ++i)
+	const uint64 StartCycle = bRecordEvaluationStats ? FPlatformTime::Cycles64() : 0;
+
+	if (bCompactPoseIndicesDirty || ModifyBoneCompactPoseIndices.Num() != ModifyBones.Num())
 	{
-		OutBoneTransforms.Add(FBoneTransform(ModifyBones[i].BoneRef.GetCompactPoseIndex(BoneContainer),
-		                                     FTransform(ModifyBones[i].PoseRotation, ModifyBones[i].PoseLocation,
-		                                                ModifyBones[i].PoseScale)));
+		CacheCompactPoseIndices(BoneContainer);
 	}
 
-	for (int32 i = 0; i < ModifyBones.Num(); ++i)
+	// The baked motion of a frozen node is played through InterpolatedLocations, even if SolverState is compacted
+	const TArray<FVector>& Locations = bUseInterpolatedLocations ? InterpolatedLocations : SolverState.Locations;
+	const int32 NumBones = Locations.Num();
+
+	SimulateResultTransforms.SetNumUninitialized(NumBones);
+	for (int32 i = 0; i < NumBones; ++i)
+	{
+		SimulateResultTransforms[i] = FTransform(SolverState.PoseRotations[i], SolverState.PoseLocations[i],
+		                                         SolverState.PoseScales[i]);
+	}
+
+	for (int32 i = 0; i < NumBones; ++i)
 	{
-		FKawaiiPhysicsModifyBone& Bone = ModifyBones[i];
-		if (!Bone.HasParent())
+		const int32 ParentIndex = SolverState.ParentIndices[i];
+		if (ParentIndex < 0)
 		{
 			continue;
 		}
 
-		FKawaiiPhysicsModifyBone& ParentBone = ModifyBones[Bone.ParentIndex];
-
-		if (ParentBone.ChildIndices.Num() <= 1)
+		if (ModifyBones[ParentIndex].ChildIndices.Num() <= 1)
 		{
-			if (ParentBone.BoneRef.BoneIndex >= 0)
+			if (SolverState.bHasBones[ParentIndex])
 			{
-				FVector PoseVector = Bone.PoseLocation - ParentBone.PoseLocation;
-				FVector SimulateVector = Bone.Location - ParentBone.Location;
+				FVector PoseVector = SolverState.PoseLocations[i] - SolverState.PoseLocations[ParentIndex];
+				FVector SimulateVector = Locations[i] - Locations[ParentIndex];
 
 				if (PoseVector.GetSafeNormal() == SimulateVector.GetSafeNormal())
 				{
@@ -1617,24 +3592,135 @@ void FAnimNode_KawaiiPhysics::ApplySimulateResult(FComponentSpacePoseContext& Ou
 					SimulateVector *= -1;
 				}
 
-				FQuat SimulateRotation = FQuat::FindBetweenVectors(PoseVector, SimulateVector) * ParentBone.
-					PoseRotation;
-				OutBoneTransforms[Bone.ParentIndex].Transform.SetRotation(SimulateRotation);
-				ParentBone.PrevRotation = SimulateRotation;
+				FQuat SimulateRotation = FQuat::FindBetweenVectors(PoseVector, SimulateVector) * SolverState.
+					PoseRotations[ParentIndex];
+				SimulateResultTransforms[ParentIndex].SetRotation(SimulateRotation);
+				if (!CompactSolverState.IsPacked())
+				{
+					SolverState.PrevRotations[ParentIndex] = SimulateRotation;
+				}
 			}
 		}
 
-		if (Bone.BoneRef.BoneIndex >= 0 && !Bone.bDummy)
+		if (SolverState.bHasBones[i] && !SolverState.bDummies[i])
+		{
+			SimulateResultTransforms[i].SetLocation(Locations[i]);
+		}
+	}
+	bModifyBonesViewDirty = true;
+
+	// OutputBoneOrder is already sorted for the check in FCSPose<PoseType>::LocalBlendCSBoneTransforms
+	OutBoneTransforms.Reserve(OutputBoneOrder.Num());
+	for (const int32 Index : OutputBoneOrder)
+	{
+		OutBoneTransforms.Emplace(ModifyBoneCompactPoseIndices[Index], SimulateResultTransforms[Index]);
+	}
+
+	if (bRecordEvaluationStats)
+	{
+		EvaluationStats.ApplySimulateResultCycles += FPlatformTime::Cycles64() - StartCycle;
+	}
+}
+
+void FAnimNode_KawaiiPhysics::CacheCompactPoseIndices(const FBoneContainer& BoneContainer)
+{
+	const int32 NumBones = ModifyBones.Num();
+	ModifyBoneCompactPoseIndices.Reset(NumBones);
+	OutputBoneOrder.Reset(NumBones);
+	for (int32 i = 0; i < NumBones; ++i)
+	{
+		const FCompactPoseBoneIndex CompactPoseIndex = ModifyBones[i].bDummy
+			                                               ? FCompactPoseBoneIndex(INDEX_NONE)
+			                                               : ModifyBones[i].BoneRef.GetCompactPoseIndex(BoneContainer);
+		ModifyBoneCompactPoseIndices.Add(CompactPoseIndex);
+		if (CompactPoseIndex != INDEX_NONE)
 		{
-			OutBoneTransforms[i].Transform.SetLocation(Bone.Location);
+			OutputBoneOrder.Add(i);
 		}
 	}
 
-	OutBoneTransforms.RemoveAll([](const FBoneTransform& BoneTransform)
+	OutputBoneOrder.StableSort([this](const int32 A, const int32 B)
 	{
-		return BoneTransform.BoneIndex < 0;
+		return ModifyBoneCompactPoseIndices[A].GetInt() < ModifyBoneCompactPoseIndices[B].GetInt();
 	});
+	bCompactPoseIndicesDirty = false;
+}
+
+#if ENABLE_ANIM_DEBUG
+namespace
+{
+	/** Gives the benchmark access to the bone constraint setup */
+	struct FKawaiiPhysicsBenchmarkNode : FAnimNode_KawaiiPhysics
+	{
+		using FAnimNode_KawaiiPhysics::BuildModifyBoneIndexMap;
+		using FAnimNode_KawaiiPhysics::InitBoneConstraints;
+	};
+
+	/**
+	 * Compares the bone constraint setup against the linear bone search it replaced.
+	 * Usage : a.AnimNode.KawaiiPhysics.Benchmark.InitBoneConstraints [NumBones] [NumConstraints] [Iterations]
+	 */
+	void BenchmarkInitBoneConstraints(const TArray<FString>& Args)
+	{
+		const int32 NumBones = FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000, 2);
+		const int32 NumConstraints = FMath::Max(Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 500, 1);
+		const int32 Iterations = FMath::Max(Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 20, 1);
+
+		FKawaiiPhysicsBenchmarkNode Node;
+		Node.bAutoAddChildDummyBoneConstraint = false;
+		Node.ModifyBones.SetNum(NumBones);
+		for (int32 i = 0; i < NumBones; ++i)
+		{
+			Node.ModifyBones[i].BoneRef = FBoneReference(FName(TEXT("KawaiiBenchmarkBone"), i));
+			Node.ModifyBones[i].Index = i;
+		}
+		Node.BoneConstraints.SetNum(NumConstraints);
+		for (int32 i = 0; i < NumConstraints; ++i)
+		{
+			Node.BoneConstraints[i].Bone1 = Node.ModifyBones[(i * 7) % NumBones].BoneRef;
+			Node.BoneConstraints[i].Bone2 = Node.ModifyBones[(i * 13 + 1) % NumBones].BoneRef;
+		}
+
+		// Previous implementation
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			TArray<FModifyBoneConstraint> Constraints = Node.BoneConstraints;
+			for (FModifyBoneConstraint& Constraint : Constraints)
+			{
+				Constraint.ModifyBoneIndex1 = Node.ModifyBones.IndexOfByPredicate(
+					[&Constraint](const FKawaiiPhysicsModifyBone& ModifyBone)
+					{
+						return ModifyBone.BoneRef == Constraint.Bone1;
+					});
+				Constraint.ModifyBoneIndex2 = Node.ModifyBones.IndexOfByPredicate(
+					[&Constraint](const FKawaiiPhysicsModifyBone& ModifyBone)
+					{
+						return ModifyBone.BoneRef == Constraint.Bone2;
+					});
+				Constraint.Length = (Node.ModifyBones[Constraint.ModifyBoneIndex1].Location -
+					Node.ModifyBones[Constraint.ModifyBoneIndex2].Location).Size();
+			}
+		}
+		const double LinearTime = FPlatformTime::Seconds() - StartTime;
+
+		// Index map, including building it as InitModifyBones does
+		StartTime = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			Node.BuildModifyBoneIndexMap();
+			Node.InitBoneConstraints();
+		}
+		const double MapTime = FPlatformTime::Seconds() - StartTime;
+
+		UE_LOG(LogKawaiiPhysics, Display,
+		       TEXT("InitBoneConstraints (%d bones, %d constraints) : linear search %.3f ms, index map %.3f ms"),
+		       NumBones, NumConstraints, LinearTime * 1000.0 / Iterations, MapTime * 1000.0 / Iterations);
+	}
 
-	// for check in FCSPose<PoseType>::LocalBlendCSBoneTransforms
-	OutBoneTransforms.Sort(FCompareBoneTransformIndex());
+	FAutoConsoleCommand BenchmarkInitBoneConstraintsCommand(
+		TEXT("a.AnimNode.KawaiiPhysics.Benchmark.InitBoneConstraints"),
+		TEXT("Measure the bone constraint setup of KawaiiPhysics. Args : [NumBones] [NumConstraints] [Iterations]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkInitBoneConstraints));
 }
+#endif
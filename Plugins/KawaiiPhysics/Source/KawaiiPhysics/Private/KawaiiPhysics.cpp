@@ -3,17 +3,57 @@
 #include "KawaiiPhysics.h"
 #include "Modules/ModuleManager.h"
 
+#if WITH_EDITOR
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "UObject/UObjectGlobals.h"
+
+#include <atomic>
+#endif
+
 #define LOCTEXT_NAMESPACE "FKawaiiPhysicsModule"
 
+#if WITH_EDITOR
+namespace
+{
+	std::atomic<uint32> GPhysicsAssetRevision{0};
+
+	void OnPhysicsAssetMaybeModified(const UObject* Object)
+	{
+		// Bodies are subobjects of their PhysicsAsset
+		if (Object && (Object->IsA<UPhysicsAsset>() || Object->GetTypedOuter<UPhysicsAsset>()))
+		{
+			++GPhysicsAssetRevision;
+		}
+	}
+}
+
+uint32 FKawaiiPhysicsModule::GetPhysicsAssetRevision()
+{
+	return GPhysicsAssetRevision.load();
+}
+#endif
+
 void FKawaiiPhysicsModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
+#if WITH_EDITOR
+	ObjectModifiedHandle = FCoreUObjectDelegates::OnObjectModified.AddStatic(&OnPhysicsAssetMaybeModified);
+	ObjectPropertyChangedHandle = FCoreUObjectDelegates::OnObjectPropertyChanged.AddLambda(
+		[](UObject* Object, FPropertyChangedEvent&)
+		{
+			OnPhysicsAssetMaybeModified(Object);
+		});
+#endif
 }
 
 void FKawaiiPhysicsModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+#if WITH_EDITOR
+	FCoreUObjectDelegates::OnObjectModified.Remove(ObjectModifiedHandle);
+	FCoreUObjectDelegates::OnObjectPropertyChanged.Remove(ObjectPropertyChangedHandle);
+#endif
 }
 
 #undef LOCTEXT_NAMESPACE
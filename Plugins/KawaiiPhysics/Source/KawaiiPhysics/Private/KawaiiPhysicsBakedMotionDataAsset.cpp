@@ -0,0 +1,156 @@
+// KawaiiPhysics : Copyright (c) 2019-2024 pafuhana1213, MIT License
+
+#include "KawaiiPhysicsBakedMotionDataAsset.h"
+
+#include "Animation/Skeleton.h"
+
+namespace
+{
+	/** Number of frames searched on each side of the expected frame by FindFrameNear */
+	constexpr int32 NearFrameSearchRadius = 2;
+
+	void Quantize(TConstArrayView<FVector> Values, TArray<int16>& OutQuantized, float& OutStep)
+	{
+		double MaxValue = 0.0;
+		for (const FVector& Value : Values)
+		{
+			MaxValue = FMath::Max(MaxValue, Value.GetAbsMax());
+		}
+		constexpr int32 QuantizedMax = MAX_int16;
+		OutStep = FMath::Max(static_cast<float>(MaxValue / QuantizedMax), UE_SMALL_NUMBER);
+
+		OutQuantized.SetNumUninitialized(Values.Num() * 3);
+		for (int32 i = 0; i < Values.Num(); ++i)
+		{
+			for (int32 Axis = 0; Axis < 3; ++Axis)
+			{
+				OutQuantized[i * 3 + Axis] = static_cast<int16>(
+					FMath::Clamp(FMath::RoundToInt(Values[i][Axis] / OutStep), -QuantizedMax, QuantizedMax));
+			}
+		}
+	}
+
+	FVector Dequantize(const TArray<int16>& Quantized, int32 Index, float Step)
+	{
+		return FVector(Quantized[Index * 3], Quantized[Index * 3 + 1], Quantized[Index * 3 + 2]) * Step;
+	}
+
+	bool MatchesBones(const FKawaiiPhysicsBakedMotionClip& Clip, TConstArrayView<FName> BoneNames)
+	{
+		if (Clip.BoneNames.Num() != BoneNames.Num())
+		{
+			return false;
+		}
+		for (int32 i = 0; i < BoneNames.Num(); ++i)
+		{
+			if (Clip.BoneNames[i] != BoneNames[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+void FKawaiiPhysicsBakedMotionClip::Build(TConstArrayView<FVector> InPoseLocations, TConstArrayView<FVector> InOffsets)
+{
+	check(InPoseLocations.Num() == InOffsets.Num());
+	NumFrames = BoneNames.Num() > 0 ? InPoseLocations.Num() / BoneNames.Num() : 0;
+	Quantize(InPoseLocations, PoseLocations, PoseStep);
+	Quantize(InOffsets, Offsets, OffsetStep);
+}
+
+float FKawaiiPhysicsBakedMotionClip::GetPoseDistance(int32 Frame, TConstArrayView<FVector> InPoseLocations) const
+{
+	const int32 NumBones = BoneNames.Num();
+	float MaxDistanceSquared = 0.0f;
+	for (int32 i = 0; i < NumBones; ++i)
+	{
+		const FVector RelativeLocation = InPoseLocations[i] - InPoseLocations[0];
+		MaxDistanceSquared = FMath::Max(MaxDistanceSquared, static_cast<float>(FVector::DistSquared(
+			                                RelativeLocation, Dequantize(PoseLocations, Frame * NumBones + i,
+			                                                             PoseStep))));
+	}
+	return FMath::Sqrt(MaxDistanceSquared);
+}
+
+FVector FKawaiiPhysicsBakedMotionClip::SampleOffset(float Frame, int32 BoneIndex) const
+{
+	const int32 NumBones = BoneNames.Num();
+	const float WrappedFrame = FMath::Fmod(Frame, static_cast<float>(NumFrames));
+	const int32 Frame0 = FMath::Clamp(FMath::FloorToInt(WrappedFrame), 0, NumFrames - 1);
+	const int32 Frame1 = (Frame0 + 1) % NumFrames;
+	return FMath::Lerp(Dequantize(Offsets, Frame0 * NumBones + BoneIndex, OffsetStep),
+	                   Dequantize(Offsets, Frame1 * NumBones + BoneIndex, OffsetStep), WrappedFrame - Frame0);
+}
+
+void UKawaiiPhysicsBakedMotionDataAsset::GetMatchingClips(const USkeleton* Skeleton,
+                                                          TConstArrayView<FName> BoneNames,
+                                                          TArray<int32>& OutClipIndices) const
+{
+	const FSoftObjectPath SkeletonPath(Skeleton);
+
+	OutClipIndices.Reset();
+	for (int32 ClipIndex = 0; ClipIndex < Clips.Num(); ++ClipIndex)
+	{
+		const FKawaiiPhysicsBakedMotionClip& Clip = Clips[ClipIndex];
+		if (Clip.IsValid() && Clip.Skeleton.ToSoftObjectPath() == SkeletonPath && MatchesBones(Clip, BoneNames))
+		{
+			OutClipIndices.Add(ClipIndex);
+		}
+	}
+}
+
+bool UKawaiiPhysicsBakedMotionDataAsset::FindFrame(TConstArrayView<int32> ClipIndices,
+                                                   TConstArrayView<FVector> PoseLocations, int32& OutClipIndex,
+                                                   int32& OutFrame) const
+{
+	float BestDistance = PoseTolerance;
+	OutClipIndex = INDEX_NONE;
+	for (const int32 ClipIndex : ClipIndices)
+	{
+		const FKawaiiPhysicsBakedMotionClip& Clip = Clips[ClipIndex];
+		if (!Clip.IsValid() || Clip.BoneNames.Num() != PoseLocations.Num())
+		{
+			continue;
+		}
+
+		for (int32 Frame = 0; Frame < Clip.NumFrames; ++Frame)
+		{
+			const float Distance = Clip.GetPoseDistance(Frame, PoseLocations);
+			if (Distance <= BestDistance)
+			{
+				BestDistance = Distance;
+				OutClipIndex = ClipIndex;
+				OutFrame = Frame;
+			}
+		}
+	}
+	return OutClipIndex != INDEX_NONE;
+}
+
+bool UKawaiiPhysicsBakedMotionDataAsset::FindFrameNear(int32 ClipIndex, float ExpectedFrame,
+                                                       TConstArrayView<FVector> PoseLocations, int32& OutFrame) const
+{
+	const FKawaiiPhysicsBakedMotionClip& Clip = Clips[ClipIndex];
+	if (!Clip.IsValid() || Clip.BoneNames.Num() != PoseLocations.Num())
+	{
+		return false;
+	}
+
+	float BestDistance = PoseTolerance;
+	bool bFound = false;
+	const int32 CenterFrame = FMath::RoundToInt(ExpectedFrame);
+	for (int32 Offset = -NearFrameSearchRadius; Offset <= NearFrameSearchRadius; ++Offset)
+	{
+		const int32 Frame = ((CenterFrame + Offset) % Clip.NumFrames + Clip.NumFrames) % Clip.NumFrames;
+		const float Distance = Clip.GetPoseDistance(Frame, PoseLocations);
+		if (Distance <= BestDistance)
+		{
+			BestDistance = Distance;
+			OutFrame = Frame;
+			bFound = true;
+		}
+	}
+	return bFound;
+}
@@ -7,7 +7,12 @@
 #include "Internationalization/Regex.h"
 
 #if WITH_EDITOR
+#include "AnimationRuntime.h"
 #include "Editor.h"
+#include "Async/ParallelFor.h"
+#include "Containers/Ticker.h"
+#include "Misc/AsyncTaskNotification.h"
+#include "Tasks/Task.h"
 #endif
 
 struct FBoneConstraintDataCustomVersion
@@ -82,9 +87,8 @@ void UKawaiiPhysicsBoneConstraintsDataAsset::PostLoad()
 			Data.BoneReference2 = FBoneReference(Data.BoneName2);
 		}
 
-#if WITH_EDITOR
-		UpdatePreviewBoneList();
-#endif
+		// The preview bone list is refreshed where it is used (ApplyRegex, or when the KawaiiPhysics anim graph node
+		// creates this asset), instead of loading the skeleton while loading this asset
 		UE_LOG(LogKawaiiPhysics, Log, TEXT("Update : BoneName -> BoneReference (%s)"), *this->GetName());
 	}
 }
@@ -102,6 +106,113 @@ USkeleton* UKawaiiPhysicsBoneConstraintsDataAsset::GetSkeleton(bool& bInvalidSke
 #if WITH_EDITOR
 #define LOCTEXT_NAMESPACE "KawaiiPhysicsBoneConstraintsDataAsset"
 
+/**
+ * Inputs, progress and result of AutoGenerateBoneConstraints, shared with its background task.
+ */
+struct FKawaiiPhysicsBoneConstraintGeneration
+{
+	/** Name, reference pose location and chain of each bone. INDEX_NONE for the roots and the bones outside chains */
+	TArray<FName> BoneNames;
+	TArray<FVector> Locations;
+	TArray<int32> Chains;
+	float MaxDistance = 0.0f;
+
+	FGuid SkeletonGuid;
+	uint32 SettingsHash = 0;
+
+	UE::Tasks::FTask Task;
+	std::atomic<int32> NumProcessedBones = 0;
+
+	/** Constrained bones, the lower index first */
+	TArray<TPair<int32, int32>> Pairs;
+
+	void Run()
+	{
+		// Cells as large as the search distance, so that only the 27 cells around a bone can hold its neighbors
+		const double CellSize = MaxDistance;
+		auto GetCell = [CellSize](const FVector& Location)
+		{
+			return FIntVector(FMath::FloorToInt32(Location.X / CellSize), FMath::FloorToInt32(Location.Y / CellSize),
+			                  FMath::FloorToInt32(Location.Z / CellSize));
+		};
+
+		TMap<FIntVector, TArray<int32>> Grid;
+		for (int32 i = 0; i < Locations.Num(); ++i)
+		{
+			if (Chains[i] != INDEX_NONE)
+			{
+				Grid.FindOrAdd(GetCell(Locations[i])).Add(i);
+			}
+		}
+
+		// Closest bone of every other chain within the distance
+		const double MaxDistanceSquared = FMath::Square(static_cast<double>(MaxDistance));
+		TArray<TArray<int32, TInlineAllocator<4>>> Neighbors;
+		Neighbors.SetNum(Locations.Num());
+		ParallelFor(Locations.Num(), [&](int32 i)
+		{
+			NumProcessedBones.fetch_add(1, std::memory_order_relaxed);
+			if (Chains[i] == INDEX_NONE)
+			{
+				return;
+			}
+
+			TMap<int32, TPair<double, int32>, TInlineSetAllocator<8>> Closest;
+			const FIntVector Cell = GetCell(Locations[i]);
+			for (int32 Z = -1; Z <= 1; ++Z)
+			{
+				for (int32 Y = -1; Y <= 1; ++Y)
+				{
+					for (int32 X = -1; X <= 1; ++X)
+					{
+						const TArray<int32>* CellBones = Grid.Find(Cell + FIntVector(X, Y, Z));
+						if (!CellBones)
+						{
+							continue;
+						}
+						for (const int32 Other : *CellBones)
+						{
+							const double DistanceSquared = FVector::DistSquared(Locations[i], Locations[Other]);
+							if (Chains[Other] == Chains[i] || DistanceSquared > MaxDistanceSquared)
+							{
+								continue;
+							}
+							TPair<double, int32>* Found = Closest.Find(Chains[Other]);
+							if (!Found)
+							{
+								Closest.Add(Chains[Other], TPair<double, int32>(DistanceSquared, Other));
+							}
+							else if (DistanceSquared < Found->Key)
+							{
+								*Found = TPair<double, int32>(DistanceSquared, Other);
+							}
+						}
+					}
+				}
+			}
+			for (const TPair<int32, TPair<double, int32>>& Pair : Closest)
+			{
+				Neighbors[i].Add(Pair.Value.Value);
+			}
+		});
+
+		// Neighboring bones usually find each other, so each pair is kept once
+		TSet<TPair<int32, int32>> UniquePairs;
+		for (int32 i = 0; i < Neighbors.Num(); ++i)
+		{
+			for (const int32 Other : Neighbors[i])
+			{
+				UniquePairs.Add(TPair<int32, int32>(FMath::Min(i, Other), FMath::Max(i, Other)));
+			}
+		}
+		Pairs = UniquePairs.Array();
+		Pairs.Sort([](const TPair<int32, int32>& A, const TPair<int32, int32>& B)
+		{
+			return A.Key != B.Key ? A.Key < B.Key : A.Value < B.Value;
+		});
+	}
+};
+
 void UKawaiiPhysicsBoneConstraintsDataAsset::ApplyRegex()
 {
 	GEditor->BeginTransaction(FText::FromString("ApplyRegex"));
@@ -125,11 +236,179 @@ void UKawaiiPhysicsBoneConstraintsDataAsset::ApplyRegex()
 			BoneConstraintsData.Add(BoneConstraintData);
 		}
 	}
+	++Revision;
 
 	GEditor->EndTransaction();
 }
 
 
+void UKawaiiPhysicsBoneConstraintsDataAsset::AutoGenerateBoneConstraints()
+{
+	if (PendingGeneration)
+	{
+		UE_LOG(LogKawaiiPhysics, Log, TEXT("%s : bone constraints are already being generated"), *GetName());
+		return;
+	}
+
+	const USkeleton* Skeleton = PreviewSkeleton.LoadSynchronous();
+	if (!Skeleton)
+	{
+		UE_LOG(LogKawaiiPhysics, Warning, TEXT("%s : no preview skeleton to generate the bone constraints from"),
+		       *GetName());
+		return;
+	}
+
+	const FReferenceSkeleton& RefSkeleton = Skeleton->GetReferenceSkeleton();
+	TArray<FTransform> RefPose;
+	FAnimationRuntime::FillUpComponentSpaceTransforms(RefSkeleton, RefSkeleton.GetRefBonePose(), RefPose);
+
+	// The skeleton GUID is kept when the reference pose is changed, so the pose is part of the settings
+	const int32 NumBones = RefSkeleton.GetNum();
+	uint32 SettingsHash = GetTypeHash(AutoGenerateMaxDistance);
+	for (const FBoneReference& RootBone : AutoGenerateRootBones)
+	{
+		SettingsHash = HashCombine(SettingsHash, GetTypeHash(RootBone.BoneName));
+	}
+	for (int32 i = 0; i < NumBones; ++i)
+	{
+		SettingsHash = HashCombine(SettingsHash, GetTypeHash(RefSkeleton.GetBoneName(i)));
+		SettingsHash = HashCombine(SettingsHash, GetTypeHash(RefSkeleton.GetParentIndex(i)));
+		SettingsHash = HashCombine(SettingsHash, GetTypeHash(RefPose[i].GetLocation()));
+	}
+	if (Skeleton->GetGuid() == AutoGeneratedSkeletonGuid && SettingsHash == AutoGeneratedSettingsHash &&
+		CalcAutoGeneratedConstraintsHash() == AutoGeneratedConstraintsHash)
+	{
+		UE_LOG(LogKawaiiPhysics, Log, TEXT("%s : bone constraints are up to date with %s"), *GetName(),
+		       *Skeleton->GetName());
+		return;
+	}
+
+	// The task only reads this copy of the reference pose, so that the asset stays editable meanwhile
+	const TSharedRef<FKawaiiPhysicsBoneConstraintGeneration> Generation =
+		MakeShared<FKawaiiPhysicsBoneConstraintGeneration>();
+	Generation->MaxDistance = AutoGenerateMaxDistance;
+	Generation->SkeletonGuid = Skeleton->GetGuid();
+	Generation->SettingsHash = SettingsHash;
+
+	TArray<int32> RootChains;
+	RootChains.Init(INDEX_NONE, NumBones);
+	for (int32 Chain = 0; Chain < AutoGenerateRootBones.Num(); ++Chain)
+	{
+		const int32 BoneIndex = RefSkeleton.FindBoneIndex(AutoGenerateRootBones[Chain].BoneName);
+		if (BoneIndex != INDEX_NONE)
+		{
+			RootChains[BoneIndex] = Chain;
+		}
+	}
+
+	// Parents come before their children, so the chain of the parent is already known
+	TArray<int32> InheritedChains;
+	InheritedChains.SetNumUninitialized(NumBones);
+	Generation->BoneNames.SetNumUninitialized(NumBones);
+	Generation->Locations.SetNumUninitialized(NumBones);
+	Generation->Chains.SetNumUninitialized(NumBones);
+	for (int32 i = 0; i < NumBones; ++i)
+	{
+		const int32 ParentIndex = RefSkeleton.GetParentIndex(i);
+		const int32 ParentChain = ParentIndex != INDEX_NONE ? InheritedChains[ParentIndex] : INDEX_NONE;
+		InheritedChains[i] = RootChains[i] != INDEX_NONE ? RootChains[i] : ParentChain;
+
+		Generation->BoneNames[i] = RefSkeleton.GetBoneName(i);
+		Generation->Locations[i] = RefPose[i].GetLocation();
+		Generation->Chains[i] = RootChains[i] != INDEX_NONE ? INDEX_NONE : ParentChain;
+	}
+
+	Generation->Task = UE::Tasks::Launch(UE_SOURCE_LOCATION, [Generation]()
+	{
+		Generation->Run();
+	});
+	PendingGeneration = Generation;
+
+	FAsyncTaskNotificationConfig NotificationConfig;
+	NotificationConfig.TitleText = FText::Format(
+		LOCTEXT("AutoGenerateBoneConstraints", "Generating Bone Constraints: {0}"), FText::FromString(GetName()));
+	NotificationConfig.LogCategory = &LogKawaiiPhysics;
+	const TSharedRef<FAsyncTaskNotification> Notification = MakeShared<FAsyncTaskNotification>(NotificationConfig);
+
+	// Polled on the game thread, which applies the result to the asset
+	FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateWeakLambda(
+		this, [this, Generation, Notification](float)
+		{
+			if (!Generation->Task.IsCompleted())
+			{
+				const int32 Percent = Generation->NumProcessedBones.load(std::memory_order_relaxed) * 100 /
+					FMath::Max(Generation->Locations.Num(), 1);
+				Notification->SetProgressText(FText::Format(
+					LOCTEXT("AutoGenerateBoneConstraintsProgress", "{0}%"), FText::AsNumber(Percent)));
+				return true;
+			}
+
+			ApplyGeneratedBoneConstraints(*Generation);
+			PendingGeneration.Reset();
+			Notification->SetComplete(FText::Format(
+				                          LOCTEXT("AutoGeneratedBoneConstraints", "Generated {0} Bone Constraints: {1}"),
+				                          FText::AsNumber(Generation->Pairs.Num()), FText::FromString(GetName())),
+			                          FText(), true);
+			return false;
+		}));
+}
+
+void UKawaiiPhysicsBoneConstraintsDataAsset::ApplyGeneratedBoneConstraints(
+	const FKawaiiPhysicsBoneConstraintGeneration& Generation)
+{
+	GEditor->BeginTransaction(FText::FromString("AutoGenerateBoneConstraints"));
+	Modify();
+
+	// The constraints added by hand or by ApplyRegex are kept
+	BoneConstraintsData.RemoveAll([](const FModifyBoneConstraintData& BoneConstraintData)
+	{
+		return BoneConstraintData.bAutoGenerated;
+	});
+	for (const TPair<int32, int32>& Pair : Generation.Pairs)
+	{
+		FModifyBoneConstraintData BoneConstraintData;
+		BoneConstraintData.BoneReference1 = FBoneReference(Generation.BoneNames[Pair.Key]);
+		BoneConstraintData.BoneReference2 = FBoneReference(Generation.BoneNames[Pair.Value]);
+		BoneConstraintData.bAutoGenerated = true;
+		BoneConstraintsData.Add(BoneConstraintData);
+	}
+	AutoGeneratedSkeletonGuid = Generation.SkeletonGuid;
+	AutoGeneratedSettingsHash = Generation.SettingsHash;
+	AutoGeneratedConstraintsHash = CalcAutoGeneratedConstraintsHash();
+	++Revision;
+
+	GEditor->EndTransaction();
+	MarkPackageDirty();
+}
+
+void UKawaiiPhysicsBoneConstraintsDataAsset::RegenerateBoneConstraints()
+{
+	if (PendingGeneration)
+	{
+		UE_LOG(LogKawaiiPhysics, Log, TEXT("%s : bone constraints are already being generated"), *GetName());
+		return;
+	}
+
+	AutoGeneratedSkeletonGuid.Invalidate();
+	AutoGenerateBoneConstraints();
+}
+
+uint32 UKawaiiPhysicsBoneConstraintsDataAsset::CalcAutoGeneratedConstraintsHash() const
+{
+	uint32 Hash = 0;
+	for (const FModifyBoneConstraintData& BoneConstraintData : BoneConstraintsData)
+	{
+		if (BoneConstraintData.bAutoGenerated)
+		{
+			Hash = HashCombine(Hash, GetTypeHash(BoneConstraintData.BoneReference1.BoneName));
+			Hash = HashCombine(Hash, GetTypeHash(BoneConstraintData.BoneReference2.BoneName));
+			Hash = HashCombine(Hash, GetTypeHash(BoneConstraintData.bOverrideCompliance));
+			Hash = HashCombine(Hash, GetTypeHash(BoneConstraintData.ComplianceType));
+		}
+	}
+	return Hash;
+}
+
 void UKawaiiPhysicsBoneConstraintsDataAsset::UpdatePreviewBoneList()
 {
 	PreviewBoneList.Empty();
@@ -156,6 +435,9 @@ void UKawaiiPhysicsBoneConstraintsDataAsset::UpdatePreviewBoneList()
 
 void UKawaiiPhysicsBoneConstraintsDataAsset::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
 {
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	++Revision;
+
 	const FName PropertyName = PropertyChangedEvent.MemberProperty
 		                           ? PropertyChangedEvent.MemberProperty->GetFName()
 		                           : NAME_None;
@@ -166,6 +448,13 @@ void UKawaiiPhysicsBoneConstraintsDataAsset::PostEditChangeProperty(FPropertyCha
 	}
 }
 
+void UKawaiiPhysicsBoneConstraintsDataAsset::PostEditUndo()
+{
+	Super::PostEditUndo();
+
+	++Revision;
+}
+
 #undef LOCTEXT_NAMESPACE
 
 #endif
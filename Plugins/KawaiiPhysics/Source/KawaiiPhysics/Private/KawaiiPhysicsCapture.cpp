@@ -0,0 +1,585 @@
+// KawaiiPhysics : Copyright (c) 2019-2024 pafuhana1213, MIT License
+
+#include "KawaiiPhysicsCapture.h"
+
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "KawaiiPhysics.h"
+#include "KawaiiPhysicsDistanceFieldDataAsset.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Serialization/MemoryReader.h"
+
+#include <atomic>
+
+namespace
+{
+	int32 GKawaiiPhysicsCaptureSteps = 0;
+	FString GKawaiiPhysicsCaptureFilter;
+
+	/** Bumped whenever a capture is requested, so that every node starts at most one capture per request */
+	std::atomic<uint32> GKawaiiPhysicsCaptureRequestSerial{0};
+
+	/** Copy of the request read by the nodes, which evaluate on worker threads */
+	FCriticalSection GKawaiiPhysicsCaptureRequestLock;
+	int32 GKawaiiPhysicsCaptureRequestSteps = 0;
+	FString GKawaiiPhysicsCaptureRequestFilter;
+
+	void OnCaptureRequested(IConsoleVariable*)
+	{
+		FScopeLock Lock(&GKawaiiPhysicsCaptureRequestLock);
+		GKawaiiPhysicsCaptureRequestSteps = GKawaiiPhysicsCaptureSteps;
+		GKawaiiPhysicsCaptureRequestFilter = GKawaiiPhysicsCaptureFilter;
+		++GKawaiiPhysicsCaptureRequestSerial;
+	}
+
+	FAutoConsoleVariableRef CVarAnimNodeKawaiiPhysicsCaptureSteps(
+		TEXT("a.AnimNode.KawaiiPhysics.Capture.Steps"), GKawaiiPhysicsCaptureSteps,
+		TEXT("Capture the next N solver steps of the KawaiiPhysics nodes matching a.AnimNode.KawaiiPhysics.Capture.Filter ")
+		TEXT("to Saved/KawaiiPhysics/Captures. Nodes initialized later capture too until this is set back to 0"),
+		FConsoleVariableDelegate::CreateStatic(&OnCaptureRequested));
+	FAutoConsoleVariableRef CVarAnimNodeKawaiiPhysicsCaptureFilter(
+		TEXT("a.AnimNode.KawaiiPhysics.Capture.Filter"), GKawaiiPhysicsCaptureFilter,
+		TEXT("Only capture the KawaiiPhysics nodes whose name (KawaiiPhysics <Owner class> <Tag>) contains this. ")
+		TEXT("Set it before a.AnimNode.KawaiiPhysics.Capture.Steps"));
+
+	/** Upper bound of the array sizes read from a capture, to reject corrupted files */
+	constexpr int32 MaxCaptureArrayNum = 1 << 24;
+
+	template <typename T, typename FuncType>
+	void SerializeArray(FArchive& Ar, TArray<T>& Array, FuncType&& SerializeElement)
+	{
+		int32 Num = Array.Num();
+		Ar << Num;
+		if (Ar.IsLoading())
+		{
+			if (Num < 0 || Num > MaxCaptureArrayNum)
+			{
+				Ar.SetError();
+				return;
+			}
+			Array.SetNum(Num);
+		}
+		for (T& Element : Array)
+		{
+			SerializeElement(Element);
+		}
+	}
+
+	template <typename T>
+	void SerializeArray(FArchive& Ar, TArray<T>& Array)
+	{
+		SerializeArray(Ar, Array, [&Ar](T& Element) { Ar << Element; });
+	}
+
+	template <typename EnumType>
+	void SerializeEnum(FArchive& Ar, EnumType& Value)
+	{
+		uint8 RawValue = static_cast<uint8>(Value);
+		Ar << RawValue;
+		Value = static_cast<EnumType>(RawValue);
+	}
+
+	void SerializeParams(FArchive& Ar, FKawaiiPhysicsSolverParams& Params)
+	{
+		Ar << Params.DeltaTime;
+		Ar << Params.DeltaTimeOld;
+		Ar << Params.TargetFramerate;
+		Ar << Params.GravityCS;
+		Ar << Params.SkelCompMoveVector;
+		Ar << Params.SkelCompMoveRotation;
+		SerializeEnum(Ar, Params.PlanarConstraint);
+		SerializeEnum(Ar, Params.BoneConstraintGlobalComplianceType);
+		Ar << Params.BoneConstraintIterationCountAfterCollision;
+		SerializeEnum(Ar, Params.BoneConstraintSolver);
+	}
+
+	/** Only the arrays the solver reads are kept. The others are rebuilt when loading */
+	void SerializeKeyframe(FArchive& Ar, FKawaiiPhysicsCaptureKeyframe& Keyframe)
+	{
+		FKawaiiPhysicsSolverState& State = Keyframe.State;
+		SerializeArray(Ar, State.Locations);
+		SerializeArray(Ar, State.PrevLocations);
+		SerializeArray(Ar, State.PoseLocations);
+		SerializeArray(Ar, State.PoseRotations);
+		SerializeArray(Ar, State.ParentIndices);
+		SerializeArray(Ar, State.Radii);
+		SerializeArray(Ar, State.Dampings);
+		SerializeArray(Ar, State.Stiffnesses);
+		SerializeArray(Ar, State.WorldDampingLocations);
+		SerializeArray(Ar, State.WorldDampingRotations);
+		SerializeArray(Ar, State.LimitAngles);
+		SerializeArray(Ar, State.bDummies);
+		SerializeArray(Ar, State.bHasBones);
+
+		SerializeArray(Ar, Keyframe.Constraints, [&Ar](FModifyBoneConstraint& Constraint)
+		{
+			Ar << Constraint.ModifyBoneIndex1;
+			Ar << Constraint.ModifyBoneIndex2;
+			Ar << Constraint.Length;
+			Ar << Constraint.bOverrideCompliance;
+			SerializeEnum(Ar, Constraint.ComplianceType);
+			Ar << Constraint.bIsDummy;
+		});
+		SerializeArray(Ar, Keyframe.ConstraintColorStarts);
+
+		if (Ar.IsLoading())
+		{
+			const int32 NumBones = State.Locations.Num();
+			State.PoseScales.Init(FVector::OneVector, NumBones);
+			State.PrevRotations.Init(FQuat::Identity, NumBones);
+			State.bSkipSimulates.Init(false, NumBones);
+			State.BoneConstraintLambdas.Reset();
+		}
+	}
+
+	void SerializeDistanceField(FArchive& Ar, FKawaiiPhysicsDistanceField& Field)
+	{
+		Ar << Field.Bounds;
+		Ar << Field.Resolution;
+		SerializeArray(Ar, Field.Distances);
+	}
+
+	/** Distance fields are written as their index in the capture */
+	template <typename FieldToIndexType, typename IndexToFieldType>
+	void SerializeStep(FArchive& Ar, FKawaiiPhysicsCaptureStep& Step, FieldToIndexType&& FieldToIndex,
+	                   IndexToFieldType&& IndexToField)
+	{
+		SerializeParams(Ar, Step.Params);
+		Ar << Step.ComponentTransform;
+		SerializeArray(Ar, Step.PoseLocations);
+		SerializeArray(Ar, Step.PoseRotations);
+		SerializeArray(Ar, Step.SimulatedBoneIndices);
+		SerializeArray(Ar, Step.WindVelocities);
+		SerializeArray(Ar, Step.ExternalForceOffsets);
+		SerializeArray(Ar, Step.WorldCollisionOffsets);
+
+		FKawaiiPhysicsPackedLimits& Limits = Step.Limits;
+		SerializeArray(Ar, Limits.Spheres, [&Ar](FKawaiiPhysicsPackedLimits::FPackedSphere& Sphere)
+		{
+			Ar << Sphere.Location;
+			Ar << Sphere.Radius;
+			Ar << Sphere.bInner;
+			Ar << Sphere.Bounds;
+		});
+		SerializeArray(Ar, Limits.Capsules, [&Ar](FKawaiiPhysicsPackedLimits::FPackedCapsule& Capsule)
+		{
+			Ar << Capsule.StartPoint;
+			Ar << Capsule.EndPoint;
+			Ar << Capsule.Radius;
+			Ar << Capsule.Bounds;
+		});
+		SerializeArray(Ar, Limits.Boxes, [&Ar](FKawaiiPhysicsPackedLimits::FPackedBox& Box)
+		{
+			Ar << Box.Transform;
+			Ar << Box.Extent;
+			Ar << Box.BoundingRadius;
+			Ar << Box.Bounds;
+		});
+		SerializeArray(Ar, Limits.DistanceFields, [&](FKawaiiPhysicsPackedLimits::FPackedDistanceField& DistanceField)
+		{
+			Ar << DistanceField.Transform;
+			Ar << DistanceField.Bounds;
+			int32 FieldIndex = Ar.IsLoading() ? INDEX_NONE : FieldToIndex(DistanceField.Field);
+			Ar << FieldIndex;
+			if (Ar.IsLoading())
+			{
+				DistanceField.Field = IndexToField(FieldIndex);
+				if (!DistanceField.Field)
+				{
+					Ar.SetError();
+				}
+			}
+		});
+		SerializeArray(Ar, Limits.Planars, [&Ar](FKawaiiPhysicsPackedLimits::FPackedPlanar& Planar)
+		{
+			Ar << Planar.Plane;
+			Ar << Planar.UpVector;
+		});
+
+		SerializeArray(Ar, Step.ResultLocations);
+	}
+
+	void WriteRecord(FArchive& Ar, KawaiiPhysicsCapture::ERecord Record)
+	{
+		SerializeEnum(Ar, Record);
+	}
+
+	/** Whether a loaded keyframe can be indexed by bone and by constraint like the node's own state */
+	bool IsValidKeyframe(const FKawaiiPhysicsCaptureKeyframe& Keyframe)
+	{
+		const FKawaiiPhysicsSolverState& State = Keyframe.State;
+		const int32 NumBones = State.Num();
+		if (State.PrevLocations.Num() != NumBones || State.PoseLocations.Num() != NumBones ||
+			State.PoseRotations.Num() != NumBones || State.ParentIndices.Num() != NumBones ||
+			State.Radii.Num() != NumBones || State.Dampings.Num() != NumBones ||
+			State.Stiffnesses.Num() != NumBones || State.WorldDampingLocations.Num() != NumBones ||
+			State.WorldDampingRotations.Num() != NumBones || State.LimitAngles.Num() != NumBones ||
+			State.bDummies.Num() != NumBones || State.bHasBones.Num() != NumBones)
+		{
+			return false;
+		}
+
+		// The solver relies on the bones being parent-sorted
+		for (int32 i = 0; i < NumBones; ++i)
+		{
+			if (State.ParentIndices[i] < INDEX_NONE || State.ParentIndices[i] >= i)
+			{
+				return false;
+			}
+		}
+
+		for (const FModifyBoneConstraint& Constraint : Keyframe.Constraints)
+		{
+			if (Constraint.ModifyBoneIndex1 < 0 || Constraint.ModifyBoneIndex1 >= NumBones ||
+				Constraint.ModifyBoneIndex2 < 0 || Constraint.ModifyBoneIndex2 >= NumBones)
+			{
+				return false;
+			}
+		}
+
+		int32 PrevColorStart = 0;
+		for (const int32 ColorStart : Keyframe.ConstraintColorStarts)
+		{
+			if (ColorStart < PrevColorStart || ColorStart > Keyframe.Constraints.Num())
+			{
+				return false;
+			}
+			PrevColorStart = ColorStart;
+		}
+		return true;
+	}
+
+	/** Whether a loaded step matches the bones of the keyframe it continues from */
+	bool IsValidStep(const FKawaiiPhysicsCaptureStep& Step, const FKawaiiPhysicsSolverState& State)
+	{
+		const int32 NumBones = State.Num();
+		auto IsPerBone = [NumBones](const auto& Array, bool bOptional)
+		{
+			return Array.Num() == NumBones || (bOptional && Array.IsEmpty());
+		};
+		if (!IsPerBone(Step.PoseLocations, false) || !IsPerBone(Step.PoseRotations, false) ||
+			!IsPerBone(Step.ResultLocations, false) || !IsPerBone(Step.WindVelocities, true) ||
+			!IsPerBone(Step.ExternalForceOffsets, true) || !IsPerBone(Step.WorldCollisionOffsets, true))
+		{
+			return false;
+		}
+
+		// The solver reads the parent of every simulated bone
+		for (const int32 Index : Step.SimulatedBoneIndices)
+		{
+			if (Index < 0 || Index >= NumBones || State.ParentIndices[Index] < 0 ||
+				State.ParentIndices[Index] >= NumBones)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+void FKawaiiPhysicsCaptureStep::Reset()
+{
+	KeyframeIndex = INDEX_NONE;
+	Params = FKawaiiPhysicsSolverParams();
+	ComponentTransform = FTransform::Identity;
+	PoseLocations.Reset();
+	PoseRotations.Reset();
+	SimulatedBoneIndices.Reset();
+	WindVelocities.Reset();
+	ExternalForceOffsets.Reset();
+	WorldCollisionOffsets.Reset();
+	Limits.Spheres.Reset();
+	Limits.Capsules.Reset();
+	Limits.Boxes.Reset();
+	Limits.DistanceFields.Reset();
+	Limits.Planars.Reset();
+	ResultLocations.Reset();
+}
+
+bool FKawaiiPhysicsCapture::Load(const FString& Path, FString& OutError)
+{
+	Keyframes.Reset();
+	Steps.Reset();
+	DistanceFields.Reset();
+
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *Path))
+	{
+		OutError = FString::Printf(TEXT("Failed to read %s"), *Path);
+		return false;
+	}
+
+	FMemoryReader Ar(Data);
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	Ar << Magic;
+	Ar << Version;
+	if (Magic != KawaiiPhysicsCapture::Magic || Version != KawaiiPhysicsCapture::Version)
+	{
+		OutError = FString::Printf(TEXT("%s is not a KawaiiPhysics capture of version %u"), *Path,
+		                           KawaiiPhysicsCapture::Version);
+		return false;
+	}
+	Ar << NodeName;
+
+	auto IndexToField = [this](int32 Index) -> const FKawaiiPhysicsDistanceField*
+	{
+		return DistanceFields.IsValidIndex(Index) ? DistanceFields[Index].Get() : nullptr;
+	};
+
+	// Records are only kept once they were read completely and are consistent with the keyframe they apply to.
+	// The first one that is not ends the capture
+	int32 PendingKeyframeIndex = INDEX_NONE;
+	int32 ActiveKeyframeIndex = INDEX_NONE;
+	while (!Ar.AtEnd() && !Ar.IsError())
+	{
+		KawaiiPhysicsCapture::ERecord Record = KawaiiPhysicsCapture::ERecord::End;
+		SerializeEnum(Ar, Record);
+
+		switch (Record)
+		{
+		case KawaiiPhysicsCapture::ERecord::Keyframe:
+			{
+				FKawaiiPhysicsCaptureKeyframe Keyframe;
+				SerializeKeyframe(Ar, Keyframe);
+				if (Ar.IsError() || !IsValidKeyframe(Keyframe))
+				{
+					Ar.SetError();
+					break;
+				}
+				PendingKeyframeIndex = Keyframes.Add(MoveTemp(Keyframe));
+			}
+			break;
+		case KawaiiPhysicsCapture::ERecord::DistanceField:
+			{
+				TUniquePtr<FKawaiiPhysicsDistanceField> Field = MakeUnique<FKawaiiPhysicsDistanceField>();
+				SerializeDistanceField(Ar, *Field);
+				if (Ar.IsError() || !Field->IsValid())
+				{
+					Ar.SetError();
+					break;
+				}
+				DistanceFields.Add(MoveTemp(Field));
+			}
+			break;
+		case KawaiiPhysicsCapture::ERecord::Step:
+			{
+				FKawaiiPhysicsCaptureStep Step;
+				SerializeStep(Ar, Step, [](const FKawaiiPhysicsDistanceField*) { return INDEX_NONE; }, IndexToField);
+				const int32 StepKeyframeIndex = PendingKeyframeIndex != INDEX_NONE
+					                                ? PendingKeyframeIndex
+					                                : ActiveKeyframeIndex;
+				if (Ar.IsError() || StepKeyframeIndex == INDEX_NONE ||
+					!IsValidStep(Step, Keyframes[StepKeyframeIndex].State))
+				{
+					Ar.SetError();
+					break;
+				}
+				Step.KeyframeIndex = PendingKeyframeIndex;
+				PendingKeyframeIndex = INDEX_NONE;
+				ActiveKeyframeIndex = StepKeyframeIndex;
+				Steps.Add(MoveTemp(Step));
+			}
+			break;
+		case KawaiiPhysicsCapture::ERecord::End:
+			return true;
+		default:
+			Ar.SetError();
+			break;
+		}
+	}
+
+	// A capture cut short (e.g. by a crash) is still replayed up to its last complete and consistent step
+	if (Ar.IsError())
+	{
+		UE_LOG(LogKawaiiPhysics, Warning, TEXT("%s is truncated or corrupted, replaying the first %d steps"), *Path,
+		       Steps.Num());
+	}
+	if (Steps.IsEmpty() || Steps[0].KeyframeIndex == INDEX_NONE)
+	{
+		OutError = FString::Printf(TEXT("%s has no steps"), *Path);
+		return false;
+	}
+	return true;
+}
+
+TSharedPtr<FKawaiiPhysicsCaptureWriter> FKawaiiPhysicsCaptureWriter::CreateIfRequested(
+	uint32& InOutRequestSerial, const FString& NodeName)
+{
+	const uint32 RequestSerial = GKawaiiPhysicsCaptureRequestSerial.load(std::memory_order_relaxed);
+	if (RequestSerial == InOutRequestSerial)
+	{
+		return nullptr;
+	}
+	InOutRequestSerial = RequestSerial;
+
+	int32 NumSteps;
+	{
+		FScopeLock Lock(&GKawaiiPhysicsCaptureRequestLock);
+		if (GKawaiiPhysicsCaptureRequestSteps <= 0 || !NodeName.Contains(GKawaiiPhysicsCaptureRequestFilter))
+		{
+			return nullptr;
+		}
+		NumSteps = GKawaiiPhysicsCaptureRequestSteps;
+	}
+
+	static std::atomic<uint32> CaptureIndex{0};
+	const FString FileName = FPaths::MakeValidFileName(
+		FString::Printf(TEXT("%s_%s_%u.kpcap"), *NodeName.Replace(TEXT(" "), TEXT("_")),
+		                *FDateTime::Now().ToString(), CaptureIndex++));
+	const FString Path = FPaths::ProjectSavedDir() / TEXT("KawaiiPhysics") / TEXT("Captures") / FileName;
+
+	TUniquePtr<FArchive> Archive(IFileManager::Get().CreateFileWriter(*Path));
+	if (!Archive)
+	{
+		UE_LOG(LogKawaiiPhysics, Warning, TEXT("Failed to create the capture %s"), *Path);
+		return nullptr;
+	}
+
+	UE_LOG(LogKawaiiPhysics, Log, TEXT("Capturing %d steps of %s to %s"), NumSteps, *NodeName, *Path);
+	return MakeShared<FKawaiiPhysicsCaptureWriter>(MoveTemp(Archive), NodeName, NumSteps);
+}
+
+FKawaiiPhysicsCaptureWriter::FKawaiiPhysicsCaptureWriter(TUniquePtr<FArchive>&& InArchive, const FString& NodeName,
+                                                         int32 InNumSteps)
+	: Archive(MoveTemp(InArchive))
+	, NumSteps(InNumSteps)
+{
+	uint32 Magic = KawaiiPhysicsCapture::Magic;
+	uint32 Version = KawaiiPhysicsCapture::Version;
+	FString Name = NodeName;
+	*Archive << Magic;
+	*Archive << Version;
+	*Archive << Name;
+}
+
+FKawaiiPhysicsCaptureWriter::~FKawaiiPhysicsCaptureWriter()
+{
+	WriteRecord(*Archive, KawaiiPhysicsCapture::ERecord::End);
+	Archive->Close();
+}
+
+bool FKawaiiPhysicsCaptureWriter::NeedsKeyframe(const FKawaiiPhysicsSolverState& State,
+                                                TConstArrayView<FModifyBoneConstraint> Constraints,
+                                                TConstArrayView<int32> ConstraintColorStarts) const
+{
+	if (!bHasEndState || Constraints.GetData() != KeyframeConstraints ||
+		Constraints.Num() != NumKeyframeConstraints || ConstraintColorStarts.Num() != NumKeyframeConstraintColors)
+	{
+		return true;
+	}
+
+	// Pose arrays are written with every step, and PrevRotations are not read by the solver
+	return State.Locations != EndState.Locations || State.PrevLocations != EndState.PrevLocations ||
+		State.ParentIndices != EndState.ParentIndices || State.Radii != EndState.Radii ||
+		State.Dampings != EndState.Dampings || State.Stiffnesses != EndState.Stiffnesses ||
+		State.WorldDampingLocations != EndState.WorldDampingLocations ||
+		State.WorldDampingRotations != EndState.WorldDampingRotations || State.LimitAngles != EndState.LimitAngles ||
+		State.bDummies != EndState.bDummies || State.bHasBones != EndState.bHasBones;
+}
+
+void FKawaiiPhysicsCaptureWriter::BeginStep(const FKawaiiPhysicsSolverState& State,
+                                            TConstArrayView<FModifyBoneConstraint> Constraints,
+                                            TConstArrayView<int32> ConstraintColorStarts,
+                                            const FKawaiiPhysicsPackedLimits& Limits)
+{
+	if (NeedsKeyframe(State, Constraints, ConstraintColorStarts))
+	{
+		FKawaiiPhysicsCaptureKeyframe Keyframe;
+		Keyframe.State = State;
+		Keyframe.Constraints.Append(Constraints.GetData(), Constraints.Num());
+		Keyframe.ConstraintColorStarts.Append(ConstraintColorStarts.GetData(), ConstraintColorStarts.Num());
+		WriteRecord(*Archive, KawaiiPhysicsCapture::ERecord::Keyframe);
+		SerializeKeyframe(*Archive, Keyframe);
+
+		KeyframeConstraints = Constraints.GetData();
+		NumKeyframeConstraints = Constraints.Num();
+		NumKeyframeConstraintColors = ConstraintColorStarts.Num();
+	}
+
+	for (const FKawaiiPhysicsPackedLimits::FPackedDistanceField& DistanceField : Limits.DistanceFields)
+	{
+		if (!DistanceFieldIndices.Contains(DistanceField.Field))
+		{
+			DistanceFieldIndices.Add(DistanceField.Field, DistanceFieldIndices.Num());
+			WriteRecord(*Archive, KawaiiPhysicsCapture::ERecord::DistanceField);
+			FKawaiiPhysicsDistanceField Field = *DistanceField.Field;
+			SerializeDistanceField(*Archive, Field);
+		}
+	}
+
+	Step.Reset();
+	Step.PoseLocations = State.PoseLocations;
+	Step.PoseRotations = State.PoseRotations;
+	Step.Limits = Limits;
+	bInStep = true;
+}
+
+void FKawaiiPhysicsCaptureWriter::DiscardStep()
+{
+	bInStep = false;
+}
+
+void FKawaiiPhysicsCaptureWriter::SetParams(const FKawaiiPhysicsSolverParams& Params,
+                                            const FTransform& ComponentTransform)
+{
+	Step.Params = Params;
+	Step.ComponentTransform = ComponentTransform;
+}
+
+void FKawaiiPhysicsCaptureWriter::SetSimulatedBoneIndices(TConstArrayView<int32> SimulatedBoneIndices)
+{
+	Step.SimulatedBoneIndices.Reset();
+	Step.SimulatedBoneIndices.Append(SimulatedBoneIndices.GetData(), SimulatedBoneIndices.Num());
+}
+
+void FKawaiiPhysicsCaptureWriter::SetWindVelocity(int32 Index, const FVector& WindVelocity)
+{
+	if (Step.WindVelocities.IsEmpty())
+	{
+		Step.WindVelocities.Init(FVector::ZeroVector, Step.PoseLocations.Num());
+	}
+	Step.WindVelocities[Index] = WindVelocity;
+}
+
+void FKawaiiPhysicsCaptureWriter::AddExternalForceOffset(int32 Index, const FVector& Offset)
+{
+	if (Step.ExternalForceOffsets.IsEmpty())
+	{
+		Step.ExternalForceOffsets.Init(FVector::ZeroVector, Step.PoseLocations.Num());
+	}
+	Step.ExternalForceOffsets[Index] += Offset;
+}
+
+void FKawaiiPhysicsCaptureWriter::AddWorldCollisionOffset(int32 Index, const FVector& Offset)
+{
+	if (Step.WorldCollisionOffsets.IsEmpty())
+	{
+		Step.WorldCollisionOffsets.Init(FVector::ZeroVector, Step.PoseLocations.Num());
+	}
+	Step.WorldCollisionOffsets[Index] += Offset;
+}
+
+bool FKawaiiPhysicsCaptureWriter::EndStep(const FKawaiiPhysicsSolverState& State)
+{
+	if (!bInStep)
+	{
+		return NumWrittenSteps < NumSteps;
+	}
+	bInStep = false;
+
+	Step.ResultLocations = State.Locations;
+	WriteRecord(*Archive, KawaiiPhysicsCapture::ERecord::Step);
+	SerializeStep(*Archive, Step, [this](const FKawaiiPhysicsDistanceField* Field)
+	{
+		return DistanceFieldIndices.FindChecked(Field);
+	}, [](int32) { return nullptr; });
+
+	EndState = State;
+	bHasEndState = true;
+
+	return ++NumWrittenSteps < NumSteps;
+}
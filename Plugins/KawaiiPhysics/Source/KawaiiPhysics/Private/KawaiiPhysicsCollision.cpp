@@ -0,0 +1,676 @@
+// KawaiiPhysics : Copyright (c) 2019-2024 pafuhana1213, MIT License
+
+#include "AnimNode_KawaiiPhysics.h"
+#include "KawaiiPhysicsDistanceFieldDataAsset.h"
+
+#if ENABLE_ANIM_DEBUG
+TAutoConsoleVariable<bool> CVarAnimNodeKawaiiPhysicsSIMDCollision(
+	TEXT("a.AnimNode.KawaiiPhysics.SIMDCollision"), true,
+	TEXT("Use the vectorized collision kernels for KawaiiPhysics limits. 0 = scalar reference path"));
+
+TAutoConsoleVariable<bool> CVarAnimNodeKawaiiPhysicsCollisionBroadphase(
+	TEXT("a.AnimNode.KawaiiPhysics.CollisionBroadphase"), true,
+	TEXT("Cull the KawaiiPhysics limits that a group of bones cannot reach before testing them. 0 = test every limit"));
+#endif
+
+DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_PackLimits"), STAT_KawaiiPhysics_PackLimits, STATGROUP_Anim);
+DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_CollisionBroadphase"), STAT_KawaiiPhysics_CollisionBroadphase, STATGROUP_Anim);
+
+namespace KawaiiPhysicsCollision
+{
+	using FPackedSphere = FKawaiiPhysicsPackedLimits::FPackedSphere;
+	using FPackedCapsule = FKawaiiPhysicsPackedLimits::FPackedCapsule;
+	using FPackedBox = FKawaiiPhysicsPackedLimits::FPackedBox;
+	using FPackedPlanar = FKawaiiPhysicsPackedLimits::FPackedPlanar;
+	using FPackedDistanceField = FKawaiiPhysicsPackedLimits::FPackedDistanceField;
+
+	// Number of bones tested at once (width of VectorRegister4Double)
+	constexpr int32 LaneCount = 4;
+
+	// Number of consecutive bones sharing the limits left by the broadphase. Bones are parent-sorted,
+	// so consecutive bones mostly belong to the same chains and their bounds stay small
+	constexpr int32 BroadphaseGroupSize = LaneCount * 4;
+
+	// The rejection tests are widened by this (relative and absolute) amount so that rounding differences between
+	// the vector and the scalar math can never reject a bone the scalar path would have moved.
+	constexpr double RejectSlack = 1.e-3;
+
+	// ---- Exact scalar resolution. Shared by both paths so that they produce identical results ----
+
+	void AdjustBySphere(FKawaiiPhysicsSolverState& State, int32 Index, const FPackedSphere& Sphere)
+	{
+		FVector& Location = State.Locations[Index];
+		const float Radius = State.Radii[Index];
+
+		const float LimitDistance = Radius + Sphere.Radius;
+		if (!Sphere.bInner)
+		{
+			if ((Location - Sphere.Location).SizeSquared() > LimitDistance * LimitDistance)
+			{
+				return;
+			}
+			Location += (LimitDistance - (Location - Sphere.Location).Size())
+				* (Location - Sphere.Location).GetSafeNormal();
+		}
+		else
+		{
+			if ((Location - Sphere.Location).SizeSquared() < LimitDistance * LimitDistance)
+			{
+				return;
+			}
+			Location = Sphere.Location + (Sphere.Radius - Radius) * (Location - Sphere.Location).GetSafeNormal();
+		}
+	}
+
+	void AdjustByCapsule(FKawaiiPhysicsSolverState& State, int32 Index, const FPackedCapsule& Capsule)
+	{
+		FVector& Location = State.Locations[Index];
+
+		const float DistSquared = FMath::PointDistToSegmentSquared(Location, Capsule.StartPoint, Capsule.EndPoint);
+
+		const float LimitDistance = State.Radii[Index] + Capsule.Radius;
+		if (DistSquared < LimitDistance * LimitDistance)
+		{
+			FVector ClosestPoint = FMath::ClosestPointOnSegment(Location, Capsule.StartPoint, Capsule.EndPoint);
+			Location = ClosestPoint + (Location - ClosestPoint).GetSafeNormal() * LimitDistance;
+		}
+	}
+
+	void AdjustByBox(FKawaiiPhysicsSolverState& State, int32 Index, const FPackedBox& Box)
+	{
+		FVector& Location = State.Locations[Index];
+		const float SphereRadius = State.Radii[Index];
+
+		FVector LocalSphereCenter = Box.Transform.InverseTransformPosition(Location);
+		FBox LocalBox(-Box.Extent, Box.Extent);
+		if (FMath::SphereAABBIntersection(FSphere(LocalSphereCenter, SphereRadius), LocalBox))
+		{
+			// Calculate the point of the Box closest to the center of the Sphere
+			FVector ClosestPoint = LocalSphereCenter;
+			ClosestPoint.X = FMath::Clamp(ClosestPoint.X, LocalBox.Min.X, LocalBox.Max.X);
+			ClosestPoint.Y = FMath::Clamp(ClosestPoint.Y, LocalBox.Min.Y, LocalBox.Max.Y);
+			ClosestPoint.Z = FMath::Clamp(ClosestPoint.Z, LocalBox.Min.Z, LocalBox.Max.Z);
+
+			FVector PushOutVector = LocalSphereCenter - ClosestPoint;
+			float Distance = PushOutVector.Size();
+
+			// When the bone sphere is completely buried inside the box, forced to push.
+			if (PushOutVector.IsNearlyZero())
+			{
+				PushOutVector = LocalSphereCenter;
+				Distance = SphereRadius;
+			}
+
+			// push
+			if (Distance <= SphereRadius)
+			{
+				FVector PushOutDirection = PushOutVector.GetSafeNormal();
+				FVector NewLocalSphereCenter = ClosestPoint + PushOutDirection * SphereRadius;
+				Location = Box.Transform.TransformPosition(NewLocalSphereCenter);
+			}
+		}
+	}
+
+	void AdjustByDistanceField(FKawaiiPhysicsSolverState& State, int32 Index, const FPackedDistanceField& Field)
+	{
+		FVector& Location = State.Locations[Index];
+		const float Radius = State.Radii[Index];
+
+		// Bones outside of the field are at least its padding away from the body
+		FVector LocalLocation = Field.Transform.InverseTransformPositionNoScale(Location);
+		if (!Field.Field->Bounds.IsInsideOrOn(LocalLocation))
+		{
+			return;
+		}
+
+		FVector Gradient;
+		const float Distance = Field.Field->Sample(LocalLocation, Gradient);
+		if (Distance >= Radius)
+		{
+			return;
+		}
+
+		// One step along the gradient. The field is close to linear within a cell, so this lands on the surface
+		const FVector PushOutDirection = Gradient.GetSafeNormal();
+		if (PushOutDirection.IsZero())
+		{
+			return;
+		}
+		LocalLocation += PushOutDirection * (Radius - Distance);
+		Location = Field.Transform.TransformPositionNoScale(LocalLocation);
+	}
+
+	/** Both the scalar and the vectorized planar tests expect a plane with a unit normal */
+	FPlane NormalizePlane(const FPlane& Plane)
+	{
+		const double NormalSize = FVector(Plane).Size();
+		return NormalSize > UE_SMALL_NUMBER ? FPlane(FVector(Plane) / NormalSize, Plane.W / NormalSize) : Plane;
+	}
+
+	void AdjustByPlanar(FKawaiiPhysicsSolverState& State, int32 Index, const FPackedPlanar& Planar)
+	{
+		FVector& Location = State.Locations[Index];
+		const float Radius = State.Radii[Index];
+
+		FVector PointOnPlane = FVector::PointPlaneProject(Location, Planar.Plane);
+		const float DistSquared = (Location - PointOnPlane).SizeSquared();
+
+		FVector IntersectionPoint;
+		if (DistSquared < Radius * Radius ||
+			FMath::SegmentPlaneIntersection(Location, State.PrevLocations[Index], Planar.Plane, IntersectionPoint))
+		{
+			Location = PointOnPlane + Planar.UpVector * Radius;
+		}
+	}
+
+	// ---- Vectorized rejection ----
+
+	/** Up to LaneCount bones, transposed so that each component can be loaded into one register */
+	struct FBoneLanes
+	{
+		alignas(32) double X[LaneCount];
+		alignas(32) double Y[LaneCount];
+		alignas(32) double Z[LaneCount];
+		alignas(32) double PrevX[LaneCount];
+		alignas(32) double PrevY[LaneCount];
+		alignas(32) double PrevZ[LaneCount];
+		alignas(32) double Radius[LaneCount];
+		int32 BoneIndices[LaneCount];
+		uint32 ActiveMask = 0;
+
+		void Load(const FKawaiiPhysicsSolverState& State, TConstArrayView<int32> Indices, int32 First)
+		{
+			ActiveMask = 0;
+			for (int32 Lane = 0; Lane < LaneCount; ++Lane)
+			{
+				if (First + Lane < Indices.Num())
+				{
+					BoneIndices[Lane] = Indices[First + Lane];
+					ActiveMask |= 1u << Lane;
+
+					const FVector& PrevLocation = State.PrevLocations[BoneIndices[Lane]];
+					PrevX[Lane] = PrevLocation.X;
+					PrevY[Lane] = PrevLocation.Y;
+					PrevZ[Lane] = PrevLocation.Z;
+					Radius[Lane] = State.Radii[BoneIndices[Lane]];
+					Refresh(State, Lane);
+				}
+				else
+				{
+					// Inactive lanes are masked out, they only need to hold finite values
+					BoneIndices[Lane] = INDEX_NONE;
+					X[Lane] = Y[Lane] = Z[Lane] = 0.0;
+					PrevX[Lane] = PrevY[Lane] = PrevZ[Lane] = 0.0;
+					Radius[Lane] = 0.0;
+				}
+			}
+		}
+
+		void Refresh(const FKawaiiPhysicsSolverState& State, int32 Lane)
+		{
+			const FVector& Location = State.Locations[BoneIndices[Lane]];
+			X[Lane] = Location.X;
+			Y[Lane] = Location.Y;
+			Z[Lane] = Location.Z;
+		}
+	};
+
+	FORCEINLINE VectorRegister4Double InflateThreshold(const VectorRegister4Double& Threshold)
+	{
+		return VectorMultiplyAdd(Threshold, VectorSetFloat1(1.0 + RejectSlack), VectorSetFloat1(RejectSlack));
+	}
+
+	FORCEINLINE VectorRegister4Double DeflateThreshold(const VectorRegister4Double& Threshold)
+	{
+		return VectorMultiplyAdd(Threshold, VectorSetFloat1(1.0 - RejectSlack), VectorSetFloat1(-RejectSlack));
+	}
+
+	FORCEINLINE VectorRegister4Double DistSquaredToPoint(const FBoneLanes& Lanes, const FVector& Point)
+	{
+		const VectorRegister4Double DX = VectorSubtract(VectorLoadAligned(Lanes.X), VectorSetFloat1(Point.X));
+		const VectorRegister4Double DY = VectorSubtract(VectorLoadAligned(Lanes.Y), VectorSetFloat1(Point.Y));
+		const VectorRegister4Double DZ = VectorSubtract(VectorLoadAligned(Lanes.Z), VectorSetFloat1(Point.Z));
+		return VectorMultiplyAdd(DX, DX, VectorMultiplyAdd(DY, DY, VectorMultiply(DZ, DZ)));
+	}
+
+	uint32 TestSphere(const FBoneLanes& Lanes, const FPackedSphere& Sphere)
+	{
+		const VectorRegister4Double DistSq = DistSquaredToPoint(Lanes, Sphere.Location);
+		const VectorRegister4Double LimitDistance = VectorAdd(VectorLoadAligned(Lanes.Radius),
+		                                                      VectorSetFloat1(static_cast<double>(Sphere.Radius)));
+		const VectorRegister4Double LimitSq = VectorMultiply(LimitDistance, LimitDistance);
+
+		return Sphere.bInner
+			       ? VectorMaskBits(VectorCompareGE(DistSq, DeflateThreshold(LimitSq)))
+			       : VectorMaskBits(VectorCompareLE(DistSq, InflateThreshold(LimitSq)));
+	}
+
+	uint32 TestCapsule(const FBoneLanes& Lanes, const FPackedCapsule& Capsule)
+	{
+		const FVector Segment = Capsule.EndPoint - Capsule.StartPoint;
+		const VectorRegister4Double SegX = VectorSetFloat1(Segment.X);
+		const VectorRegister4Double SegY = VectorSetFloat1(Segment.Y);
+		const VectorRegister4Double SegZ = VectorSetFloat1(Segment.Z);
+
+		const VectorRegister4Double AX = VectorSubtract(VectorLoadAligned(Lanes.X), VectorSetFloat1(Capsule.StartPoint.X));
+		const VectorRegister4Double AY = VectorSubtract(VectorLoadAligned(Lanes.Y), VectorSetFloat1(Capsule.StartPoint.Y));
+		const VectorRegister4Double AZ = VectorSubtract(VectorLoadAligned(Lanes.Z), VectorSetFloat1(Capsule.StartPoint.Z));
+
+		// Closest point on the segment, clamped to its end points
+		const VectorRegister4Double Dot = VectorMultiplyAdd(AX, SegX, VectorMultiplyAdd(AY, SegY, VectorMultiply(AZ, SegZ)));
+		const double SegmentSizeSq = Segment.SizeSquared();
+		const double InvSegmentSizeSq = SegmentSizeSq > UE_DOUBLE_SMALL_NUMBER ? 1.0 / SegmentSizeSq : 0.0;
+		VectorRegister4Double T = VectorMultiply(Dot, VectorSetFloat1(InvSegmentSizeSq));
+		T = VectorMin(VectorMax(T, GlobalVectorConstants::DoubleZero), GlobalVectorConstants::DoubleOne);
+
+		const VectorRegister4Double DX = VectorNegateMultiplyAdd(T, SegX, AX);
+		const VectorRegister4Double DY = VectorNegateMultiplyAdd(T, SegY, AY);
+		const VectorRegister4Double DZ = VectorNegateMultiplyAdd(T, SegZ, AZ);
+		const VectorRegister4Double DistSq = VectorMultiplyAdd(DX, DX, VectorMultiplyAdd(DY, DY, VectorMultiply(DZ, DZ)));
+
+		const VectorRegister4Double LimitDistance = VectorAdd(VectorLoadAligned(Lanes.Radius),
+		                                                      VectorSetFloat1(static_cast<double>(Capsule.Radius)));
+		return VectorMaskBits(VectorCompareLE(DistSq, InflateThreshold(VectorMultiply(LimitDistance, LimitDistance))));
+	}
+
+	uint32 TestBox(const FBoneLanes& Lanes, const FPackedBox& Box)
+	{
+		// Conservative: the sphere enclosing the box, grown by the bone radius
+		const VectorRegister4Double DistSq = DistSquaredToPoint(Lanes, Box.Transform.GetTranslation());
+		const VectorRegister4Double LimitDistance = VectorAdd(VectorLoadAligned(Lanes.Radius),
+		                                                      VectorSetFloat1(Box.BoundingRadius));
+		return VectorMaskBits(VectorCompareLE(DistSq, InflateThreshold(VectorMultiply(LimitDistance, LimitDistance))));
+	}
+
+	uint32 TestDistanceField(const FBoneLanes& Lanes, const FPackedDistanceField& Field)
+	{
+		// Conservative: the bounds of the field in component space. Bones outside of the field are not moved
+		auto InRange = [](const double* Values, double Min, double Max)
+		{
+			const VectorRegister4Double Value = VectorLoadAligned(Values);
+			return VectorBitwiseAnd(VectorCompareGE(Value, VectorSetFloat1(Min - RejectSlack)),
+			                        VectorCompareLE(Value, VectorSetFloat1(Max + RejectSlack)));
+		};
+		const FBox& Bounds = Field.Bounds;
+		return VectorMaskBits(VectorBitwiseAnd(InRange(Lanes.X, Bounds.Min.X, Bounds.Max.X),
+		                                       VectorBitwiseAnd(InRange(Lanes.Y, Bounds.Min.Y, Bounds.Max.Y),
+		                                                        InRange(Lanes.Z, Bounds.Min.Z, Bounds.Max.Z))));
+	}
+
+	uint32 TestPlanar(const FBoneLanes& Lanes, const FPackedPlanar& Planar)
+	{
+		const VectorRegister4Double NX = VectorSetFloat1(Planar.Plane.X);
+		const VectorRegister4Double NY = VectorSetFloat1(Planar.Plane.Y);
+		const VectorRegister4Double NZ = VectorSetFloat1(Planar.Plane.Z);
+		const VectorRegister4Double W = VectorSetFloat1(Planar.Plane.W);
+
+		// Signed distances of the current and the previous location. The normal is normalized when packed
+		const VectorRegister4Double Dist = VectorSubtract(
+			VectorMultiplyAdd(VectorLoadAligned(Lanes.X), NX,
+			                  VectorMultiplyAdd(VectorLoadAligned(Lanes.Y), NY,
+			                                    VectorMultiply(VectorLoadAligned(Lanes.Z), NZ))), W);
+		const VectorRegister4Double PrevDist = VectorSubtract(
+			VectorMultiplyAdd(VectorLoadAligned(Lanes.PrevX), NX,
+			                  VectorMultiplyAdd(VectorLoadAligned(Lanes.PrevY), NY,
+			                                    VectorMultiply(VectorLoadAligned(Lanes.PrevZ), NZ))), W);
+
+		// Close to the plane
+		const VectorRegister4Double Radius = VectorLoadAligned(Lanes.Radius);
+		const VectorRegister4Double NearMask = VectorCompareLE(VectorMultiply(Dist, Dist),
+		                                                       InflateThreshold(VectorMultiply(Radius, Radius)));
+
+		// Crossed the plane since the previous step
+		const VectorRegister4Double Slack = VectorSetFloat1(RejectSlack);
+		const VectorRegister4Double CrossMask = VectorBitwiseAnd(
+			VectorCompareLE(VectorMin(Dist, PrevDist), Slack),
+			VectorCompareGE(VectorMax(Dist, PrevDist), VectorNegate(Slack)));
+
+		return VectorMaskBits(VectorBitwiseOr(NearMask, CrossMask));
+	}
+
+	template <typename PackedLimitType, typename TestFunc, typename AdjustFunc>
+	FORCEINLINE void AdjustLanes(FKawaiiPhysicsSolverState& State, FBoneLanes& Lanes, const PackedLimitType& Limit,
+	                             TestFunc Test, AdjustFunc Adjust)
+	{
+		uint32 HitMask = Test(Lanes, Limit) & Lanes.ActiveMask;
+		while (HitMask)
+		{
+			const int32 Lane = FMath::CountTrailingZeros(HitMask);
+			HitMask &= HitMask - 1;
+
+			Adjust(State, Lanes.BoneIndices[Lane], Limit);
+			Lanes.Refresh(State, Lane);
+		}
+	}
+
+	template <typename PackedLimitType, typename TestFunc, typename AdjustFunc>
+	FORCEINLINE void AdjustLanes(FKawaiiPhysicsSolverState& State, FBoneLanes& Lanes,
+	                             const TArray<PackedLimitType>& Limits, TestFunc Test, AdjustFunc Adjust)
+	{
+		for (const PackedLimitType& Limit : Limits)
+		{
+			AdjustLanes(State, Lanes, Limit, Test, Adjust);
+		}
+	}
+
+	template <typename PackedLimitType, typename TestFunc, typename AdjustFunc>
+	FORCEINLINE void AdjustLanes(FKawaiiPhysicsSolverState& State, FBoneLanes& Lanes,
+	                             const TArray<PackedLimitType>& Limits, TConstArrayView<int32> Candidates,
+	                             TestFunc Test, AdjustFunc Adjust)
+	{
+		for (const int32 LimitIndex : Candidates)
+		{
+			AdjustLanes(State, Lanes, Limits[LimitIndex], Test, Adjust);
+		}
+	}
+
+	// ---- Broadphase ----
+
+	/** Inner spheres push every bone outside of them, so they cannot be culled */
+	FORCEINLINE bool IsAlwaysCandidate(const FPackedSphere& Sphere) { return Sphere.bInner; }
+	FORCEINLINE bool IsAlwaysCandidate(const FPackedCapsule& Capsule) { return false; }
+	FORCEINLINE bool IsAlwaysCandidate(const FPackedBox& Box) { return false; }
+
+	/** Limits that a group of bones may touch, in the order they are applied */
+	struct FLimitCandidates
+	{
+		TArray<int32, TInlineAllocator<16>> Spheres;
+		TArray<int32, TInlineAllocator<16>> Capsules;
+		TArray<int32, TInlineAllocator<16>> Boxes;
+		TBitArray<TInlineAllocator<2>> bSphereAdded;
+		TBitArray<TInlineAllocator<2>> bCapsuleAdded;
+		TBitArray<TInlineAllocator<2>> bBoxAdded;
+	};
+
+	/**
+	 * Gathers the limits a group of bones may touch.
+	 * A bone is only moved by a limit it touches, and always onto the surface (or the inside) of that limit, so the
+	 * bones stay within the bounds of the group grown by the bounds of the limits they touch. The region is grown until
+	 * no more limit reaches it, which keeps the result exact. Distance fields and planes are applied after the other
+	 * limits, so they do not move the bones before them, and are always tested.
+	 */
+	void GatherCandidates(const FKawaiiPhysicsPackedLimits& Limits, const FKawaiiPhysicsSolverState& State,
+	                      TConstArrayView<int32> Indices, FLimitCandidates& Out)
+	{
+		FBox Region(ForceInit);
+		float MaxRadius = 0.0f;
+		for (const int32 Index : Indices)
+		{
+			Region += State.Locations[Index];
+			MaxRadius = FMath::Max(MaxRadius, State.Radii[Index]);
+		}
+
+		// The radius of the bones is added to the region, and twice to the limits joining it:
+		// once for the location a bone is pushed to and once for testing that location
+		const double Margin = MaxRadius * (1.0 + RejectSlack) + RejectSlack;
+		Region = Region.ExpandBy(Margin);
+
+		Out.bSphereAdded.Init(false, Limits.Spheres.Num());
+		Out.bCapsuleAdded.Init(false, Limits.Capsules.Num());
+		Out.bBoxAdded.Init(false, Limits.Boxes.Num());
+
+		auto GrowRegion = [&Region, Margin](const auto& PackedLimits, TBitArray<TInlineAllocator<2>>& bAdded)
+		{
+			bool bGrown = false;
+			for (int32 i = 0; i < PackedLimits.Num(); ++i)
+			{
+				if (bAdded[i])
+				{
+					continue;
+				}
+
+				const FBox& Bounds = PackedLimits[i].Bounds;
+				if (IsAlwaysCandidate(PackedLimits[i]) || Bounds.Intersect(Region))
+				{
+					bAdded[i] = true;
+					Region += Bounds.ExpandBy(Margin * 2.0);
+					bGrown = true;
+				}
+			}
+			return bGrown;
+		};
+
+		bool bGrown = true;
+		while (bGrown)
+		{
+			bGrown = GrowRegion(Limits.Spheres, Out.bSphereAdded);
+			bGrown |= GrowRegion(Limits.Capsules, Out.bCapsuleAdded);
+			bGrown |= GrowRegion(Limits.Boxes, Out.bBoxAdded);
+		}
+
+		auto Collect = [](const TBitArray<TInlineAllocator<2>>& bAdded, TArray<int32, TInlineAllocator<16>>& OutIndices)
+		{
+			OutIndices.Reset();
+			for (TConstSetBitIterator<TInlineAllocator<2>> It(bAdded); It; ++It)
+			{
+				OutIndices.Add(It.GetIndex());
+			}
+		};
+		Collect(Out.bSphereAdded, Out.Spheres);
+		Collect(Out.bCapsuleAdded, Out.Capsules);
+		Collect(Out.bBoxAdded, Out.Boxes);
+	}
+}
+
+void FKawaiiPhysicsPackedLimits::Build(const TArray<FSphericalLimit>& SphericalLimits,
+                                       const TArray<FSphericalLimit>& SphericalLimitsData,
+                                       const TArray<FCapsuleLimit>& CapsuleLimits,
+                                       const TArray<FCapsuleLimit>& CapsuleLimitsData,
+                                       const TArray<FBoxLimit>& BoxLimits, const TArray<FBoxLimit>& BoxLimitsData,
+                                       const TArray<FPlanarLimit>& PlanarLimits,
+                                       const TArray<FPlanarLimit>& PlanarLimitsData,
+                                       const TArray<FDistanceFieldLimit>& DistanceFieldLimits)
+{
+	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_PackLimits);
+
+	Spheres.Reset();
+	Capsules.Reset();
+	Boxes.Reset();
+	DistanceFields.Reset();
+	Planars.Reset();
+
+	auto PackSpheres = [this](const TArray<FSphericalLimit>& Limits)
+	{
+		for (const auto& Sphere : Limits)
+		{
+			if (!Sphere.bEnable || Sphere.Radius <= 0.0f)
+			{
+				continue;
+			}
+			Spheres.Add({
+				Sphere.Location, Sphere.Radius, Sphere.LimitType != ESphericalLimitType::Outer,
+				FBox::BuildAABB(Sphere.Location, FVector(Sphere.Radius))
+			});
+		}
+	};
+	auto PackCapsules = [this](const TArray<FCapsuleLimit>& Limits)
+	{
+		for (const auto& Capsule : Limits)
+		{
+			if (!Capsule.bEnable || Capsule.Radius <= 0 || Capsule.Length <= 0)
+			{
+				continue;
+			}
+			FVector StartPoint = Capsule.Location + Capsule.Rotation.GetAxisZ() * Capsule.Length * 0.5f;
+			FVector EndPoint = Capsule.Location + Capsule.Rotation.GetAxisZ() * Capsule.Length * -0.5f;
+			const FBox Bounds = FBox(StartPoint.ComponentMin(EndPoint), StartPoint.ComponentMax(EndPoint)).
+				ExpandBy(Capsule.Radius);
+			Capsules.Add({StartPoint, EndPoint, Capsule.Radius, Bounds});
+		}
+	};
+	auto PackBoxes = [this](const TArray<FBoxLimit>& Limits)
+	{
+		// NOTE: box limits have never checked bEnable, keep it that way
+		for (const auto& Box : Limits)
+		{
+			const double BoundingRadius = Box.Extent.Size();
+			Boxes.Add({
+				FTransform(Box.Rotation, Box.Location), Box.Extent, BoundingRadius,
+				FBox::BuildAABB(Box.Location, FVector(BoundingRadius))
+			});
+		}
+	};
+	auto PackPlanars = [this](const TArray<FPlanarLimit>& Limits)
+	{
+		for (const auto& Planar : Limits)
+		{
+			if (!Planar.bEnable)
+			{
+				continue;
+			}
+			Planars.Add({KawaiiPhysicsCollision::NormalizePlane(Planar.Plane), Planar.Rotation.GetUpVector()});
+		}
+	};
+
+	PackSpheres(SphericalLimits);
+	PackSpheres(SphericalLimitsData);
+	PackCapsules(CapsuleLimits);
+	PackCapsules(CapsuleLimitsData);
+	PackBoxes(BoxLimits);
+	PackBoxes(BoxLimitsData);
+	PackPlanars(PlanarLimits);
+	PackPlanars(PlanarLimitsData);
+
+	// bEnable is only set when the field is valid
+	for (const auto& DistanceField : DistanceFieldLimits)
+	{
+		if (!DistanceField.bEnable)
+		{
+			continue;
+		}
+		const FKawaiiPhysicsDistanceField& Field = DistanceField.DistanceField->DistanceField;
+		const FTransform Transform(DistanceField.Rotation, DistanceField.Location);
+		DistanceFields.Add({Transform, &Field, Field.Bounds.TransformBy(Transform)});
+	}
+}
+
+void FKawaiiPhysicsPackedLimits::AppendTransformed(const FKawaiiPhysicsPackedLimits& Other,
+                                                   const FTransform& OtherToThis)
+{
+	// Spheres and capsules stay round, so the radii take the largest scale to cover the scaled shapes
+	const double RadiusScale = OtherToThis.GetScale3D().GetAbsMax();
+	for (const FPackedSphere& Sphere : Other.Spheres)
+	{
+		const FVector Location = OtherToThis.TransformPosition(Sphere.Location);
+		const float Radius = static_cast<float>(Sphere.Radius * RadiusScale);
+		Spheres.Add({Location, Radius, Sphere.bInner, FBox::BuildAABB(Location, FVector(Radius))});
+	}
+	for (const FPackedCapsule& Capsule : Other.Capsules)
+	{
+		const FVector StartPoint = OtherToThis.TransformPosition(Capsule.StartPoint);
+		const FVector EndPoint = OtherToThis.TransformPosition(Capsule.EndPoint);
+		const float Radius = static_cast<float>(Capsule.Radius * RadiusScale);
+		const FBox Bounds = FBox(StartPoint.ComponentMin(EndPoint), StartPoint.ComponentMax(EndPoint)).
+			ExpandBy(Radius);
+		Capsules.Add({StartPoint, EndPoint, Radius, Bounds});
+	}
+	for (const FPackedBox& Box : Other.Boxes)
+	{
+		const FTransform Transform = Box.Transform * OtherToThis;
+		const double BoundingRadius = Box.BoundingRadius * RadiusScale;
+		Boxes.Add({
+			Transform, Box.Extent, BoundingRadius,
+			FBox::BuildAABB(Transform.GetTranslation(), FVector(BoundingRadius))
+		});
+	}
+	for (const FPackedDistanceField& DistanceField : Other.DistanceFields)
+	{
+		const FTransform Transform = DistanceField.Transform * OtherToThis;
+		DistanceFields.Add({Transform, DistanceField.Field, DistanceField.Field->Bounds.TransformBy(Transform)});
+	}
+	const FMatrix PlaneMatrix = OtherToThis.ToMatrixWithScale();
+	for (const FPackedPlanar& Planar : Other.Planars)
+	{
+		Planars.Add({
+			NormalizePlane(Planar.Plane.TransformBy(PlaneMatrix)), OtherToThis.TransformVectorNoScale(Planar.UpVector)
+		});
+	}
+}
+
+void FKawaiiPhysicsPackedLimits::AdjustBones(FKawaiiPhysicsSolverState& SolverState,
+                                             TConstArrayView<int32> BoneIndices) const
+{
+	using namespace KawaiiPhysicsCollision;
+
+	if (IsEmpty())
+	{
+		return;
+	}
+
+#if ENABLE_ANIM_DEBUG
+	if (!CVarAnimNodeKawaiiPhysicsSIMDCollision.GetValueOnAnyThread())
+	{
+		AdjustBonesScalar(SolverState, BoneIndices);
+		return;
+	}
+#endif
+
+	bool bBroadphase = Spheres.Num() + Capsules.Num() + Boxes.Num() > 0;
+#if ENABLE_ANIM_DEBUG
+	bBroadphase &= CVarAnimNodeKawaiiPhysicsCollisionBroadphase.GetValueOnAnyThread();
+#endif
+
+	// Bones do not affect each other here, so each batch can run through every limit on its own.
+	// Within a lane the limits are still applied in the same order as the scalar path.
+	FBoneLanes Lanes;
+	FLimitCandidates Candidates;
+	for (int32 GroupFirst = 0; GroupFirst < BoneIndices.Num(); GroupFirst += BroadphaseGroupSize)
+	{
+		const int32 GroupEnd = FMath::Min(GroupFirst + BroadphaseGroupSize, BoneIndices.Num());
+		if (bBroadphase)
+		{
+			SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_CollisionBroadphase);
+			GatherCandidates(*this, SolverState, BoneIndices.Slice(GroupFirst, GroupEnd - GroupFirst), Candidates);
+		}
+
+		for (int32 First = GroupFirst; First < GroupEnd; First += LaneCount)
+		{
+			Lanes.Load(SolverState, BoneIndices, First);
+
+			if (bBroadphase)
+			{
+				AdjustLanes(SolverState, Lanes, Spheres, Candidates.Spheres, TestSphere, AdjustBySphere);
+				AdjustLanes(SolverState, Lanes, Capsules, Candidates.Capsules, TestCapsule, AdjustByCapsule);
+				AdjustLanes(SolverState, Lanes, Boxes, Candidates.Boxes, TestBox, AdjustByBox);
+			}
+			else
+			{
+				AdjustLanes(SolverState, Lanes, Spheres, TestSphere, AdjustBySphere);
+				AdjustLanes(SolverState, Lanes, Capsules, TestCapsule, AdjustByCapsule);
+				AdjustLanes(SolverState, Lanes, Boxes, TestBox, AdjustByBox);
+			}
+			AdjustLanes(SolverState, Lanes, DistanceFields, TestDistanceField, AdjustByDistanceField);
+			AdjustLanes(SolverState, Lanes, Planars, TestPlanar, AdjustByPlanar);
+		}
+	}
+}
+
+void FKawaiiPhysicsPackedLimits::AdjustBonesScalar(FKawaiiPhysicsSolverState& SolverState,
+                                                   TConstArrayView<int32> BoneIndices) const
+{
+	using namespace KawaiiPhysicsCollision;
+
+	for (const int32 Index : BoneIndices)
+	{
+		for (const FPackedSphere& Sphere : Spheres)
+		{
+			AdjustBySphere(SolverState, Index, Sphere);
+		}
+		for (const FPackedCapsule& Capsule : Capsules)
+		{
+			AdjustByCapsule(SolverState, Index, Capsule);
+		}
+		for (const FPackedBox& Box : Boxes)
+		{
+			AdjustByBox(SolverState, Index, Box);
+		}
+		for (const FPackedDistanceField& DistanceField : DistanceFields)
+		{
+			AdjustByDistanceField(SolverState, Index, DistanceField);
+		}
+		for (const FPackedPlanar& Planar : Planars)
+		{
+			AdjustByPlanar(SolverState, Index, Planar);
+		}
+	}
+}
@@ -0,0 +1,347 @@
+// KawaiiPhysics : Copyright (c) 2019-2024 pafuhana1213, MIT License
+
+#include "KawaiiPhysicsDistanceFieldDataAsset.h"
+
+#include "KawaiiPhysics.h"
+
+#if WITH_EDITOR
+#include "AnimationRuntime.h"
+#include "Async/ParallelFor.h"
+#include "Engine/SkeletalMesh.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+#include "Rendering/SkeletalMeshLODModel.h"
+#include "Rendering/SkeletalMeshModel.h"
+#endif
+
+float FKawaiiPhysicsDistanceField::Sample(const FVector& LocalLocation, FVector& OutGradient) const
+{
+	const FVector CellSize = Bounds.GetSize() / FVector(Resolution - FIntVector(1));
+	const FVector GridLocation = (Bounds.GetClosestPointTo(LocalLocation) - Bounds.Min) / CellSize;
+
+	// Cell holding the location, and the location within it
+	const int32 X = FMath::Clamp(FMath::FloorToInt32(GridLocation.X), 0, Resolution.X - 2);
+	const int32 Y = FMath::Clamp(FMath::FloorToInt32(GridLocation.Y), 0, Resolution.Y - 2);
+	const int32 Z = FMath::Clamp(FMath::FloorToInt32(GridLocation.Z), 0, Resolution.Z - 2);
+	const float TX = static_cast<float>(GridLocation.X - X);
+	const float TY = static_cast<float>(GridLocation.Y - Y);
+	const float TZ = static_cast<float>(GridLocation.Z - Z);
+
+	const int32 StrideY = Resolution.X;
+	const int32 StrideZ = Resolution.X * Resolution.Y;
+	const float* Corner = Distances.GetData() + X + Y * StrideY + Z * StrideZ;
+	const float D000 = Corner[0];
+	const float D100 = Corner[1];
+	const float D010 = Corner[StrideY];
+	const float D110 = Corner[StrideY + 1];
+	const float D001 = Corner[StrideZ];
+	const float D101 = Corner[StrideZ + 1];
+	const float D011 = Corner[StrideZ + StrideY];
+	const float D111 = Corner[StrideZ + StrideY + 1];
+
+	// Derivatives of the trilinear interpolation along each axis
+	OutGradient.X = ((D100 - D000) * (1.0f - TY) * (1.0f - TZ) + (D110 - D010) * TY * (1.0f - TZ) +
+		(D101 - D001) * (1.0f - TY) * TZ + (D111 - D011) * TY * TZ) / CellSize.X;
+	OutGradient.Y = ((D010 - D000) * (1.0f - TX) * (1.0f - TZ) + (D110 - D100) * TX * (1.0f - TZ) +
+		(D011 - D001) * (1.0f - TX) * TZ + (D111 - D101) * TX * TZ) / CellSize.Y;
+	OutGradient.Z = ((D001 - D000) * (1.0f - TX) * (1.0f - TY) + (D101 - D100) * TX * (1.0f - TY) +
+		(D011 - D010) * (1.0f - TX) * TY + (D111 - D110) * TX * TY) / CellSize.Z;
+
+	const float D00 = FMath::Lerp(D000, D100, TX);
+	const float D10 = FMath::Lerp(D010, D110, TX);
+	const float D01 = FMath::Lerp(D001, D101, TX);
+	const float D11 = FMath::Lerp(D011, D111, TX);
+	return FMath::Lerp(FMath::Lerp(D00, D10, TY), FMath::Lerp(D01, D11, TY), TZ);
+}
+
+#if WITH_EDITOR
+
+namespace
+{
+	/** Signed distance to a primitive of a PhysicsAsset, in the space of the field */
+	struct FBakeShape
+	{
+		enum class EType : uint8 { Sphere, Capsule, Box };
+
+		EType Type;
+		/** Inverse of the transform of the primitive in the space of the field */
+		FTransform ToShape;
+		float Radius = 0.0f;
+		float HalfLength = 0.0f;
+		FVector HalfExtent = FVector::ZeroVector;
+
+		float GetDistance(const FVector& Location) const
+		{
+			const FVector Local = ToShape.TransformPosition(Location);
+			switch (Type)
+			{
+			case EType::Sphere:
+				return static_cast<float>(Local.Size()) - Radius;
+			case EType::Capsule:
+				{
+					const double Z = Local.Z - FMath::Clamp(Local.Z, -HalfLength, HalfLength);
+					return static_cast<float>(FVector(Local.X, Local.Y, Z).Size()) - Radius;
+				}
+			case EType::Box:
+				{
+					const FVector Q = Local.GetAbs() - HalfExtent;
+					return static_cast<float>(Q.ComponentMax(FVector::ZeroVector).Size() + FMath::Min(Q.GetMax(), 0.0));
+				}
+			}
+			return UE_BIG_NUMBER;
+		}
+	};
+
+	/** Triangle of a skeletal mesh, in the space of the field */
+	struct FBakeTriangle
+	{
+		FVector A;
+		FVector B;
+		FVector C;
+		FVector Normal;
+	};
+
+	void GatherShapes(const UPhysicsAsset& PhysicsAsset, const FReferenceSkeleton& RefSkeleton,
+	                  TConstArrayView<FTransform> RefPose, const FTransform& AttachTransform,
+	                  const TSet<int32>& SourceBones, TArray<FBakeShape>& OutShapes, FBox& OutBounds)
+	{
+		for (const USkeletalBodySetup* BodySetup : PhysicsAsset.SkeletalBodySetups)
+		{
+			const int32 BoneIndex = BodySetup ? RefSkeleton.FindBoneIndex(BodySetup->BoneName) : INDEX_NONE;
+			if (BoneIndex == INDEX_NONE || (!SourceBones.IsEmpty() && !SourceBones.Contains(BoneIndex)))
+			{
+				continue;
+			}
+			const FTransform BodyTransform = RefPose[BoneIndex].GetRelativeTransform(AttachTransform);
+
+			for (const FKSphereElem& Sphere : BodySetup->AggGeom.SphereElems)
+			{
+				const FTransform ShapeTransform = Sphere.GetTransform() * BodyTransform;
+				OutShapes.Add({FBakeShape::EType::Sphere, ShapeTransform.Inverse(), Sphere.Radius});
+				OutBounds += FBox::BuildAABB(ShapeTransform.GetLocation(), FVector(Sphere.Radius));
+			}
+			for (const FKSphylElem& Capsule : BodySetup->AggGeom.SphylElems)
+			{
+				const FTransform ShapeTransform = Capsule.GetTransform() * BodyTransform;
+				const float HalfLength = Capsule.Length * 0.5f;
+				OutShapes.Add({FBakeShape::EType::Capsule, ShapeTransform.Inverse(), Capsule.Radius, HalfLength});
+				OutBounds += FBox::BuildAABB(ShapeTransform.TransformPosition(FVector(0, 0, HalfLength)),
+				                             FVector(Capsule.Radius));
+				OutBounds += FBox::BuildAABB(ShapeTransform.TransformPosition(FVector(0, 0, -HalfLength)),
+				                             FVector(Capsule.Radius));
+			}
+			for (const FKBoxElem& Box : BodySetup->AggGeom.BoxElems)
+			{
+				const FTransform ShapeTransform = Box.GetTransform() * BodyTransform;
+				const FVector HalfExtent(Box.X * 0.5f, Box.Y * 0.5f, Box.Z * 0.5f);
+				OutShapes.Add({FBakeShape::EType::Box, ShapeTransform.Inverse(), 0.0f, 0.0f, HalfExtent});
+				OutBounds += FBox(-HalfExtent, HalfExtent).TransformBy(ShapeTransform);
+			}
+		}
+	}
+
+	void GatherTriangles(const USkeletalMesh& SkeletalMesh, const FTransform& AttachTransform,
+	                     const TSet<int32>& SourceBones, TArray<FBakeTriangle>& OutTriangles, FBox& OutBounds)
+	{
+		const FSkeletalMeshModel* ImportedModel = SkeletalMesh.GetImportedModel();
+		if (!ImportedModel || ImportedModel->LODModels.IsEmpty())
+		{
+			return;
+		}
+		const FSkeletalMeshLODModel& LODModel = ImportedModel->LODModels[0];
+
+		// Location, normal and most influential bone of each vertex
+		TArray<FVector> Locations;
+		TArray<FVector> Normals;
+		TArray<int32> Bones;
+		Locations.SetNumZeroed(LODModel.NumVertices);
+		Normals.SetNumZeroed(LODModel.NumVertices);
+		Bones.SetNumZeroed(LODModel.NumVertices);
+		for (const FSkelMeshSection& Section : LODModel.Sections)
+		{
+			for (int32 i = 0; i < Section.SoftVertices.Num(); ++i)
+			{
+				const FSoftSkinVertex& Vertex = Section.SoftVertices[i];
+				int32 BestInfluence = 0;
+				for (int32 Influence = 1; Influence < MAX_TOTAL_INFLUENCES; ++Influence)
+				{
+					if (Vertex.InfluenceWeights[Influence] > Vertex.InfluenceWeights[BestInfluence])
+					{
+						BestInfluence = Influence;
+					}
+				}
+
+				const int32 VertexIndex = Section.BaseVertexIndex + i;
+				if (Locations.IsValidIndex(VertexIndex))
+				{
+					Locations[VertexIndex] = AttachTransform.InverseTransformPosition(FVector(Vertex.Position));
+					Normals[VertexIndex] =
+						AttachTransform.InverseTransformVector(FVector(FVector3f(Vertex.TangentZ)));
+					const int32 MapIndex = Vertex.InfluenceBones[BestInfluence];
+					Bones[VertexIndex] = Section.BoneMap.IsValidIndex(MapIndex) ? Section.BoneMap[MapIndex] : INDEX_NONE;
+				}
+			}
+		}
+
+		for (const FSkelMeshSection& Section : LODModel.Sections)
+		{
+			for (uint32 Triangle = 0; Triangle < Section.NumTriangles; ++Triangle)
+			{
+				const uint32 First = Section.BaseIndex + Triangle * 3;
+				const uint32 I0 = LODModel.IndexBuffer[First];
+				const uint32 I1 = LODModel.IndexBuffer[First + 1];
+				const uint32 I2 = LODModel.IndexBuffer[First + 2];
+				if (!SourceBones.IsEmpty() && !SourceBones.Contains(Bones[I0]) && !SourceBones.Contains(Bones[I1]) &&
+					!SourceBones.Contains(Bones[I2]))
+				{
+					continue;
+				}
+
+				const FVector& A = Locations[I0];
+				const FVector& B = Locations[I1];
+				const FVector& C = Locations[I2];
+				// Face the way of the vertex normals, whatever the winding
+				FVector Normal = FVector::CrossProduct(B - A, C - A).GetSafeNormal();
+				if (Normal.IsZero())
+				{
+					continue;
+				}
+				if (FVector::DotProduct(Normal, Normals[I0] + Normals[I1] + Normals[I2]) < 0.0)
+				{
+					Normal = -Normal;
+				}
+				OutTriangles.Add({A, B, C, Normal});
+				OutBounds += A;
+				OutBounds += B;
+				OutBounds += C;
+			}
+		}
+	}
+
+	float GetDistanceToTriangles(const FVector& Location, TConstArrayView<FBakeTriangle> Triangles)
+	{
+		// The side is taken from the closest triangle. On its edges several triangles are equally close,
+		// so the one facing the location the most decides
+		float BestDistance = UE_BIG_NUMBER;
+		float BestFacing = 0.0f;
+		float BestSide = 1.0f;
+		for (const FBakeTriangle& Triangle : Triangles)
+		{
+			const FVector ClosestPoint = FMath::ClosestPointOnTriangleToPoint(Location, Triangle.A, Triangle.B,
+			                                                                  Triangle.C);
+			const FVector ToLocation = Location - ClosestPoint;
+			const float Distance = ToLocation.Size();
+			if (Distance > BestDistance + UE_KINDA_SMALL_NUMBER)
+			{
+				continue;
+			}
+
+			const float Side = FVector::DotProduct(ToLocation, Triangle.Normal);
+			const float Facing = Distance > UE_KINDA_SMALL_NUMBER ? FMath::Abs(Side) / Distance : 1.0f;
+			if (Distance < BestDistance - UE_KINDA_SMALL_NUMBER || Facing > BestFacing)
+			{
+				BestDistance = FMath::Min(BestDistance, Distance);
+				BestFacing = Facing;
+				BestSide = Side < 0.0f ? -1.0f : 1.0f;
+			}
+		}
+		return BestDistance * BestSide;
+	}
+}
+
+void UKawaiiPhysicsDistanceFieldDataAsset::Bake()
+{
+	USkeletalMesh* Mesh = SkeletalMesh ? SkeletalMesh.Get() : PhysicsAsset ? PhysicsAsset->GetPreviewMesh() : nullptr;
+	if (!Mesh)
+	{
+		UE_LOG(LogKawaiiPhysics, Warning, TEXT("%s : no skeletal mesh to bake the distance field with"), *GetName());
+		return;
+	}
+
+	const FReferenceSkeleton& RefSkeleton = Mesh->GetRefSkeleton();
+	const int32 AttachBoneIndex = RefSkeleton.FindBoneIndex(AttachBoneName);
+	if (AttachBoneIndex == INDEX_NONE)
+	{
+		UE_LOG(LogKawaiiPhysics, Warning, TEXT("%s : bone %s is not in %s"), *GetName(), *AttachBoneName.ToString(),
+		       *Mesh->GetName());
+		return;
+	}
+
+	TArray<FTransform> RefPose;
+	FAnimationRuntime::FillUpComponentSpaceTransforms(RefSkeleton, RefSkeleton.GetRefBonePose(), RefPose);
+	const FTransform& AttachTransform = RefPose[AttachBoneIndex];
+
+	TSet<int32> SourceBones;
+	for (const FName& BoneName : SourceBoneNames)
+	{
+		const int32 BoneIndex = RefSkeleton.FindBoneIndex(BoneName);
+		if (BoneIndex != INDEX_NONE)
+		{
+			SourceBones.Add(BoneIndex);
+		}
+	}
+
+	TArray<FBakeShape> Shapes;
+	TArray<FBakeTriangle> Triangles;
+	FBox Bounds(ForceInit);
+	if (Source == EKawaiiPhysicsDistanceFieldSource::PhysicsAsset)
+	{
+		if (PhysicsAsset)
+		{
+			GatherShapes(*PhysicsAsset, RefSkeleton, RefPose, AttachTransform, SourceBones, Shapes, Bounds);
+		}
+	}
+	else
+	{
+		GatherTriangles(*Mesh, AttachTransform, SourceBones, Triangles, Bounds);
+	}
+	if (!Bounds.IsValid)
+	{
+		UE_LOG(LogKawaiiPhysics, Warning, TEXT("%s : nothing to bake the distance field from"), *GetName());
+		return;
+	}
+
+	Modify();
+
+	DistanceField.Bounds = Bounds.ExpandBy(Padding);
+	const FVector Size = DistanceField.Bounds.GetSize();
+	const float Cell = FMath::Max(CellSize, static_cast<float>(Size.GetMax()) / (MaxResolution - 1));
+	DistanceField.Resolution = FIntVector(
+		FMath::Clamp(FMath::CeilToInt32(Size.X / Cell) + 1, 2, MaxResolution),
+		FMath::Clamp(FMath::CeilToInt32(Size.Y / Cell) + 1, 2, MaxResolution),
+		FMath::Clamp(FMath::CeilToInt32(Size.Z / Cell) + 1, 2, MaxResolution));
+
+	const FIntVector& Resolution = DistanceField.Resolution;
+	const FVector SampleSpacing = Size / FVector(Resolution - FIntVector(1));
+	DistanceField.Distances.SetNumUninitialized(Resolution.X * Resolution.Y * Resolution.Z);
+	ParallelFor(Resolution.Z, [&](int32 Z)
+	{
+		for (int32 Y = 0; Y < Resolution.Y; ++Y)
+		{
+			for (int32 X = 0; X < Resolution.X; ++X)
+			{
+				const FVector Location = DistanceField.Bounds.Min + FVector(X, Y, Z) * SampleSpacing;
+
+				float Distance = UE_BIG_NUMBER;
+				if (Shapes.IsEmpty())
+				{
+					Distance = GetDistanceToTriangles(Location, Triangles);
+				}
+				else
+				{
+					for (const FBakeShape& Shape : Shapes)
+					{
+						Distance = FMath::Min(Distance, Shape.GetDistance(Location));
+					}
+				}
+				DistanceField.Distances[X + (Y + Z * Resolution.Y) * Resolution.X] = Distance;
+			}
+		}
+	});
+
+	MarkPackageDirty();
+	UE_LOG(LogKawaiiPhysics, Log, TEXT("%s : baked a %dx%dx%d distance field from %d shapes and %d triangles"),
+	       *GetName(), Resolution.X, Resolution.Y, Resolution.Z, Shapes.Num(), Triangles.Num());
+}
+
+#endif
@@ -15,6 +15,48 @@ DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_ExternalForce_Curve_Apply"), STAT_KawaiiP
 DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_ExternalForce_Wind_Apply"), STAT_KawaiiPhysics_ExternalForce_Wind_Apply,
                    STATGROUP_Anim);
 
+///
+/// Base
+///
+bool FKawaiiPhysics_ExternalForce::CanApplyBatch(const FInstancedStruct& ExternalForce)
+{
+	// Exact types only, so that a subclass overriding Apply is not skipped by the batched kernel of its parent
+	const UScriptStruct* ScriptStruct = ExternalForce.GetScriptStruct();
+	if (ScriptStruct == FKawaiiPhysics_ExternalForce::StaticStruct() ||
+		ScriptStruct == FKawaiiPhysics_ExternalForce_Basic::StaticStruct() ||
+		ScriptStruct == FKawaiiPhysics_ExternalForce_Gravity::StaticStruct() ||
+		ScriptStruct == FKawaiiPhysics_ExternalForce_Curve::StaticStruct() ||
+		ScriptStruct == FKawaiiPhysics_ExternalForce_Wind::StaticStruct())
+	{
+		return true;
+	}
+
+	const FKawaiiPhysics_ExternalForce* Force = ExternalForce.GetPtr<FKawaiiPhysics_ExternalForce>();
+	return Force && Force->SupportsApplyBatch();
+}
+
+#if ENABLE_ANIM_DEBUG
+void FKawaiiPhysics_ExternalForce::AddBatchDebugForce(const FKawaiiPhysicsExternalForceBatch& Batch, int32 Index,
+                                                      const FVector& BoneForce, bool bDrawBone)
+{
+	// BoneForceMap is only read for drawing
+	if (!bDrawDebug)
+	{
+		return;
+	}
+
+	const FKawaiiPhysicsModifyBone& ModifyBone = Batch.Node.ModifyBones[Index];
+	BoneForceMap.Add(ModifyBone.BoneRef.BoneName, BoneForce);
+
+	if (bDrawBone && IsDebugEnabled())
+	{
+		FKawaiiPhysicsModifyBone DebugBone = ModifyBone;
+		DebugBone.Location = Batch.Locations[Index];
+		AnimDrawDebug(DebugBone, Batch.Node, Batch.PoseContext);
+	}
+}
+#endif
+
 ///
 /// Basic
 ///
@@ -83,6 +125,32 @@ void FKawaiiPhysics_ExternalForce_Basic::Apply(FKawaiiPhysicsModifyBone& Bone, F
 	}
 }
 
+void FKawaiiPhysics_ExternalForce_Basic::ApplyBatch(const FKawaiiPhysicsExternalForceBatch& Batch)
+{
+	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_ExternalForce_Basic_Apply);
+
+	const FRichCurve* ForceRateCurve = GetForceRateCurve(ForceRateByBoneLengthRate);
+	const bool bBoneSpace = ExternalForceSpace == EExternalForceSpace::BoneSpace;
+	const float DeltaTime = Batch.Node.DeltaTime;
+
+	for (const int32 Index : Batch.BoneIndices)
+	{
+		const FKawaiiPhysicsModifyBone& ModifyBone = Batch.Node.ModifyBones[Index];
+		if (!CanApply(ModifyBone))
+		{
+			continue;
+		}
+
+		const float ForceRate = ForceRateCurve ? ForceRateCurve->Eval(ModifyBone.LengthRateFromRoot) : 1.0f;
+		const FVector BoneForce = bBoneSpace ? Batch.BoneTransforms[Index].TransformVector(Force) : Force;
+		Batch.Locations[Index] += BoneForce * ForceRate * DeltaTime;
+
+#if ENABLE_ANIM_DEBUG
+		AddBatchDebugForce(Batch, Index, bBoneSpace ? BoneForce : BoneForce * ForceRate, false);
+#endif
+	}
+}
+
 ///
 /// Gravity
 ///
@@ -142,6 +210,30 @@ void FKawaiiPhysics_ExternalForce_Gravity::Apply(FKawaiiPhysicsModifyBone& Bone,
 #endif
 }
 
+void FKawaiiPhysics_ExternalForce_Gravity::ApplyBatch(const FKawaiiPhysicsExternalForceBatch& Batch)
+{
+	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_ExternalForce_Gravity_Apply);
+
+	const FRichCurve* ForceRateCurve = GetForceRateCurve(ForceRateByBoneLengthRate);
+	const FVector StepForce = 0.5f * Force * Batch.Node.DeltaTime * Batch.Node.DeltaTime;
+
+	for (const int32 Index : Batch.BoneIndices)
+	{
+		const FKawaiiPhysicsModifyBone& ModifyBone = Batch.Node.ModifyBones[Index];
+		if (!CanApply(ModifyBone))
+		{
+			continue;
+		}
+
+		const float ForceRate = ForceRateCurve ? ForceRateCurve->Eval(ModifyBone.LengthRateFromRoot) : 1.0f;
+		Batch.Locations[Index] += StepForce * ForceRate;
+
+#if ENABLE_ANIM_DEBUG
+		AddBatchDebugForce(Batch, Index, Force * ForceRate, true);
+#endif
+	}
+}
+
 ///
 /// Curve
 ///
@@ -280,6 +372,35 @@ void FKawaiiPhysics_ExternalForce_Curve::Apply(FKawaiiPhysicsModifyBone& Bone, F
 #endif
 }
 
+void FKawaiiPhysics_ExternalForce_Curve::ApplyBatch(const FKawaiiPhysicsExternalForceBatch& Batch)
+{
+	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_ExternalForce_Curve_Apply);
+
+	const FRichCurve* ForceRateCurve = GetForceRateCurve(ForceRateByBoneLengthRate);
+	const bool bBoneSpace = ExternalForceSpace == EExternalForceSpace::BoneSpace;
+	const float DeltaTime = Batch.Node.DeltaTime;
+
+	for (const int32 Index : Batch.BoneIndices)
+	{
+		const FKawaiiPhysicsModifyBone& ModifyBone = Batch.Node.ModifyBones[Index];
+		if (!CanApply(ModifyBone))
+		{
+			continue;
+		}
+
+		const float ForceRate = ForceRateCurve ? ForceRateCurve->Eval(ModifyBone.LengthRateFromRoot) : 1.0f;
+		const FVector BoneForce = bBoneSpace ? Batch.BoneTransforms[Index].TransformVector(Force) : Force;
+		Batch.Locations[Index] += BoneForce * ForceRate * DeltaTime;
+
+#if ENABLE_ANIM_DEBUG
+		AddBatchDebugForce(Batch, Index, BoneForce * ForceRate, true);
+#endif
+	}
+}
+
+///
+/// Wind
+///
 void FKawaiiPhysics_ExternalForce_Wind::PreApply(FAnimNode_KawaiiPhysics& Node, const USkeletalMeshComponent* SkelComp)
 {
 	Super::PreApply(Node, SkelComp);
@@ -318,3 +439,41 @@ void FKawaiiPhysics_ExternalForce_Wind::Apply(FKawaiiPhysicsModifyBone& Bone, FA
 	AnimDrawDebug(Bone, Node, PoseContext);
 #endif
 }
+
+void FKawaiiPhysics_ExternalForce_Wind::ApplyBatch(const FKawaiiPhysicsExternalForceBatch& Batch)
+{
+	const FSceneInterface* Scene = World && World->Scene ? World->Scene : nullptr;
+	if (!Scene)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_ExternalForce_Wind_Apply);
+
+	const FRichCurve* ForceRateCurve = GetForceRateCurve(ForceRateByBoneLengthRate);
+	const float ForceScale = RandomizedForceScale * Batch.Node.DeltaTime;
+
+	for (const int32 Index : Batch.BoneIndices)
+	{
+		const FKawaiiPhysicsModifyBone& ModifyBone = Batch.Node.ModifyBones[Index];
+		if (!CanApply(ModifyBone))
+		{
+			continue;
+		}
+
+		const float ForceRate = ForceRateCurve ? ForceRateCurve->Eval(ModifyBone.LengthRateFromRoot) : 1.0f;
+
+		FVector WindDirection = FVector::ZeroVector;
+		float WindSpeed, WindMinGust, WindMaxGust = 0.0f;
+		Scene->GetWindParameters(ComponentTransform.TransformPosition(Batch.PoseLocations[Index]), WindDirection,
+		                         WindSpeed, WindMinGust, WindMaxGust);
+		WindDirection = ComponentTransform.InverseTransformVector(WindDirection);
+		WindDirection *= WindSpeed;
+
+		Batch.Locations[Index] += WindDirection * ForceRate * ForceScale;
+
+#if ENABLE_ANIM_DEBUG
+		AddBatchDebugForce(Batch, Index, WindDirection * ForceRate * RandomizedForceScale, true);
+#endif
+	}
+}
@@ -71,6 +71,7 @@ void UKawaiiPhysicsLimitsDataAsset::UpdateLimit(FCollisionLimitBase* Limit)
 		break;
 	}
 
+	IncrementRevision();
 	MarkPackageDirty();
 }
 
@@ -91,6 +92,7 @@ void UKawaiiPhysicsLimitsDataAsset::Sync()
 	SyncCollisionLimits(CapsuleLimitsData, CapsuleLimits);
 	SyncCollisionLimits(BoxLimitsData, BoxLimits);
 	SyncCollisionLimits(PlanarLimitsData, PlanarLimits);
+	IncrementRevision();
 }
 
 void UKawaiiPhysicsLimitsDataAsset::PostEditChangeChainProperty(FPropertyChangedChainEvent& PropertyChangedEvent)
@@ -139,8 +141,16 @@ void UKawaiiPhysicsLimitsDataAsset::PostEditChangeChainProperty(FPropertyChanged
 		UpdateLimits(PlanarLimits);
 	}
 
+	IncrementRevision();
 	OnLimitsChanged.Broadcast(PropertyChangedEvent);
 }
+
+void UKawaiiPhysicsLimitsDataAsset::PostEditUndo()
+{
+	Super::PostEditUndo();
+
+	IncrementRevision();
+}
 #endif
 
 #if WITH_EDITORONLY_DATA
@@ -0,0 +1,80 @@
+// KawaiiPhysics : Copyright (c) 2019-2024 pafuhana1213, MIT License
+
+#include "KawaiiPhysicsRestStateDataAsset.h"
+
+#include "Animation/Skeleton.h"
+
+float FKawaiiPhysicsRestStateSnapshot::GetPoseDistance(TConstArrayView<FVector> InPoseLocations) const
+{
+	if (InPoseLocations.IsEmpty() || InPoseLocations.Num() != PoseLocations.Num())
+	{
+		return -1.0f;
+	}
+
+	float MaxDistanceSquared = 0.0f;
+	for (int32 i = 0; i < PoseLocations.Num(); ++i)
+	{
+		const FVector RelativeLocation = InPoseLocations[i] - InPoseLocations[0];
+		MaxDistanceSquared = FMath::Max(MaxDistanceSquared,
+		                                static_cast<float>(FVector::DistSquared(RelativeLocation, PoseLocations[i])));
+	}
+	return FMath::Sqrt(MaxDistanceSquared);
+}
+
+namespace
+{
+	bool MatchesBones(const FKawaiiPhysicsRestStateSnapshot& Snapshot, TConstArrayView<FName> BoneNames)
+	{
+		if (Snapshot.BoneNames.Num() != BoneNames.Num() || Snapshot.Offsets.Num() != BoneNames.Num())
+		{
+			return false;
+		}
+		for (int32 i = 0; i < BoneNames.Num(); ++i)
+		{
+			if (Snapshot.BoneNames[i] != BoneNames[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+const FKawaiiPhysicsRestStateSnapshot* UKawaiiPhysicsRestStateDataAsset::FindSnapshot(
+	const USkeleton* Skeleton, TConstArrayView<FName> BoneNames, TConstArrayView<FVector> PoseLocations) const
+{
+	const FSoftObjectPath SkeletonPath(Skeleton);
+
+	const FKawaiiPhysicsRestStateSnapshot* BestSnapshot = nullptr;
+	float BestDistance = PoseTolerance;
+	for (const FKawaiiPhysicsRestStateSnapshot& Snapshot : Snapshots)
+	{
+		if (Snapshot.Skeleton.ToSoftObjectPath() != SkeletonPath || !MatchesBones(Snapshot, BoneNames))
+		{
+			continue;
+		}
+
+		const float Distance = Snapshot.GetPoseDistance(PoseLocations);
+		if (Distance >= 0.0f && Distance <= BestDistance)
+		{
+			BestSnapshot = &Snapshot;
+			BestDistance = Distance;
+		}
+	}
+	return BestSnapshot;
+}
+
+void UKawaiiPhysicsRestStateDataAsset::AddSnapshot(const FKawaiiPhysicsRestStateSnapshot& Snapshot)
+{
+	// Snapshot.PoseLocations are relative to the first bone, which GetPoseDistance accepts as well
+	Snapshots.RemoveAll([this, &Snapshot](const FKawaiiPhysicsRestStateSnapshot& Other)
+	{
+		if (Other.Skeleton != Snapshot.Skeleton || !MatchesBones(Other, Snapshot.BoneNames))
+		{
+			return false;
+		}
+		const float Distance = Other.GetPoseDistance(Snapshot.PoseLocations);
+		return Distance >= 0.0f && Distance <= PoseTolerance;
+	});
+	Snapshots.Add(Snapshot);
+}
@@ -0,0 +1,139 @@
+// KawaiiPhysics : Copyright (c) 2019-2024 pafuhana1213, MIT License
+
+#include "KawaiiPhysicsSharedContextComponent.h"
+
+#include "Components/SkeletalMeshComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_AppendSharedLimits"), STAT_KawaiiPhysics_AppendSharedLimits, STATGROUP_Anim);
+
+uint32 UKawaiiPhysicsSharedContextComponent::RegistrationSerial = 0;
+
+UKawaiiPhysicsSharedContextComponent::UKawaiiPhysicsSharedContextComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UKawaiiPhysicsSharedContextComponent::OnRegister()
+{
+	Super::OnRegister();
+	++RegistrationSerial;
+}
+
+void UKawaiiPhysicsSharedContextComponent::OnUnregister()
+{
+	++RegistrationSerial;
+	Super::OnUnregister();
+}
+
+void UKawaiiPhysicsSharedContextComponent::SetLimitSourceComponent(USkeletalMeshComponent* Component)
+{
+	LimitSourceComponent = Component;
+	AddMemberComponent(Component);
+
+	for (USkeletalMeshComponent* Member : MemberComponents)
+	{
+		AddLimitSourcePrerequisite(Member);
+	}
+}
+
+void UKawaiiPhysicsSharedContextComponent::AddMemberComponent(USkeletalMeshComponent* Component)
+{
+	if (!Component)
+	{
+		return;
+	}
+
+	MemberComponents.AddUnique(Component);
+	AddLimitSourcePrerequisite(Component);
+}
+
+void UKawaiiPhysicsSharedContextComponent::RemoveMemberComponent(USkeletalMeshComponent* Component)
+{
+	if (!Component)
+	{
+		return;
+	}
+
+	if (LimitSourceComponent && Component != LimitSourceComponent)
+	{
+		Component->PrimaryComponentTick.RemovePrerequisite(LimitSourceComponent,
+		                                                   LimitSourceComponent->PrimaryComponentTick);
+	}
+	MemberComponents.Remove(Component);
+	if (Component == LimitSourceComponent)
+	{
+		LimitSourceComponent = nullptr;
+	}
+}
+
+void UKawaiiPhysicsSharedContextComponent::AddLimitSourcePrerequisite(USkeletalMeshComponent* Component) const
+{
+	// The tick of a skeletal mesh component only completes once its animation evaluation is done,
+	// so the members see the limits of the current frame
+	if (Component && LimitSourceComponent && Component != LimitSourceComponent &&
+		Component->PrimaryComponentTick.bCanEverTick)
+	{
+		Component->PrimaryComponentTick.AddPrerequisite(LimitSourceComponent, LimitSourceComponent->PrimaryComponentTick);
+	}
+}
+
+void UKawaiiPhysicsSharedContextComponent::PublishLimits(const FAnimNode_KawaiiPhysics* Publisher,
+                                                         const FKawaiiPhysicsPackedLimits& Limits,
+                                                         const FTransform& ComponentTransform)
+{
+	FScopeLock Lock(&PublishedLimitsLock);
+
+	// Drop the limits of nodes that stopped publishing (e.g. their anim instance was replaced)
+	PublishedLimits.RemoveAll([](const FPublishedLimits& Published)
+	{
+		return Published.Frame + 1 < GFrameCounter;
+	});
+
+	FPublishedLimits* Published = PublishedLimits.FindByPredicate([Publisher](const FPublishedLimits& Entry)
+	{
+		return Entry.Publisher == Publisher;
+	});
+	if (!Published)
+	{
+		Published = &PublishedLimits.AddDefaulted_GetRef();
+		Published->Publisher = Publisher;
+	}
+	Published->Limits = Limits;
+	Published->ComponentTransform = ComponentTransform;
+	Published->Frame = GFrameCounter;
+}
+
+void UKawaiiPhysicsSharedContextComponent::UnpublishLimits(const FAnimNode_KawaiiPhysics* Publisher)
+{
+	FScopeLock Lock(&PublishedLimitsLock);
+	PublishedLimits.RemoveAll([Publisher](const FPublishedLimits& Published)
+	{
+		return Published.Publisher == Publisher;
+	});
+}
+
+void UKawaiiPhysicsSharedContextComponent::AppendSharedLimits(FKawaiiPhysicsPackedLimits& Limits,
+                                                              const FTransform& ComponentTransform) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_AppendSharedLimits);
+
+	FScopeLock Lock(&PublishedLimitsLock);
+	for (const FPublishedLimits& Published : PublishedLimits)
+	{
+		if (Published.Frame + 1 >= GFrameCounter)
+		{
+			Limits.AppendTransformed(Published.Limits,
+			                         Published.ComponentTransform.GetRelativeTransform(ComponentTransform));
+		}
+	}
+}
+
+void UKawaiiPhysicsSharedContextComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	{
+		FScopeLock Lock(&PublishedLimitsLock);
+		PublishedLimits.Empty();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
@@ -0,0 +1,525 @@
+// KawaiiPhysics : Copyright (c) 2019-2024 pafuhana1213, MIT License
+
+#include "KawaiiPhysicsSolver.h"
+
+#include "Async/ParallelFor.h"
+
+DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_AdjustByBoneConstraint"), STAT_KawaiiPhysics_AdjustByBoneConstraint,
+                   STATGROUP_Anim);
+DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_ColorBoneConstraints"), STAT_KawaiiPhysics_ColorBoneConstraints,
+                   STATGROUP_Anim);
+
+static TAutoConsoleVariable<int32> CVarKawaiiPhysicsBoneConstraintParallelBatchSize(
+	TEXT("a.AnimNode.KawaiiPhysics.BoneConstraint.ParallelBatchSize"), 64,
+	TEXT("Number of constraints of one color KawaiiPhysics solves per ParallelFor work item. "
+		"Colors with fewer constraints are solved on the calling thread"));
+
+namespace KawaiiPhysicsSolver
+{
+	const TArray<float> XPBDComplianceValues =
+	{
+		0.00000000004f, // 0.04 x 10^(-9) (M^2/N) Concrete
+		0.00000000016f, // 0.16 x 10^(-9) (M^2/N) Wood
+		0.000000001f, // 1.0  x 10^(-8) (M^2/N) Leather
+		0.000000002f, // 0.2  x 10^(-7) (M^2/N) Tendon
+		0.0000001f, // 1.0  x 10^(-6) (M^2/N) Rubber
+		0.00002f, // 0.2  x 10^(-3) (M^2/N) Muscle
+		0.0001f, // 1.0  x 10^(-3) (M^2/N) Fat
+	};
+
+	void PrepareStep(FKawaiiPhysicsSolverState& State, TArray<int32>& OutSimulatedBoneIndices)
+	{
+		OutSimulatedBoneIndices.Reset();
+		State.bDormants.Reset();
+		for (int32 i = 0; i < State.Num(); ++i)
+		{
+			if (!State.bHasBones[i] && !State.bDummies[i])
+			{
+				State.bSkipSimulates[i] = true;
+				continue;
+			}
+
+			if (State.ParentIndices[i] < 0)
+			{
+				State.bSkipSimulates[i] = true;
+				State.PrevLocations[i] = State.Locations[i];
+				State.Locations[i] = State.PoseLocations[i];
+				continue;
+			}
+
+			State.bSkipSimulates[i] = false;
+			OutSimulatedBoneIndices.Add(i);
+		}
+	}
+
+	void MarkDormantBones(FKawaiiPhysicsSolverState& State, TConstArrayView<int32> SimulatedBoneIndices)
+	{
+		State.bDormants.SetNumUninitialized(State.Num());
+		for (int32 i = 0; i < State.Num(); ++i)
+		{
+			State.bDormants[i] = !State.bSkipSimulates[i];
+		}
+		for (const int32 Index : SimulatedBoneIndices)
+		{
+			State.bDormants[Index] = false;
+		}
+		if (!State.bDormants.Contains(true))
+		{
+			State.bDormants.Reset();
+		}
+	}
+
+	void Integrate(FKawaiiPhysicsSolverState& State, int32 Index, const FKawaiiPhysicsSolverParams& Params,
+	               const FVector* WindVelocity)
+	{
+		FVector& Location = State.Locations[Index];
+		FVector& PrevLocation = State.PrevLocations[Index];
+
+		// Move using Velocity( = movement amount in pre frame ) and Damping
+		FVector Velocity = (Location - PrevLocation) / Params.DeltaTimeOld;
+		PrevLocation = Location;
+		Velocity *= (1.0f - State.Dampings[Index]);
+
+		// wind
+		if (WindVelocity)
+		{
+			Velocity += *WindVelocity * Params.TargetFramerate;
+		}
+		Location += Velocity * Params.DeltaTime;
+
+		// Follow Translation
+		Location += Params.SkelCompMoveVector * (1.0f - State.WorldDampingLocations[Index]);
+
+		// Follow Rotation
+		Location += (Params.SkelCompMoveRotation.RotateVector(PrevLocation) - PrevLocation)
+			* (1.0f - State.WorldDampingRotations[Index]);
+
+		// Gravity
+		// TODO:Migrate if there are more good method (Currently copying AnimDynamics implementation)
+		Location += 0.5 * Params.GravityCS * Params.DeltaTime * Params.DeltaTime;
+	}
+
+	void PullToPose(FKawaiiPhysicsSolverState& State, int32 Index, float Exponent)
+	{
+		const int32 ParentIndex = State.ParentIndices[Index];
+		FVector& Location = State.Locations[Index];
+
+		const FVector BaseLocation = State.Locations[ParentIndex] +
+			(State.PoseLocations[Index] - State.PoseLocations[ParentIndex]);
+		Location += (BaseLocation - Location) *
+			(1.0f - FMath::Pow(1.0f - State.Stiffnesses[Index], Exponent));
+	}
+
+	/**
+	 * Gets the XPBD correction of a bone constraint. Location1 moves by +Correction and Location2 by -Correction.
+	 *
+	 * @return False if the constraint can not be solved.
+	 */
+	static bool CalcBoneConstraintCorrection(const FModifyBoneConstraint& BoneConstraint, float Lambda,
+	                                         const FVector& Location1, const FVector& Location2,
+	                                         const FKawaiiPhysicsSolverParams& Params, FVector& OutCorrection,
+	                                         float& OutDeltaLambda)
+	{
+		const EXPBDComplianceType ComplianceType = BoneConstraint.bOverrideCompliance
+			                                           ? BoneConstraint.ComplianceType
+			                                           : Params.BoneConstraintGlobalComplianceType;
+
+		const FVector Delta = Location2 - Location1;
+		const float DeltaLength = Delta.Size();
+		if (DeltaLength <= 0.0f)
+		{
+			return false;
+		}
+
+		// PBD
+		// Delta *= (DeltaLength - BoneConstraint.Length) / DeltaLength * 0.5f;
+		// ModifyBone1.Location += Delta * Stiffness;
+		// ModifyBone2.Location -= Delta * Stiffness;
+
+		// XBPD
+		const float Constraint = DeltaLength - BoneConstraint.Length;
+		float Compliance = XPBDComplianceValues[static_cast<int32>(ComplianceType)];
+		Compliance /= Params.DeltaTime * Params.DeltaTime;
+		OutDeltaLambda = (Constraint - Compliance * Lambda) / (2 + Compliance); // 2 = SumMass
+		OutCorrection = (Delta / DeltaLength) * OutDeltaLambda;
+		return true;
+	}
+
+	static bool IsDormant(const FKawaiiPhysicsSolverState& State, int32 Index)
+	{
+		return !State.bDormants.IsEmpty() && State.bDormants[Index];
+	}
+
+	/** Dormant bones moved by a constraint leave the sleep, so that their chain settles again */
+	static void WakeIfMoved(FKawaiiPhysicsSolverState& State, int32 Index, const FVector& Correction)
+	{
+		if (IsDormant(State, Index) && Correction.SizeSquared() > FMath::Square(UE_KINDA_SMALL_NUMBER))
+		{
+			State.bDormants[Index] = false;
+		}
+	}
+
+	static void SolveBoneConstraint(FKawaiiPhysicsSolverState& State, const FModifyBoneConstraint& BoneConstraint,
+	                                int32 ConstraintIndex, const FKawaiiPhysicsSolverParams& Params)
+	{
+		if (!BoneConstraint.IsValid() ||
+			(IsDormant(State, BoneConstraint.ModifyBoneIndex1) && IsDormant(State, BoneConstraint.ModifyBoneIndex2)))
+		{
+			return;
+		}
+
+		FVector& Location1 = State.Locations[BoneConstraint.ModifyBoneIndex1];
+		FVector& Location2 = State.Locations[BoneConstraint.ModifyBoneIndex2];
+		FVector Correction;
+		float DeltaLambda;
+		float& Lambda = State.BoneConstraintLambdas[ConstraintIndex];
+		if (CalcBoneConstraintCorrection(BoneConstraint, Lambda, Location1, Location2, Params, Correction,
+		                                 DeltaLambda))
+		{
+			Location1 += Correction;
+			Location2 -= Correction;
+			Lambda += DeltaLambda;
+			WakeIfMoved(State, BoneConstraint.ModifyBoneIndex1, Correction);
+			WakeIfMoved(State, BoneConstraint.ModifyBoneIndex2, Correction);
+		}
+	}
+
+	void AdjustByBoneConstraints(FKawaiiPhysicsSolverState& State, TConstArrayView<FModifyBoneConstraint> Constraints,
+	                             const FKawaiiPhysicsSolverParams& Params)
+	{
+		for (int32 i = 0; i < Constraints.Num(); ++i)
+		{
+			SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_AdjustByBoneConstraint);
+
+			SolveBoneConstraint(State, Constraints[i], i, Params);
+		}
+	}
+
+	void AdjustByBoneConstraintsColored(FKawaiiPhysicsSolverState& State,
+	                                    TConstArrayView<FModifyBoneConstraint> Constraints,
+	                                    TConstArrayView<int32> ColorStarts, const FKawaiiPhysicsSolverParams& Params)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_AdjustByBoneConstraint);
+
+		const int32 BatchSize = FMath::Max(1, CVarKawaiiPhysicsBoneConstraintParallelBatchSize.GetValueOnAnyThread());
+		for (int32 Color = 0; Color + 1 < ColorStarts.Num(); ++Color)
+		{
+			const int32 Start = ColorStarts[Color];
+			const int32 Num = ColorStarts[Color + 1] - Start;
+			if (Num < BatchSize * 2)
+			{
+				for (int32 i = Start; i < Start + Num; ++i)
+				{
+					SolveBoneConstraint(State, Constraints[i], i, Params);
+				}
+				continue;
+			}
+
+			// No two constraints of a color share a bone, so they can be solved in any order
+			const int32 NumBatches = FMath::DivideAndRoundUp(Num, BatchSize);
+			ParallelFor(NumBatches, [&State, Constraints, &Params, Start, Num, BatchSize](int32 BatchIndex)
+			{
+				const int32 BatchStart = Start + BatchIndex * BatchSize;
+				const int32 BatchEnd = FMath::Min(BatchStart + BatchSize, Start + Num);
+				for (int32 i = BatchStart; i < BatchEnd; ++i)
+				{
+					SolveBoneConstraint(State, Constraints[i], i, Params);
+				}
+			});
+		}
+	}
+
+	void AdjustByBoneConstraintsJacobi(FKawaiiPhysicsSolverState& State,
+	                                   TConstArrayView<FModifyBoneConstraint> Constraints,
+	                                   const FKawaiiPhysicsSolverParams& Params, TArray<FVector>& Corrections,
+	                                   TArray<int32>& CorrectionCounts)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_AdjustByBoneConstraint);
+
+		Corrections.SetNumUninitialized(State.Num());
+		CorrectionCounts.SetNumUninitialized(State.Num());
+		FMemory::Memzero(Corrections.GetData(), Corrections.Num() * sizeof(FVector));
+		FMemory::Memzero(CorrectionCounts.GetData(), CorrectionCounts.Num() * sizeof(int32));
+
+		for (int32 i = 0; i < Constraints.Num(); ++i)
+		{
+			const FModifyBoneConstraint& BoneConstraint = Constraints[i];
+			const int32 Index1 = BoneConstraint.ModifyBoneIndex1;
+			const int32 Index2 = BoneConstraint.ModifyBoneIndex2;
+			if (!BoneConstraint.IsValid() || (IsDormant(State, Index1) && IsDormant(State, Index2)))
+			{
+				continue;
+			}
+
+			FVector Correction;
+			float DeltaLambda;
+			if (CalcBoneConstraintCorrection(BoneConstraint, State.BoneConstraintLambdas[i], State.Locations[Index1],
+			                                 State.Locations[Index2], Params, Correction, DeltaLambda))
+			{
+				Corrections[Index1] += Correction;
+				Corrections[Index2] -= Correction;
+				++CorrectionCounts[Index1];
+				++CorrectionCounts[Index2];
+				State.BoneConstraintLambdas[i] += DeltaLambda;
+			}
+		}
+
+		// Average the corrections so that bones with many constraints do not overshoot
+		for (int32 i = 0; i < State.Num(); ++i)
+		{
+			if (CorrectionCounts[i] > 0)
+			{
+				const FVector Correction = Corrections[i] / CorrectionCounts[i];
+				State.Locations[i] += Correction;
+				WakeIfMoved(State, i, Correction);
+			}
+		}
+	}
+
+	void SolveBoneConstraints(FKawaiiPhysicsSolverState& State, TConstArrayView<FModifyBoneConstraint> Constraints,
+	                          const FKawaiiPhysicsSolverParams& Params, TConstArrayView<int32> ColorStarts,
+	                          FKawaiiPhysicsBoneConstraintMetrics* OutMetrics)
+	{
+		if (OutMetrics)
+		{
+			*OutMetrics = FKawaiiPhysicsBoneConstraintMetrics();
+			OutMetrics->NumColors = FMath::Max(0, ColorStarts.Num() - 1);
+			float MaxError;
+			MeasureBoneConstraintError(State, Constraints, OutMetrics->InitialRMSError, MaxError);
+		}
+
+		if (Params.BoneConstraintIterationCountAfterCollision > 0)
+		{
+			State.BoneConstraintLambdas.SetNumUninitialized(Constraints.Num());
+			FMemory::Memzero(State.BoneConstraintLambdas.GetData(), Constraints.Num() * sizeof(float));
+
+			switch (Params.BoneConstraintSolver)
+			{
+			case EKawaiiPhysicsBoneConstraintSolver::GraphColored:
+				if (ColorStarts.Num() > 1)
+				{
+					for (int i = 0; i < Params.BoneConstraintIterationCountAfterCollision; ++i)
+					{
+						AdjustByBoneConstraintsColored(State, Constraints, ColorStarts, Params);
+					}
+					break;
+				}
+				// Not colored yet
+				[[fallthrough]];
+			case EKawaiiPhysicsBoneConstraintSolver::GaussSeidel:
+				for (int i = 0; i < Params.BoneConstraintIterationCountAfterCollision; ++i)
+				{
+					AdjustByBoneConstraints(State, Constraints, Params);
+				}
+				break;
+			case EKawaiiPhysicsBoneConstraintSolver::Jacobi:
+				for (int i = 0; i < Params.BoneConstraintIterationCountAfterCollision; ++i)
+				{
+					AdjustByBoneConstraintsJacobi(State, Constraints, Params, State.BoneConstraintCorrections,
+					                              State.BoneConstraintCorrectionCounts);
+				}
+				break;
+			default: ;
+			}
+		}
+
+		if (OutMetrics)
+		{
+			MeasureBoneConstraintError(State, Constraints, OutMetrics->FinalRMSError, OutMetrics->FinalMaxError);
+		}
+	}
+
+	void ColorBoneConstraints(TArray<FModifyBoneConstraint>& Constraints, int32 NumBones,
+	                          TArray<int32>& OutColorStarts)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_ColorBoneConstraints);
+
+		OutColorStarts.Reset();
+		if (Constraints.IsEmpty())
+		{
+			return;
+		}
+
+		// Greedy coloring : each constraint takes the lowest color none of its bones has used yet
+		TArray<TArray<uint64, TInlineAllocator<1>>> BoneColorMasks;
+		BoneColorMasks.SetNum(NumBones);
+		TArray<int32> Colors;
+		Colors.SetNumUninitialized(Constraints.Num());
+		int32 NumColors = 1;
+		for (int32 i = 0; i < Constraints.Num(); ++i)
+		{
+			const FModifyBoneConstraint& Constraint = Constraints[i];
+			if (!Constraint.IsValid() || !Constraint.IsBoneReferenceValid() ||
+				Constraint.ModifyBoneIndex1 >= NumBones || Constraint.ModifyBoneIndex2 >= NumBones)
+			{
+				// Skipped by the solver, any color will do
+				Colors[i] = 0;
+				continue;
+			}
+
+			auto& Masks1 = BoneColorMasks[Constraint.ModifyBoneIndex1];
+			auto& Masks2 = BoneColorMasks[Constraint.ModifyBoneIndex2];
+			int32 Color = 0;
+			for (int32 Word = 0;; ++Word)
+			{
+				const uint64 Used = (Masks1.IsValidIndex(Word) ? Masks1[Word] : 0) |
+					(Masks2.IsValidIndex(Word) ? Masks2[Word] : 0);
+				if (Used != MAX_uint64)
+				{
+					Color = Word * 64 + static_cast<int32>(FMath::CountTrailingZeros64(~Used));
+					break;
+				}
+			}
+
+			const int32 Word = Color / 64;
+			const uint64 Bit = 1ull << (Color % 64);
+			Masks1.SetNumZeroed(FMath::Max(Masks1.Num(), Word + 1));
+			Masks2.SetNumZeroed(FMath::Max(Masks2.Num(), Word + 1));
+			Masks1[Word] |= Bit;
+			Masks2[Word] |= Bit;
+			Colors[i] = Color;
+			NumColors = FMath::Max(NumColors, Color + 1);
+		}
+
+		// Sort by color, keeping the order within each color
+		OutColorStarts.SetNumZeroed(NumColors + 1);
+		for (const int32 Color : Colors)
+		{
+			++OutColorStarts[Color + 1];
+		}
+		for (int32 Color = 0; Color < NumColors; ++Color)
+		{
+			OutColorStarts[Color + 1] += OutColorStarts[Color];
+		}
+
+		TArray<int32> Offsets(OutColorStarts.GetData(), NumColors);
+		TArray<FModifyBoneConstraint> Sorted;
+		Sorted.SetNum(Constraints.Num());
+		for (int32 i = 0; i < Constraints.Num(); ++i)
+		{
+			Sorted[Offsets[Colors[i]]++] = MoveTemp(Constraints[i]);
+		}
+		Constraints = MoveTemp(Sorted);
+	}
+
+	void MeasureBoneConstraintError(const FKawaiiPhysicsSolverState& State,
+	                                TConstArrayView<FModifyBoneConstraint> Constraints, float& OutRMSError,
+	                                float& OutMaxError)
+	{
+		double SumSquaredError = 0.0;
+		int32 NumValid = 0;
+		OutMaxError = 0.0f;
+		for (const FModifyBoneConstraint& BoneConstraint : Constraints)
+		{
+			if (!BoneConstraint.IsValid())
+			{
+				continue;
+			}
+
+			const float Error = FMath::Abs(FVector::Dist(State.Locations[BoneConstraint.ModifyBoneIndex1],
+			                                             State.Locations[BoneConstraint.ModifyBoneIndex2]) -
+				BoneConstraint.Length);
+			SumSquaredError += Error * Error;
+			OutMaxError = FMath::Max(OutMaxError, Error);
+			++NumValid;
+		}
+		OutRMSError = NumValid > 0 ? static_cast<float>(FMath::Sqrt(SumSquaredError / NumValid)) : 0.0f;
+	}
+
+	void AdjustByAngleLimit(FKawaiiPhysicsSolverState& State, int32 Index, int32 ParentIndex)
+	{
+		const float LimitAngle = State.LimitAngles[Index];
+		if (LimitAngle == 0.0f)
+		{
+			return;
+		}
+
+		FVector& Location = State.Locations[Index];
+		const FVector& ParentLocation = State.Locations[ParentIndex];
+
+		FVector BoneDir = (Location - ParentLocation).GetSafeNormal();
+		const FVector PoseDir = (State.PoseLocations[Index] - State.PoseLocations[ParentIndex]).GetSafeNormal();
+		const FVector Axis = FVector::CrossProduct(PoseDir, BoneDir);
+		const float Angle = FMath::Atan2(Axis.Size(), FVector::DotProduct(PoseDir, BoneDir));
+		const float AngleOverLimit = FMath::RadiansToDegrees(Angle) - LimitAngle;
+
+		if (AngleOverLimit > 0.0f)
+		{
+			BoneDir = BoneDir.RotateAngleAxis(-AngleOverLimit, Axis.GetSafeNormal());
+			Location = BoneDir * (Location - ParentLocation).Size() + ParentLocation;
+		}
+	}
+
+	void AdjustByPlanarConstraint(FKawaiiPhysicsSolverState& State, int32 Index, int32 ParentIndex,
+	                              EPlanarConstraint PlanarConstraint)
+	{
+		if (PlanarConstraint != EPlanarConstraint::None)
+		{
+			const FVector& ParentLocation = State.Locations[ParentIndex];
+			const FQuat& ParentPoseRotation = State.PoseRotations[ParentIndex];
+
+			FPlane Plane;
+			switch (PlanarConstraint)
+			{
+			case EPlanarConstraint::X:
+				Plane = FPlane(ParentLocation, ParentPoseRotation.GetAxisX());
+				break;
+			case EPlanarConstraint::Y:
+				Plane = FPlane(ParentLocation, ParentPoseRotation.GetAxisY());
+				break;
+			case EPlanarConstraint::Z:
+				Plane = FPlane(ParentLocation, ParentPoseRotation.GetAxisZ());
+				break;
+			case EPlanarConstraint::None:
+				break;
+			default: ;
+			}
+			State.Locations[Index] = FVector::PointPlaneProject(State.Locations[Index], Plane);
+		}
+	}
+
+	void FinishStep(FKawaiiPhysicsSolverState& State, TConstArrayView<int32> SimulatedBoneIndices,
+	                const FKawaiiPhysicsSolverParams& Params)
+	{
+		for (const int32 Index : SimulatedBoneIndices)
+		{
+			const int32 ParentIndex = State.ParentIndices[Index];
+
+			// Adjust by angle limit
+			AdjustByAngleLimit(State, Index, ParentIndex);
+
+			// Adjust by Planar Constraint
+			AdjustByPlanarConstraint(State, Index, ParentIndex, Params.PlanarConstraint);
+
+			// Restore Bone Length
+			const FVector& ParentLocation = State.Locations[ParentIndex];
+			const float BoneLength = (State.PoseLocations[Index] - State.PoseLocations[ParentIndex]).Size();
+			State.Locations[Index] = (State.Locations[Index] - ParentLocation).GetSafeNormal() * BoneLength +
+				ParentLocation;
+		}
+	}
+
+	void Step(FKawaiiPhysicsSolverState& State, TArray<int32>& SimulatedBoneIndices,
+	          const FKawaiiPhysicsPackedLimits& Limits, TConstArrayView<FModifyBoneConstraint> Constraints,
+	          TConstArrayView<int32> ConstraintColorStarts, const FKawaiiPhysicsSolverParams& Params,
+	          TConstArrayView<FVector> WindVelocities)
+	{
+		if (Params.DeltaTime <= 0.0f)
+		{
+			return;
+		}
+
+		PrepareStep(State, SimulatedBoneIndices);
+
+		const float Exponent = Params.GetExponent();
+		for (const int32 Index : SimulatedBoneIndices)
+		{
+			Integrate(State, Index, Params, WindVelocities.IsEmpty() ? nullptr : &WindVelocities[Index]);
+			PullToPose(State, Index, Exponent);
+		}
+
+		Limits.AdjustBones(State, SimulatedBoneIndices);
+		SolveBoneConstraints(State, Constraints, Params, ConstraintColorStarts);
+		FinishStep(State, SimulatedBoneIndices, Params);
+	}
+}
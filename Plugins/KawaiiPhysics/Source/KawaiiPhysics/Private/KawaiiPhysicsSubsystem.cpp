@@ -0,0 +1,268 @@
+// KawaiiPhysics : Copyright (c) 2019-2024 pafuhana1213, MIT License
+
+#include "KawaiiPhysicsSubsystem.h"
+
+#include "Async/ParallelFor.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_BatchedSimulation"), STAT_KawaiiPhysics_BatchedSimulation, STATGROUP_Anim);
+DECLARE_CYCLE_STAT(TEXT("KawaiiPhysics_AsyncWorldCollision"), STAT_KawaiiPhysics_AsyncWorldCollision, STATGROUP_Anim);
+
+static TAutoConsoleVariable<int32> CVarKawaiiPhysicsBatchedBonesPerChunk(
+	TEXT("a.AnimNode.KawaiiPhysics.Batched.BonesPerChunk"), 256,
+	TEXT("Number of bones KawaiiPhysics batched simulation puts into one ParallelFor work item"));
+
+static TAutoConsoleVariable<int32> CVarKawaiiPhysicsLODMaxSimulatedBonesPerFrame(
+	TEXT("a.AnimNode.KawaiiPhysics.LOD.MaxSimulatedBonesPerFrame"), 0,
+	TEXT("Maximum number of bones simulated per frame by KawaiiPhysics nodes with LOD enabled. 0 means unlimited"));
+
+void UKawaiiPhysicsSubsystem::SubmitJob(const TSharedRef<FKawaiiPhysicsBatchJob, ESPMode::ThreadSafe>& Job)
+{
+	check(Job->JobState == FKawaiiPhysicsBatchJob::EState::Pending);
+
+	// Already in the queue if it was cancelled and refilled before we got to it
+	if (Job->bQueued.exchange(true))
+	{
+		return;
+	}
+
+	FScopeLock Lock(&PendingJobsLock);
+	PendingJobs.Add(Job);
+}
+
+bool UKawaiiPhysicsSubsystem::TryReserveSimulatedBones(int32 NumBones, bool bForce)
+{
+	const int32 MaxBones = CVarKawaiiPhysicsLODMaxSimulatedBonesPerFrame.GetValueOnAnyThread();
+	if (MaxBones <= 0)
+	{
+		return true;
+	}
+
+	const uint32 Frame = static_cast<uint32>(GFrameCounter);
+	uint64 Budget = SimulatedBoneBudget.load();
+	for (;;)
+	{
+		const int32 UsedBones = static_cast<uint32>(Budget >> 32) == Frame ? static_cast<int32>(Budget & MAX_uint32) : 0;
+
+		// Always let the first node through, even if it alone is over the budget
+		if (!bForce && UsedBones > 0 && UsedBones + NumBones > MaxBones)
+		{
+			return false;
+		}
+
+		const uint64 NewBudget = static_cast<uint64>(Frame) << 32 | static_cast<uint32>(UsedBones + NumBones);
+		if (SimulatedBoneBudget.compare_exchange_weak(Budget, NewBudget))
+		{
+			return true;
+		}
+	}
+}
+
+void UKawaiiPhysicsSubsystem::SubmitWorldCollision(
+	const TSharedRef<FKawaiiPhysicsWorldCollisionBatch, ESPMode::ThreadSafe>& Batch)
+{
+	check(Batch->BatchState == FKawaiiPhysicsWorldCollisionBatch::EState::Submitted);
+
+	FScopeLock Lock(&PendingJobsLock);
+	PendingWorldCollisions.Add(Batch);
+}
+
+void UKawaiiPhysicsSubsystem::Deinitialize()
+{
+	{
+		FScopeLock Lock(&PendingJobsLock);
+		for (const auto& Job : PendingJobs)
+		{
+			Job->bQueued = false;
+		}
+		PendingJobs.Empty();
+		PendingWorldCollisions.Empty();
+	}
+	InFlightWorldCollisions.Empty();
+
+	Super::Deinitialize();
+}
+
+void UKawaiiPhysicsSubsystem::Tick(float DeltaTime)
+{
+	UpdateWorldCollisions();
+
+	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_BatchedSimulation);
+
+	TArray<TSharedRef<FKawaiiPhysicsBatchJob, ESPMode::ThreadSafe>> Jobs;
+	{
+		FScopeLock Lock(&PendingJobsLock);
+		Swap(Jobs, PendingJobs);
+	}
+
+	// Claim the jobs. The ones cancelled by their node in the meantime are dropped
+	Jobs.RemoveAll([](const TSharedRef<FKawaiiPhysicsBatchJob, ESPMode::ThreadSafe>& Job)
+	{
+		Job->bQueued = false;
+		auto Expected = FKawaiiPhysicsBatchJob::EState::Pending;
+		return !Job->JobState.compare_exchange_strong(Expected, FKawaiiPhysicsBatchJob::EState::Running);
+	});
+	if (Jobs.IsEmpty())
+	{
+		return;
+	}
+
+	// Split the jobs into work items of roughly the same number of bones
+	const int32 BonesPerChunk = FMath::Max(1, CVarKawaiiPhysicsBatchedBonesPerChunk.GetValueOnGameThread());
+	TArray<int32, TInlineAllocator<64>> ChunkStarts;
+	int32 ChunkBones = BonesPerChunk;
+	for (int32 i = 0; i < Jobs.Num(); ++i)
+	{
+		if (ChunkBones >= BonesPerChunk)
+		{
+			ChunkStarts.Add(i);
+			ChunkBones = 0;
+		}
+		ChunkBones += Jobs[i]->State.Num() * Jobs[i]->NumSubsteps;
+	}
+	ChunkStarts.Add(Jobs.Num());
+
+	ParallelFor(ChunkStarts.Num() - 1, [&Jobs, &ChunkStarts](int32 ChunkIndex)
+	{
+		for (int32 i = ChunkStarts[ChunkIndex]; i < ChunkStarts[ChunkIndex + 1]; ++i)
+		{
+			FKawaiiPhysicsBatchJob& Job = *Jobs[i];
+			const FKawaiiPhysicsChainTemplate* ChainTemplate = Job.ChainTemplate.Get();
+			const TConstArrayView<FModifyBoneConstraint> Constraints = ChainTemplate
+				                                                          ? ChainTemplate->BoneConstraints
+				                                                          : Job.Constraints;
+			const TConstArrayView<int32> ConstraintColorStarts = ChainTemplate
+				                                                     ? ChainTemplate->BoneConstraintColorStarts
+				                                                     : Job.ConstraintColorStarts;
+			for (int32 Substep = 0; Substep < Job.NumSubsteps; ++Substep)
+			{
+				KawaiiPhysicsSolver::Step(Job.State, Job.SimulatedBoneIndices, Job.Limits, Constraints,
+				                          ConstraintColorStarts, Job.Params, Job.WindVelocities);
+				Job.Params.DeltaTimeOld = Job.Params.DeltaTime;
+			}
+			Job.bHasResult = true;
+			Job.JobState = FKawaiiPhysicsBatchJob::EState::Idle;
+		}
+	});
+}
+
+void UKawaiiPhysicsSubsystem::UpdateWorldCollisions()
+{
+	SCOPE_CYCLE_COUNTER(STAT_KawaiiPhysics_AsyncWorldCollision);
+
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		return;
+	}
+
+	// Collect the results of the sweeps issued in previous frames
+	InFlightWorldCollisions.RemoveAll(
+		[World](const TSharedRef<FKawaiiPhysicsWorldCollisionBatch, ESPMode::ThreadSafe>& Batch)
+		{
+			const USkeletalMeshComponent* Component = Batch->Component.Get();
+			bool bFinished = true;
+			for (FKawaiiPhysicsWorldCollisionBatch::FSweep& Sweep : Batch->Sweeps)
+			{
+				if (!Sweep.Handle.IsValid())
+				{
+					continue;
+				}
+
+				FTraceDatum TraceDatum;
+				if (World->QueryTraceData(Sweep.Handle, TraceDatum))
+				{
+					for (const FHitResult& Hit : TraceDatum.OutHits)
+					{
+						if (Hit.bBlockingHit && !FAnimNode_KawaiiPhysics::ShouldIgnoreWorldCollisionHit(
+							Hit, Component, Sweep.BoneName, Batch->IgnoreBones, Batch->IgnoreBoneNamePrefix))
+						{
+							Sweep.Hit = Hit;
+							Sweep.bHit = true;
+							break;
+						}
+					}
+				}
+				else if (World->IsTraceHandleValid(Sweep.Handle, false))
+				{
+					bFinished = false;
+					continue;
+				}
+				// Done, or too old to be queried anymore
+				Sweep.Handle.Invalidate();
+			}
+
+			if (bFinished)
+			{
+				Batch->BatchState = FKawaiiPhysicsWorldCollisionBatch::EState::Ready;
+			}
+			return bFinished;
+		});
+
+	TArray<TSharedRef<FKawaiiPhysicsWorldCollisionBatch, ESPMode::ThreadSafe>> Batches;
+	{
+		FScopeLock Lock(&PendingJobsLock);
+		Swap(Batches, PendingWorldCollisions);
+	}
+
+	// Issue the sweeps of this frame
+	for (const auto& Batch : Batches)
+	{
+		bool bIssued = false;
+		if (const USkeletalMeshComponent* Component = Batch->Component.Get())
+		{
+			FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(KawaiiCollision));
+			if (Batch->bIgnoreSelfComponent)
+			{
+				QueryParams.AddIgnoredComponent(Component);
+			}
+
+			// Multi sweeps are needed to skip the hits on ignored bones of the owning component
+			const EAsyncTraceType TraceType = Batch->bIgnoreSelfComponent
+				                                  ? EAsyncTraceType::Single
+				                                  : EAsyncTraceType::Multi;
+
+			for (const FKawaiiPhysicsWorldCollisionBatch::FChain& Chain : Batch->Chains)
+			{
+				// Broadphase : skip the chains that are nowhere near the world
+				if (!World->OverlapBlockingTestByChannel(Chain.Bounds.GetCenter(), FQuat::Identity, Batch->TraceChannel,
+				                                         FCollisionShape::MakeBox(Chain.Bounds.GetExtent()),
+				                                         QueryParams, Batch->ResponseParams))
+				{
+					continue;
+				}
+
+				for (int32 i = Chain.FirstSweep; i < Chain.FirstSweep + Chain.NumSweeps; ++i)
+				{
+					FKawaiiPhysicsWorldCollisionBatch::FSweep& Sweep = Batch->Sweeps[i];
+					Sweep.Handle = World->AsyncSweepByChannel(TraceType, Sweep.Start, Sweep.End, FQuat::Identity,
+					                                          Batch->TraceChannel,
+					                                          FCollisionShape::MakeSphere(Sweep.Radius), QueryParams,
+					                                          Batch->ResponseParams);
+					bIssued = true;
+				}
+			}
+		}
+
+		if (bIssued)
+		{
+			Batch->BatchState = FKawaiiPhysicsWorldCollisionBatch::EState::InFlight;
+			InFlightWorldCollisions.Add(Batch);
+		}
+		else
+		{
+			Batch->BatchState = FKawaiiPhysicsWorldCollisionBatch::EState::Ready;
+		}
+	}
+}
+
+TStatId UKawaiiPhysicsSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UKawaiiPhysicsSubsystem, STATGROUP_Tickables);
+}
+
+bool UKawaiiPhysicsSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,113 @@
+// KawaiiPhysics : Copyright (c) 2019-2024 pafuhana1213, MIT License
+
+#include "KawaiiPhysicsTrace.h"
+
+#if KAWAIIPHYSICS_TRACE_ENABLED
+UE_TRACE_CHANNEL_DEFINE(KawaiiPhysicsChannel);
+
+UE_TRACE_EVENT_BEGIN(KawaiiPhysics, NodeEvaluation)
+	UE_TRACE_EVENT_FIELD(uint64, StartCycle)
+	UE_TRACE_EVENT_FIELD(uint64, EndCycle)
+	UE_TRACE_EVENT_FIELD(uint64, NodeId)
+	UE_TRACE_EVENT_FIELD(uint32, ThreadId)
+	UE_TRACE_EVENT_FIELD(int32, NumBones)
+	UE_TRACE_EVENT_FIELD(int32, NumSimulatedBones)
+	UE_TRACE_EVENT_FIELD(int32, NumSubsteps)
+	UE_TRACE_EVENT_FIELD(int32, NumLimits)
+	UE_TRACE_EVENT_FIELD(int32, NumBoneConstraints)
+	UE_TRACE_EVENT_FIELD(int32, NumBoneConstraintIterations)
+	UE_TRACE_EVENT_FIELD(int32, NumWorldSweeps)
+	UE_TRACE_EVENT_FIELD(int32, NumDormantChains)
+	UE_TRACE_EVENT_FIELD(uint8, LODTier)
+	UE_TRACE_EVENT_FIELD(uint8, bBatched)
+	UE_TRACE_EVENT_FIELD(uint64, SimulateCycles)
+	UE_TRACE_EVENT_FIELD(uint64, CollisionCycles)
+	UE_TRACE_EVENT_FIELD(uint64, BoneConstraintCycles)
+	UE_TRACE_EVENT_FIELD(uint64, ApplySimulateResultCycles)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, OwnerName)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, Tag)
+UE_TRACE_EVENT_END()
+#endif
+
+CSV_DEFINE_CATEGORY_MODULE(KAWAIIPHYSICS_API, KawaiiPhysics, true);
+
+bool KawaiiPhysicsTrace::IsRecording()
+{
+#if KAWAIIPHYSICS_TRACE_ENABLED
+	if (UE_TRACE_CHANNELEXPR_IS_ENABLED(KawaiiPhysicsChannel))
+	{
+		return true;
+	}
+#endif
+#if CSV_PROFILER
+	if (FCsvProfiler::Get()->IsCapturing())
+	{
+		return true;
+	}
+#endif
+	return false;
+}
+
+void KawaiiPhysicsTrace::OutputEvaluation(uint64 NodeId, FName OwnerName, FName Tag, uint64 StartCycle,
+                                          uint64 EndCycle, const FKawaiiPhysicsEvaluationStats& Stats)
+{
+#if KAWAIIPHYSICS_TRACE_ENABLED
+	if (UE_TRACE_CHANNELEXPR_IS_ENABLED(KawaiiPhysicsChannel))
+	{
+		const FString OwnerString = OwnerName.ToString();
+		const FString TagString = Tag.ToString();
+		UE_TRACE_LOG(KawaiiPhysics, NodeEvaluation, KawaiiPhysicsChannel)
+			<< NodeEvaluation.StartCycle(StartCycle)
+			<< NodeEvaluation.EndCycle(EndCycle)
+			<< NodeEvaluation.NodeId(NodeId)
+			<< NodeEvaluation.ThreadId(FPlatformTLS::GetCurrentThreadId())
+			<< NodeEvaluation.NumBones(Stats.NumBones)
+			<< NodeEvaluation.NumSimulatedBones(Stats.NumSimulatedBones)
+			<< NodeEvaluation.NumSubsteps(Stats.NumSubsteps)
+			<< NodeEvaluation.NumLimits(Stats.NumLimits)
+			<< NodeEvaluation.NumBoneConstraints(Stats.NumBoneConstraints)
+			<< NodeEvaluation.NumBoneConstraintIterations(Stats.NumBoneConstraintIterations)
+			<< NodeEvaluation.NumWorldSweeps(Stats.NumWorldSweeps)
+			<< NodeEvaluation.NumDormantChains(Stats.NumDormantChains)
+			<< NodeEvaluation.LODTier(Stats.LODTier)
+			<< NodeEvaluation.bBatched(Stats.bBatched ? 1 : 0)
+			<< NodeEvaluation.SimulateCycles(Stats.SimulateCycles)
+			<< NodeEvaluation.CollisionCycles(Stats.CollisionCycles)
+			<< NodeEvaluation.BoneConstraintCycles(Stats.BoneConstraintCycles)
+			<< NodeEvaluation.ApplySimulateResultCycles(Stats.ApplySimulateResultCycles)
+			<< NodeEvaluation.OwnerName(*OwnerString, OwnerString.Len())
+			<< NodeEvaluation.Tag(*TagString, TagString.Len());
+	}
+#endif
+
+#if CSV_PROFILER
+	if (FCsvProfiler::Get()->IsCapturing())
+	{
+		const float Milliseconds = static_cast<float>(FPlatformTime::ToMilliseconds64(EndCycle - StartCycle));
+		CSV_CUSTOM_STAT(KawaiiPhysics, TotalMs, Milliseconds, ECsvCustomStatOp::Accumulate);
+		CSV_CUSTOM_STAT(KawaiiPhysics, NumNodes, 1, ECsvCustomStatOp::Accumulate);
+		CSV_CUSTOM_STAT(KawaiiPhysics, NumSimulatedBones, Stats.NumSimulatedBones, ECsvCustomStatOp::Accumulate);
+		CSV_CUSTOM_STAT(KawaiiPhysics, NumWorldSweeps, Stats.NumWorldSweeps, ECsvCustomStatOp::Accumulate);
+		CSV_CUSTOM_STAT(KawaiiPhysics, NumDormantChains, Stats.NumDormantChains, ECsvCustomStatOp::Accumulate);
+		CSV_CUSTOM_STAT(KawaiiPhysics, SimulateMs,
+		                static_cast<float>(FPlatformTime::ToMilliseconds64(Stats.SimulateCycles)),
+		                ECsvCustomStatOp::Accumulate);
+		CSV_CUSTOM_STAT(KawaiiPhysics, CollisionMs,
+		                static_cast<float>(FPlatformTime::ToMilliseconds64(Stats.CollisionCycles)),
+		                ECsvCustomStatOp::Accumulate);
+		CSV_CUSTOM_STAT(KawaiiPhysics, BoneConstraintMs,
+		                static_cast<float>(FPlatformTime::ToMilliseconds64(Stats.BoneConstraintCycles)),
+		                ECsvCustomStatOp::Accumulate);
+		CSV_CUSTOM_STAT(KawaiiPhysics, ApplySimulateResultMs,
+		                static_cast<float>(FPlatformTime::ToMilliseconds64(Stats.ApplySimulateResultCycles)),
+		                ECsvCustomStatOp::Accumulate);
+
+		// Time per character type, so that the cost of each one can be tracked across builds
+		if (!OwnerName.IsNone())
+		{
+			FCsvProfiler::RecordCustomStat(OwnerName, CSV_CATEGORY_INDEX(KawaiiPhysics), Milliseconds,
+			                               ECsvCustomStatOp::Accumulate);
+		}
+	}
+#endif
+}
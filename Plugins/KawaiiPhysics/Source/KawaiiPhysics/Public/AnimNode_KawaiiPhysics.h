@@ -6,6 +6,8 @@
 #include "BoneContainer.h"
 #include "BonePose.h"
 #include "GameplayTagContainer.h"
+#include "KawaiiPhysicsTrace.h"
+#include "UObject/ObjectKey.h"
 
 #include "BoneControllers/AnimNode_AnimDynamics.h"
 #include "BoneControllers/AnimNode_SkeletalControlBase.h"
@@ -21,6 +23,18 @@
 class UKawaiiPhysics_CustomExternalForce;
 class UKawaiiPhysicsLimitsDataAsset;
 class UKawaiiPhysicsBoneConstraintsDataAsset;
+class UKawaiiPhysicsRestStateDataAsset;
+class UKawaiiPhysicsBakedMotionDataAsset;
+struct FKawaiiPhysicsBakedMotionClip;
+class UKawaiiPhysicsDistanceFieldDataAsset;
+struct FKawaiiPhysicsDistanceField;
+struct FKawaiiPhysicsRestStateSnapshot;
+class UKawaiiPhysicsSubsystem;
+class UKawaiiPhysicsSharedContextComponent;
+struct FKawaiiPhysicsBatchJob;
+struct FKawaiiPhysicsWorldCollisionBatch;
+struct FKawaiiPhysicsSolverParams;
+class FKawaiiPhysicsCaptureWriter;
 
 #if ENABLE_ANIM_DEBUG
 extern KAWAIIPHYSICS_API TAutoConsoleVariable<bool> CVarAnimNodeKawaiiPhysicsEnable;
@@ -282,6 +296,28 @@ struct FPlanarLimit : public FCollisionLimitBase
 	}
 };
 
+/**
+ * Structure representing a signed distance field limit for collision in KawaiiPhysics.
+ * Bones are pushed out along the gradient of a field baked around a body region.
+ */
+USTRUCT(BlueprintType)
+struct FDistanceFieldLimit : public FCollisionLimitBase
+{
+	GENERATED_BODY()
+
+	/** The baked distance field. DrivingBone should be the bone it was baked for */
+	UPROPERTY(EditAnywhere, Category = DistanceFieldLimit)
+	TObjectPtr<UKawaiiPhysicsDistanceFieldDataAsset> DistanceField = nullptr;
+
+	/** Assignment operator */
+	FDistanceFieldLimit& operator=(const FDistanceFieldLimit& Other)
+	{
+		FCollisionLimitBase::operator=(Other);
+		DistanceField = Other.DistanceField;
+		return *this;
+	}
+};
+
 /**
  * Structure representing the root bone settings for KawaiiPhysics.
  */
@@ -358,6 +394,204 @@ struct KAWAIIPHYSICS_API FKawaiiPhysicsSettings
 	*/
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0"), category = "KawaiiPhysics")
 	float LimitAngle = 0.0f;
+
+	bool Equals(const FKawaiiPhysicsSettings& Other) const
+	{
+		return Damping == Other.Damping && Stiffness == Other.Stiffness &&
+			WorldDampingLocation == Other.WorldDampingLocation && WorldDampingRotation == Other.WorldDampingRotation &&
+			Radius == Other.Radius && LimitAngle == Other.LimitAngle;
+	}
+};
+
+/**
+ * Enum representing the value that drives the simulation LOD of KawaiiPhysics.
+ */
+UENUM()
+enum class EKawaiiPhysicsLODMetric : uint8
+{
+	/** Distance from the closest view to the bounds of the skeletal mesh component */
+	Distance,
+	/** Approximate screen size of the bounds of the skeletal mesh component */
+	ScreenSize,
+};
+
+/**
+ * Enum representing the simulation LOD tier of KawaiiPhysics.
+ */
+UENUM()
+enum class EKawaiiPhysicsLODTier : uint8
+{
+	/** Simulate every frame with all features */
+	Full,
+	/** Fewer bone constraint iterations and no world collision */
+	Reduced,
+	/** Same as Reduced, simulated at a lower rate and interpolated in between */
+	Low,
+	/** Not simulated. The animated pose is used as is */
+	Frozen,
+};
+
+/**
+ * Enum representing the precision of the locations of a compacted KawaiiPhysics solver state.
+ */
+UENUM()
+enum class EKawaiiPhysicsCompactPrecision : uint8
+{
+	/** Single precision offsets from the root of each chain */
+	Float,
+	/** 16-bit offsets from the root of each chain, scaled to the longest offset */
+	Quantized16,
+};
+
+/**
+ * Structure representing the significance based simulation LOD settings for KawaiiPhysics.
+ */
+USTRUCT(BlueprintType)
+struct KAWAIIPHYSICS_API FKawaiiPhysicsLODSettings
+{
+	GENERATED_BODY()
+
+	/** 
+	* 距離・画面サイズに応じてシミュレーションの品質を下げる
+	* Lower the quality of the simulation depending on the distance or screen size
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LOD")
+	bool bEnable = false;
+
+	/** 
+	* LODの判定に使用する値
+	* Value used to choose the LOD tier
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LOD", meta = (EditCondition = "bEnable"))
+	EKawaiiPhysicsLODMetric Metric = EKawaiiPhysicsLODMetric::Distance;
+
+	/** 
+	* Reduced・Low・Frozenに切り替わる閾値。Distanceでは距離(cm)、ScreenSizeでは画面サイズ（大きい順）
+	* Thresholds to switch to Reduced, Low and Frozen. Distance in cm for Distance, screen size (descending) for ScreenSize
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LOD", meta = (EditCondition = "bEnable"))
+	float ReducedThreshold = 1500.0f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LOD", meta = (EditCondition = "bEnable"))
+	float LowThreshold = 3000.0f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LOD", meta = (EditCondition = "bEnable"))
+	float FrozenThreshold = 6000.0f;
+
+	/** 
+	* 閾値付近でLODが頻繁に切り替わらないようにするための割合
+	* Ratio of the thresholds used to avoid switching back and forth around them
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LOD",
+		meta = (EditCondition = "bEnable", ClampMin = "0", ClampMax = "1"))
+	float Hysteresis = 0.1f;
+
+	/** 
+	* Reduced以下でのBoneConstraintの最大反復回数
+	* Maximum bone constraint iteration count at Reduced and below
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LOD", meta = (EditCondition = "bEnable", ClampMin = "0"))
+	int32 ReducedBoneConstraintIterationCount = 1;
+
+	/** 
+	* Lowでは指定フレームごとにシミュレーションし、間を補間
+	* At Low, simulate once every this many frames and interpolate in between
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LOD", meta = (EditCondition = "bEnable", ClampMin = "1"))
+	int32 LowSimulationInterval = 3;
+
+	/** 
+	* Frozenの間、シミュレーション状態をルートからの相対位置に圧縮して保持し、解除時にそこから再開する
+	* While Frozen, keep the simulation state compacted as offsets from the roots and resume from it when unfrozen
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LOD", meta = (EditCondition = "bEnable"))
+	bool bCompactFrozenState = false;
+
+	/** 
+	* 圧縮した位置の精度
+	* Precision of the compacted locations
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LOD",
+		meta = (EditCondition = "bEnable && bCompactFrozenState"))
+	EKawaiiPhysicsCompactPrecision CompactPrecision = EKawaiiPhysicsCompactPrecision::Quantized16;
+
+	/** 
+	* Frozenの間、シミュレーションの代わりに再生するベイク済みの揺れ。現在のポーズに一致するフレームを再生
+	* Baked motion played instead of the simulation while Frozen. The frame matching the current pose is played
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LOD", meta = (EditCondition = "bEnable"))
+	TObjectPtr<UKawaiiPhysicsBakedMotionDataAsset> FrozenBakedMotion;
+
+	/** 
+	* シミュレーションからベイク済みの揺れへのブレンド時間（秒）
+	* Time in seconds to blend from the simulation to the baked motion
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LOD",
+		meta = (EditCondition = "bEnable && FrozenBakedMotion != nullptr", ClampMin = "0"))
+	float BakedMotionBlendTime = 0.25f;
+
+	/**
+	 * Gets the threshold to enter the given tier.
+	 *
+	 * @param Tier The tier. Must not be Full.
+	 * @return The threshold.
+	 */
+	float GetThreshold(EKawaiiPhysicsLODTier Tier) const
+	{
+		switch (Tier)
+		{
+		case EKawaiiPhysicsLODTier::Reduced:
+			return ReducedThreshold;
+		case EKawaiiPhysicsLODTier::Low:
+			return LowThreshold;
+		default:
+			return FrozenThreshold;
+		}
+	}
+};
+
+/**
+ * Structure representing the settings of the chains going dormant once they have settled.
+ */
+USTRUCT(BlueprintType)
+struct KAWAIIPHYSICS_API FKawaiiPhysicsSleepSettings
+{
+	GENERATED_BODY()
+
+	/** 
+	* 落ち着いたチェーンのシミュレーションを停止
+	* Stop simulating the chains that have settled
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sleep")
+	bool bEnable = false;
+
+	/** 
+	* 落ち着いたと判定する速度(cm/s)
+	* Speed (cm/s) below which a bone is at rest
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sleep", meta = (EditCondition = "bEnable", ClampMin = "0"))
+	float VelocityThreshold = 1.0f;
+
+	/** 
+	* 落ち着いたと判定する、1ステップあたりのポーズの移動量(cm)
+	* Movement (cm) of the pose per step below which a bone is at rest
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sleep", meta = (EditCondition = "bEnable", ClampMin = "0"))
+	float PoseThreshold = 0.1f;
+
+	/** 
+	* 停止するまでに落ち着いている必要があるステップ数
+	* Number of steps a chain must be at rest before it goes dormant
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sleep", meta = (EditCondition = "bEnable", ClampMin = "1"))
+	int32 StepsToSleep = 30;
+
+	/** 
+	* 停止中のチェーンを起こすSkeletalMeshComponentの移動量(cm)・回転量(度)
+	* Movement (cm) and rotation (degrees) of the SkeletalMeshComponent that wake the dormant chains
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sleep", meta = (EditCondition = "bEnable", ClampMin = "0"))
+	float WakeMoveThreshold = 0.5f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sleep", meta = (EditCondition = "bEnable", ClampMin = "0"))
+	float WakeRotationThreshold = 0.5f;
 };
 
 /**
@@ -482,6 +716,36 @@ enum class EXPBDComplianceType : uint8
 	Fat UMETA(DisplayName = "Fat"),
 };
 
+/**
+ * Enum representing how the bone constraints are solved in KawaiiPhysics.
+ */
+UENUM()
+enum class EKawaiiPhysicsBoneConstraintSolver : uint8
+{
+	/** Solve the constraints one by one in order */
+	GaussSeidel,
+	/** Color the constraints so that no two of a color share a bone, and solve each color in parallel */
+	GraphColored,
+	/** Solve all constraints from the same locations and average the corrections. For very large webs */
+	Jacobi,
+};
+
+/**
+ * Convergence of the bone constraints in the last step, for debugging.
+ */
+struct KAWAIIPHYSICS_API FKawaiiPhysicsBoneConstraintMetrics
+{
+	/** RMS of the length error of the constraints before and after the iterations */
+	float InitialRMSError = 0.0f;
+	float FinalRMSError = 0.0f;
+
+	/** Largest length error after the iterations */
+	float FinalMaxError = 0.0f;
+
+	/** Number of colors, 0 if the constraints are not colored */
+	int32 NumColors = 0;
+};
+
 /**
  * Structure representing a constraint between two bones for the KawaiiPhysics system.
  */
@@ -526,10 +790,6 @@ struct FModifyBoneConstraint
 	UPROPERTY()
 	bool bIsDummy = false;
 
-	/** Lambda value for the constraint */
-	UPROPERTY()
-	float Lambda = 0.0f;
-
 	/** Equality operator to compare two constraints */
 	FORCEINLINE bool operator ==(const FModifyBoneConstraint& Other) const
 	{
@@ -557,6 +817,371 @@ struct FModifyBoneConstraint
 	}
 };
 
+/**
+ * Packed solver state of the modify bones (structure of arrays).
+ * Indices match FAnimNode_KawaiiPhysics::ModifyBones, which are parent-sorted (a parent always precedes its children),
+ * so every pass over the bones can walk these arrays linearly.
+ */
+struct KAWAIIPHYSICS_API FKawaiiPhysicsSolverState
+{
+	/** Current location of each bone */
+	TArray<FVector> Locations;
+
+	/** Previous location of each bone */
+	TArray<FVector> PrevLocations;
+
+	/** Pose location of each bone */
+	TArray<FVector> PoseLocations;
+
+	/** Pose rotation of each bone */
+	TArray<FQuat> PoseRotations;
+
+	/** Pose scale of each bone */
+	TArray<FVector> PoseScales;
+
+	/** Previous (simulated) rotation of each bone */
+	TArray<FQuat> PrevRotations;
+
+	/** Index of the parent bone, or INDEX_NONE for root bones */
+	TArray<int32> ParentIndices;
+
+	/** Collision radius of each bone */
+	TArray<float> Radii;
+
+	/** Damping of each bone */
+	TArray<float> Dampings;
+
+	/** Stiffness of each bone */
+	TArray<float> Stiffnesses;
+
+	/** WorldDampingLocation of each bone */
+	TArray<float> WorldDampingLocations;
+
+	/** WorldDampingRotation of each bone */
+	TArray<float> WorldDampingRotations;
+
+	/** LimitAngle of each bone */
+	TArray<float> LimitAngles;
+
+	/** Whether each bone is a dummy bone */
+	TArray<bool> bDummies;
+
+	/** Whether each bone references a valid skeleton bone */
+	TArray<bool> bHasBones;
+
+	/** Whether simulation is skipped for each bone in the current frame */
+	TArray<bool> bSkipSimulates;
+
+	/**
+	 * Whether each bone belongs to a dormant sleep chain in the current step, or empty if none does.
+	 * Bone constraints clear the flag of the dormant bones they move. See KawaiiPhysicsSolver::MarkDormantBones.
+	 */
+	TArray<bool> bDormants;
+
+	/** XPBD lambda of each bone constraint, so that the constraints themselves stay immutable (and shareable) */
+	TArray<float> BoneConstraintLambdas;
+
+	/** Scratch arrays of the Jacobi bone constraint solver, kept to avoid allocating every step */
+	TArray<FVector> BoneConstraintCorrections;
+	TArray<int32> BoneConstraintCorrectionCounts;
+
+	int32 Num() const { return Locations.Num(); }
+
+	/** Clears all arrays */
+	void Reset();
+
+	/** Rebuilds every array from the given modify bones, which must be parent-sorted */
+	void Build(const TArray<FKawaiiPhysicsModifyBone>& ModifyBones);
+
+	/** Copies the per-bone physics settings of the given modify bone */
+	void SetPhysicsSettings(int32 Index, const FKawaiiPhysicsSettings& Settings);
+
+	/** Writes the state of a single bone to its Blueprint-facing view */
+	void WriteToModifyBone(int32 Index, FKawaiiPhysicsModifyBone& ModifyBone) const;
+};
+
+/**
+ * Compacted copy of the simulated part of a FKawaiiPhysicsSolverState, kept instead of it while a node is frozen.
+ * Locations are stored as offsets from the pose location of the root of their chain, so that the chain can resume
+ * wherever the character moved to, and rotations as the three smallest components of the quaternion.
+ * Per bone, that is 16 bytes with Quantized16 and 28 bytes with Float, instead of 80.
+ */
+struct KAWAIIPHYSICS_API FKawaiiPhysicsCompactSolverState
+{
+	struct FQuantizedOffset
+	{
+		int16 X;
+		int16 Y;
+		int16 Z;
+	};
+
+	/** Offsets of the locations, then of the previous locations, with Float */
+	TArray<FVector3f> Offsets;
+
+	/** Offsets of the locations, then of the previous locations, with Quantized16 */
+	TArray<FQuantizedOffset> QuantizedOffsets;
+
+	/** Length of one step of QuantizedOffsets */
+	float QuantizationStep = 0.0f;
+
+	/** Previous rotation of each bone. Index of the largest component in the lowest 2 bits, then 10 bits per other */
+	TArray<uint32> PrevRotations;
+
+	bool IsPacked() const { return PrevRotations.Num() > 0; }
+	int32 Num() const { return PrevRotations.Num(); }
+
+	/**
+	 * Compacts the locations and rotations of the state and frees them. The pose and settings are kept.
+	 *
+	 * @param State The state to compact. Must not be empty.
+	 * @param Precision The precision of the locations.
+	 */
+	void Pack(FKawaiiPhysicsSolverState& State, EKawaiiPhysicsCompactPrecision Precision);
+
+	/**
+	 * Restores the locations and rotations of the state relative to its current pose, and frees the compacted copy.
+	 *
+	 * @param State The state the copy was packed from, with the same bones.
+	 */
+	void Unpack(FKawaiiPhysicsSolverState& State);
+
+	/** Frees the compacted copy */
+	void Reset();
+};
+
+/**
+ * Collision limits of a node packed into one array per shape.
+ * The AnimNode limits come first and the DataAsset/PhysicsAsset limits follow, which is the order the limits were
+ * applied in when they were stored in separate arrays. Limits that would never push a bone (disabled or zero sized)
+ * are dropped while packing.
+ * Each sphere, capsule and box also keeps its bounds for the broadphase of AdjustBones.
+ */
+struct KAWAIIPHYSICS_API FKawaiiPhysicsPackedLimits
+{
+	struct FPackedSphere
+	{
+		FVector Location;
+		float Radius;
+		bool bInner;
+		FBox Bounds;
+	};
+
+	struct FPackedCapsule
+	{
+		FVector StartPoint;
+		FVector EndPoint;
+		float Radius;
+		FBox Bounds;
+	};
+
+	struct FPackedBox
+	{
+		FTransform Transform;
+		FVector Extent;
+		/** Radius of the sphere enclosing the box, used for early rejection */
+		double BoundingRadius;
+		FBox Bounds;
+	};
+
+	struct FPackedPlanar
+	{
+		FPlane Plane;
+		FVector UpVector;
+	};
+
+	struct FPackedDistanceField
+	{
+		FTransform Transform;
+		/** Owned by the data asset of the limit, which the node keeps alive */
+		const FKawaiiPhysicsDistanceField* Field;
+		/** Bounds of the field in component space */
+		FBox Bounds;
+	};
+
+	TArray<FPackedSphere> Spheres;
+	TArray<FPackedCapsule> Capsules;
+	TArray<FPackedBox> Boxes;
+	TArray<FPackedDistanceField> DistanceFields;
+	TArray<FPackedPlanar> Planars;
+
+	bool IsEmpty() const
+	{
+		return Spheres.IsEmpty() && Capsules.IsEmpty() && Boxes.IsEmpty() && DistanceFields.IsEmpty() &&
+			Planars.IsEmpty();
+	}
+
+	int32 Num() const
+	{
+		return Spheres.Num() + Capsules.Num() + Boxes.Num() + DistanceFields.Num() + Planars.Num();
+	}
+
+	/** Rebuilds the packed arrays from the current (already updated) limits of a node */
+	void Build(const TArray<FSphericalLimit>& SphericalLimits, const TArray<FSphericalLimit>& SphericalLimitsData,
+	           const TArray<FCapsuleLimit>& CapsuleLimits, const TArray<FCapsuleLimit>& CapsuleLimitsData,
+	           const TArray<FBoxLimit>& BoxLimits, const TArray<FBoxLimit>& BoxLimitsData,
+	           const TArray<FPlanarLimit>& PlanarLimits, const TArray<FPlanarLimit>& PlanarLimitsData,
+	           const TArray<FDistanceFieldLimit>& DistanceFieldLimits);
+
+	/**
+	 * Appends the limits of another node after the ones of each shape. Radii are not scaled.
+	 *
+	 * @param Other The packed limits of the other node.
+	 * @param OtherToThis Transform from the component space of the other node to the one of this node.
+	 */
+	void AppendTransformed(const FKawaiiPhysicsPackedLimits& Other, const FTransform& OtherToThis);
+
+	/**
+	 * Pushes the given bones out of every limit (spheres, capsules, boxes, distance fields, then planes).
+	 * A broadphase first culls, for each group of neighbouring bones, the limits that none of them can reach.
+	 * The remaining bones are tested several at a time with vector instructions and only the ones that may touch a
+	 * limit go through the exact scalar resolution, so the result is the same as AdjustBonesScalar.
+	 *
+	 * @param SolverState The solver state whose locations are adjusted.
+	 * @param BoneIndices The bones to adjust.
+	 */
+	void AdjustBones(FKawaiiPhysicsSolverState& SolverState, TConstArrayView<int32> BoneIndices) const;
+
+	/**
+	 * Scalar reference version of AdjustBones.
+	 *
+	 * @param SolverState The solver state whose locations are adjusted.
+	 * @param BoneIndices The bones to adjust.
+	 */
+	void AdjustBonesScalar(FKawaiiPhysicsSolverState& SolverState, TConstArrayView<int32> BoneIndices) const;
+};
+
+/**
+ * Everything that decides the chains a FAnimNode_KawaiiPhysics builds, so that nodes with the same setup can share them.
+ */
+struct KAWAIIPHYSICS_API FKawaiiPhysicsChainTemplateKey
+{
+	/** Skeletal mesh (or skeleton if there is none) the reference pose comes from */
+	FObjectKey PoseAsset;
+
+	FObjectKey BoneConstraintsDataAsset;
+
+	/** Bones required by the current LOD. Only these can be simulated */
+	TArray<FBoneIndexType> RequiredBones;
+
+	/** Each root bone followed by its exclude bones, then the bone pairs of BoneConstraints. Separated by NAME_None */
+	TArray<FName> BoneNames;
+
+	float DummyBoneLength = 0.0f;
+	EBoneForwardAxis BoneForwardAxis = EBoneForwardAxis::X_Positive;
+	EKawaiiPhysicsBoneConstraintSolver BoneConstraintSolver = EKawaiiPhysicsBoneConstraintSolver::GaussSeidel;
+	bool bAutoAddChildDummyBoneConstraint = false;
+
+#if WITH_EDITOR
+	/** Revisions of the data assets of the node, so that a template is not reused after they were edited (e.g. in PIE) */
+	uint32 BoneConstraintsDataAssetRevision = 0;
+	uint32 LimitsDataAssetRevision = 0;
+	uint32 PhysicsAssetRevision = 0;
+#endif
+
+	bool operator==(const FKawaiiPhysicsChainTemplateKey& Other) const
+	{
+#if WITH_EDITOR
+		if (BoneConstraintsDataAssetRevision != Other.BoneConstraintsDataAssetRevision ||
+			LimitsDataAssetRevision != Other.LimitsDataAssetRevision ||
+			PhysicsAssetRevision != Other.PhysicsAssetRevision)
+		{
+			return false;
+		}
+#endif
+		return PoseAsset == Other.PoseAsset && BoneConstraintsDataAsset == Other.BoneConstraintsDataAsset &&
+			DummyBoneLength == Other.DummyBoneLength && BoneForwardAxis == Other.BoneForwardAxis &&
+			BoneConstraintSolver == Other.BoneConstraintSolver &&
+			bAutoAddChildDummyBoneConstraint == Other.bAutoAddChildDummyBoneConstraint &&
+			RequiredBones == Other.RequiredBones && BoneNames == Other.BoneNames;
+	}
+
+	friend uint32 GetTypeHash(const FKawaiiPhysicsChainTemplateKey& Key)
+	{
+		uint32 Hash = HashCombine(GetTypeHash(Key.PoseAsset), GetTypeHash(Key.BoneConstraintsDataAsset));
+#if WITH_EDITOR
+		Hash = HashCombine(Hash, GetTypeHash(Key.BoneConstraintsDataAssetRevision));
+		Hash = HashCombine(Hash, GetTypeHash(Key.LimitsDataAssetRevision));
+		Hash = HashCombine(Hash, GetTypeHash(Key.PhysicsAssetRevision));
+#endif
+		Hash = HashCombine(Hash, GetTypeHash(Key.RequiredBones.Num()));
+		for (const FName& BoneName : Key.BoneNames)
+		{
+			Hash = HashCombine(Hash, GetTypeHash(BoneName));
+		}
+		return HashCombine(Hash, GetTypeHash(Key.DummyBoneLength));
+	}
+};
+
+/**
+ * Immutable topology and rest data of the chains of a FAnimNode_KawaiiPhysics.
+ * Built once per FKawaiiPhysicsChainTemplateKey and shared by every node with that key (e.g. a crowd using the same
+ * anim blueprint), so that only the simulation state is per instance. The rest data comes from the reference pose.
+ */
+struct KAWAIIPHYSICS_API FKawaiiPhysicsChainTemplate
+{
+	/** Modify bones in the reference pose. Parent-sorted */
+	TArray<FKawaiiPhysicsModifyBone> ModifyBones;
+
+	/** Index of the first modify bone with each bone name */
+	TMap<FName, int32> ModifyBoneIndexMap;
+
+	/** Merged bone constraints, with the lengths of the reference pose */
+	TArray<FModifyBoneConstraint> BoneConstraints;
+
+	/** Start of each color in BoneConstraints, plus the end. Empty if the constraints are not colored */
+	TArray<int32> BoneConstraintColorStarts;
+
+	/**
+	 * Finds the template of a key, or builds it if no node holds one right now.
+	 * Templates are released with the last node that uses them.
+	 *
+	 * @param Key The setup of the node.
+	 * @param Build Fills a new template. Called at most once per key while the template is alive.
+	 * @return The shared template.
+	 */
+	static TSharedRef<const FKawaiiPhysicsChainTemplate, ESPMode::ThreadSafe> FindOrBuild(
+		const FKawaiiPhysicsChainTemplateKey& Key, TFunctionRef<void(FKawaiiPhysicsChainTemplate&)> Build);
+};
+
+#if WITH_EDITORONLY_DATA
+/**
+ * Asset and revision a FAnimNode_KawaiiPhysics last applied its limits or bone constraints from, so that the editor
+ * only applies them again when they changed.
+ */
+struct FKawaiiPhysicsAppliedAsset
+{
+	FObjectKey Asset;
+	uint32 Revision = 0;
+	uint16 BoneContainerSerial = 0;
+	bool bApplied = false;
+
+	/**
+	 * Checks if the asset has to be applied, and records it as applied.
+	 *
+	 * @param InAsset The asset set on the node. May be null.
+	 * @param InRevision The current revision of the asset.
+	 * @param RequiredBones The bone container the asset is applied for.
+	 * @return True if the asset, its revision or the bone container changed since it was last applied.
+	 */
+	bool Update(const UObject* InAsset, uint32 InRevision, const FBoneContainer& RequiredBones)
+	{
+		const FObjectKey NewAsset(InAsset);
+		if (bApplied && Asset == NewAsset && Revision == InRevision &&
+			BoneContainerSerial == RequiredBones.GetSerialNumber())
+		{
+			return false;
+		}
+		Asset = NewAsset;
+		Revision = InRevision;
+		BoneContainerSerial = RequiredBones.GetSerialNumber();
+		bApplied = true;
+		return true;
+	}
+
+	void Invalidate() { bApplied = false; }
+};
+#endif
+
 USTRUCT(BlueprintType)
 struct KAWAIIPHYSICS_API FAnimNode_KawaiiPhysics : public FAnimNode_SkeletalControlBase
 {
@@ -615,10 +1240,26 @@ struct KAWAIIPHYSICS_API FAnimNode_KawaiiPhysics : public FAnimNode_SkeletalCont
 	bool OverrideTargetFramerate = false;
 
 	/** 
-	* 物理の空回し回数。物理処理が落ち着いてから開始・表示したい際に使用
-	* Number of times physics has been idle. Used when you want to start/display after physics processing has settled down
+	* 固定タイムステップでシミュレーション。指定したレートでサブステップし、表示は直近2ステップの間を補間
+	* Simulate with a fixed timestep. Substeps at the specified rate and interpolates the result between the last two steps
 	*/
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Physics Settings",
+	UPROPERTY(EditAnywhere, Category = "Physics Settings", meta = (EditCondition = "bUseFixedTimestep", ClampMin = "1"))
+	float FixedTimestepRate = 60.0f;
+	UPROPERTY(EditAnywhere, Category = "Physics Settings", meta = (InlineEditConditionToggle))
+	bool bUseFixedTimestep = false;
+
+	/** 
+	* 1フレームあたりの最大サブステップ数。追いつけない分の時間は切り捨て
+	* Maximum number of substeps per frame. Time that cannot be caught up with is dropped
+	*/
+	UPROPERTY(EditAnywhere, Category = "Physics Settings", meta = (EditCondition = "bUseFixedTimestep", ClampMin = "1"))
+	int32 MaxSubsteps = 4;
+
+	/** 
+	* 物理の空回し回数。物理処理が落ち着いてから開始・表示したい際に使用
+	* Number of times physics has been idle. Used when you want to start/display after physics processing has settled down
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Physics Settings",
 		meta = (PinHiddenByDefault, EditCondition="bNeedWarmUp", ClampMin = "0"))
 	int32 WarmUpFrames = 0;
 	/** 
@@ -633,6 +1274,21 @@ struct KAWAIIPHYSICS_API FAnimNode_KawaiiPhysics : public FAnimNode_SkeletalCont
 		meta = (PinHiddenByDefault, InlineEditConditionToggle))
 	bool bNeedWarmUp = false;
 
+	/** 
+	* 1フレームあたりの空回し回数。0の場合は初回に全て実行。空回し中はアニメーションのポーズを表示
+	* Number of warm up frames run per evaluation. 0 runs them all at once. The animated pose is shown while warming up
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Physics Settings",
+		meta = (PinHiddenByDefault, EditCondition="bNeedWarmUp", ClampMin = "0"))
+	int32 WarmUpFramesPerEvaluation = 0;
+
+	/** 
+	* 落ち着いた状態のスナップショット。一致するものがあれば空回しの代わりに復元
+	* Snapshots of the settled state. If one matches the skeleton and pose, it is restored instead of warming up
+	*/
+	UPROPERTY(EditAnywhere, Category = "Physics Settings", meta = (EditCondition="bNeedWarmUp"))
+	TObjectPtr<UKawaiiPhysicsRestStateDataAsset> RestStateDataAsset;
+
 	/** 
 	* 1フレームにおけるSkeletalMeshComponentの移動量が設定値を超えた場合、その移動量を物理制御に反映しない
 	* If the amount of movement of a SkeletalMeshComponent in one frame exceeds the set value, that amount of movement will not be reflected in the physics control.
@@ -655,10 +1311,10 @@ struct KAWAIIPHYSICS_API FAnimNode_KawaiiPhysics : public FAnimNode_SkeletalCont
 	EPlanarConstraint PlanarConstraint = EPlanarConstraint::None;
 
 	/** 
- 	* 各ボーンの物理パラメータを毎フレーム更新するフラグ。
- 	* 無効にするとパフォーマンスが僅かに改善するが、実行中に物理パラメータを変更することが不可能に
-	* Flag to update the physics parameters of each bone every frame.
-	* Disabling this will slightly improve performance, but it will make it impossible to change physics parameters during execution.
+ 	* 実行中に物理パラメータの変更を各ボーンに反映するフラグ。PhysicsSettingsが変わった時のみ再計算。
+ 	* カーブを実行中に変更した場合はMarkPhysicsSettingsDirtyを呼ぶこと
+	* Flag to apply changes of the physics parameters to each bone during execution. They are only recalculated when
+	* PhysicsSettings changes. Call MarkPhysicsSettingsDirty after changing the curves during execution.
 	*/
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Physics Settings", AdvancedDisplay,
 		meta = (PinHiddenByDefault))
@@ -769,6 +1425,12 @@ struct KAWAIIPHYSICS_API FAnimNode_KawaiiPhysics : public FAnimNode_SkeletalCont
 	*/
 	UPROPERTY(EditAnywhere, Category = "Limits")
 	TArray<FPlanarLimit> PlanarLimits;
+	/** 
+	* コリジョン（距離場）。体の形状を事前にベイクし、多数の球・カプセルの代わりに1回の参照で衝突判定
+	* Signed distance field collision. The body shape is baked offline and resolved with one lookup instead of many spheres and capsules
+	*/
+	UPROPERTY(EditAnywhere, Category = "Limits")
+	TArray<FDistanceFieldLimit> DistanceFieldLimits;
 
 	/** 
 	* コリジョン設定（DataAsset版）。別AnimNode・ABPで設定を流用したい場合はこちらを推奨
@@ -832,6 +1494,12 @@ struct KAWAIIPHYSICS_API FAnimNode_KawaiiPhysics : public FAnimNode_SkeletalCont
 		meta = (PinHiddenByDefault))
 	int32 BoneConstraintIterationCountAfterCollision = 1;
 	/** 
+	* Bone Constraintの解き方。GraphColored・Jacobiは大量のConstraintを並列に処理
+	* How the bone constraints are solved. GraphColored and Jacobi process many constraints in parallel
+	*/
+	UPROPERTY(EditAnywhere, Category = "Bone Constraint (Experimental)", AdvancedDisplay)
+	EKawaiiPhysicsBoneConstraintSolver BoneConstraintSolver = EKawaiiPhysicsBoneConstraintSolver::GaussSeidel;
+	/** 
 	* 末端ボーンをBoneConstraint処理の対象にした場合、自動的にダミーボーンも処理対象にするフラグ
 	* Flag to automatically processes dummy bones when the end bones are subject to BoneConstraint processing.
 	*/
@@ -864,6 +1532,11 @@ struct KAWAIIPHYSICS_API FAnimNode_KawaiiPhysics : public FAnimNode_SkeletalCont
 	UPROPERTY()
 	TArray<FModifyBoneConstraint> MergedBoneConstraints;
 
+	/**
+	 * Start of each color in MergedBoneConstraints, plus the end. Empty unless BoneConstraintSolver is GraphColored.
+	 */
+	TArray<int32> BoneConstraintColorStarts;
+
 	/** 
 	* 外力（重力など）
 	* External forces (gravity, etc.)
@@ -884,6 +1557,22 @@ struct KAWAIIPHYSICS_API FAnimNode_KawaiiPhysics : public FAnimNode_SkeletalCont
 		meta = (PinHiddenByDefault))
 	float WindScale = 1.0f;
 
+	/** 
+	* 風の強弱（突風）のノイズの周波数。0の場合は強弱なし
+	* Frequency of the noise varying the wind strength (gusts). No gusts if 0
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ExternalForce",
+		meta = (EditCondition = "bEnableWind", ClampMin = "0"), meta = (PinHiddenByDefault))
+	float WindGustFrequency = 4.0f;
+
+	/** 
+	* 風の強弱のノイズのシード。同じシード・同じ入力なら同じ結果を再現
+	* Seed of the wind gust noise. The same seed and inputs reproduce the same result
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ExternalForce", meta = (EditCondition = "bEnableWind"),
+		meta = (PinHiddenByDefault))
+	int32 WindNoiseSeed = 0;
+
 	/** 
 	* 外力のプリセット。C++で独自のプリセットを追加可能(Instanced Struct)
 	* External force presets. You can add your own presets in C++.
@@ -910,6 +1599,14 @@ struct KAWAIIPHYSICS_API FAnimNode_KawaiiPhysics : public FAnimNode_SkeletalCont
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "World Collision", meta = (PinHiddenByDefault))
 	bool bAllowWorldCollision = false;
 
+	/** 
+	* WorldCollisionの判定をフレーム単位でまとめて非同期に行う。結果は1フレーム遅れて反映。ゲーム中のみ有効
+	* Trace the world collision of the whole frame asynchronously in one batch. Results are applied one frame later. Only in game
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "World Collision",
+		meta = (PinHiddenByDefault, EditCondition = "bAllowWorldCollision"))
+	bool bUseAsyncWorldCollision = false;
+
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "World Collision",
 		meta = (PinHiddenByDefault, InlineEditConditionToggle))
@@ -945,6 +1642,47 @@ struct KAWAIIPHYSICS_API FAnimNode_KawaiiPhysics : public FAnimNode_SkeletalCont
 	UPROPERTY(EditAnywhere, Category = "World Collision", meta = (EditCondition = "!bIgnoreSelfComponent"))
 	TArray<FName> IgnoreBoneNamePrefix;
 
+	/** 
+	* 他のキャラクターのKawaiiPhysicsとまとめて、フレームの最後に並列でシミュレーションする。結果は1フレーム遅れて反映
+	* CustomExternalForces・ExternalForces・WorldCollisionを使用している場合は無効
+	* Simulate together with other KawaiiPhysics nodes in parallel at the end of the frame. Results are one frame late.
+	* Ignored when CustomExternalForces, ExternalForces or WorldCollision are used
+	*/
+	UPROPERTY(EditAnywhere, Category = "Optimization")
+	bool bUseBatchedSimulation = false;
+
+	/** 
+	* 所有アクターのKawaiiPhysicsSharedContextComponentのメンバーなら、コリジョンの共有と1回のパスでのシミュレーションを行う
+	* If the component is a member of a KawaiiPhysicsSharedContextComponent of the owning actor,
+	* share collision limits with the other members and simulate together with them in one pass
+	*/
+	UPROPERTY(EditAnywhere, Category = "Optimization")
+	bool bUseSharedContext = false;
+
+	/** 
+	* 距離・画面サイズに応じたシミュレーションのLOD
+	* Simulation LOD depending on the distance or screen size
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Optimization")
+	FKawaiiPhysicsLODSettings LODSettings;
+
+	/** 
+	* 落ち着いたチェーンを停止し、動き・ポーズの変化・外力で再開
+	* Put the settled chains to sleep, and wake them on movement, pose change or external forces
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Optimization")
+	FKawaiiPhysicsSleepSettings SleepSettings;
+
+	/** 
+	* 同じスケルトン・設定のノード間でボーンの階層とBoneConstraintを共有し、初期化の時間とメモリを削減する。
+	* BoneConstraintの長さは初期化時のポーズではなくリファレンスポーズから計算される
+	* Share the bone hierarchy and bone constraints between the nodes with the same skeleton and settings,
+	* to cut the initialization time and memory of crowds.
+	* The bone constraint lengths are taken from the reference pose instead of the pose at initialization
+	*/
+	UPROPERTY(EditAnywhere, Category = "Optimization")
+	bool bShareChainTemplate = false;
+
 	/** 
 	* ExternalForceなどで使用するフィルタリング用タグ
 	* Tag for filtering of ExternalForce etc
@@ -952,6 +1690,10 @@ struct KAWAIIPHYSICS_API FAnimNode_KawaiiPhysics : public FAnimNode_SkeletalCont
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tag")
 	FGameplayTag KawaiiPhysicsTag;
 
+	/**
+	 * Blueprint-facing view of the simulated bones. The solver works on SolverState and only copies its results
+	 * here when they are read (see GetModifyBones / SyncModifyBonesView).
+	 */
 	UPROPERTY(BlueprintReadWrite, Category = "Bones")
 	TArray<FKawaiiPhysicsModifyBone> ModifyBones;
 
@@ -964,10 +1706,32 @@ protected:
 	UPROPERTY()
 	bool bInitPhysicsSettings = false;
 
+	/** PhysicsSettings the per-bone settings were last calculated from */
+	FKawaiiPhysicsSettings BakedPhysicsSettings;
+
+	/** Hash of the *CurveData the per-bone settings were last calculated from, which can be changed through pins */
+	uint32 BakedCurveDataHash = 0;
+
+	/** Whether the per-bone settings must be recalculated even though PhysicsSettings did not change */
+	bool bPhysicsSettingsDirty = false;
+
 #if WITH_EDITORONLY_DATA
 	UPROPERTY()
 	bool bEditing = false;
 
+	/**
+	 * Assets the limits and bone constraints were last applied from. See FKawaiiPhysicsAppliedAsset.
+	 */
+	FKawaiiPhysicsAppliedAsset AppliedLimitsDataAsset;
+	FKawaiiPhysicsAppliedAsset AppliedPhysicsAsset;
+	FKawaiiPhysicsAppliedAsset AppliedBoneConstraintsDataAsset;
+
+	/**
+	 * Whether the bone references must be initialized again before the next evaluation outside of PIE,
+	 * e.g. because the editor copied new properties to this preview node.
+	 */
+	bool bBoneReferencesDirty = true;
+
 	UPROPERTY()
 	double LastEvaluatedTime = 0.0;
 
@@ -993,6 +1757,257 @@ protected:
 	 */
 	bool bResetDynamics;
 
+	/**
+	 * Packed solver state of ModifyBones.
+	 */
+	FKawaiiPhysicsSolverState SolverState;
+
+	/**
+	 * Compacted SolverState while frozen with LODSettings.bCompactFrozenState.
+	 */
+	FKawaiiPhysicsCompactSolverState CompactSolverState;
+
+	/**
+	 * Flag indicating that ModifyBones is older than SolverState.
+	 */
+	bool bModifyBonesViewDirty = false;
+
+	/**
+	 * Convergence of the bone constraints in the last step.
+	 */
+	FKawaiiPhysicsBoneConstraintMetrics BoneConstraintMetrics;
+
+	/**
+	 * Warm up frames left to run over the next evaluations.
+	 */
+	int32 RemainingWarmUpFrames = 0;
+
+	/**
+	 * Index of the first modify bone with each bone name. Built with ModifyBones.
+	 */
+	TMap<FName, int32> ModifyBoneIndexMap;
+
+	/**
+	 * Shared chains the modify bones were copied from, if bShareChainTemplate.
+	 * ModifyBoneIndexMap, MergedBoneConstraints and BoneConstraintColorStarts stay empty while it is set.
+	 */
+	TSharedPtr<const FKawaiiPhysicsChainTemplate, ESPMode::ThreadSafe> ChainTemplate;
+
+	/**
+	 * Compact pose index of each modify bone. INDEX_NONE for dummy bones and bones not in the current LOD.
+	 */
+	TArray<FCompactPoseBoneIndex> ModifyBoneCompactPoseIndices;
+
+	/**
+	 * Modify bones written out by ApplySimulateResult, sorted by compact pose index.
+	 */
+	TArray<int32> OutputBoneOrder;
+
+	/**
+	 * Flag indicating that ModifyBoneCompactPoseIndices and OutputBoneOrder must be resolved again.
+	 */
+	bool bCompactPoseIndicesDirty = true;
+
+	/**
+	 * Scratch array of ApplySimulateResult, indexed like ModifyBones.
+	 */
+	TArray<FTransform> SimulateResultTransforms;
+
+	/**
+	 * Scratch array of the bone transforms handed to batched external forces, indexed like ModifyBones.
+	 */
+	TArray<FTransform> ExternalForceBoneTransforms;
+
+	/**
+	 * Collision limits packed for the batched collision kernels. Rebuilt every frame after the limits are updated.
+	 */
+	FKawaiiPhysicsPackedLimits PackedLimits;
+
+	/**
+	 * Indices of the bones that are simulated in the current step. Kept as a member to reuse its allocation.
+	 */
+	TArray<int32> SimulatedBoneIndices;
+
+	/**
+	 * Subsystem of the world used for batched simulation and the bone budget. Updated in PreUpdate.
+	 */
+	UKawaiiPhysicsSubsystem* KawaiiPhysicsSubsystem = nullptr;
+
+	/**
+	 * Shared context the component is a member of, and whether this node publishes its limits to it or receives
+	 * the published ones. Updated in PreUpdate.
+	 */
+	UKawaiiPhysicsSharedContextComponent* SharedContext = nullptr;
+	bool bPublishSharedLimits = false;
+	bool bSimulateInSharedPass = false;
+
+	/**
+	 * Context found on the owning actor, whether or not the component is a member of it. Only looked up again when the
+	 * owner or UKawaiiPhysicsSharedContextComponent::GetRegistrationSerial changes.
+	 */
+	TWeakObjectPtr<const AActor> SharedContextOwner;
+	TWeakObjectPtr<UKawaiiPhysicsSharedContextComponent> OwnerSharedContext;
+	uint32 SharedContextRegistrationSerial = 0;
+
+	/**
+	 * Counters of the current evaluation, only updated while bRecordEvaluationStats is set. See KawaiiPhysicsTrace.
+	 */
+	FKawaiiPhysicsEvaluationStats EvaluationStats;
+	bool bRecordEvaluationStats = false;
+
+	/**
+	 * Class name of the owning actor, and name of the timing scope of this node in Unreal Insights.
+	 */
+	FName TraceOwnerName;
+	FString TraceScopeName;
+
+	/**
+	 * Capture of the solver inputs of this node, while one is being written. See KawaiiPhysicsCapture.h.
+	 */
+	TSharedPtr<FKawaiiPhysicsCaptureWriter> CaptureWriter;
+	uint32 CaptureRequestSerial = 0;
+
+	/**
+	 * Job handed over to KawaiiPhysicsSubsystem.
+	 */
+	TSharedPtr<FKawaiiPhysicsBatchJob, ESPMode::ThreadSafe> BatchJob;
+
+	/**
+	 * Batches of asynchronous world collision sweeps, reused across frames.
+	 */
+	TArray<TSharedRef<FKawaiiPhysicsWorldCollisionBatch, ESPMode::ThreadSafe>> WorldCollisionBatches;
+
+	/**
+	 * Batch whose results are applied in the current frame, and batch gathering the sweeps of the current frame.
+	 */
+	TSharedPtr<FKawaiiPhysicsWorldCollisionBatch, ESPMode::ThreadSafe> WorldCollisionResultBatch;
+	TSharedPtr<FKawaiiPhysicsWorldCollisionBatch, ESPMode::ThreadSafe> WorldCollisionGatherBatch;
+	uint64 WorldCollisionSequence = 0;
+
+	/**
+	 * Value of LODSettings.Metric, updated in PreUpdate.
+	 */
+	float LODMetricValue = 0.0f;
+	bool bHasLODMetricValue = false;
+
+	/**
+	 * Component space bounds of the pose of the bones at the last evaluation, around which the wind is sampled.
+	 */
+	FBox WindSampleBounds = FBox(ForceInit);
+
+	/**
+	 * Wind velocity in component space at the corners of WindSampleBounds, or at the component if the bounds are not
+	 * known yet. Updated in PreUpdate, since the wind sources can only be read on the game thread.
+	 */
+	TStaticArray<FVector, 8> WindSamples;
+	int32 NumWindSamples = 0;
+
+	/**
+	 * Simulated time driving the wind gust noise.
+	 */
+	float WindGustTime = 0.0f;
+
+	/**
+	 * Current simulation LOD tier.
+	 */
+	EKawaiiPhysicsLODTier LODTier = EKawaiiPhysicsLODTier::Full;
+
+	/**
+	 * Delta time and frames since the last simulation step, for the Low tier and the bone budget.
+	 */
+	float LODAccumulatedDeltaTime = 0.0f;
+	int32 LODFramesSinceStep = 0;
+
+	/**
+	 * Whether the last step was deferred because the bone budget was used up.
+	 */
+	bool bDeferredByBoneBudget = false;
+
+	/**
+	 * Sleep chain of each modify bone, or INDEX_NONE for root bones. Chains hang from the children of the root bones;
+	 * chains connected by bone constraints are merged so that they sleep and wake together.
+	 */
+	TArray<int32> BoneSleepChains;
+
+	/**
+	 * Number of steps each sleep chain has been at rest. The chain is dormant once it reaches StepsToSleep.
+	 */
+	TArray<int32> SleepChainCalmSteps;
+
+	/**
+	 * Largest squared speed and pose movement of each sleep chain in the current step. Scratch arrays.
+	 */
+	TArray<float> SleepChainMaxSpeedsSquared;
+	TArray<float> SleepChainMaxPoseDeltasSquared;
+
+	/**
+	 * Pose location of each bone in the last step, or when its chain went dormant.
+	 */
+	TArray<FVector> SleepPoseLocations;
+
+	/**
+	 * Number of dormant sleep chains.
+	 */
+	int32 NumDormantChains = 0;
+
+	/**
+	 * Whether UpdateSkelCompMove detected a teleport since the last evaluation.
+	 */
+	bool bSkelCompTeleported = false;
+
+	/**
+	 * Simulation time not consumed by fixed timestep substeps yet.
+	 */
+	float FixedTimestepAccumulator = 0.0f;
+
+	/**
+	 * Offsets from the pose of the last two steps, interpolated at the Low tier or with the fixed timestep.
+	 */
+	TArray<FVector> InterpolationFromOffsets;
+	TArray<FVector> InterpolationToOffsets;
+
+	/**
+	 * Interpolated locations used instead of the solver locations when bUseInterpolatedLocations is set.
+	 */
+	TArray<FVector> InterpolatedLocations;
+	bool bUseInterpolatedLocations = false;
+
+	/**
+	 * Clips of LODSettings.FrozenBakedMotion matching the modify bones, and the asset they were gathered from.
+	 */
+	TArray<int32> BakedMotionClipIndices;
+	const UKawaiiPhysicsBakedMotionDataAsset* BakedMotionClipsAsset = nullptr;
+	int32 BakedMotionNumClips = 0;
+
+	/**
+	 * Played clip of LODSettings.FrozenBakedMotion or INDEX_NONE, and the played time in frames.
+	 */
+	int32 BakedMotionClip = INDEX_NONE;
+	float BakedMotionFrame = 0.0f;
+
+	/**
+	 * Evaluations left before every clip is searched again after no frame matched the pose.
+	 */
+	int32 BakedMotionFramesUntilSearch = 0;
+
+	/**
+	 * Offsets from the pose played in the last frame, and the simulated ones faded out when the node froze.
+	 */
+	TArray<FVector> BakedMotionOffsets;
+	TArray<FVector> BakedMotionBlendOffsets;
+	float BakedMotionBlendAlpha = 1.0f;
+
+#if WITH_EDITORONLY_DATA
+	/**
+	 * Frames recorded since StartBakedMotionRecording. Pose locations relative to the first bone and offsets from the
+	 * pose, frame by frame, and the time of each frame.
+	 */
+	bool bRecordingBakedMotion = false;
+	TArray<float> BakedMotionRecordTimes;
+	TArray<FVector> BakedMotionRecordPoseLocations;
+	TArray<FVector> BakedMotionRecordOffsets;
+#endif
+
 public:
 	FAnimNode_KawaiiPhysics();
 
@@ -1021,6 +2036,106 @@ public:
 	}
 #endif
 
+	/**
+	 * Copies the latest solver results to ModifyBones if they are out of date.
+	 */
+	void SyncModifyBonesView();
+
+	/**
+	 * Gets ModifyBones after syncing them with the latest solver results.
+	 *
+	 * @return The up-to-date modify bones.
+	 */
+	const TArray<FKawaiiPhysicsModifyBone>& GetModifyBones()
+	{
+		SyncModifyBonesView();
+		return ModifyBones;
+	}
+
+	/**
+	 * Gets the packed solver state of the modify bones.
+	 */
+	const FKawaiiPhysicsSolverState& GetSolverState() const { return SolverState; }
+
+	/**
+	 * Gets the convergence of the bone constraints in the last step.
+	 * Only measured in the editor or with a.AnimNode.KawaiiPhysics.Debug.BoneConstraintMetrics.
+	 */
+	const FKawaiiPhysicsBoneConstraintMetrics& GetBoneConstraintMetrics() const { return BoneConstraintMetrics; }
+
+	/**
+	 * Captures the current state of the modify bones as a rest state snapshot.
+	 *
+	 * @param Skeleton The skeleton the node is evaluated on.
+	 * @param OutSnapshot Receives the snapshot.
+	 * @return False if the node has not been simulated yet.
+	 */
+	bool CaptureRestState(const USkeleton* Skeleton, FKawaiiPhysicsRestStateSnapshot& OutSnapshot) const;
+
+#if WITH_EDITOR
+	/**
+	 * Starts recording the simulated motion of every evaluation, to bake it into a FKawaiiPhysicsBakedMotionClip.
+	 */
+	void StartBakedMotionRecording();
+
+	/**
+	 * Stops recording and bakes the recorded motion.
+	 *
+	 * @param Skeleton The skeleton the node is evaluated on.
+	 * @param SampleRate Frames per second of the clip.
+	 * @param OutClip Receives the clip.
+	 * @return False if nothing was recorded.
+	 */
+	bool StopBakedMotionRecording(const USkeleton* Skeleton, float SampleRate, FKawaiiPhysicsBakedMotionClip& OutClip);
+
+	bool IsRecordingBakedMotion() const { return bRecordingBakedMotion; }
+#endif
+
+	/**
+	 * Requests the per-bone physics settings to be recalculated on the next evaluation,
+	 * e.g. after the curves were changed.
+	 */
+	void MarkPhysicsSettingsDirty() { bPhysicsSettingsDirty = true; }
+
+	/**
+	 * Gets the number of sleep chains and how many of them are dormant.
+	 */
+	int32 GetNumSleepChains() const { return SleepChainCalmSteps.Num(); }
+	int32 GetNumDormantChains() const { return NumDormantChains; }
+
+	/**
+	 * Gets the current simulation LOD tier.
+	 */
+	EKawaiiPhysicsLODTier GetLODTier() const { return LODTier; }
+
+	/**
+	 * Finds a modify bone by its bone name.
+	 *
+	 * @param BoneName The name of the bone.
+	 * @return The index of the modify bone, or INDEX_NONE if the bone is not simulated by this node.
+	 */
+	int32 FindModifyBoneIndex(const FName& BoneName) const
+	{
+		const int32* Index = (ChainTemplate ? ChainTemplate->ModifyBoneIndexMap : ModifyBoneIndexMap).Find(BoneName);
+		return Index ? *Index : INDEX_NONE;
+	}
+
+	/**
+	 * Gets the bone constraints the node simulates, which are shared if the node uses a chain template.
+	 */
+	TConstArrayView<FModifyBoneConstraint> GetMergedBoneConstraints() const
+	{
+		return ChainTemplate ? ChainTemplate->BoneConstraints : MergedBoneConstraints;
+	}
+
+	/**
+	 * Gets the start of each color in GetMergedBoneConstraints, plus the end. Empty if they are not colored.
+	 */
+	TConstArrayView<int32> GetBoneConstraintColorStarts() const
+	{
+		return ChainTemplate ? ChainTemplate->BoneConstraintColorStarts : BoneConstraintColorStarts;
+	}
+
 protected:
 	/**
 	 * Gets the forward vector of a bone based on its rotation.
@@ -1060,11 +2175,77 @@ protected:
 	 */
 	void InitModifyBones(FComponentSpacePoseContext& Output, const FBoneContainer& BoneContainer);
 
+	/**
+	 * Collects the modify bones of every root bone.
+	 *
+	 * @param Output The component space pose context.
+	 * @param BoneContainer The bone container containing bone hierarchy information.
+	 * @param OutModifyBones The collected modify bones, in the pose of Output.
+	 */
+	void CollectModifyBones(FComponentSpacePoseContext& Output, const FBoneContainer& BoneContainer,
+	                        TArray<FKawaiiPhysicsModifyBone>& OutModifyBones);
+
+	/**
+	 * Moves modify bones to a pose. Dummy bones follow their parent.
+	 *
+	 * @param InModifyBones The parent-sorted modify bones to move.
+	 * @param GetComponentSpaceTransform Gets the component space transform of a bone that is not a dummy.
+	 */
+	void PoseModifyBones(TArray<FKawaiiPhysicsModifyBone>& InModifyBones,
+	                     TFunctionRef<FTransform(const FKawaiiPhysicsModifyBone&)> GetComponentSpaceTransform) const;
+
+	/**
+	 * Gets the key of the chain template this node would share.
+	 *
+	 * @param BoneContainer The bone container containing bone hierarchy information.
+	 */
+	FKawaiiPhysicsChainTemplateKey MakeChainTemplateKey(const FBoneContainer& BoneContainer) const;
+
+	/**
+	 * Fills a new chain template from the setup of this node.
+	 *
+	 * @param Output The component space pose context.
+	 * @param BoneContainer The bone container containing bone hierarchy information.
+	 * @param OutTemplate The template to fill.
+	 */
+	void BuildChainTemplate(FComponentSpacePoseContext& Output, const FBoneContainer& BoneContainer,
+	                        FKawaiiPhysicsChainTemplate& OutTemplate);
+
+	/**
+	 * Stops sharing the chain template, copying what the node still needs from it.
+	 */
+	void DetachChainTemplate();
+
+	/**
+	 * Rebuilds ModifyBoneIndexMap from ModifyBones.
+	 */
+	void BuildModifyBoneIndexMap();
+
+	/**
+	 * Reorders ModifyBones so that every parent precedes its children, remapping the indices they hold.
+	 * ModifyBones replaced from Blueprint are not guaranteed to be in that order.
+	 *
+	 * @return False if a parent index is out of range or the parents form a cycle. ModifyBones is left unchanged.
+	 */
+	bool SortModifyBonesInParentOrder();
+
 	/**
 	 * Initializes the bone constraints for the physics simulation.
 	 */
 	void InitBoneConstraints();
 
+	/**
+	 * Resolves and merges BoneConstraints and BoneConstraintsData against modify bones.
+	 *
+	 * @param InModifyBones The modify bones. The constraint lengths are taken from their locations.
+	 * @param FindBoneIndex Finds a modify bone by its bone name.
+	 * @param OutConstraints The merged constraints, including the ones of the child dummy bones.
+	 * @param OutColorStarts The start of each color, if BoneConstraintSolver is GraphColored.
+	 */
+	void BuildBoneConstraints(const TArray<FKawaiiPhysicsModifyBone>& InModifyBones,
+	                          TFunctionRef<int32(const FName&)> FindBoneIndex,
+	                          TArray<FModifyBoneConstraint>& OutConstraints, TArray<int32>& OutColorStarts) const;
+
 	/**
 	 * Applies the data asset to LimitData.
 	 *
@@ -1128,6 +2309,13 @@ protected:
 	 */
 	void UpdatePhysicsSettingsOfModifyBones();
 
+	/**
+	 * Hashes the keys of the curves that scale the per-bone physics settings.
+	 *
+	 * @return The hash, compared with BakedCurveDataHash to detect changed curves.
+	 */
+	uint32 CalcCurveDataHash() const;
+
 	/**
 	 * Updates the spherical limits for the given bones.
 	 *
@@ -1173,6 +2361,17 @@ protected:
 	void UpdatePlanerLimits(TArray<FPlanarLimit>& Limits, FComponentSpacePoseContext& Output,
 	                        const FBoneContainer& BoneContainer, const FTransform& ComponentTransform);
 
+	/**
+	 * Updates the distance field limits for the given bones.
+	 *
+	 * @param Limits An array of distance field limits to update.
+	 * @param Output The pose context.
+	 * @param BoneContainer The bone container.
+	 * @param ComponentTransform The component transform.
+	 */
+	void UpdateDistanceFieldLimits(TArray<FDistanceFieldLimit>& Limits, FComponentSpacePoseContext& Output,
+	                               const FBoneContainer& BoneContainer, const FTransform& ComponentTransform);
+
 	/**
 	 * Updates the pose transform for all modified bones.
 	 *
@@ -1198,95 +2397,272 @@ protected:
 	                         const FTransform& ComponentTransform);
 
 	/**
-	 * Simulates the physics for a single bone.
+	 * Hands the simulation of this frame over to UKawaiiPhysicsSubsystem and adopts the result of the previous one.
 	 *
-	 * @param Bone The bone to simulate.
-	 * @param Scene The scene interface.
+	 * @param Output The pose context.
 	 * @param ComponentTransform The component transform.
-	 * @param GravityCS The gravity vector in component space.
-	 * @param Exponent The exponent for the simulation.
-	 * @param SkelComp The skeletal mesh component.
+	 * @param NumSubsteps The number of steps to simulate.
+	 */
+	void SimulateModifyBonesBatched(FComponentSpacePoseContext& Output, const FTransform& ComponentTransform,
+	                                int32 NumSubsteps = 1);
+
+	/**
+	 * Checks if this node can be simulated by UKawaiiPhysicsSubsystem.
+	 *
+	 * @return True if batched simulation is enabled and nothing used by this node needs the node itself.
+	 */
+	bool CanUseBatchedSimulation() const;
+
+	/**
+	 * Finds the shared context the component of this node is a member of. Called on the game thread.
+	 *
+	 * @param InAnimInstance The anim instance that owns this node.
+	 */
+	void UpdateSharedContext(const UAnimInstance* InAnimInstance);
+
+	/**
+	 * Updates TraceOwnerName and TraceScopeName.
+	 *
+	 * @param SkelComp The component this node is evaluated for.
+	 */
+	void UpdateTraceNames(const USkeletalMeshComponent* SkelComp);
+
+	/**
+	 * Fills in the counters that describe the state of the node and sends EvaluationStats.
+	 *
+	 * @param StartCycle FPlatformTime::Cycles64 at the start of the evaluation.
+	 */
+	void OutputEvaluationStats(uint64 StartCycle);
+
+	/**
+	 * Updates LODMetricValue from the views of the world. Called on the game thread.
+	 *
+	 * @param InAnimInstance The anim instance that owns this node.
+	 */
+	void UpdateLODMetric(const UAnimInstance* InAnimInstance);
+
+	/**
+	 * Calculates the simulation LOD tier from LODMetricValue, with hysteresis around the current tier.
+	 *
+	 * @return The new tier.
+	 */
+	EKawaiiPhysicsLODTier CalcLODTier() const;
+
+	/**
+	 * Updates the LOD tier and decides whether to simulate in this frame.
+	 * When simulating, DeltaTime is replaced by the time accumulated since the last step.
+	 *
+	 * @param ComponentTransform The component transform.
+	 * @return True if the node should simulate in this frame.
+	 */
+	bool UpdateSimulationLOD(const FTransform& ComponentTransform);
+
+	/**
+	 * Plays LODSettings.FrozenBakedMotion into InterpolatedLocations while frozen, blending in from the simulation.
+	 *
+	 * @param Skeleton The skeleton the node is evaluated on.
+	 * @return False if no baked frame matches the current pose.
+	 */
+	bool PlayBakedMotion(const USkeleton* Skeleton);
+
+#if WITH_EDITOR
+	/**
+	 * Records the locations applied in this evaluation, while recording the baked motion.
+	 *
+	 * @param FrameDeltaTime The delta time of the anim instance.
+	 */
+	void RecordBakedMotionFrame(float FrameDeltaTime);
+#endif
+
+	/**
+	 * Checks if the result is interpolated between steps by the Low tier.
+	 */
+	bool UseLODInterpolation() const
+	{
+		return LODTier == EKawaiiPhysicsLODTier::Low && LODSettings.LowSimulationInterval > 1 &&
+			!CanUseBatchedSimulation();
+	}
+
+	/**
+	 * Checks if the result is interpolated between fixed timestep substeps.
+	 */
+	bool UseFixedTimestepInterpolation() const
+	{
+		return bUseFixedTimestep && !UseLODInterpolation() && !CanUseBatchedSimulation();
+	}
+
+	/**
+	 * Updates InterpolatedLocations for the Low tier or the fixed timestep.
+	 *
+	 * @param bSimulated Whether the node simulated in this frame.
+	 */
+	void UpdateInterpolatedLocations(bool bSimulated);
+
+	/**
+	 * Stores the offsets of the current locations from the pose.
+	 *
+	 * @param OutOffsets Receives the offsets.
+	 */
+	void CaptureInterpolationOffsets(TArray<FVector>& OutOffsets) const;
+
+	/**
+	 * Adds DeltaTime to the fixed timestep accumulator and takes the substeps to simulate in this frame out of it.
+	 * DeltaTime is replaced by the length of a substep. Without the fixed timestep, the frame is simulated in one step.
+	 *
+	 * @return The number of substeps to simulate.
+	 */
+	int32 ConsumeFixedTimesteps();
+
+	/**
+	 * Simulates the given number of substeps, spreading the movement of the component over them.
+	 *
 	 * @param Output The pose context.
+	 * @param ComponentTransform The component transform.
+	 * @param NumSubsteps The number of substeps.
 	 */
-	void Simulate(FKawaiiPhysicsModifyBone& Bone, const FSceneInterface* Scene, const FTransform& ComponentTransform,
-	              const FVector& GravityCS, const float& Exponent, const USkeletalMeshComponent* SkelComp,
-	              FComponentSpacePoseContext& Output);
+	void SimulateSubsteps(FComponentSpacePoseContext& Output, const FTransform& ComponentTransform,
+	                      int32 NumSubsteps);
 
 	/**
-	 * Adjusts the bone position based on world collision.
+	 * Checks if world collision is used in the current step.
+	 */
+	bool IsWorldCollisionActive() const
+	{
+		return bAllowWorldCollision && LODTier == EKawaiiPhysicsLODTier::Full;
+	}
+
+	/**
+	 * Makes the solver parameters of the current step.
 	 *
-	 * @param Bone The bone to adjust.
-	 * @param OwningComp The owning skeletal mesh component.
+	 * @param ComponentTransform The component transform.
+	 * @return The solver parameters.
 	 */
-	void AdjustByWorldCollision(FKawaiiPhysicsModifyBone& Bone, const USkeletalMeshComponent* OwningComp);
+	FKawaiiPhysicsSolverParams MakeSolverParams(const FTransform& ComponentTransform) const;
 
 	/**
-	 * Adjusts the bone position based on spherical collision limits.
+	 * Integrates the velocity, wind, follow translation/rotation and gravity of a single bone.
 	 *
-	 * @param Bone The bone to adjust.
-	 * @param Limits An array of spherical limits.
+	 * @param Index The index of the bone.
+	 * @param Params The solver parameters of the current step.
+	 */
+	void IntegrateBone(int32 Index, const FKawaiiPhysicsSolverParams& Params);
+
+	/**
+	 * Checks if all the external forces can be applied with ApplyBatch.
+	 * Custom external forces and forces that only implement Apply are applied bone by bone by Simulate.
 	 */
-	void AdjustBySphereCollision(FKawaiiPhysicsModifyBone& Bone, TArray<FSphericalLimit>& Limits);
+	bool CanBatchExternalForces() const;
 
 	/**
-	 * Adjusts the bone position based on capsule collision limits.
+	 * Applies the external forces to all the simulated bones at once, one call per force.
 	 *
-	 * @param Bone The bone to adjust.
-	 * @param Limits An array of capsule limits.
+	 * @param Output The pose context.
 	 */
-	void AdjustByCapsuleCollision(FKawaiiPhysicsModifyBone& Bone, TArray<FCapsuleLimit>& Limits);
+	void ApplyExternalForcesBatched(FComponentSpacePoseContext& Output);
 
 	/**
-	 * Adjusts the bone position based on box collision limits.
+	 * Simulates the physics for a single bone, applying the external forces bone by bone.
+	 * ModifyBones must be synced before the first bone, so that forces reading other bones see the same state
+	 * as before the solver state was packed: bones already simulated in this step, and the previous step for the rest.
 	 *
-	 * @param Bone The bone to adjust.
-	 * @param Limits An array of box limits.
+	 * @param Index The index of the bone to simulate.
+	 * @param Params The solver parameters of the current step.
+	 * @param SkelComp The skeletal mesh component.
+	 * @param Output The pose context.
 	 */
-	void AdjustByBoxCollision(FKawaiiPhysicsModifyBone& Bone, TArray<FBoxLimit>& Limits);
+	void Simulate(int32 Index, const FKawaiiPhysicsSolverParams& Params, const USkeletalMeshComponent* SkelComp,
+	              FComponentSpacePoseContext& Output);
 
 	/**
-	 * Adjusts the bone position based on planar collision limits.
+	 * Gets the channel and responses used for world collision.
 	 *
-	 * @param Bone The bone to adjust.
-	 * @param Limits An array of planar limits.
+	 * @param OwningComp The owning skeletal mesh component.
+	 * @param OutTraceChannel Receives the trace channel.
+	 * @param OutResponseParams Receives the collision responses.
 	 */
-	void AdjustByPlanerCollision(FKawaiiPhysicsModifyBone& Bone, TArray<FPlanarLimit>& Limits);
+	void GetWorldCollisionChannel(const USkeletalMeshComponent* OwningComp, ECollisionChannel& OutTraceChannel,
+	                              FCollisionResponseParams& OutResponseParams) const;
 
 	/**
-	 * Adjusts the bone position based on angle limits.
+	 * Adjusts the bone position based on world collision.
 	 *
-	 * @param Bone The bone to adjust.
-	 * @param ParentBone The parent bone.
+	 * @param Index The index of the bone to adjust.
+	 * @param OwningComp The owning skeletal mesh component.
+	 * @param QueryParams The query params, shared by all bones of the step.
+	 * @param TraceChannel The trace channel.
+	 * @param ResponseParams The collision responses.
+	 */
+	void AdjustByWorldCollision(int32 Index, const USkeletalMeshComponent* OwningComp,
+	                            const FCollisionQueryParams& QueryParams, ECollisionChannel TraceChannel,
+	                            const FCollisionResponseParams& ResponseParams);
+
+	/**
+	 * Checks if world collision is traced asynchronously in the current frame.
+	 */
+	bool UseAsyncWorldCollision() const { return bUseAsyncWorldCollision && KawaiiPhysicsSubsystem != nullptr; }
+
+	/**
+	 * Picks the batch with the newest asynchronous world collision results and a batch to gather the sweeps of this
+	 * frame into.
 	 */
-	void AdjustByAngleLimit(
-		FKawaiiPhysicsModifyBone& Bone,
-		const FKawaiiPhysicsModifyBone& ParentBone);
+	void BeginAsyncWorldCollision();
 
 	/**
-	 * Adjusts the bone position based on planar constraints.
+	 * Pushes the bones out of the world using the results of the previous frame.
 	 *
-	 * @param Bone The bone to adjust.
-	 * @param ParentBone The parent bone.
+	 * @param ComponentTransform The component transform.
 	 */
-	void AdjustByPlanarConstraint(FKawaiiPhysicsModifyBone& Bone, const FKawaiiPhysicsModifyBone& ParentBone);
+	void ApplyAsyncWorldCollision(const FTransform& ComponentTransform);
 
 	/**
-	 * Adjusts the bone positions based on bone constraints.
+	 * Stores the sweeps of the current step in the gather batch.
+	 *
+	 * @param OwningComp The owning skeletal mesh component.
+	 * @param ComponentTransform The component transform.
 	 */
-	void AdjustByBoneConstraints();
+	void GatherAsyncWorldCollision(const USkeletalMeshComponent* OwningComp, const FTransform& ComponentTransform);
+
+	/**
+	 * Hands the gathered sweeps over to UKawaiiPhysicsSubsystem and releases the applied results.
+	 */
+	void EndAsyncWorldCollision();
+
+public:
+	/**
+	 * Checks if a world collision hit must be ignored because it is on a bone of the owning component that is
+	 * excluded by IgnoreBones or IgnoreBoneNamePrefix.
+	 *
+	 * @param Hit The hit.
+	 * @param OwningComp The owning skeletal mesh component.
+	 * @param BoneName The name of the swept bone.
+	 * @param IgnoreBones Bones of the owning component to ignore.
+	 * @param IgnoreBoneNamePrefix Bone name prefixes of the owning component to ignore.
+	 * @return True if the hit must be ignored.
+	 */
+	static bool ShouldIgnoreWorldCollisionHit(const FHitResult& Hit, const UPrimitiveComponent* OwningComp,
+	                                          const FName& BoneName, TConstArrayView<FBoneReference> IgnoreBones,
+	                                          TConstArrayView<FName> IgnoreBoneNamePrefix);
+
+protected:
 
 	/**
 	 * Applies the simulation results to the bone transforms.
+	 * Does not read the pose, so that it can also run without an anim instance (e.g. in the benchmark commandlet).
 	 *
-	 * @param Output The pose context.
 	 * @param BoneContainer The bone container.
 	 * @param OutBoneTransforms An array to store the resulting bone transforms.
 	 */
-	void ApplySimulateResult(FComponentSpacePoseContext& Output, const FBoneContainer& BoneContainer,
-	                         TArray<FBoneTransform>& OutBoneTransforms);
+	void ApplySimulateResult(const FBoneContainer& BoneContainer, TArray<FBoneTransform>& OutBoneTransforms);
+
+	/**
+	 * Resolves the compact pose index of each modify bone and the order ApplySimulateResult writes them out in.
+	 *
+	 * @param BoneContainer The bone container of the current LOD.
+	 */
+	void CacheCompactPoseIndices(const FBoneContainer& BoneContainer);
 
 	/**
-	 * Warms up the simulation by running it for a specified number of frames.
+	 * Warms up the simulation by running the remaining warm up frames, at most WarmUpFramesPerEvaluation of them.
 	 *
 	 * @param Output The pose context.
 	 * @param BoneContainer The bone container.
@@ -1296,15 +2672,84 @@ protected:
 	            FTransform& ComponentTransform);
 
 	/**
-	 * Gets the wind velocity for a given bone.
+	 * Builds the sleep chains from the modify bones and the bone constraints.
+	 */
+	void BuildSleepChains();
+
+	/**
+	 * Whether the given sleep chain is dormant.
+	 */
+	bool IsSleepChainDormant(int32 Chain) const
+	{
+		return SleepChainCalmSteps[Chain] >= SleepSettings.StepsToSleep;
+	}
+
+	/**
+	 * Wakes the dormant chains on component movement, teleport, pose change, external forces or wind.
+	 * Called once per evaluation before simulating.
+	 */
+	void WakeDormantChains();
+
+	/**
+	 * Removes the bones of the dormant chains from SimulatedBoneIndices.
+	 */
+	void RemoveDormantBones();
+
+	/**
+	 * Counts the steps each awake chain has been at rest, and puts the settled chains to sleep.
+	 * Wakes the dormant chains that bone constraints moved in this step.
+	 */
+	void UpdateSleepChains();
+
+	/**
+	 * Restores the snapshot of RestStateDataAsset matching the skeleton and the current pose.
 	 *
-	 * @param Scene The scene interface.
-	 * @param ComponentTransform The component transform.
-	 * @param Bone The bone to get the wind velocity for.
-	 * @return The wind velocity vector.
+	 * @param Skeleton The skeleton the node is evaluated on.
+	 * @return False if there is no matching snapshot.
+	 */
+	bool RestoreRestState(const USkeleton* Skeleton);
+
+	/**
+	 * Samples the wind sources around the bones. Called on the game thread.
+	 *
+	 * @param InAnimInstance The anim instance.
+	 */
+	void UpdateWindSamples(const UAnimInstance* InAnimInstance);
+
+	/**
+	 * Updates the bounds the wind is sampled around from the pose of the bones.
+	 */
+	void UpdateWindSampleBounds();
+
+	/**
+	 * Checks if wind samples are available for the current step.
+	 */
+	bool HasWindSamples() const
+	{
+		return bEnableWind && NumWindSamples > 0;
+	}
+
+	/**
+	 * Gets the wind velocity for a given bone, interpolated from the wind samples and varied by the gust noise.
+	 *
+	 * @param Index The index of the bone.
+	 * @return The wind velocity vector in component space.
+	 */
+	FVector GetWindVelocity(int32 Index) const;
+
+	/**
+	 * Copies the solver state of a single bone to ModifyBones, so that external forces can read and write it.
+	 *
+	 * @param Index The index of the bone.
+	 */
+	FKawaiiPhysicsModifyBone& PushModifyBoneView(int32 Index);
+
+	/**
+	 * Copies the location written to ModifyBones by an external force back to the solver state.
+	 *
+	 * @param Index The index of the bone.
 	 */
-	FVector GetWindVelocity(const FSceneInterface* Scene, const FTransform& ComponentTransform,
-	                        const FKawaiiPhysicsModifyBone& Bone) const;
+	void PullModifyBoneView(int32 Index);
 
 #if ENABLE_ANIM_DEBUG
 	void AnimDrawDebug(const FComponentSpacePoseContext& Output);
@@ -13,4 +13,16 @@ public:
 	/** IModuleInterface implementation */
 	virtual void StartupModule() override;
 	virtual void ShutdownModule() override;
+
+#if WITH_EDITOR
+	/**
+	 * Gets a counter bumped whenever a PhysicsAsset or one of its bodies is modified in the editor.
+	 * Nodes only rebuild the limits of their PhysicsAssetForLimits when it changed.
+	 */
+	static uint32 GetPhysicsAssetRevision();
+
+private:
+	FDelegateHandle ObjectModifiedHandle;
+	FDelegateHandle ObjectPropertyChangedHandle;
+#endif
 };
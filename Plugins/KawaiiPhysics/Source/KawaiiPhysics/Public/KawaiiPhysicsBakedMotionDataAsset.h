@@ -0,0 +1,142 @@
+// KawaiiPhysics : Copyright (c) 2019-2024 pafuhana1213, MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "KawaiiPhysicsBakedMotionDataAsset.generated.h"
+
+class USkeleton;
+
+/**
+ * Simulated motion of the modify bones of a FAnimNode_KawaiiPhysics, recorded while a looping clip played and
+ * resampled at a fixed rate. Each frame keeps the pose (to find the frame again) and the offset of each bone from it,
+ * quantized to 16 bits per component.
+ */
+USTRUCT(BlueprintType)
+struct KAWAIIPHYSICS_API FKawaiiPhysicsBakedMotionClip
+{
+	GENERATED_BODY()
+
+	/** Name of the clip, e.g. the animation it was recorded on */
+	UPROPERTY(EditAnywhere, Category = "Baked Motion")
+	FName Name;
+
+	/** Skeleton the clip was recorded on */
+	UPROPERTY(VisibleAnywhere, Category = "Baked Motion")
+	TSoftObjectPtr<USkeleton> Skeleton;
+
+	/** Name of each modify bone, in the order of the node */
+	UPROPERTY(VisibleAnywhere, Category = "Baked Motion")
+	TArray<FName> BoneNames;
+
+	/** Frames per second */
+	UPROPERTY(VisibleAnywhere, Category = "Baked Motion")
+	float SampleRate = 30.0f;
+
+	UPROPERTY(VisibleAnywhere, Category = "Baked Motion")
+	int32 NumFrames = 0;
+
+	/** Pose location of each bone relative to the first bone per frame, in units of PoseStep. Used to match the pose */
+	UPROPERTY()
+	TArray<int16> PoseLocations;
+
+	UPROPERTY()
+	float PoseStep = 0.0f;
+
+	/** Simulated location of each bone relative to its pose location per frame, in units of OffsetStep */
+	UPROPERTY()
+	TArray<int16> Offsets;
+
+	UPROPERTY()
+	float OffsetStep = 0.0f;
+
+	bool IsValid() const
+	{
+		return NumFrames > 0 && PoseLocations.Num() == NumFrames * BoneNames.Num() * 3 &&
+			Offsets.Num() == PoseLocations.Num();
+	}
+
+	/**
+	 * Quantizes frames sampled at SampleRate into the clip.
+	 *
+	 * @param InPoseLocations Pose location of each bone relative to the first bone, frame by frame.
+	 * @param InOffsets Simulated location of each bone relative to its pose location, frame by frame.
+	 */
+	void Build(TConstArrayView<FVector> InPoseLocations, TConstArrayView<FVector> InOffsets);
+
+	/**
+	 * Gets how far the given pose is from the pose of a frame.
+	 *
+	 * @param Frame The frame.
+	 * @param InPoseLocations Pose location of each bone in component space.
+	 * @return The largest distance of a bone.
+	 */
+	float GetPoseDistance(int32 Frame, TConstArrayView<FVector> InPoseLocations) const;
+
+	/**
+	 * Gets the offset of a bone from its pose, interpolated between the frames around the given time.
+	 *
+	 * @param Frame The time in frames. Wraps around the end of the clip.
+	 * @param BoneIndex The modify bone.
+	 * @return The offset in component space.
+	 */
+	FVector SampleOffset(float Frame, int32 BoneIndex) const;
+};
+
+/**
+ * Data asset holding baked motion of KawaiiPhysics nodes, played instead of simulating while a node is frozen by its
+ * simulation LOD. The played frame is the one whose pose matches the current pose of the modify bones.
+ */
+UCLASS(Blueprintable)
+class KAWAIIPHYSICS_API UKawaiiPhysicsBakedMotionDataAsset : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** Baked clips */
+	UPROPERTY(EditAnywhere, Category = "Baked Motion", meta=(TitleProperty="Name"))
+	TArray<FKawaiiPhysicsBakedMotionClip> Clips;
+
+	/** Largest distance of a bone from a baked pose for the frame to be played */
+	UPROPERTY(EditAnywhere, Category = "Baked Motion", meta=(ClampMin="0"))
+	float PoseTolerance = 2.0f;
+
+	/** Frames per second of the clips baked into this asset */
+	UPROPERTY(EditAnywhere, Category = "Baked Motion", meta=(ClampMin="1"))
+	float BakeSampleRate = 30.0f;
+
+	/**
+	 * Gathers the clips recorded on the given skeleton and bones.
+	 *
+	 * @param Skeleton The skeleton of the node.
+	 * @param BoneNames Name of each modify bone.
+	 * @param OutClipIndices Receives the index of each matching clip.
+	 */
+	void GetMatchingClips(const USkeleton* Skeleton, TConstArrayView<FName> BoneNames,
+	                      TArray<int32>& OutClipIndices) const;
+
+	/**
+	 * Finds the frame closest to the given pose among the given clips.
+	 *
+	 * @param ClipIndices The clips to search, from GetMatchingClips.
+	 * @param PoseLocations Pose location of each modify bone in component space.
+	 * @param OutClipIndex Receives the clip.
+	 * @param OutFrame Receives the frame.
+	 * @return False if no frame is within PoseTolerance.
+	 */
+	bool FindFrame(TConstArrayView<int32> ClipIndices, TConstArrayView<FVector> PoseLocations, int32& OutClipIndex,
+	               int32& OutFrame) const;
+
+	/**
+	 * Finds the frame closest to the given pose among the few frames around the expected one.
+	 *
+	 * @param ClipIndex The played clip.
+	 * @param ExpectedFrame The frame the clip is expected to be at.
+	 * @param PoseLocations Pose location of each modify bone in component space.
+	 * @param OutFrame Receives the frame.
+	 * @return False if no frame around the expected one is within PoseTolerance.
+	 */
+	bool FindFrameNear(int32 ClipIndex, float ExpectedFrame, TConstArrayView<FVector> PoseLocations,
+	                   int32& OutFrame) const;
+};
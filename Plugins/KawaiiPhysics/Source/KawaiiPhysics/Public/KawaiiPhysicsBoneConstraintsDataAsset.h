@@ -40,6 +40,12 @@ struct KAWAIIPHYSICS_API FModifyBoneConstraintData
 	UPROPERTY(EditAnywhere, category = "KawaiiPhysics", meta=(EditCondition="bOverrideCompliance"))
 	EXPBDComplianceType ComplianceType = EXPBDComplianceType::Leather;
 
+#if WITH_EDITORONLY_DATA
+	/** Whether the constraint was added by AutoGenerateBoneConstraints, which replaces it when run again */
+	UPROPERTY(VisibleAnywhere, category = "KawaiiPhysics", AdvancedDisplay)
+	bool bAutoGenerated = false;
+#endif
+
 	/**
 	 * Updates the bone constraint data with the given constraint.
 	 * @param BoneConstraint The bone constraint to update from.
@@ -65,6 +71,8 @@ struct FRegexPatternBoneSet
 };
 
 
+struct FKawaiiPhysicsBoneConstraintGeneration;
+
 /**
  * Data asset for managing bone constraints in KawaiiPhysics.
  */
@@ -86,6 +94,27 @@ public:
 	UPROPERTY(EditAnywhere, Category="Helper")
 	TArray<FRegexPatternBoneSet> RegexPatternList;
 
+	/** Root bones of the chains connected by AutoGenerateBoneConstraints, e.g. the first bone of each skirt strand */
+	UPROPERTY(EditAnywhere, Category="Helper")
+	TArray<FBoneReference> AutoGenerateRootBones;
+
+	/** Largest distance in the reference pose between two bones of different chains for them to be constrained */
+	UPROPERTY(EditAnywhere, Category="Helper", meta=(ClampMin="0.1"))
+	float AutoGenerateMaxDistance = 15.0f;
+
+	/**
+	 * Skeleton, settings and reference pose the constraints were last generated for, and the generated constraints as
+	 * they were added. Generating them again is skipped if all of them are unchanged
+	 */
+	UPROPERTY()
+	FGuid AutoGeneratedSkeletonGuid;
+
+	UPROPERTY()
+	uint32 AutoGeneratedSettingsHash = 0;
+
+	UPROPERTY()
+	uint32 AutoGeneratedConstraintsHash = 0;
+
 	/** Preview skeleton for editor */
 	UPROPERTY(EditAnywhere, Category = "Skeleton")
 	TSoftObjectPtr<USkeleton> PreviewSkeleton;
@@ -116,10 +145,42 @@ public:
 	UFUNCTION(BlueprintCallable, CallInEditor, Category="Helper")
 	void ApplyRegex();
 
+	/**
+	 * Constrains each bone of the chains under AutoGenerateRootBones to the closest bone of every other chain within
+	 * AutoGenerateMaxDistance in the reference pose of PreviewSkeleton, replacing the constraints generated before.
+	 * Runs on a background task, and is skipped if nothing changed since the last generation.
+	 */
+	UFUNCTION(BlueprintCallable, CallInEditor, Category="Helper")
+	void AutoGenerateBoneConstraints();
+
+	/** Runs AutoGenerateBoneConstraints even if nothing seems to have changed since the last generation */
+	UFUNCTION(BlueprintCallable, CallInEditor, Category="Helper")
+	void RegenerateBoneConstraints();
+
 	/** Updates the preview bone list */
 	void UpdatePreviewBoneList();
 
 	/** Handles property changes in the editor */
 	virtual void PostEditChangeProperty(struct FPropertyChangedEvent& PropertyChangedEvent) override;
+	virtual void PostEditUndo() override;
+
+	/** Gets the revision of the bone constraints. Nodes apply the bone constraints again when it changed */
+	uint32 GetRevision() const { return Revision; }
+#endif
+
+private:
+#if WITH_EDITOR
+	/** Replaces the generated constraints with the result of a finished generation */
+	void ApplyGeneratedBoneConstraints(const FKawaiiPhysicsBoneConstraintGeneration& Generation);
+
+	/** Hashes the constraints currently marked as generated, to notice when they were edited or removed by hand */
+	uint32 CalcAutoGeneratedConstraintsHash() const;
+#endif
+
+#if WITH_EDITORONLY_DATA
+	uint32 Revision = 0;
+
+	/** Generation running in the background, if any */
+	TSharedPtr<FKawaiiPhysicsBoneConstraintGeneration> PendingGeneration;
 #endif
 };
@@ -0,0 +1,173 @@
+// KawaiiPhysics : Copyright (c) 2019-2024 pafuhana1213, MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AnimNode_KawaiiPhysics.h"
+#include "KawaiiPhysicsDistanceFieldDataAsset.h"
+#include "KawaiiPhysicsSolver.h"
+
+/**
+ * Record/replay capture of the solver inputs of FAnimNode_KawaiiPhysics, so that a chain that spikes in cost or
+ * explodes can be reproduced and profiled without loading the level or the character.
+ *
+ * Set "a.AnimNode.KawaiiPhysics.Capture.Filter" and then "a.AnimNode.KawaiiPhysics.Capture.Steps N" (from the console,
+ * an ini or -dpcvars, so also in shipped builds). The next N steps of every node whose Unreal Insights scope name
+ * ("KawaiiPhysics <Owner class> <Tag>") contains the filter are written to Saved/KawaiiPhysics/Captures, and can be
+ * replayed with the KawaiiPhysicsReplay commandlet. Capturing nodes simulate on their own instead of batched.
+ *
+ * A capture is a stream of records :
+ * - Keyframe : the whole solver state and the bone constraints. Written before the first step and whenever the state
+ *   was changed outside of the solver (reset, teleport, warm up, sleep, physics settings...).
+ * - DistanceField : a distance field used by the limits, written before the first step that uses it.
+ * - Step : everything the solver reads in one step, what external forces and world collision moved the bones by,
+ *   and the resulting locations.
+ */
+namespace KawaiiPhysicsCapture
+{
+	/** "KPCP" */
+	constexpr uint32 Magic = 0x4B504350;
+	constexpr uint32 Version = 1;
+
+	enum class ERecord : uint8
+	{
+		Keyframe,
+		DistanceField,
+		Step,
+		End
+	};
+}
+
+/**
+ * Solver state restored before a step of a capture.
+ */
+struct KAWAIIPHYSICS_API FKawaiiPhysicsCaptureKeyframe
+{
+	FKawaiiPhysicsSolverState State;
+	TArray<FModifyBoneConstraint> Constraints;
+	TArray<int32> ConstraintColorStarts;
+};
+
+/**
+ * Inputs and result of one solver step of a capture.
+ */
+struct KAWAIIPHYSICS_API FKawaiiPhysicsCaptureStep
+{
+	/** Keyframe to restore before the step, or INDEX_NONE to continue from the previous step */
+	int32 KeyframeIndex = INDEX_NONE;
+
+	FKawaiiPhysicsSolverParams Params;
+	FTransform ComponentTransform;
+	TArray<FVector> PoseLocations;
+	TArray<FQuat> PoseRotations;
+
+	/** Simulated bones, after the dormant chains were removed */
+	TArray<int32> SimulatedBoneIndices;
+
+	/** Wind velocity of each bone, or empty if there is no wind */
+	TArray<FVector> WindVelocities;
+
+	/** Movement of each bone by the external forces, or empty if there are none */
+	TArray<FVector> ExternalForceOffsets;
+
+	/** Movement of each bone by the world collision, or empty if it is not used */
+	TArray<FVector> WorldCollisionOffsets;
+
+	/** Collision limits in component space. Distance fields point into FKawaiiPhysicsCapture::DistanceFields */
+	FKawaiiPhysicsPackedLimits Limits;
+
+	/** Locations of the bones after the step */
+	TArray<FVector> ResultLocations;
+
+	void Reset();
+};
+
+/**
+ * Whole capture loaded from a file, for the replay.
+ */
+struct KAWAIIPHYSICS_API FKawaiiPhysicsCapture
+{
+	/** Unreal Insights scope name of the captured node */
+	FString NodeName;
+
+	TArray<FKawaiiPhysicsCaptureKeyframe> Keyframes;
+	TArray<FKawaiiPhysicsCaptureStep> Steps;
+	TArray<TUniquePtr<FKawaiiPhysicsDistanceField>> DistanceFields;
+
+	/**
+	 * Loads a capture.
+	 *
+	 * @param Path The capture file.
+	 * @param OutError Receives the reason if the capture cannot be loaded.
+	 * @return Whether the capture was loaded.
+	 */
+	bool Load(const FString& Path, FString& OutError);
+};
+
+/**
+ * Writes the steps of a node to a capture file. Used by the evaluation of one node at a time.
+ */
+class KAWAIIPHYSICS_API FKawaiiPhysicsCaptureWriter
+{
+public:
+	/**
+	 * Opens a capture for a node if one was requested since the last call and the node matches the filter.
+	 *
+	 * @param InOutRequestSerial The last request seen by the node.
+	 * @param NodeName The Unreal Insights scope name of the node.
+	 * @return The writer, or null.
+	 */
+	static TSharedPtr<FKawaiiPhysicsCaptureWriter> CreateIfRequested(uint32& InOutRequestSerial,
+	                                                                 const FString& NodeName);
+
+	FKawaiiPhysicsCaptureWriter(TUniquePtr<FArchive>&& InArchive, const FString& NodeName, int32 InNumSteps);
+	~FKawaiiPhysicsCaptureWriter();
+
+	/**
+	 * Starts a step, writing a keyframe first if the state is not the one the previous step ended with.
+	 *
+	 * @param State The solver state before the step.
+	 * @param Constraints The merged bone constraints.
+	 * @param ConstraintColorStarts The start of each color in Constraints, plus the end.
+	 * @param Limits The packed collision limits.
+	 */
+	void BeginStep(const FKawaiiPhysicsSolverState& State, TConstArrayView<FModifyBoneConstraint> Constraints,
+	               TConstArrayView<int32> ConstraintColorStarts, const FKawaiiPhysicsPackedLimits& Limits);
+
+	/** Drops the current step, e.g. when every chain is dormant */
+	void DiscardStep();
+
+	void SetParams(const FKawaiiPhysicsSolverParams& Params, const FTransform& ComponentTransform);
+	void SetSimulatedBoneIndices(TConstArrayView<int32> SimulatedBoneIndices);
+	void SetWindVelocity(int32 Index, const FVector& WindVelocity);
+	void AddExternalForceOffset(int32 Index, const FVector& Offset);
+	void AddWorldCollisionOffset(int32 Index, const FVector& Offset);
+
+	/**
+	 * Writes the current step.
+	 *
+	 * @param State The solver state after the step.
+	 * @return False once all the requested steps are written.
+	 */
+	bool EndStep(const FKawaiiPhysicsSolverState& State);
+
+private:
+	bool NeedsKeyframe(const FKawaiiPhysicsSolverState& State, TConstArrayView<FModifyBoneConstraint> Constraints,
+	                   TConstArrayView<int32> ConstraintColorStarts) const;
+
+	TUniquePtr<FArchive> Archive;
+	int32 NumSteps = 0;
+	int32 NumWrittenSteps = 0;
+	bool bInStep = false;
+
+	FKawaiiPhysicsCaptureStep Step;
+
+	/** State the last written step ended with */
+	FKawaiiPhysicsSolverState EndState;
+	bool bHasEndState = false;
+	const FModifyBoneConstraint* KeyframeConstraints = nullptr;
+	int32 NumKeyframeConstraints = 0;
+	int32 NumKeyframeConstraintColors = 0;
+
+	TMap<const FKawaiiPhysicsDistanceField*, int32> DistanceFieldIndices;
+};
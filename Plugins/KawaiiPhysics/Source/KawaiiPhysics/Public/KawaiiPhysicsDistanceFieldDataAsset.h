@@ -0,0 +1,115 @@
+// KawaiiPhysics : Copyright (c) 2019-2024 pafuhana1213, MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "KawaiiPhysicsDistanceFieldDataAsset.generated.h"
+
+class UPhysicsAsset;
+class USkeletalMesh;
+
+/**
+ * Geometry a KawaiiPhysics distance field is baked from.
+ */
+UENUM()
+enum class EKawaiiPhysicsDistanceFieldSource : uint8
+{
+	/** Spheres, capsules and boxes of the bodies of a PhysicsAsset */
+	PhysicsAsset,
+	/** Triangles of LOD 0 of a skeletal mesh */
+	Mesh,
+};
+
+/**
+ * Signed distance field sampled on a regular grid in the space of the bone it is attached to.
+ * Distances are negative inside the body.
+ */
+USTRUCT()
+struct KAWAIIPHYSICS_API FKawaiiPhysicsDistanceField
+{
+	GENERATED_BODY()
+
+	/** Bounds of the grid in the space of the bone */
+	UPROPERTY(VisibleAnywhere, Category = "Distance Field")
+	FBox Bounds = FBox(ForceInit);
+
+	/** Number of samples along each axis */
+	UPROPERTY(VisibleAnywhere, Category = "Distance Field")
+	FIntVector Resolution = FIntVector::ZeroValue;
+
+	/** Signed distance of each sample, X first */
+	UPROPERTY()
+	TArray<float> Distances;
+
+	bool IsValid() const
+	{
+		return Resolution.X >= 2 && Resolution.Y >= 2 && Resolution.Z >= 2 &&
+			Distances.Num() == Resolution.X * Resolution.Y * Resolution.Z;
+	}
+
+	/**
+	 * Samples the field with trilinear interpolation.
+	 *
+	 * @param LocalLocation Location in the space of the bone. Clamped to Bounds.
+	 * @param OutGradient Gradient of the interpolated distance, not normalized.
+	 * @return The signed distance.
+	 */
+	float Sample(const FVector& LocalLocation, FVector& OutGradient) const;
+};
+
+/**
+ * Data asset holding a signed distance field baked around a body region, used by FDistanceFieldLimit.
+ * Bones resolve collision against the whole region with one lookup, however many primitives it was baked from.
+ */
+UCLASS(Blueprintable)
+class KAWAIIPHYSICS_API UKawaiiPhysicsDistanceFieldDataAsset : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+#if WITH_EDITORONLY_DATA
+	/** Geometry to bake */
+	UPROPERTY(EditAnywhere, Category = "Bake")
+	EKawaiiPhysicsDistanceFieldSource Source = EKawaiiPhysicsDistanceFieldSource::PhysicsAsset;
+
+	/** PhysicsAsset whose bodies are baked */
+	UPROPERTY(EditAnywhere, Category = "Bake",
+		meta = (EditCondition = "Source == EKawaiiPhysicsDistanceFieldSource::PhysicsAsset", EditConditionHides))
+	TObjectPtr<UPhysicsAsset> PhysicsAsset;
+
+	/** Skeletal mesh giving the reference pose, and the triangles when baking the mesh. Defaults to the preview mesh of the PhysicsAsset */
+	UPROPERTY(EditAnywhere, Category = "Bake")
+	TObjectPtr<USkeletalMesh> SkeletalMesh;
+
+	/** Bone the field is attached to. Use it as the DrivingBone of the limit */
+	UPROPERTY(EditAnywhere, Category = "Bake")
+	FName AttachBoneName;
+
+	/** Bones whose bodies, or mostly skinned triangles, are baked. Every bone if empty */
+	UPROPERTY(EditAnywhere, Category = "Bake")
+	TArray<FName> SourceBoneNames;
+
+	/** Space between the samples */
+	UPROPERTY(EditAnywhere, Category = "Bake", meta = (ClampMin = "0.1"))
+	float CellSize = 2.0f;
+
+	/** Largest number of samples along an axis. The cells are enlarged to stay within it */
+	UPROPERTY(EditAnywhere, Category = "Bake", meta = (ClampMin = "2", ClampMax = "128"))
+	int32 MaxResolution = 32;
+
+	/** Space added around the body. Bones outside of the field are not tested, so keep it above the bone radii */
+	UPROPERTY(EditAnywhere, Category = "Bake", meta = (ClampMin = "0"))
+	float Padding = 10.0f;
+#endif
+
+	/** Baked field */
+	UPROPERTY(VisibleAnywhere, Category = "Distance Field")
+	FKawaiiPhysicsDistanceField DistanceField;
+
+#if WITH_EDITOR
+	/** Bakes DistanceField from the source geometry in the reference pose */
+	UFUNCTION(CallInEditor, Category = "Bake")
+	void Bake();
+#endif
+};
@@ -36,6 +36,40 @@ enum class EExternalForceCurveEvaluateType : uint8
 	Min
 };
 
+/**
+ * Bones of a simulation step that an external force is applied to at once.
+ * The arrays are indexed like FAnimNode_KawaiiPhysics::ModifyBones.
+ */
+struct FKawaiiPhysicsExternalForceBatch
+{
+	FKawaiiPhysicsExternalForceBatch(FAnimNode_KawaiiPhysics& InNode, const FComponentSpacePoseContext& InPoseContext,
+	                                 TConstArrayView<int32> InBoneIndices, TArrayView<FVector> InLocations,
+	                                 TConstArrayView<FVector> InPoseLocations,
+	                                 TConstArrayView<FTransform> InBoneTransforms)
+		: Node(InNode)
+		  , PoseContext(InPoseContext)
+		  , BoneIndices(InBoneIndices)
+		  , Locations(InLocations)
+		  , PoseLocations(InPoseLocations)
+		  , BoneTransforms(InBoneTransforms)
+	{
+	}
+
+	FAnimNode_KawaiiPhysics& Node;
+	const FComponentSpacePoseContext& PoseContext;
+
+	/** Simulated bones of the step, parents first */
+	TConstArrayView<int32> BoneIndices;
+
+	/** Current location of each bone, moved by the forces */
+	TArrayView<FVector> Locations;
+
+	/** Pose location of each bone */
+	TConstArrayView<FVector> PoseLocations;
+
+	/** Component space transform of each bone (the parent's for dummy bones). Only filled if a force is in bone space */
+	TConstArrayView<FTransform> BoneTransforms;
+};
 
 ///
 /// Base
@@ -135,6 +169,29 @@ public:
 	{
 	}
 
+	/**
+	 * Whether ApplyBatch is implemented.
+	 * The built-in forces are always applied with ApplyBatch, while their subclasses are applied bone by bone
+	 * unless they opt in here, since they may only override Apply.
+	 */
+	virtual bool SupportsApplyBatch() const
+	{
+		return false;
+	}
+
+	/** Applies the external force to all the simulated bones of a step at once */
+	virtual void ApplyBatch(const FKawaiiPhysicsExternalForceBatch& Batch)
+	{
+	}
+
+	/**
+	 * Checks if an external force can be applied with ApplyBatch.
+	 *
+	 * @param ExternalForce The external force.
+	 * @return True if ApplyBatch can be used instead of Apply.
+	 */
+	static bool CanApplyBatch(const FInstancedStruct& ExternalForce);
+
 	/** Finalizes the external force after applying it */
 	virtual void PostApply(FAnimNode_KawaiiPhysics& Node)
 	{
@@ -220,6 +277,19 @@ protected:
 
 		return true;
 	}
+
+	/** Gets the curve correcting the force rate of each bone, or nullptr if it is not set */
+	static const FRichCurve* GetForceRateCurve(const FRuntimeFloatCurve& ForceRateByBoneLengthRate)
+	{
+		const FRichCurve* Curve = ForceRateByBoneLengthRate.GetRichCurveConst();
+		return Curve && !Curve->IsEmpty() ? Curve : nullptr;
+	}
+
+#if ENABLE_ANIM_DEBUG
+	/** Records the force applied to a bone by ApplyBatch for debug drawing */
+	void AddBatchDebugForce(const FKawaiiPhysicsExternalForceBatch& Batch, int32 Index, const FVector& BoneForce,
+	                        bool bDrawBone);
+#endif
 };
 
 ///
@@ -251,6 +321,7 @@ struct KAWAIIPHYSICS_API FKawaiiPhysics_ExternalForce_Basic : public FKawaiiPhys
 	virtual void Apply(FKawaiiPhysicsModifyBone& Bone, FAnimNode_KawaiiPhysics& Node,
 	                   const FComponentSpacePoseContext& PoseContext,
 	                   const FTransform& BoneTM = FTransform::Identity) override;
+	virtual void ApplyBatch(const FKawaiiPhysicsExternalForceBatch& Batch) override;
 
 private:
 	/** Current time */
@@ -319,6 +390,7 @@ struct KAWAIIPHYSICS_API FKawaiiPhysics_ExternalForce_Gravity : public FKawaiiPh
 	virtual void Apply(FKawaiiPhysicsModifyBone& Bone, FAnimNode_KawaiiPhysics& Node,
 	                   const FComponentSpacePoseContext& PoseContext,
 	                   const FTransform& BoneTM = FTransform::Identity) override;
+	virtual void ApplyBatch(const FKawaiiPhysicsExternalForceBatch& Batch) override;
 };
 
 ///
@@ -407,6 +479,7 @@ public:
 	virtual void Apply(FKawaiiPhysicsModifyBone& Bone, FAnimNode_KawaiiPhysics& Node,
 	                   const FComponentSpacePoseContext& PoseContext,
 	                   const FTransform& BoneTM = FTransform::Identity) override;
+	virtual void ApplyBatch(const FKawaiiPhysicsExternalForceBatch& Batch) override;
 };
 
 ///
@@ -445,4 +518,5 @@ public:
 	virtual void Apply(FKawaiiPhysicsModifyBone& Bone, FAnimNode_KawaiiPhysics& Node,
 	                   const FComponentSpacePoseContext& PoseContext,
 	                   const FTransform& BoneTM = FTransform::Identity) override;
+	virtual void ApplyBatch(const FKawaiiPhysicsExternalForceBatch& Batch) override;
 };
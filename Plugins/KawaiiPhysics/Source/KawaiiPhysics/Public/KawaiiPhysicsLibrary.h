@@ -107,7 +107,27 @@ public:
 	static FKawaiiPhysicsReference SetPhysicsSettings(const FKawaiiPhysicsReference& KawaiiPhysics,
 	                                                  UPARAM(ref) FKawaiiPhysicsSettings& PhysicsSettings)
 	{
-		KAWAIIPHYSICS_VALUE_SETTER(FKawaiiPhysicsSettings, PhysicsSettings);
+		KawaiiPhysics.CallAnimNodeFunction<FAnimNode_KawaiiPhysics>(
+			TEXT("SetPhysicsSettings"),
+			[PhysicsSettings](FAnimNode_KawaiiPhysics& InKawaiiPhysics)
+			{
+				InKawaiiPhysics.PhysicsSettings = PhysicsSettings;
+				InKawaiiPhysics.MarkPhysicsSettingsDirty();
+			});
+		return KawaiiPhysics;
+	}
+
+	/** Recalculate the per-bone physics settings, e.g. after changing the curves */
+	UFUNCTION(BlueprintCallable, Category = "Kawaii Physics", meta=(BlueprintThreadSafe))
+	static FKawaiiPhysicsReference MarkPhysicsSettingsDirty(const FKawaiiPhysicsReference& KawaiiPhysics)
+	{
+		KawaiiPhysics.CallAnimNodeFunction<FAnimNode_KawaiiPhysics>(
+			TEXT("MarkPhysicsSettingsDirty"),
+			[](FAnimNode_KawaiiPhysics& InKawaiiPhysics)
+			{
+				InKawaiiPhysics.MarkPhysicsSettingsDirty();
+			});
+		return KawaiiPhysics;
 	}
 	
 	UFUNCTION(BlueprintPure, Category = "Kawaii Physics", meta=(BlueprintThreadSafe))
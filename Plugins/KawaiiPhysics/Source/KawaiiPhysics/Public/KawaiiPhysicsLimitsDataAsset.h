@@ -187,12 +187,27 @@ public:
 #if WITH_EDITOR
 	void UpdateLimit(FCollisionLimitBase* Limit);
 
+	/**
+	 * Gets the revision of the limits. Nodes apply the limits again when it changed.
+	 */
+	uint32 GetRevision() const { return Revision; }
+
+	/**
+	 * Bumps the revision after the limits were changed without going through the property system.
+	 */
+	void IncrementRevision() { ++Revision; }
+
 	FOnLimitsChanged OnLimitsChanged;
 	virtual void PostEditChangeChainProperty(FPropertyChangedChainEvent& PropertyChangedEvent) override;
+	virtual void PostEditUndo() override;
 #endif
 
 private:
 #if WITH_EDITOR
 	void Sync();
 #endif
+
+#if WITH_EDITORONLY_DATA
+	uint32 Revision = 0;
+#endif
 };
@@ -0,0 +1,78 @@
+// KawaiiPhysics : Copyright (c) 2019-2024 pafuhana1213, MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "KawaiiPhysicsRestStateDataAsset.generated.h"
+
+class USkeleton;
+
+/**
+ * Settled state of the modify bones of a FAnimNode_KawaiiPhysics, captured on a skeleton in a pose.
+ */
+USTRUCT(BlueprintType)
+struct KAWAIIPHYSICS_API FKawaiiPhysicsRestStateSnapshot
+{
+	GENERATED_BODY()
+
+	/** Skeleton the snapshot was captured on */
+	UPROPERTY(VisibleAnywhere, Category = "Rest State")
+	TSoftObjectPtr<USkeleton> Skeleton;
+
+	/** Name of each modify bone, in the order of the node */
+	UPROPERTY(VisibleAnywhere, Category = "Rest State")
+	TArray<FName> BoneNames;
+
+	/** Pose location of each bone relative to the first bone, in component space. Used to match the pose */
+	UPROPERTY()
+	TArray<FVector> PoseLocations;
+
+	/** Settled location of each bone relative to its pose location, in component space */
+	UPROPERTY()
+	TArray<FVector> Offsets;
+
+	/**
+	 * Gets how far the given pose is from the pose of the snapshot.
+	 *
+	 * @param InPoseLocations Pose location of each bone in component space.
+	 * @return The largest distance of a bone, or a negative value if the bones do not match.
+	 */
+	float GetPoseDistance(TConstArrayView<FVector> InPoseLocations) const;
+};
+
+/**
+ * Data asset holding settled states of KawaiiPhysics nodes, restored instead of running the warm up.
+ */
+UCLASS(Blueprintable)
+class KAWAIIPHYSICS_API UKawaiiPhysicsRestStateDataAsset : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** Captured snapshots */
+	UPROPERTY(EditAnywhere, Category = "Rest State", meta=(TitleProperty="Skeleton"))
+	TArray<FKawaiiPhysicsRestStateSnapshot> Snapshots;
+
+	/** Largest distance of a bone from the captured pose for a snapshot to be used */
+	UPROPERTY(EditAnywhere, Category = "Rest State", meta=(ClampMin="0"))
+	float PoseTolerance = 1.0f;
+
+	/**
+	 * Finds the snapshot captured closest to the given pose.
+	 *
+	 * @param Skeleton The skeleton of the node.
+	 * @param BoneNames Name of each modify bone.
+	 * @param PoseLocations Pose location of each modify bone in component space.
+	 * @return The snapshot, or nullptr if none is within PoseTolerance.
+	 */
+	const FKawaiiPhysicsRestStateSnapshot* FindSnapshot(const USkeleton* Skeleton, TConstArrayView<FName> BoneNames,
+	                                                    TConstArrayView<FVector> PoseLocations) const;
+
+	/**
+	 * Adds a snapshot, replacing the one captured on the same skeleton and bones in the same pose.
+	 *
+	 * @param Snapshot The snapshot to add.
+	 */
+	void AddSnapshot(const FKawaiiPhysicsRestStateSnapshot& Snapshot);
+};
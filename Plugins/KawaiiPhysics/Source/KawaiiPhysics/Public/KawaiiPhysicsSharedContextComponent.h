@@ -0,0 +1,129 @@
+// KawaiiPhysics : Copyright (c) 2019-2024 pafuhana1213, MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AnimNode_KawaiiPhysics.h"
+#include "Components/ActorComponent.h"
+#include "KawaiiPhysicsSharedContextComponent.generated.h"
+
+class USkeletalMeshComponent;
+
+/**
+ * Simulation context shared by the skeletal mesh components of a modular character, such as separate torso, head and
+ * legs meshes that each run their own anim instance.
+ * The KawaiiPhysics nodes of the limit source component publish their collision limits, and the nodes of the other
+ * members collide against them too. Hair on the head mesh can then hit limits driven by torso bones without setting up
+ * and updating the same limits again. Members tick after the limit source so that the limits are from the same frame,
+ * and can be simulated together in one pass by UKawaiiPhysicsSubsystem.
+ * Nodes whose bUseSharedContext is set find the context on their owning actor.
+ */
+UCLASS(ClassGroup = Animation, meta = (BlueprintSpawnableComponent))
+class KAWAIIPHYSICS_API UKawaiiPhysicsSharedContextComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UKawaiiPhysicsSharedContextComponent();
+
+	/**
+	* メンバーのKawaiiPhysicsをまとめて1回のパスでシミュレーション。bUseBatchedSimulationと同様に結果は1フレーム遅れて反映
+	* Simulate the KawaiiPhysics nodes of all the members together in one pass. Like bUseBatchedSimulation, results are one frame late
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "KawaiiPhysics")
+	bool bSimulateInOnePass = false;
+
+	/**
+	 * Sets the component whose KawaiiPhysics nodes publish their collision limits. It is added to the members.
+	 *
+	 * @param Component The limit source component.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "KawaiiPhysics")
+	void SetLimitSourceComponent(USkeletalMeshComponent* Component);
+
+	/**
+	 * Adds a component whose KawaiiPhysics nodes use this context. It ticks after the limit source component.
+	 *
+	 * @param Component The member component.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "KawaiiPhysics")
+	void AddMemberComponent(USkeletalMeshComponent* Component);
+
+	/**
+	 * Removes a member component.
+	 *
+	 * @param Component The member component.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "KawaiiPhysics")
+	void RemoveMemberComponent(USkeletalMeshComponent* Component);
+
+	USkeletalMeshComponent* GetLimitSourceComponent() const { return LimitSourceComponent; }
+
+	bool IsMember(const USkeletalMeshComponent* Component) const
+	{
+		return Component && MemberComponents.Contains(Component);
+	}
+
+	/**
+	 * Publishes the collision limits of a node of the limit source component, replacing the ones it published before.
+	 * Can be called from any thread.
+	 *
+	 * @param Publisher The publishing node.
+	 * @param Limits The packed limits in the component space of the limit source.
+	 * @param ComponentTransform The component transform of the limit source.
+	 */
+	void PublishLimits(const FAnimNode_KawaiiPhysics* Publisher, const FKawaiiPhysicsPackedLimits& Limits,
+	                   const FTransform& ComponentTransform);
+
+	/**
+	 * Removes the collision limits published by a node. Can be called from any thread.
+	 *
+	 * @param Publisher The publishing node.
+	 */
+	void UnpublishLimits(const FAnimNode_KawaiiPhysics* Publisher);
+
+	/**
+	 * Appends the published collision limits to the limits of a node, moved into its component space.
+	 * Limits that were not published in this or the previous frame are left out. Can be called from any thread.
+	 *
+	 * @param Limits The packed limits of the node.
+	 * @param ComponentTransform The component transform of the node.
+	 */
+	void AppendSharedLimits(FKawaiiPhysicsPackedLimits& Limits, const FTransform& ComponentTransform) const;
+
+	/**
+	 * Gets a number that changes whenever a context is registered or unregistered, so that nodes only need to look
+	 * up the context of their owner again when it changes. Game thread only.
+	 */
+	static uint32 GetRegistrationSerial() { return RegistrationSerial; }
+
+protected:
+	virtual void OnRegister() override;
+	virtual void OnUnregister() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/**
+	 * Makes a member tick after the limit source component.
+	 */
+	void AddLimitSourcePrerequisite(USkeletalMeshComponent* Component) const;
+
+private:
+	UPROPERTY(Transient)
+	TObjectPtr<USkeletalMeshComponent> LimitSourceComponent;
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<USkeletalMeshComponent>> MemberComponents;
+
+	struct FPublishedLimits
+	{
+		const FAnimNode_KawaiiPhysics* Publisher = nullptr;
+		FKawaiiPhysicsPackedLimits Limits;
+		FTransform ComponentTransform;
+		uint64 Frame = 0;
+	};
+
+	mutable FCriticalSection PublishedLimitsLock;
+	TArray<FPublishedLimits> PublishedLimits;
+
+	static uint32 RegistrationSerial;
+};
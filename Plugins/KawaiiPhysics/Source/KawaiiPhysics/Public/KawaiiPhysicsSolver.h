@@ -0,0 +1,218 @@
+// KawaiiPhysics : Copyright (c) 2019-2024 pafuhana1213, MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AnimNode_KawaiiPhysics.h"
+
+/**
+ * Per-step inputs of the solver.
+ * Everything the core solve needs from FAnimNode_KawaiiPhysics, so that it can also run without a node
+ * (e.g. batched by UKawaiiPhysicsSubsystem).
+ */
+struct KAWAIIPHYSICS_API FKawaiiPhysicsSolverParams
+{
+	/** Delta time of the current step */
+	float DeltaTime = 0.0f;
+
+	/** Delta time of the previous step, used to get the velocity */
+	float DeltaTimeOld = 0.0f;
+
+	/** Target frame rate of the node */
+	int32 TargetFramerate = 60;
+
+	/** Gravity in component space */
+	FVector GravityCS = FVector::ZeroVector;
+
+	/** Movement of the skeletal mesh component since the previous step, in component space */
+	FVector SkelCompMoveVector = FVector::ZeroVector;
+
+	/** Rotation of the skeletal mesh component since the previous step, in component space */
+	FQuat SkelCompMoveRotation = FQuat::Identity;
+
+	/** Planar constraint of the node */
+	EPlanarConstraint PlanarConstraint = EPlanarConstraint::None;
+
+	/** Compliance of bone constraints that do not override it */
+	EXPBDComplianceType BoneConstraintGlobalComplianceType = EXPBDComplianceType::Leather;
+
+	/** Number of bone constraint iterations after collision */
+	int32 BoneConstraintIterationCountAfterCollision = 1;
+
+	/** How the bone constraints are solved */
+	EKawaiiPhysicsBoneConstraintSolver BoneConstraintSolver = EKawaiiPhysicsBoneConstraintSolver::GaussSeidel;
+
+	/** Exponent used to make stiffness independent of the frame rate */
+	float GetExponent() const { return TargetFramerate * DeltaTime; }
+};
+
+/**
+ * Core solver of KawaiiPhysics, working only on FKawaiiPhysicsSolverState.
+ * FAnimNode_KawaiiPhysics calls these pieces one by one so that it can insert external forces and world collision;
+ * Step runs all of them for chains that use neither.
+ */
+namespace KawaiiPhysicsSolver
+{
+	/**
+	 * Decides which bones are simulated in this step and moves the root bones to their pose.
+	 *
+	 * @param State The solver state.
+	 * @param OutSimulatedBoneIndices Receives the indices of the simulated bones, parents first.
+	 */
+	KAWAIIPHYSICS_API void PrepareStep(FKawaiiPhysicsSolverState& State, TArray<int32>& OutSimulatedBoneIndices);
+
+	/**
+	 * Marks the bones PrepareStep would simulate but that were removed from SimulatedBoneIndices as dormant,
+	 * so that SolveBoneConstraints skips the constraints between them.
+	 *
+	 * @param State The solver state, after PrepareStep.
+	 * @param SimulatedBoneIndices The bones simulated in this step.
+	 */
+	KAWAIIPHYSICS_API void MarkDormantBones(FKawaiiPhysicsSolverState& State,
+	                                        TConstArrayView<int32> SimulatedBoneIndices);
+
+	/**
+	 * Moves a bone by its velocity, wind, the movement of the component and gravity.
+	 *
+	 * @param State The solver state.
+	 * @param Index The index of the bone.
+	 * @param Params The step parameters.
+	 * @param WindVelocity Wind velocity at the bone, or nullptr if there is no wind.
+	 */
+	KAWAIIPHYSICS_API void Integrate(FKawaiiPhysicsSolverState& State, int32 Index,
+	                                 const FKawaiiPhysicsSolverParams& Params, const FVector* WindVelocity);
+
+	/**
+	 * Pulls a bone back towards its pose location, relative to its (already simulated) parent.
+	 *
+	 * @param State The solver state.
+	 * @param Index The index of the bone.
+	 * @param Exponent The exponent returned by FKawaiiPhysicsSolverParams::GetExponent.
+	 */
+	KAWAIIPHYSICS_API void PullToPose(FKawaiiPhysicsSolverState& State, int32 Index, float Exponent);
+
+	/**
+	 * Runs one Gauss-Seidel XPBD iteration over the bone constraints.
+	 *
+	 * @param State The solver state.
+	 * @param Constraints The bone constraints.
+	 * @param Params The step parameters.
+	 */
+	KAWAIIPHYSICS_API void AdjustByBoneConstraints(FKawaiiPhysicsSolverState& State,
+	                                               TConstArrayView<FModifyBoneConstraint> Constraints,
+	                                               const FKawaiiPhysicsSolverParams& Params);
+
+	/**
+	 * Runs one XPBD iteration over colored bone constraints. The constraints of a color are solved in parallel.
+	 *
+	 * @param State The solver state.
+	 * @param Constraints The bone constraints, sorted by color.
+	 * @param ColorStarts The start of each color in Constraints, plus the end.
+	 * @param Params The step parameters.
+	 */
+	KAWAIIPHYSICS_API void AdjustByBoneConstraintsColored(FKawaiiPhysicsSolverState& State,
+	                                                      TConstArrayView<FModifyBoneConstraint> Constraints,
+	                                                      TConstArrayView<int32> ColorStarts,
+	                                                      const FKawaiiPhysicsSolverParams& Params);
+
+	/**
+	 * Runs one Jacobi XPBD iteration over the bone constraints.
+	 * Every constraint is solved from the same locations, and the corrections of each bone are averaged.
+	 *
+	 * @param State The solver state.
+	 * @param Constraints The bone constraints.
+	 * @param Params The step parameters.
+	 * @param Corrections Scratch array for the corrections of each bone.
+	 * @param CorrectionCounts Scratch array for the number of corrections of each bone.
+	 */
+	KAWAIIPHYSICS_API void AdjustByBoneConstraintsJacobi(FKawaiiPhysicsSolverState& State,
+	                                                     TConstArrayView<FModifyBoneConstraint> Constraints,
+	                                                     const FKawaiiPhysicsSolverParams& Params,
+	                                                     TArray<FVector>& Corrections,
+	                                                     TArray<int32>& CorrectionCounts);
+
+	/**
+	 * Resets the constraint lambdas and runs all bone constraint iterations of a step.
+	 * Constraints between two dormant bones are skipped, and a dormant bone a constraint moves is no longer dormant.
+	 *
+	 * @param State The solver state.
+	 * @param Constraints The bone constraints.
+	 * @param Params The step parameters.
+	 * @param ColorStarts The start of each color in Constraints, plus the end. Empty if not colored.
+	 * @param OutMetrics If set, receives the convergence of the constraints.
+	 */
+	KAWAIIPHYSICS_API void SolveBoneConstraints(FKawaiiPhysicsSolverState& State,
+	                                            TConstArrayView<FModifyBoneConstraint> Constraints,
+	                                            const FKawaiiPhysicsSolverParams& Params,
+	                                            TConstArrayView<int32> ColorStarts = {},
+	                                            FKawaiiPhysicsBoneConstraintMetrics* OutMetrics = nullptr);
+
+	/**
+	 * Colors the bone constraints so that no two constraints of a color share a bone, and sorts them by color.
+	 *
+	 * @param Constraints The bone constraints. Sorted by color on return.
+	 * @param NumBones The number of modify bones.
+	 * @param OutColorStarts Receives the start of each color, plus the end.
+	 */
+	KAWAIIPHYSICS_API void ColorBoneConstraints(TArray<FModifyBoneConstraint>& Constraints, int32 NumBones,
+	                                            TArray<int32>& OutColorStarts);
+
+	/**
+	 * Measures the length error of the bone constraints.
+	 *
+	 * @param State The solver state.
+	 * @param Constraints The bone constraints.
+	 * @param OutRMSError Receives the RMS of the errors.
+	 * @param OutMaxError Receives the largest error.
+	 */
+	KAWAIIPHYSICS_API void MeasureBoneConstraintError(const FKawaiiPhysicsSolverState& State,
+	                                                  TConstArrayView<FModifyBoneConstraint> Constraints,
+	                                                  float& OutRMSError, float& OutMaxError);
+
+	/**
+	 * Adjusts the bone position based on angle limits.
+	 *
+	 * @param State The solver state.
+	 * @param Index The index of the bone to adjust.
+	 * @param ParentIndex The index of the parent bone.
+	 */
+	KAWAIIPHYSICS_API void AdjustByAngleLimit(FKawaiiPhysicsSolverState& State, int32 Index, int32 ParentIndex);
+
+	/**
+	 * Adjusts the bone position based on planar constraints.
+	 *
+	 * @param State The solver state.
+	 * @param Index The index of the bone to adjust.
+	 * @param ParentIndex The index of the parent bone.
+	 * @param PlanarConstraint The planar constraint axis.
+	 */
+	KAWAIIPHYSICS_API void AdjustByPlanarConstraint(FKawaiiPhysicsSolverState& State, int32 Index, int32 ParentIndex,
+	                                                EPlanarConstraint PlanarConstraint);
+
+	/**
+	 * Applies angle limits and planar constraints, then restores the bone lengths.
+	 *
+	 * @param State The solver state.
+	 * @param SimulatedBoneIndices The bones simulated in this step, parents first.
+	 * @param Params The step parameters.
+	 */
+	KAWAIIPHYSICS_API void FinishStep(FKawaiiPhysicsSolverState& State, TConstArrayView<int32> SimulatedBoneIndices,
+	                                  const FKawaiiPhysicsSolverParams& Params);
+
+	/**
+	 * Runs a whole step for chains without external forces and world collision.
+	 *
+	 * @param State The solver state.
+	 * @param SimulatedBoneIndices Scratch array that receives the simulated bones.
+	 * @param Limits The packed collision limits.
+	 * @param Constraints The bone constraints.
+	 * @param ConstraintColorStarts The start of each color in Constraints, plus the end. Empty if not colored.
+	 * @param Params The step parameters.
+	 * @param WindVelocities Wind velocity of each bone, or empty if there is no wind.
+	 */
+	KAWAIIPHYSICS_API void Step(FKawaiiPhysicsSolverState& State, TArray<int32>& SimulatedBoneIndices,
+	                            const FKawaiiPhysicsPackedLimits& Limits,
+	                            TConstArrayView<FModifyBoneConstraint> Constraints,
+	                            TConstArrayView<int32> ConstraintColorStarts,
+	                            const FKawaiiPhysicsSolverParams& Params, TConstArrayView<FVector> WindVelocities);
+}
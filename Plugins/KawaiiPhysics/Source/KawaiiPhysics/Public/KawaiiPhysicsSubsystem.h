@@ -0,0 +1,201 @@
+// KawaiiPhysics : Copyright (c) 2019-2024 pafuhana1213, MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "KawaiiPhysicsSolver.h"
+#include "WorldCollision.h"
+#include "Subsystems/WorldSubsystem.h"
+
+#include <atomic>
+
+#include "KawaiiPhysicsSubsystem.generated.h"
+
+/**
+ * One simulation step of a FAnimNode_KawaiiPhysics, handed off to UKawaiiPhysicsSubsystem.
+ * The node owns the job and only touches it while it is idle; the subsystem only touches it while it is running.
+ */
+struct KAWAIIPHYSICS_API FKawaiiPhysicsBatchJob
+{
+	enum class EState : uint8
+	{
+		/** Owned by the node */
+		Idle,
+		/** Filled by the node and waiting for the subsystem */
+		Pending,
+		/** Being simulated by the subsystem */
+		Running,
+	};
+
+	/** Copy of the node's solver state. Holds the result once the job has run */
+	FKawaiiPhysicsSolverState State;
+
+	/** Copy of the node's packed collision limits */
+	FKawaiiPhysicsPackedLimits Limits;
+
+	/** Copy of the node's bone constraints. Empty if the node shares ChainTemplate */
+	TArray<FModifyBoneConstraint> Constraints;
+
+	/** Copy of the node's bone constraint colors. Empty if the constraints are not colored */
+	TArray<int32> ConstraintColorStarts;
+
+	/** Shared chains of the node. Their constraints are used instead of copying them every step */
+	TSharedPtr<const FKawaiiPhysicsChainTemplate, ESPMode::ThreadSafe> ChainTemplate;
+
+	/** Wind velocity of each bone, sampled by the node. Empty if wind is disabled */
+	TArray<FVector> WindVelocities;
+
+	/** Step parameters */
+	FKawaiiPhysicsSolverParams Params;
+
+	/** Number of steps to simulate with Params */
+	int32 NumSubsteps = 1;
+
+	/** Scratch array for the solver */
+	TArray<int32> SimulatedBoneIndices;
+
+	std::atomic<EState> JobState{EState::Idle};
+
+	/** Whether the job is in the subsystem's queue */
+	std::atomic<bool> bQueued{false};
+
+	/** Whether State holds a result the node has not adopted yet */
+	bool bHasResult = false;
+
+	/**
+	 * Takes the job back from the subsystem so that the node can read or refill it.
+	 * A pending job is cancelled.
+	 *
+	 * @return False if the subsystem is simulating the job right now.
+	 */
+	bool TryAcquire()
+	{
+		EState Expected = EState::Pending;
+		if (JobState.compare_exchange_strong(Expected, EState::Idle))
+		{
+			return true;
+		}
+		return Expected == EState::Idle;
+	}
+};
+
+/**
+ * World collision sweeps of one FAnimNode_KawaiiPhysics for one frame, traced asynchronously by
+ * UKawaiiPhysicsSubsystem. The node owns the batch while it is idle or ready; the subsystem owns it while it is
+ * submitted or in flight.
+ */
+struct KAWAIIPHYSICS_API FKawaiiPhysicsWorldCollisionBatch
+{
+	enum class EState : uint8
+	{
+		/** Owned by the node */
+		Idle,
+		/** Filled by the node and waiting for the subsystem */
+		Submitted,
+		/** Sweeps are being traced */
+		InFlight,
+		/** Results are ready to be applied by the node */
+		Ready,
+	};
+
+	/** Sphere sweep of one bone */
+	struct FSweep
+	{
+		int32 BoneIndex = INDEX_NONE;
+		FName BoneName;
+		FVector Start = FVector::ZeroVector;
+		FVector End = FVector::ZeroVector;
+		float Radius = 0.0f;
+
+		FTraceHandle Handle;
+
+		/** First hit that is not ignored, valid if bHit is set */
+		FHitResult Hit;
+		bool bHit = false;
+	};
+
+	/** Range of sweeps whose bones hang from the same child of a root bone, tested together in the broadphase */
+	struct FChain
+	{
+		int32 FirstSweep = 0;
+		int32 NumSweeps = 0;
+		FBox Bounds = FBox(ForceInit);
+	};
+
+	/** Owning component, ignored if bIgnoreSelfComponent is set */
+	TWeakObjectPtr<const USkeletalMeshComponent> Component;
+
+	ECollisionChannel TraceChannel = ECC_WorldDynamic;
+	FCollisionResponseParams ResponseParams;
+	bool bIgnoreSelfComponent = true;
+	TArray<FBoneReference> IgnoreBones;
+	TArray<FName> IgnoreBoneNamePrefix;
+
+	TArray<FSweep> Sweeps;
+	TArray<FChain> Chains;
+
+	/** Increasing number given by the node, to find the newest results */
+	uint64 Sequence = 0;
+
+	std::atomic<EState> BatchState{EState::Idle};
+};
+
+/**
+ * World-wide services for KawaiiPhysics nodes.
+ * Simulates the nodes that opted in to bUseBatchedSimulation: nodes submit a job during animation evaluation; all jobs
+ * submitted during a frame are simulated together in one ParallelFor at the end of the frame and adopted by the nodes
+ * on their next evaluation (one frame of latency).
+ * Traces the world collision of nodes with bUseAsyncWorldCollision asynchronously, with a broadphase per chain.
+ * Also keeps the per-frame budget of simulated bones used by the simulation LOD.
+ */
+UCLASS()
+class KAWAIIPHYSICS_API UKawaiiPhysicsSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Queues a job to be simulated at the end of the frame. Can be called from any thread.
+	 *
+	 * @param Job The job. Its state must be Pending.
+	 */
+	void SubmitJob(const TSharedRef<FKawaiiPhysicsBatchJob, ESPMode::ThreadSafe>& Job);
+
+	/**
+	 * Reserves bones from the budget of simulated bones of the current frame
+	 * (a.AnimNode.KawaiiPhysics.LOD.MaxSimulatedBonesPerFrame). Can be called from any thread.
+	 *
+	 * @param NumBones The number of bones to simulate.
+	 * @param bForce Reserve even if the budget is used up.
+	 * @return False if the budget is used up and the node should not simulate in this frame.
+	 */
+	bool TryReserveSimulatedBones(int32 NumBones, bool bForce);
+
+	/**
+	 * Queues world collision sweeps to be traced asynchronously. Can be called from any thread.
+	 *
+	 * @param Batch The sweeps. Its state must be Submitted.
+	 */
+	void SubmitWorldCollision(const TSharedRef<FKawaiiPhysicsWorldCollisionBatch, ESPMode::ThreadSafe>& Batch);
+
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/**
+	 * Issues the submitted world collision sweeps and collects the results of the ones in flight.
+	 */
+	void UpdateWorldCollisions();
+
+private:
+	FCriticalSection PendingJobsLock;
+	TArray<TSharedRef<FKawaiiPhysicsBatchJob, ESPMode::ThreadSafe>> PendingJobs;
+	TArray<TSharedRef<FKawaiiPhysicsWorldCollisionBatch, ESPMode::ThreadSafe>> PendingWorldCollisions;
+	TArray<TSharedRef<FKawaiiPhysicsWorldCollisionBatch, ESPMode::ThreadSafe>> InFlightWorldCollisions;
+
+	/** Frame number in the upper 32 bits and bones simulated in that frame in the lower 32 bits */
+	std::atomic<uint64> SimulatedBoneBudget{0};
+};
@@ -0,0 +1,92 @@
+// KawaiiPhysics : Copyright (c) 2019-2024 pafuhana1213, MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "Trace/Trace.h"
+
+#ifndef KAWAIIPHYSICS_TRACE_ENABLED
+#define KAWAIIPHYSICS_TRACE_ENABLED (UE_TRACE_ENABLED && !UE_BUILD_SHIPPING)
+#endif
+
+#if KAWAIIPHYSICS_TRACE_ENABLED
+/**
+ * Unreal Insights channel of KawaiiPhysics. Enable it with -trace=cpu,kawaiiphysics or "Trace.Enable KawaiiPhysics".
+ * Each node evaluation then gets its own timing scope named after the owning actor class and KawaiiPhysicsTag,
+ * and a NodeEvaluation event holding the counters below.
+ */
+UE_TRACE_CHANNEL_EXTERN(KawaiiPhysicsChannel, KAWAIIPHYSICS_API);
+#endif
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(KAWAIIPHYSICS_API, KawaiiPhysics);
+
+/**
+ * Counters of one evaluation of a FAnimNode_KawaiiPhysics.
+ */
+struct FKawaiiPhysicsEvaluationStats
+{
+	/** Number of bones of the node */
+	int32 NumBones = 0;
+
+	/** Number of bones simulated, summed over the substeps */
+	int32 NumSimulatedBones = 0;
+
+	/** Number of simulated substeps */
+	int32 NumSubsteps = 0;
+
+	/** Number of collision limits, including the ones shared by a KawaiiPhysicsSharedContextComponent */
+	int32 NumLimits = 0;
+
+	/** Number of bone constraints */
+	int32 NumBoneConstraints = 0;
+
+	/** Number of bone constraint iterations, summed over the substeps */
+	int32 NumBoneConstraintIterations = 0;
+
+	/** Number of world collision sweeps issued */
+	int32 NumWorldSweeps = 0;
+
+	/** Number of dormant sleep chains */
+	int32 NumDormantChains = 0;
+
+	/** EKawaiiPhysicsLODTier of the node */
+	uint8 LODTier = 0;
+
+	/** Whether the substeps were handed over to UKawaiiPhysicsSubsystem */
+	bool bBatched = false;
+
+	/** Cycles spent integrating the bones and applying the external forces, limit angles and bone lengths */
+	uint64 SimulateCycles = 0;
+
+	/** Cycles spent in the collision limits and the world collision */
+	uint64 CollisionCycles = 0;
+
+	/** Cycles spent solving the bone constraints */
+	uint64 BoneConstraintCycles = 0;
+
+	/** Cycles spent writing the simulated bone transforms */
+	uint64 ApplySimulateResultCycles = 0;
+};
+
+namespace KawaiiPhysicsTrace
+{
+	/**
+	 * Checks if evaluation stats are recorded, i.e. the trace channel is enabled or a CSV profile is being captured.
+	 */
+	KAWAIIPHYSICS_API bool IsRecording();
+
+	/**
+	 * Sends the stats of one node evaluation to Unreal Insights and the CSV profiler.
+	 * The CSV profiler gets the totals of all nodes, plus the time spent per character type.
+	 *
+	 * @param NodeId Identifies the node within the capture.
+	 * @param OwnerName Class name of the owning actor, used as the character type.
+	 * @param Tag KawaiiPhysicsTag of the node.
+	 * @param StartCycle FPlatformTime::Cycles64 at the start of the evaluation.
+	 * @param EndCycle FPlatformTime::Cycles64 at the end of the evaluation.
+	 * @param Stats Counters of the evaluation.
+	 */
+	KAWAIIPHYSICS_API void OutputEvaluation(uint64 NodeId, FName OwnerName, FName Tag, uint64 StartCycle,
+	                                        uint64 EndCycle, const FKawaiiPhysicsEvaluationStats& Stats);
+}
@@ -7,8 +7,10 @@
 #include "DetailCategoryBuilder.h"
 #include "DetailLayoutBuilder.h"
 #include "DetailWidgetRow.h"
+#include "KawaiiPhysicsBakedMotionDataAsset.h"
 #include "KawaiiPhysicsBoneConstraintsDataAsset.h"
 #include "KawaiiPhysicsLimitsDataAsset.h"
+#include "KawaiiPhysicsRestStateDataAsset.h"
 #include "Widgets/Input/SButton.h"
 #include "Framework/Notifications/NotificationManager.h"
 #include "Selection.h"
@@ -122,6 +124,9 @@ void UAnimGraphNode_KawaiiPhysics::CopyNodeDataToPreviewNode(FAnimNode_Base* Ani
 	KawaiiPhysics->AdditionalRootBones = Node.AdditionalRootBones;
 	KawaiiPhysics->TargetFramerate = Node.TargetFramerate;
 	KawaiiPhysics->OverrideTargetFramerate = Node.OverrideTargetFramerate;
+	KawaiiPhysics->FixedTimestepRate = Node.FixedTimestepRate;
+	KawaiiPhysics->bUseFixedTimestep = Node.bUseFixedTimestep;
+	KawaiiPhysics->MaxSubsteps = Node.MaxSubsteps;
 
 	// Physics Settings
 	KawaiiPhysics->PhysicsSettings = Node.PhysicsSettings;
@@ -143,6 +148,7 @@ void UAnimGraphNode_KawaiiPhysics::CopyNodeDataToPreviewNode(FAnimNode_Base* Ani
 	KawaiiPhysics->SphericalLimits = Node.SphericalLimits;
 	KawaiiPhysics->CapsuleLimits = Node.CapsuleLimits;
 	KawaiiPhysics->BoxLimits = Node.BoxLimits;
+	KawaiiPhysics->DistanceFieldLimits = Node.DistanceFieldLimits;
 	KawaiiPhysics->PlanarLimits = Node.PlanarLimits;
 	KawaiiPhysics->LimitsDataAsset = Node.LimitsDataAsset;
 	KawaiiPhysics->PhysicsAssetForLimits = Node.PhysicsAssetForLimits;
@@ -155,17 +161,31 @@ void UAnimGraphNode_KawaiiPhysics::CopyNodeDataToPreviewNode(FAnimNode_Base* Ani
 	// Wind
 	KawaiiPhysics->bEnableWind = Node.bEnableWind;
 	KawaiiPhysics->WindScale = Node.WindScale;
+	KawaiiPhysics->WindGustFrequency = Node.WindGustFrequency;
+	KawaiiPhysics->WindNoiseSeed = Node.WindNoiseSeed;
 
 	// BoneConstraint
 	KawaiiPhysics->BoneConstraintGlobalComplianceType = Node.BoneConstraintGlobalComplianceType;
 	KawaiiPhysics->BoneConstraintIterationCountBeforeCollision = Node.BoneConstraintIterationCountBeforeCollision;
 	KawaiiPhysics->BoneConstraintIterationCountAfterCollision = Node.BoneConstraintIterationCountAfterCollision;
+	KawaiiPhysics->BoneConstraintSolver = Node.BoneConstraintSolver;
 	KawaiiPhysics->bAutoAddChildDummyBoneConstraint = Node.bAutoAddChildDummyBoneConstraint;
 	KawaiiPhysics->BoneConstraints = Node.BoneConstraints;
 	KawaiiPhysics->BoneConstraintsDataAsset = Node.BoneConstraintsDataAsset;
 
+	// Warm up
+	KawaiiPhysics->WarmUpFramesPerEvaluation = Node.WarmUpFramesPerEvaluation;
+	KawaiiPhysics->RestStateDataAsset = Node.RestStateDataAsset;
+
+	// Optimization
+	KawaiiPhysics->bUseBatchedSimulation = Node.bUseBatchedSimulation;
+	KawaiiPhysics->bUseSharedContext = Node.bUseSharedContext;
+	KawaiiPhysics->LODSettings = Node.LODSettings;
+	KawaiiPhysics->SleepSettings = Node.SleepSettings;
+
 	// Reset for sync without compile
 	KawaiiPhysics->ModifyBones.Empty();
+	KawaiiPhysics->bBoneReferencesDirty = true;
 }
 
 void UAnimGraphNode_KawaiiPhysics::CustomizeDetailTools(IDetailLayoutBuilder& DetailBuilder)
@@ -209,6 +229,44 @@ void UAnimGraphNode_KawaiiPhysics::CustomizeDetailTools(IDetailLayoutBuilder& De
 				.Text(FText::FromString(TEXT("Export BoneConstraints")))
 			]
 		]
+		+ SUniformGridPanel::Slot(2, 0)
+		[
+			SNew(SButton)
+			.HAlign(HAlign_Center)
+			.VAlign(VAlign_Center)
+			.OnClicked_Lambda([this]()
+			{
+				this->ExportRestStateDataAsset();
+				return FReply::Handled();
+			})
+			.Content()
+			[
+				SNew(STextBlock)
+				.Text(FText::FromString(TEXT("Export Rest State")))
+			]
+		]
+		+ SUniformGridPanel::Slot(0, 1)
+		[
+			SNew(SButton)
+			.HAlign(HAlign_Center)
+			.VAlign(VAlign_Center)
+			.OnClicked_Lambda([this]()
+			{
+				this->RecordBakedMotionDataAsset();
+				return FReply::Handled();
+			})
+			.Content()
+			[
+				SNew(STextBlock)
+				.Text_Lambda([this]()
+				{
+					const FAnimNode_KawaiiPhysics* RuntimeNode = this->GetDebuggedRuntimeNode();
+					return FText::FromString(RuntimeNode && RuntimeNode->IsRecordingBakedMotion()
+						                         ? TEXT("Stop Recording")
+						                         : TEXT("Record Baked Motion"));
+				})
+			]
+		]
 	];
 }
 
@@ -468,6 +526,7 @@ void UAnimGraphNode_KawaiiPhysics::CustomizeDetails(IDetailLayoutBuilder& Detail
 		// Other
 		SafeSetOrder(FName("World Collision"));
 		SafeSetOrder(FName("ExternalForce"));
+		SafeSetOrder(FName("Optimization"));
 
 		// AnimNode
 		SafeSetOrder(FName("Tag"));
@@ -668,4 +727,164 @@ void UAnimGraphNode_KawaiiPhysics::ExportBoneConstraintsDataAsset()
 	}
 }
 
+void UAnimGraphNode_KawaiiPhysics::ExportRestStateDataAsset()
+{
+	// The settled state lives in the node instance being debugged, not in the graph node
+	const UAnimInstance* InstanceBeingDebugged = Cast<UAnimInstance>(GetAnimBlueprint()->GetObjectBeingDebugged());
+	USkeletalMeshComponent* Component = InstanceBeingDebugged ? InstanceBeingDebugged->GetSkelMeshComponent() : nullptr;
+	const FAnimNode_KawaiiPhysics* RuntimeNode =
+		Component ? FindDebugAnimNode<FAnimNode_KawaiiPhysics>(Component) : nullptr;
+
+	FKawaiiPhysicsRestStateSnapshot Snapshot;
+	if (!RuntimeNode || !RuntimeNode->CaptureRestState(InstanceBeingDebugged->CurrentSkeleton, Snapshot))
+	{
+		FNotificationInfo NotificationInfo(
+			LOCTEXT("ExportRestStateFailed", "No simulated node to capture the rest state from"));
+		NotificationInfo.ExpireDuration = 5.0f;
+		FSlateNotificationManager::Get().AddNotification(NotificationInfo);
+		return;
+	}
+
+	// Add to the asset the node already uses
+	if (UKawaiiPhysicsRestStateDataAsset* DataAsset = Node.RestStateDataAsset)
+	{
+		DataAsset->Modify();
+		DataAsset->AddSnapshot(Snapshot);
+		DataAsset->MarkPackageDirty();
+
+		FText NotificationText = FText::Format(
+			LOCTEXT("AddedRestStateSnapshot", "Added Rest State to Data Asset: {0}"),
+			FText::FromString(DataAsset->GetName()));
+		ShowExportAssetNotification(DataAsset, NotificationText);
+		return;
+	}
+
+	FString AssetName;
+	UPackage* Package = CreateDataAssetPackage(
+		TEXT("Choose Location for Rest State Data Asset"), TEXT("_RestState"), AssetName);
+	if (!Package)
+	{
+		return;
+	}
+
+	if (UKawaiiPhysicsRestStateDataAsset* NewDataAsset =
+		NewObject<UKawaiiPhysicsRestStateDataAsset>(Package, UKawaiiPhysicsRestStateDataAsset::StaticClass(),
+		                                            FName(AssetName), RF_Public | RF_Standalone))
+	{
+		NewDataAsset->AddSnapshot(Snapshot);
+
+		// select new asset
+		USelection* SelectionSet = GEditor->GetSelectedObjects();
+		SelectionSet->DeselectAll();
+		SelectionSet->Select(NewDataAsset);
+
+		FAssetRegistryModule::AssetCreated(NewDataAsset);
+		Package->MarkPackageDirty();
+
+		// Add Notification
+		FText NotificationText = FText::Format(
+			LOCTEXT("ExportedRestStateDataAsset", "Exported Rest State Data Asset: {0}"),
+			FText::FromString(AssetName));
+		ShowExportAssetNotification(NewDataAsset, NotificationText);
+	}
+}
+
+FAnimNode_KawaiiPhysics* UAnimGraphNode_KawaiiPhysics::GetDebuggedRuntimeNode(const USkeleton** OutSkeleton) const
+{
+	const UAnimBlueprint* AnimBlueprint = GetAnimBlueprint();
+	const UAnimInstance* InstanceBeingDebugged =
+		AnimBlueprint ? Cast<UAnimInstance>(AnimBlueprint->GetObjectBeingDebugged()) : nullptr;
+	USkeletalMeshComponent* Component = InstanceBeingDebugged ? InstanceBeingDebugged->GetSkelMeshComponent() : nullptr;
+	if (OutSkeleton)
+	{
+		*OutSkeleton = InstanceBeingDebugged ? InstanceBeingDebugged->CurrentSkeleton.Get() : nullptr;
+	}
+	return Component ? FindDebugAnimNode<FAnimNode_KawaiiPhysics>(Component) : nullptr;
+}
+
+void UAnimGraphNode_KawaiiPhysics::RecordBakedMotionDataAsset()
+{
+	// The motion is recorded by the node instance being debugged, while the preview plays a looping clip
+	const USkeleton* Skeleton = nullptr;
+	FAnimNode_KawaiiPhysics* RuntimeNode = GetDebuggedRuntimeNode(&Skeleton);
+	if (!RuntimeNode)
+	{
+		FNotificationInfo NotificationInfo(
+			LOCTEXT("RecordBakedMotionFailed", "No simulated node to record the baked motion from"));
+		NotificationInfo.ExpireDuration = 5.0f;
+		FSlateNotificationManager::Get().AddNotification(NotificationInfo);
+		return;
+	}
+
+	if (!RuntimeNode->IsRecordingBakedMotion())
+	{
+		RuntimeNode->StartBakedMotionRecording();
+		FNotificationInfo NotificationInfo(
+			LOCTEXT("RecordingBakedMotion",
+			        "Recording Baked Motion. Play a looping clip and stop after a whole number of loops"));
+		NotificationInfo.ExpireDuration = 5.0f;
+		FSlateNotificationManager::Get().AddNotification(NotificationInfo);
+		return;
+	}
+
+	UKawaiiPhysicsBakedMotionDataAsset* DataAsset = Node.LODSettings.FrozenBakedMotion;
+	const float SampleRate = (DataAsset
+		                          ? DataAsset
+		                          : GetDefault<UKawaiiPhysicsBakedMotionDataAsset>())->BakeSampleRate;
+	FKawaiiPhysicsBakedMotionClip Clip;
+	if (!RuntimeNode->StopBakedMotionRecording(Skeleton, SampleRate, Clip))
+	{
+		FNotificationInfo NotificationInfo(
+			LOCTEXT("BakeBakedMotionFailed", "Nothing was recorded. The node must simulate while recording"));
+		NotificationInfo.ExpireDuration = 5.0f;
+		FSlateNotificationManager::Get().AddNotification(NotificationInfo);
+		return;
+	}
+
+	// Add to the asset the node already uses
+	if (DataAsset)
+	{
+		Clip.Name = *FString::Printf(TEXT("Clip%d"), DataAsset->Clips.Num());
+		DataAsset->Modify();
+		DataAsset->Clips.Add(Clip);
+		DataAsset->MarkPackageDirty();
+
+		FText NotificationText = FText::Format(
+			LOCTEXT("AddedBakedMotionClip", "Added Baked Motion to Data Asset: {0}"),
+			FText::FromString(DataAsset->GetName()));
+		ShowExportAssetNotification(DataAsset, NotificationText);
+		return;
+	}
+
+	FString AssetName;
+	UPackage* Package = CreateDataAssetPackage(
+		TEXT("Choose Location for Baked Motion Data Asset"), TEXT("_BakedMotion"), AssetName);
+	if (!Package)
+	{
+		return;
+	}
+
+	if (UKawaiiPhysicsBakedMotionDataAsset* NewDataAsset =
+		NewObject<UKawaiiPhysicsBakedMotionDataAsset>(Package, UKawaiiPhysicsBakedMotionDataAsset::StaticClass(),
+		                                              FName(AssetName), RF_Public | RF_Standalone))
+	{
+		Clip.Name = TEXT("Clip0");
+		NewDataAsset->Clips.Add(Clip);
+
+		// select new asset
+		USelection* SelectionSet = GEditor->GetSelectedObjects();
+		SelectionSet->DeselectAll();
+		SelectionSet->Select(NewDataAsset);
+
+		FAssetRegistryModule::AssetCreated(NewDataAsset);
+		Package->MarkPackageDirty();
+
+		// Add Notification
+		FText NotificationText = FText::Format(
+			LOCTEXT("ExportedBakedMotionDataAsset", "Exported Baked Motion Data Asset: {0}"),
+			FText::FromString(AssetName));
+		ShowExportAssetNotification(NewDataAsset, NotificationText);
+	}
+}
+
 #undef LOCTEXT_NAMESPACE
@@ -0,0 +1,555 @@
+// KawaiiPhysics : Copyright (c) 2019-2024 pafuhana1213, MIT License
+
+#include "KawaiiPhysicsBenchmarkCommandlet.h"
+
+#include "AnimNode_KawaiiPhysics.h"
+#include "Animation/AnimInstanceProxy.h"
+#include "Animation/Skeleton.h"
+#include "Engine/SkeletalMesh.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/StrongObjectPtr.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogKawaiiPhysicsBenchmark, Log, All);
+
+namespace
+{
+	/** Gives the benchmark access to the node internals */
+	struct FKawaiiPhysicsBenchmarkNode : FAnimNode_KawaiiPhysics
+	{
+		using FAnimNode_KawaiiPhysics::ModifyBones;
+		using FAnimNode_KawaiiPhysics::SolverState;
+		using FAnimNode_KawaiiPhysics::PackedLimits;
+		using FAnimNode_KawaiiPhysics::DeltaTime;
+		using FAnimNode_KawaiiPhysics::DeltaTimeOld;
+		using FAnimNode_KawaiiPhysics::PreSkelCompTransform;
+		using FAnimNode_KawaiiPhysics::WindSamples;
+		using FAnimNode_KawaiiPhysics::NumWindSamples;
+		using FAnimNode_KawaiiPhysics::EvaluationStats;
+		using FAnimNode_KawaiiPhysics::bRecordEvaluationStats;
+		using FAnimNode_KawaiiPhysics::BuildModifyBoneIndexMap;
+		using FAnimNode_KawaiiPhysics::InitBoneConstraints;
+		using FAnimNode_KawaiiPhysics::UpdateSkelCompMove;
+		using FAnimNode_KawaiiPhysics::UpdateModifyBonesPoseTransform;
+		using FAnimNode_KawaiiPhysics::SimulateModifyBones;
+		using FAnimNode_KawaiiPhysics::ApplySimulateResult;
+	};
+
+	/**
+	 * Phases of EvaluateSkeletalControl_AnyThread, which itself needs a mesh component and a world.
+	 * Except for the pose update, they are timed by the node in its evaluation stats.
+	 */
+	enum class EBenchmarkPhase : uint8
+	{
+		UpdatePose,
+		Simulate,
+		Collision,
+		BoneConstraints,
+		ApplySimulateResult,
+		Num
+	};
+
+	const TCHAR* PhaseNames[] = {
+		TEXT("UpdatePose"), TEXT("Simulate"), TEXT("Collision"), TEXT("BoneConstraints"), TEXT("ApplySimulateResult")
+	};
+	static_assert(UE_ARRAY_COUNT(PhaseNames) == static_cast<int32>(EBenchmarkPhase::Num));
+
+	struct FBenchmarkScenario
+	{
+		FString Name;
+		int32 NumChains = 1;
+		int32 NumBonesPerChain = 8;
+		int32 NumSpheres = 0;
+		int32 NumCapsules = 0;
+
+		/** Spacing of the bones along a chain */
+		float BoneLength = 5.0f;
+
+		/** Distance of the chain roots from the center */
+		float RootRadius = 10.0f;
+
+		/** Connect the bones of neighbouring chains with bone constraints (closed ring) */
+		bool bRingConstraints = false;
+
+		/** Add a floor plane below the chains */
+		bool bFloor = false;
+
+		/** Unique key of the configuration in the golden data */
+		FString GetKey(int32 NumFrames, EKawaiiPhysicsBoneConstraintSolver Solver) const
+		{
+			return FString::Printf(TEXT("%s Chains=%d Bones=%d Spheres=%d Capsules=%d Frames=%d Solver=%s"), *Name,
+			                       NumChains, NumBonesPerChain, NumSpheres, NumCapsules, NumFrames,
+			                       *StaticEnum<EKawaiiPhysicsBoneConstraintSolver>()->GetNameStringByValue(
+				                       static_cast<int64>(Solver)));
+		}
+	};
+
+	struct FBenchmarkResult
+	{
+		FString Key;
+		int32 NumBones = 0;
+		int32 NumFrames = 0;
+		uint64 PhaseCycles[static_cast<int32>(EBenchmarkPhase::Num)] = {};
+
+		/** Final simulated location and rotation of each bone */
+		TArray<FVector> Locations;
+		TArray<FQuat> Rotations;
+	};
+
+	FBenchmarkScenario MakeScenario(const FString& Name)
+	{
+		FBenchmarkScenario Scenario;
+		Scenario.Name = Name;
+		if (Name == TEXT("Hair"))
+		{
+			Scenario.NumChains = 32;
+			Scenario.NumBonesPerChain = 6;
+			Scenario.NumSpheres = 1;
+			Scenario.BoneLength = 3.0f;
+			Scenario.RootRadius = 10.0f;
+		}
+		else if (Name == TEXT("Skirt"))
+		{
+			Scenario.NumChains = 16;
+			Scenario.NumBonesPerChain = 8;
+			Scenario.NumCapsules = 2;
+			Scenario.BoneLength = 6.0f;
+			Scenario.RootRadius = 15.0f;
+			Scenario.bRingConstraints = true;
+		}
+		else
+		{
+			Scenario.NumChains = 1;
+			Scenario.NumBonesPerChain = 24;
+			Scenario.NumCapsules = 1;
+			Scenario.BoneLength = 4.0f;
+			Scenario.RootRadius = 0.0f;
+			Scenario.bFloor = true;
+		}
+		return Scenario;
+	}
+
+	FName MakeBoneName(int32 Chain, int32 Bone)
+	{
+		return FName(*FString::Printf(TEXT("KawaiiBenchmark_%d"), Chain), Bone + 1);
+	}
+
+	void BuildModifyBones(FKawaiiPhysicsBenchmarkNode& Node, const FBenchmarkScenario& Scenario)
+	{
+		// Chains hang down from a ring of roots, parent-first
+		for (int32 Chain = 0; Chain < Scenario.NumChains; ++Chain)
+		{
+			const float Angle = 2.0f * PI * Chain / Scenario.NumChains;
+			const FVector Outward(FMath::Cos(Angle), FMath::Sin(Angle), 0.0f);
+			const FVector RootLocation = FVector(0.0f, 0.0f, 150.0f) + Outward * Scenario.RootRadius;
+			const FVector Direction = (FVector(0.0f, 0.0f, -1.0f) + Outward * 0.3f).GetSafeNormal();
+
+			for (int32 Bone = 0; Bone < Scenario.NumBonesPerChain; ++Bone)
+			{
+				const int32 Index = Node.ModifyBones.Num();
+				FKawaiiPhysicsModifyBone& ModifyBone = Node.ModifyBones.AddDefaulted_GetRef();
+				ModifyBone.BoneRef = FBoneReference(MakeBoneName(Chain, Bone));
+				ModifyBone.Index = Index;
+				ModifyBone.ParentIndex = Bone == 0 ? INDEX_NONE : Index - 1;
+				if (Bone + 1 < Scenario.NumBonesPerChain)
+				{
+					ModifyBone.ChildIndices.Add(Index + 1);
+				}
+				ModifyBone.PoseLocation = RootLocation + Direction * Scenario.BoneLength * Bone;
+				ModifyBone.PoseRotation = FQuat::FindBetweenNormals(FVector::XAxisVector, Direction);
+				ModifyBone.Location = ModifyBone.PoseLocation;
+				ModifyBone.PrevLocation = ModifyBone.PoseLocation;
+				ModifyBone.PrevRotation = ModifyBone.PoseRotation;
+				ModifyBone.LengthFromRoot = Scenario.BoneLength * Bone;
+				ModifyBone.LengthRateFromRoot = Scenario.NumBonesPerChain > 1
+					                                ? static_cast<float>(Bone) / (Scenario.NumBonesPerChain - 1)
+					                                : 0.0f;
+				ModifyBone.PhysicsSettings.Radius = Scenario.BoneLength * 0.5f;
+			}
+		}
+	}
+
+	/**
+	 * Builds a transient skeletal mesh whose reference pose is the pose of the modify bones.
+	 * Bone 0 is a root at the component origin, followed by the modify bones in order.
+	 */
+	TStrongObjectPtr<USkeletalMesh> BuildSkeletalMesh(const TArray<FKawaiiPhysicsModifyBone>& ModifyBones)
+	{
+		TStrongObjectPtr<USkeletalMesh> Mesh(NewObject<USkeletalMesh>(GetTransientPackage()));
+		USkeleton* Skeleton = NewObject<USkeleton>(GetTransientPackage());
+		{
+			FReferenceSkeletonModifier Modifier(Mesh->GetRefSkeleton(), Skeleton);
+			const FName RootName(TEXT("KawaiiBenchmark_Root"));
+			Modifier.Add(FMeshBoneInfo(RootName, RootName.ToString(), INDEX_NONE), FTransform::Identity);
+			for (const FKawaiiPhysicsModifyBone& ModifyBone : ModifyBones)
+			{
+				const FTransform PoseTransform(ModifyBone.PoseRotation, ModifyBone.PoseLocation);
+				FTransform LocalTransform = PoseTransform;
+				if (ModifyBone.ParentIndex >= 0)
+				{
+					const FKawaiiPhysicsModifyBone& Parent = ModifyBones[ModifyBone.ParentIndex];
+					LocalTransform = PoseTransform.GetRelativeTransform(
+						FTransform(Parent.PoseRotation, Parent.PoseLocation));
+				}
+				const FName BoneName = ModifyBone.BoneRef.BoneName;
+				Modifier.Add(FMeshBoneInfo(BoneName, BoneName.ToString(), ModifyBone.ParentIndex + 1), LocalTransform);
+			}
+		}
+		Skeleton->MergeAllBonesToBoneTree(Mesh.Get(), false);
+		Mesh->SetSkeleton(Skeleton);
+		return Mesh;
+	}
+
+	void FinishNode(FKawaiiPhysicsBenchmarkNode& Node, const FBenchmarkScenario& Scenario,
+	                const FBoneContainer& BoneContainer)
+	{
+		for (FKawaiiPhysicsModifyBone& ModifyBone : Node.ModifyBones)
+		{
+			ModifyBone.BoneRef.Initialize(BoneContainer);
+		}
+
+		// Ring of constraints between neighbouring chains
+		if (Scenario.bRingConstraints && Scenario.NumChains > 1)
+		{
+			for (int32 Chain = 0; Chain < Scenario.NumChains; ++Chain)
+			{
+				for (int32 Bone = 1; Bone < Scenario.NumBonesPerChain; ++Bone)
+				{
+					FModifyBoneConstraint& Constraint = Node.BoneConstraints.AddDefaulted_GetRef();
+					Constraint.Bone1 = FBoneReference(MakeBoneName(Chain, Bone));
+					Constraint.Bone2 = FBoneReference(MakeBoneName((Chain + 1) % Scenario.NumChains, Bone));
+				}
+			}
+		}
+
+		// Limits are placed deterministically around the chains
+		for (int32 i = 0; i < Scenario.NumSpheres; ++i)
+		{
+			FSphericalLimit& Sphere = Node.SphericalLimits.AddDefaulted_GetRef();
+			Sphere.Location = FVector(0.0f, 0.0f, 150.0f - 8.0f * i);
+			Sphere.Radius = Scenario.RootRadius * 0.9f;
+		}
+		for (int32 i = 0; i < Scenario.NumCapsules; ++i)
+		{
+			FCapsuleLimit& Capsule = Node.CapsuleLimits.AddDefaulted_GetRef();
+			const float Side = i % 2 == 0 ? 1.0f : -1.0f;
+			Capsule.Location = FVector(0.0f, Side * (5.0f + 2.0f * (i / 2)), 120.0f);
+			Capsule.Radius = 6.0f;
+			Capsule.Length = 60.0f;
+		}
+		if (Scenario.bFloor)
+		{
+			FPlanarLimit& Floor = Node.PlanarLimits.AddDefaulted_GetRef();
+			Floor.Location = FVector(0.0f, 0.0f, 100.0f);
+			Floor.Plane = FPlane(Floor.Location, FVector::UpVector);
+		}
+
+		Node.SolverState.Build(Node.ModifyBones);
+		Node.BuildModifyBoneIndexMap();
+		Node.InitBoneConstraints();
+		Node.PackedLimits.Build(Node.SphericalLimits, {}, Node.CapsuleLimits, {}, Node.BoxLimits, {},
+		                        Node.PlanarLimits, {}, Node.DistanceFieldLimits);
+	}
+
+	/** Component transform of the scripted root motion : walk in a circle, teleport half way */
+	FTransform GetScriptedComponentTransform(int32 Frame, int32 NumFrames)
+	{
+		const float Time = Frame / 60.0f;
+		const float Angle = Time * 1.5f;
+		FVector Location(FMath::Cos(Angle) * 200.0f, FMath::Sin(Angle) * 200.0f, 0.0f);
+		if (Frame >= NumFrames / 2)
+		{
+			Location.X += 1000.0f;
+		}
+		const FQuat Rotation(FVector::UpVector, Angle + HALF_PI);
+		return FTransform(Rotation, Location);
+	}
+
+	FBenchmarkResult RunScenario(const FBenchmarkScenario& Scenario, int32 NumFrames,
+	                             EKawaiiPhysicsBoneConstraintSolver Solver)
+	{
+		FKawaiiPhysicsBenchmarkNode Node;
+		Node.Gravity = FVector(0.0f, 0.0f, -980.0f);
+		Node.BoneConstraintSolver = Solver;
+		BuildModifyBones(Node, Scenario);
+
+		// The wind is set directly instead of being sampled from the world, without gusts
+		Node.bEnableWind = true;
+		Node.WindGustFrequency = 0.0f;
+		Node.NumWindSamples = 1;
+
+		// A real bone container and pose, so that the node reads and writes bones like in a game
+		const TStrongObjectPtr<USkeletalMesh> Mesh = BuildSkeletalMesh(Node.ModifyBones);
+		TArray<FBoneIndexType> RequiredBoneIndices;
+		for (int32 i = 0; i < Mesh->GetRefSkeleton().GetNum(); ++i)
+		{
+			RequiredBoneIndices.Add(static_cast<FBoneIndexType>(i));
+		}
+		FAnimInstanceProxy AnimInstanceProxy;
+		AnimInstanceProxy.GetRequiredBones().InitializeTo(RequiredBoneIndices, UE::Anim::FCurveFilterSettings(),
+		                                                  *Mesh);
+		const FBoneContainer& BoneContainer = AnimInstanceProxy.GetRequiredBones();
+		FinishNode(Node, Scenario, BoneContainer);
+
+		FComponentSpacePoseContext Output(&AnimInstanceProxy);
+		Output.ResetToRefPose();
+
+		FBenchmarkResult Result;
+		Result.Key = Scenario.GetKey(NumFrames, Solver);
+		Result.NumBones = Node.ModifyBones.Num();
+		Result.NumFrames = NumFrames;
+
+		constexpr float FixedDeltaTime = 1.0f / 60.0f;
+		Node.DeltaTimeOld = FixedDeltaTime;
+		Node.PreSkelCompTransform = GetScriptedComponentTransform(0, NumFrames);
+
+		// Seeded so that every run sees the same gusts
+		FRandomStream WindStream(0x4B415741);
+		TArray<FBoneTransform> BoneTransforms;
+		BoneTransforms.Reserve(Node.ModifyBones.Num());
+
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			const FTransform ComponentTransform = GetScriptedComponentTransform(Frame, NumFrames);
+			Node.DeltaTime = FixedDeltaTime;
+			Node.UpdateSkelCompMove(ComponentTransform);
+
+			Node.WindSamples[0] = ComponentTransform.InverseTransformVector(
+				FVector(1.0f, 0.0f, 0.0f) * (0.05f + 0.03f * FMath::Sin(Frame * 0.1f)) + WindStream.GetUnitVector() *
+				0.01f);
+
+			Node.bRecordEvaluationStats = true;
+			Node.EvaluationStats = FKawaiiPhysicsEvaluationStats();
+
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			Node.UpdateModifyBonesPoseTransform(Output, BoneContainer);
+			Result.PhaseCycles[static_cast<int32>(EBenchmarkPhase::UpdatePose)] += FPlatformTime::Cycles64() -
+				StartCycles;
+
+			Node.SimulateModifyBones(Output, ComponentTransform);
+
+			BoneTransforms.Reset();
+			Node.ApplySimulateResult(BoneContainer, BoneTransforms);
+
+			const FKawaiiPhysicsEvaluationStats& Stats = Node.EvaluationStats;
+			Result.PhaseCycles[static_cast<int32>(EBenchmarkPhase::Simulate)] += Stats.SimulateCycles;
+			Result.PhaseCycles[static_cast<int32>(EBenchmarkPhase::Collision)] += Stats.CollisionCycles;
+			Result.PhaseCycles[static_cast<int32>(EBenchmarkPhase::BoneConstraints)] += Stats.BoneConstraintCycles;
+			Result.PhaseCycles[static_cast<int32>(EBenchmarkPhase::ApplySimulateResult)] +=
+				Stats.ApplySimulateResultCycles;
+		}
+
+		Result.Locations = Node.SolverState.Locations;
+		Result.Rotations = Node.SolverState.PrevRotations;
+		return Result;
+	}
+
+	/** Golden data : a "[Key]" line per configuration, followed by "X Y Z QX QY QZ QW" per bone */
+	TMap<FString, TArray<FString>> LoadGolden(const FString& Path)
+	{
+		TMap<FString, TArray<FString>> Sections;
+		TArray<FString> Lines;
+		if (!FFileHelper::LoadFileToStringArray(Lines, *Path))
+		{
+			return Sections;
+		}
+
+		TArray<FString>* Section = nullptr;
+		for (const FString& Line : Lines)
+		{
+			if (Line.StartsWith(TEXT("[")) && Line.EndsWith(TEXT("]")))
+			{
+				Section = &Sections.Add(Line.Mid(1, Line.Len() - 2));
+			}
+			else if (Section && !Line.IsEmpty())
+			{
+				Section->Add(Line);
+			}
+		}
+		return Sections;
+	}
+
+	void AppendGolden(FString& OutText, const FBenchmarkResult& Result)
+	{
+		OutText += FString::Printf(TEXT("[%s]\n"), *Result.Key);
+		for (int32 i = 0; i < Result.Locations.Num(); ++i)
+		{
+			const FVector& L = Result.Locations[i];
+			const FQuat& Q = Result.Rotations[i];
+			OutText += FString::Printf(TEXT("%.6f %.6f %.6f %.6f %.6f %.6f %.6f\n"), L.X, L.Y, L.Z, Q.X, Q.Y, Q.Z,
+			                           Q.W);
+		}
+	}
+
+	bool CompareGolden(const FBenchmarkResult& Result, const TArray<FString>& Golden, float Tolerance)
+	{
+		if (Golden.Num() != Result.Locations.Num())
+		{
+			UE_LOG(LogKawaiiPhysicsBenchmark, Error, TEXT("%s : golden data has %d bones, simulated %d"),
+			       *Result.Key, Golden.Num(), Result.Locations.Num());
+			return false;
+		}
+
+		float MaxLocationError = 0.0f;
+		float MaxRotationError = 0.0f;
+		for (int32 i = 0; i < Golden.Num(); ++i)
+		{
+			TArray<FString> Values;
+			Golden[i].ParseIntoArrayWS(Values);
+			if (Values.Num() != 7)
+			{
+				UE_LOG(LogKawaiiPhysicsBenchmark, Error, TEXT("%s : malformed golden data for bone %d"),
+				       *Result.Key, i);
+				return false;
+			}
+
+			const FVector GoldenLocation(FCString::Atod(*Values[0]), FCString::Atod(*Values[1]),
+			                             FCString::Atod(*Values[2]));
+			const FQuat GoldenRotation(FCString::Atod(*Values[3]), FCString::Atod(*Values[4]),
+			                           FCString::Atod(*Values[5]), FCString::Atod(*Values[6]));
+			MaxLocationError = FMath::Max(MaxLocationError, FVector::Dist(GoldenLocation, Result.Locations[i]));
+			MaxRotationError = FMath::Max(MaxRotationError,
+			                              FMath::RadiansToDegrees(
+				                              GoldenRotation.AngularDistance(Result.Rotations[i])));
+		}
+
+		// Rotations are compared in degrees with the same tolerance
+		const bool bMatch = MaxLocationError <= Tolerance && MaxRotationError <= Tolerance;
+		UE_LOG(LogKawaiiPhysicsBenchmark, Display, TEXT("%s : %s (max location error %.6f, max rotation error %.6f)"),
+		       *Result.Key, bMatch ? TEXT("match") : TEXT("MISMATCH"), MaxLocationError, MaxRotationError);
+		return bMatch;
+	}
+}
+
+UKawaiiPhysicsBenchmarkCommandlet::UKawaiiPhysicsBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+	ShowErrorCount = true;
+}
+
+int32 UKawaiiPhysicsBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString ScenarioName = TEXT("All");
+	FParse::Value(*Params, TEXT("Scenario="), ScenarioName);
+
+	TArray<FBenchmarkScenario> Scenarios;
+	for (const TCHAR* Name : {TEXT("Hair"), TEXT("Skirt"), TEXT("Tail")})
+	{
+		if (ScenarioName == TEXT("All") || ScenarioName == Name)
+		{
+			Scenarios.Add(MakeScenario(Name));
+		}
+	}
+	if (Scenarios.IsEmpty())
+	{
+		UE_LOG(LogKawaiiPhysicsBenchmark, Error, TEXT("Unknown scenario %s. Use Hair, Skirt, Tail or All"),
+		       *ScenarioName);
+		return 1;
+	}
+
+	for (FBenchmarkScenario& Scenario : Scenarios)
+	{
+		FParse::Value(*Params, TEXT("Chains="), Scenario.NumChains);
+		FParse::Value(*Params, TEXT("Bones="), Scenario.NumBonesPerChain);
+		FParse::Value(*Params, TEXT("Spheres="), Scenario.NumSpheres);
+		FParse::Value(*Params, TEXT("Capsules="), Scenario.NumCapsules);
+		Scenario.NumChains = FMath::Max(Scenario.NumChains, 1);
+		Scenario.NumBonesPerChain = FMath::Max(Scenario.NumBonesPerChain, 2);
+		Scenario.NumSpheres = FMath::Max(Scenario.NumSpheres, 0);
+		Scenario.NumCapsules = FMath::Max(Scenario.NumCapsules, 0);
+	}
+
+	int32 NumFrames = 600;
+	FParse::Value(*Params, TEXT("Frames="), NumFrames);
+	NumFrames = FMath::Max(NumFrames, 1);
+
+	EKawaiiPhysicsBoneConstraintSolver Solver = EKawaiiPhysicsBoneConstraintSolver::GaussSeidel;
+	FString SolverName;
+	if (FParse::Value(*Params, TEXT("Solver="), SolverName))
+	{
+		const int64 Value = StaticEnum<EKawaiiPhysicsBoneConstraintSolver>()->GetValueByNameString(SolverName);
+		if (Value == INDEX_NONE)
+		{
+			UE_LOG(LogKawaiiPhysicsBenchmark, Error, TEXT("Unknown solver %s"), *SolverName);
+			return 1;
+		}
+		Solver = static_cast<EKawaiiPhysicsBoneConstraintSolver>(Value);
+	}
+
+	FString GoldenPath;
+	const bool bHasGolden = FParse::Value(*Params, TEXT("Golden="), GoldenPath);
+	const bool bWriteGolden = FParse::Param(*Params, TEXT("WriteGolden"));
+	float Tolerance = 0.01f;
+	FParse::Value(*Params, TEXT("Tolerance="), Tolerance);
+
+	TArray<FBenchmarkResult> Results;
+	for (const FBenchmarkScenario& Scenario : Scenarios)
+	{
+		const FBenchmarkResult& Result = Results.Add_GetRef(RunScenario(Scenario, NumFrames, Solver));
+
+		FString Report = FString::Printf(TEXT("%s (%d bones) ns/bone/frame :"), *Result.Key, Result.NumBones);
+		const double BoneFrames = static_cast<double>(Result.NumBones) * Result.NumFrames;
+		for (int32 Phase = 0; Phase < static_cast<int32>(EBenchmarkPhase::Num); ++Phase)
+		{
+			Report += FString::Printf(TEXT(" %s %.1f"), PhaseNames[Phase],
+			                          FPlatformTime::ToSeconds64(Result.PhaseCycles[Phase]) * 1e9 / BoneFrames);
+		}
+		UE_LOG(LogKawaiiPhysicsBenchmark, Display, TEXT("%s"), *Report);
+	}
+
+	if (!bHasGolden)
+	{
+		return 0;
+	}
+
+	if (bWriteGolden)
+	{
+		// Keep the configurations that were not run this time
+		TMap<FString, TArray<FString>> Golden = LoadGolden(GoldenPath);
+		FString Text;
+		for (const FBenchmarkResult& Result : Results)
+		{
+			Golden.Remove(Result.Key);
+			AppendGolden(Text, Result);
+		}
+		for (const TPair<FString, TArray<FString>>& Section : Golden)
+		{
+			Text += FString::Printf(TEXT("[%s]\n%s\n"), *Section.Key, *FString::Join(Section.Value, TEXT("\n")));
+		}
+
+		if (!FFileHelper::SaveStringToFile(Text, *GoldenPath))
+		{
+			UE_LOG(LogKawaiiPhysicsBenchmark, Error, TEXT("Failed to write golden data to %s"), *GoldenPath);
+			return 1;
+		}
+		UE_LOG(LogKawaiiPhysicsBenchmark, Display, TEXT("Wrote golden data to %s"), *GoldenPath);
+		return 0;
+	}
+
+	if (!FPaths::FileExists(GoldenPath))
+	{
+		UE_LOG(LogKawaiiPhysicsBenchmark, Warning,
+		       TEXT("No golden data at %s, skipping the comparison. Run with -WriteGolden to create it"),
+		       *GoldenPath);
+		return 0;
+	}
+
+	const TMap<FString, TArray<FString>> Golden = LoadGolden(GoldenPath);
+	bool bAllMatch = true;
+	for (const FBenchmarkResult& Result : Results)
+	{
+		if (const TArray<FString>* Section = Golden.Find(Result.Key))
+		{
+			bAllMatch &= CompareGolden(Result, *Section, Tolerance);
+		}
+		else
+		{
+			UE_LOG(LogKawaiiPhysicsBenchmark, Error, TEXT("%s : no golden data in %s"), *Result.Key, *GoldenPath);
+			bAllMatch = false;
+		}
+	}
+	return bAllMatch ? 0 : 1;
+}
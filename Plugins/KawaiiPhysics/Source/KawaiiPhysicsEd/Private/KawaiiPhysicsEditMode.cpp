@@ -62,7 +62,7 @@ void FKawaiiPhysicsEditMode::EnterMode(UAnimGraphNode_Base* InEditorNode, FAnimN
 	GraphNode->Node.BoxLimitsData = RuntimeNode->BoxLimitsData;
 	GraphNode->Node.PlanarLimitsData = RuntimeNode->PlanarLimitsData;
 	GraphNode->Node.BoneConstraintsData = RuntimeNode->BoneConstraintsData;
-	GraphNode->Node.MergedBoneConstraints = RuntimeNode->MergedBoneConstraints;
+	GraphNode->Node.MergedBoneConstraints = TArray<FModifyBoneConstraint>(RuntimeNode->GetMergedBoneConstraints());
 
 	NodePropertyDelegateHandle = GraphNode->OnNodePropertyChanged().AddSP(
 		this, &FKawaiiPhysicsEditMode::OnExternalNodePropertyChange);
@@ -104,6 +104,9 @@ void FKawaiiPhysicsEditMode::Render(const FSceneView* View, FViewport* Viewport,
 	if (SkelMeshComp && SkelMeshComp->GetSkeletalMeshAsset() && SkelMeshComp->GetSkeletalMeshAsset()->GetSkeleton() &&
 		FAnimWeight::IsRelevant(RuntimeNode->GetAlpha() && RuntimeNode->IsRecentlyEvaluated()))
 	{
+		// ModifyBones is only a view of the solver state, so bring it up to date before drawing
+		RuntimeNode->SyncModifyBonesView();
+
 		RenderModifyBones(PDI);
 		RenderLimitAngle(PDI);
 		RenderSphericalLimits(PDI);
@@ -374,7 +377,7 @@ void FKawaiiPhysicsEditMode::RenderBoneConstraint(FPrimitiveDrawInterface* PDI)
 {
 	if (GraphNode->bEnableDebugDrawBoneConstraint)
 	{
-		for (const FModifyBoneConstraint& BoneConstraint : RuntimeNode->MergedBoneConstraints)
+		for (const FModifyBoneConstraint& BoneConstraint : RuntimeNode->GetMergedBoneConstraints())
 		{
 			if (BoneConstraint.IsBoneReferenceValid() && !RuntimeNode->ModifyBones.IsEmpty())
 			{
@@ -540,6 +543,7 @@ bool FKawaiiPhysicsEditMode::InputKey(FEditorViewportClient* InViewportClient, F
 				{
 					RuntimeNode->LimitsDataAsset->SphericalLimits.RemoveAt(SelectCollisionIndex);
 					RuntimeNode->LimitsDataAsset->MarkPackageDirty();
+					RuntimeNode->LimitsDataAsset->IncrementRevision();
 				}
 				else
 				{
@@ -552,6 +556,7 @@ bool FKawaiiPhysicsEditMode::InputKey(FEditorViewportClient* InViewportClient, F
 				{
 					RuntimeNode->LimitsDataAsset->CapsuleLimits.RemoveAt(SelectCollisionIndex);
 					RuntimeNode->LimitsDataAsset->MarkPackageDirty();
+					RuntimeNode->LimitsDataAsset->IncrementRevision();
 				}
 				else
 				{
@@ -564,6 +569,7 @@ bool FKawaiiPhysicsEditMode::InputKey(FEditorViewportClient* InViewportClient, F
 				{
 					RuntimeNode->LimitsDataAsset->BoxLimits.RemoveAt(SelectCollisionIndex);
 					RuntimeNode->LimitsDataAsset->MarkPackageDirty();
+					RuntimeNode->LimitsDataAsset->IncrementRevision();
 				}
 				else
 				{
@@ -577,6 +583,7 @@ bool FKawaiiPhysicsEditMode::InputKey(FEditorViewportClient* InViewportClient, F
 				{
 					RuntimeNode->LimitsDataAsset->PlanarLimits.RemoveAt(SelectCollisionIndex);
 					RuntimeNode->LimitsDataAsset->MarkPackageDirty();
+					RuntimeNode->LimitsDataAsset->IncrementRevision();
 				}
 				else
 				{
@@ -967,12 +974,31 @@ void FKawaiiPhysicsEditMode::DrawHUD(FEditorViewportClient* ViewportClient, FVie
 	}
 	DrawTextItem(FText::FromString(CollisionDebugInfo), Canvas, XOffset, DrawPositionY, FontHeight);
 
+	if (!RuntimeNode->GetMergedBoneConstraints().IsEmpty())
+	{
+		const FKawaiiPhysicsBoneConstraintMetrics& Metrics = RuntimeNode->GetBoneConstraintMetrics();
+		const FString BoneConstraintDebugInfo = FString::Printf(
+			TEXT("Bone Constraint : %s (%d colors) Error RMS %.3f -> %.3f, Max %.3f"),
+			*StaticEnum<EKawaiiPhysicsBoneConstraintSolver>()->GetNameStringByValue(
+				static_cast<int64>(RuntimeNode->BoneConstraintSolver)),
+			Metrics.NumColors, Metrics.InitialRMSError, Metrics.FinalRMSError, Metrics.FinalMaxError);
+		DrawTextItem(FText::FromString(BoneConstraintDebugInfo), Canvas, XOffset, DrawPositionY, FontHeight);
+	}
+
+	if (RuntimeNode->SleepSettings.bEnable)
+	{
+		DrawTextItem(FText::FromString(FString::Printf(TEXT("Sleep : %d / %d chains dormant"),
+		                                               RuntimeNode->GetNumDormantChains(),
+		                                               RuntimeNode->GetNumSleepChains())),
+		             Canvas, XOffset, DrawPositionY, FontHeight);
+	}
+
 	const UDebugSkelMeshComponent* PreviewMeshComponent = GetAnimPreviewScene().GetPreviewMeshComponent();
 	if (GraphNode->bEnableDebugBoneLengthRate)
 	{
 		if (PreviewMeshComponent != nullptr && PreviewMeshComponent->MeshObject != nullptr)
 		{
-			for (auto& Bone : RuntimeNode->ModifyBones)
+			for (auto& Bone : RuntimeNode->GetModifyBones())
 			{
 				// Refer to FAnimationViewportClient::ShowBoneNames
 				const FVector BonePos = PreviewMeshComponent->GetComponentTransform().TransformPosition(Bone.Location);
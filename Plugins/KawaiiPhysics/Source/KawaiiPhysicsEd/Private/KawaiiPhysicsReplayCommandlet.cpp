@@ -0,0 +1,249 @@
+// KawaiiPhysics : Copyright (c) 2019-2024 pafuhana1213, MIT License
+
+#include "KawaiiPhysicsReplayCommandlet.h"
+
+#include "KawaiiPhysicsCapture.h"
+#include "KawaiiPhysicsSolver.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogKawaiiPhysicsReplay, Log, All);
+
+namespace
+{
+	enum class EReplayPhase : uint8
+	{
+		Simulate,
+		Collision,
+		Constraints,
+		Finish,
+		Num
+	};
+
+	const TCHAR* PhaseNames[] = {TEXT("Simulate"), TEXT("Collision"), TEXT("Constraints"), TEXT("Finish")};
+	static_assert(UE_ARRAY_COUNT(PhaseNames) == static_cast<int32>(EReplayPhase::Num));
+
+	struct FReplayOptions
+	{
+		TOptional<EKawaiiPhysicsBoneConstraintSolver> Solver;
+		bool bScalarCollision = false;
+	};
+
+	struct FReplayResult
+	{
+		int64 NumBoneSteps = 0;
+		uint64 PhaseCycles[static_cast<int32>(EReplayPhase::Num)] = {};
+
+		/** Largest distance of the replayed locations from the captured ones, and the first step beyond tolerance */
+		float MaxError = 0.0f;
+		int32 MaxErrorStep = INDEX_NONE;
+		int32 FirstDivergentStep = INDEX_NONE;
+	};
+
+	/** Bone constraints of the current keyframe, colored again if the replay uses another solver */
+	struct FReplayConstraints
+	{
+		TArray<FModifyBoneConstraint> Constraints;
+		TArray<int32> ColorStarts;
+
+		void Reset(const FKawaiiPhysicsCaptureKeyframe& Keyframe, const FReplayOptions& Options)
+		{
+			Constraints = Keyframe.Constraints;
+			ColorStarts = Keyframe.ConstraintColorStarts;
+			const bool bColor = Options.Solver.IsSet() &&
+				Options.Solver.GetValue() == EKawaiiPhysicsBoneConstraintSolver::GraphColored;
+			if (bColor && ColorStarts.IsEmpty())
+			{
+				KawaiiPhysicsSolver::ColorBoneConstraints(Constraints, Keyframe.State.Num(), ColorStarts);
+			}
+		}
+	};
+
+	FReplayResult Replay(const FKawaiiPhysicsCapture& Capture, const FReplayOptions& Options, float Tolerance)
+	{
+		FReplayResult Result;
+		FKawaiiPhysicsSolverState State;
+		FReplayConstraints Constraints;
+		TArray<int32> SimulatedBoneIndices;
+
+		for (int32 StepIndex = 0; StepIndex < Capture.Steps.Num(); ++StepIndex)
+		{
+			const FKawaiiPhysicsCaptureStep& Step = Capture.Steps[StepIndex];
+			if (Step.KeyframeIndex != INDEX_NONE)
+			{
+				const FKawaiiPhysicsCaptureKeyframe& Keyframe = Capture.Keyframes[Step.KeyframeIndex];
+				State = Keyframe.State;
+				Constraints.Reset(Keyframe, Options);
+			}
+			if (Step.PoseLocations.Num() != State.Num())
+			{
+				UE_LOG(LogKawaiiPhysicsReplay, Error, TEXT("Step %d has %d bones, the state has %d"), StepIndex,
+				       Step.PoseLocations.Num(), State.Num());
+				Result.FirstDivergentStep = StepIndex;
+				return Result;
+			}
+
+			State.PoseLocations = Step.PoseLocations;
+			State.PoseRotations = Step.PoseRotations;
+			FKawaiiPhysicsSolverParams Params = Step.Params;
+			if (Options.Solver.IsSet())
+			{
+				Params.BoneConstraintSolver = Options.Solver.GetValue();
+			}
+
+			uint64 StartCycles = FPlatformTime::Cycles64();
+			auto EndPhase = [&Result, &StartCycles](EReplayPhase Phase)
+			{
+				const uint64 EndCycles = FPlatformTime::Cycles64();
+				Result.PhaseCycles[static_cast<int32>(Phase)] += EndCycles - StartCycles;
+				StartCycles = EndCycles;
+			};
+
+			// Dormant chains were already removed from the captured bones
+			KawaiiPhysicsSolver::PrepareStep(State, SimulatedBoneIndices);
+			SimulatedBoneIndices = Step.SimulatedBoneIndices;
+			KawaiiPhysicsSolver::MarkDormantBones(State, SimulatedBoneIndices);
+			const float Exponent = Params.GetExponent();
+			for (const int32 Index : SimulatedBoneIndices)
+			{
+				KawaiiPhysicsSolver::Integrate(State, Index, Params,
+				                               Step.WindVelocities.IsEmpty() ? nullptr : &Step.WindVelocities[Index]);
+				if (!Step.ExternalForceOffsets.IsEmpty())
+				{
+					State.Locations[Index] += Step.ExternalForceOffsets[Index];
+				}
+				KawaiiPhysicsSolver::PullToPose(State, Index, Exponent);
+			}
+			EndPhase(EReplayPhase::Simulate);
+
+			if (Options.bScalarCollision)
+			{
+				Step.Limits.AdjustBonesScalar(State, SimulatedBoneIndices);
+			}
+			else
+			{
+				Step.Limits.AdjustBones(State, SimulatedBoneIndices);
+			}
+			if (!Step.WorldCollisionOffsets.IsEmpty())
+			{
+				for (const int32 Index : SimulatedBoneIndices)
+				{
+					State.Locations[Index] += Step.WorldCollisionOffsets[Index];
+				}
+			}
+			EndPhase(EReplayPhase::Collision);
+
+			KawaiiPhysicsSolver::SolveBoneConstraints(State, Constraints.Constraints, Params,
+			                                          Constraints.ColorStarts);
+			EndPhase(EReplayPhase::Constraints);
+
+			KawaiiPhysicsSolver::FinishStep(State, SimulatedBoneIndices, Params);
+			EndPhase(EReplayPhase::Finish);
+
+			Result.NumBoneSteps += SimulatedBoneIndices.Num();
+
+			float StepError = 0.0f;
+			for (int32 i = 0; i < State.Num(); ++i)
+			{
+				StepError = FMath::Max(StepError, FVector::Dist(State.Locations[i], Step.ResultLocations[i]));
+			}
+			if (StepError > Result.MaxError || FMath::IsNaN(StepError))
+			{
+				Result.MaxError = StepError;
+				Result.MaxErrorStep = StepIndex;
+			}
+			if (Result.FirstDivergentStep == INDEX_NONE && !(StepError <= Tolerance))
+			{
+				Result.FirstDivergentStep = StepIndex;
+			}
+		}
+
+		return Result;
+	}
+}
+
+UKawaiiPhysicsReplayCommandlet::UKawaiiPhysicsReplayCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+	ShowErrorCount = true;
+}
+
+int32 UKawaiiPhysicsReplayCommandlet::Main(const FString& Params)
+{
+	FString CapturePath;
+	if (!FParse::Value(*Params, TEXT("Capture="), CapturePath))
+	{
+		UE_LOG(LogKawaiiPhysicsReplay, Error, TEXT("Missing -Capture=<Path>"));
+		return 1;
+	}
+
+	FKawaiiPhysicsCapture Capture;
+	FString Error;
+	if (!Capture.Load(CapturePath, Error))
+	{
+		UE_LOG(LogKawaiiPhysicsReplay, Error, TEXT("%s"), *Error);
+		return 1;
+	}
+
+	FReplayOptions Options;
+	Options.bScalarCollision = FParse::Param(*Params, TEXT("Scalar"));
+	FString SolverName;
+	if (FParse::Value(*Params, TEXT("Solver="), SolverName))
+	{
+		const int64 Value = StaticEnum<EKawaiiPhysicsBoneConstraintSolver>()->GetValueByNameString(SolverName);
+		if (Value == INDEX_NONE)
+		{
+			UE_LOG(LogKawaiiPhysicsReplay, Error, TEXT("Unknown solver %s"), *SolverName);
+			return 1;
+		}
+		Options.Solver = static_cast<EKawaiiPhysicsBoneConstraintSolver>(Value);
+	}
+
+	int32 NumRepeats = 1;
+	FParse::Value(*Params, TEXT("Repeat="), NumRepeats);
+	NumRepeats = FMath::Max(NumRepeats, 1);
+	float Tolerance = 0.01f;
+	FParse::Value(*Params, TEXT("Tolerance="), Tolerance);
+
+	// Every repeat replays the same inputs, so only the timings are accumulated
+	FReplayResult Result = Replay(Capture, Options, Tolerance);
+	for (int32 Repeat = 1; Repeat < NumRepeats; ++Repeat)
+	{
+		const FReplayResult RepeatResult = Replay(Capture, Options, Tolerance);
+		for (int32 Phase = 0; Phase < static_cast<int32>(EReplayPhase::Num); ++Phase)
+		{
+			Result.PhaseCycles[Phase] += RepeatResult.PhaseCycles[Phase];
+		}
+		Result.NumBoneSteps += RepeatResult.NumBoneSteps;
+	}
+
+	FString Report = FString::Printf(TEXT("%s : %d steps, %d keyframes, ns/bone/step :"), *Capture.NodeName,
+	                                 Capture.Steps.Num(), Capture.Keyframes.Num());
+	const double BoneSteps = FMath::Max<double>(Result.NumBoneSteps, 1.0);
+	for (int32 Phase = 0; Phase < static_cast<int32>(EReplayPhase::Num); ++Phase)
+	{
+		Report += FString::Printf(TEXT(" %s %.1f"), PhaseNames[Phase],
+		                          FPlatformTime::ToSeconds64(Result.PhaseCycles[Phase]) * 1e9 / BoneSteps);
+	}
+	UE_LOG(LogKawaiiPhysicsReplay, Display, TEXT("%s"), *Report);
+
+	// Another solver or collision path is not expected to match the capture
+	if (Options.Solver.IsSet() || Options.bScalarCollision)
+	{
+		UE_LOG(LogKawaiiPhysicsReplay, Display, TEXT("Max difference from the capture %.6f at step %d"),
+		       Result.MaxError, Result.MaxErrorStep);
+		return 0;
+	}
+
+	if (Result.FirstDivergentStep != INDEX_NONE)
+	{
+		UE_LOG(LogKawaiiPhysicsReplay, Error,
+		       TEXT("MISMATCH : step %d differs from the capture by more than %.6f (max %.6f at step %d)"),
+		       Result.FirstDivergentStep, Tolerance, Result.MaxError, Result.MaxErrorStep);
+		return 1;
+	}
+	UE_LOG(LogKawaiiPhysicsReplay, Display, TEXT("match (max difference %.6f at step %d)"), Result.MaxError,
+	       Result.MaxErrorStep);
+	return 0;
+}
@@ -63,6 +63,15 @@ private:
 	/** Exports the bone constraints data asset. */
 	void ExportBoneConstraintsDataAsset();
 
+	/** Captures the settled state of the debugged node into the rest state data asset. */
+	void ExportRestStateDataAsset();
+
+	/** Gets the node instance being debugged, and the skeleton it is evaluated on. */
+	FAnimNode_KawaiiPhysics* GetDebuggedRuntimeNode(const USkeleton** OutSkeleton = nullptr) const;
+
+	/** Starts recording the debugged node, or bakes the recorded motion into the baked motion data asset. */
+	void RecordBakedMotionDataAsset();
+
 public:
 	/** Enables or disables debug drawing for bones. */
 	UPROPERTY()
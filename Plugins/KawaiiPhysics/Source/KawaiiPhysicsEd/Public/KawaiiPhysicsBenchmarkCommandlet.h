@@ -0,0 +1,32 @@
+// KawaiiPhysics : Copyright (c) 2019-2024 pafuhana1213, MIT License
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+
+#include "KawaiiPhysicsBenchmarkCommandlet.generated.h"
+
+/**
+ * Headless, deterministic benchmark and regression check of FAnimNode_KawaiiPhysics.
+ * Builds synthetic hair, skirt and tail chains on a transient skeletal mesh, drives them through scripted root motion,
+ * a teleport and wind without a world or renderer, and reports the time per bone per frame of each phase the node runs
+ * when evaluated (pose update, simulation, collision, bone constraints and writing the bone transforms). The final
+ * poses can be written to or compared against golden data. The comparison is skipped if the golden file does not
+ * exist.
+ *
+ * Usage : UnrealEditor-Cmd <Project> -run=KawaiiPhysicsBenchmark -nullrhi -unattended
+ *         [-Scenario=Hair|Skirt|Tail|All] [-Chains=N] [-Bones=N] [-Spheres=N] [-Capsules=N] [-Frames=N]
+ *         [-Solver=GaussSeidel|GraphColored|Jacobi] [-Golden=<Path> [-WriteGolden] [-Tolerance=0.01]]
+ *
+ * Returns non-zero if the poses do not match the golden data, or a configuration is missing from it.
+ */
+UCLASS()
+class UKawaiiPhysicsBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UKawaiiPhysicsBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
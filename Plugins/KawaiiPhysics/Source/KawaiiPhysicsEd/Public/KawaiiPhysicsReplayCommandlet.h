@@ -0,0 +1,30 @@
+// KawaiiPhysics : Copyright (c) 2019-2024 pafuhana1213, MIT License
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+
+#include "KawaiiPhysicsReplayCommandlet.generated.h"
+
+/**
+ * Headless, deterministic replay of a KawaiiPhysics capture (see KawaiiPhysicsCapture.h).
+ * Feeds the captured inputs back through the solver without a world, a character or a renderer, reports the time per
+ * bone per step of each phase, and compares the result of each step against the captured one. The first step that
+ * differs tells where a regression starts, and the return code makes it usable with git bisect.
+ *
+ * Usage : UnrealEditor-Cmd <Project> -run=KawaiiPhysicsReplay -nullrhi -unattended -Capture=<Path>
+ *         [-Repeat=N] [-Solver=GaussSeidel|GraphColored|Jacobi] [-Scalar] [-Tolerance=0.01]
+ *
+ * -Solver replays with another bone constraint solver and -Scalar with the scalar collision, to compare their cost.
+ * Returns non-zero if the capture cannot be loaded, or if a step differs from the capture by more than the tolerance.
+ */
+UCLASS()
+class UKawaiiPhysicsReplayCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UKawaiiPhysicsReplayCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};